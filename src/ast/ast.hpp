@@ -1,6 +1,11 @@
 #pragma once
 
+#include "support/arena.hpp"
+#include "support/casting.hpp"
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
+#include <new>
 #include <string>
 #include <utility>
 #include <vector>
@@ -9,34 +14,141 @@ namespace frontend::ast {
 
 class ASTVisitor;
 
+/// Owned children of a node. Lists of nodes built in an Arena must use it
+/// as their resource, so the array is released along with the nodes.
+template <typename T> using NodeList = std::pmr::vector<std::unique_ptr<T>>;
+
+/// What a node is, kept in every node so classifying one is a byte
+/// compare (see support/casting.hpp). One per concrete class of the
+/// pointer AST, except that number literals are either of two kinds; the
+/// flat and green trees use the same kinds. Expressions, statements and
+/// declarations are each one contiguous range.
+enum class NodeKind : std::uint8_t {
+	INT_LITERAL,
+	FLOAT_LITERAL,
+	STRING_LITERAL,
+	CHAR_LITERAL,
+	BOOL_LITERAL,
+	UNARY,
+	BINARY,
+	TERNARY,
+	VARIABLE,
+	CALL,
+
+	BLOCK,
+	RETURN,
+	BREAK,
+	CONTINUE,
+	ASSIGNMENT,
+	IF,
+	FOR,
+	WHILE,
+	DO,
+	ERROR_STMT,
+	DECL_STMT,
+
+	VAR_DECL,
+	FUNCTION,
+	STRUCT,
+	NAMESPACE,
+	ERROR_DECL,
+	PROGRAM,
+};
+
 // Base Class
 class ASTNode {
+	NodeKind kind;
+	// storage belongs to an Arena, which frees it in bulk
+	bool inArena = false;
+
+	template <typename T, typename... Args>
+	friend std::unique_ptr<T> makeNode(Arena *arena, Args &&...args);
+
 public:
 	virtual ~ASTNode() = default;
 
 	ASTNode(const ASTNode &) = delete;
 	ASTNode &operator=(const ASTNode &) = delete;
 
-	ASTNode(ASTNode &&) = default;
-	ASTNode &operator=(ASTNode &&) = default;
+	// where a node is stored is not part of its value
+	ASTNode(ASTNode &&other) noexcept : kind(other.kind) {}
+	ASTNode &operator=(ASTNode &&) noexcept { return *this; }
+
+	[[nodiscard]] NodeKind getKind() const noexcept { return kind; }
+
+	/// Deleting a node from an Arena, as its owning unique_ptr does, is a
+	/// no-op: the arena releases every node at once, so tearing down a
+	/// tree is not a chain of recursive destructor calls.
+	void operator delete(ASTNode *node, std::destroying_delete_t) {
+		if (node->inArena) {
+			return;
+		}
+		// reads the vtable's offset to the object, so needs no RTTI
+		void *storage = dynamic_cast<void *>(node);
+		node->~ASTNode();
+		::operator delete(storage);
+	}
 
 	virtual void accept(ASTVisitor &V) = 0;
 
 protected:
-	ASTNode() = default;
+	explicit ASTNode(NodeKind kind) : kind(kind) {}
 };
 
+/// Whether a node of type T can own memory outside its arena (strings,
+/// types, prototypes), so the arena has to run its destructor before
+/// releasing it. Node kinds whose members all live in the arena opt out
+/// next to their definitions.
+template <typename T> inline constexpr bool needsFinalizer = true;
+
+/// Constructs a node in `arena`, or on the heap when `arena` is null.
+template <typename T, typename... Args>
+std::unique_ptr<T> makeNode(Arena *arena, Args &&...args) {
+	if (arena == nullptr) {
+		return std::make_unique<T>(std::forward<Args>(args)...);
+	}
+	void *storage = arena->allocate(sizeof(T), alignof(T));
+	T *node = ::new (storage) T(std::forward<Args>(args)...);
+	static_cast<ASTNode *>(node)->inArena = true;
+	if constexpr (needsFinalizer<T>) {
+		arena->finalize(node);
+	}
+	return std::unique_ptr<T>(node);
+}
+
 // Expressions
 class ExprAST : public ASTNode {
+public:
+	static bool classof(const ASTNode *node) {
+		return node->getKind() <= NodeKind::CALL;
+	}
+
 protected:
-	ExprAST() = default;
+	using ASTNode::ASTNode;
 };
 
 // Statements
-class StmtAST : public ASTNode {};
+class StmtAST : public ASTNode {
+public:
+	static bool classof(const ASTNode *node) {
+		return node->getKind() >= NodeKind::BLOCK &&
+		       node->getKind() <= NodeKind::DECL_STMT;
+	}
+
+protected:
+	using ASTNode::ASTNode;
+};
 
 // Declarations
-class DeclAST : public ASTNode {};
+class DeclAST : public ASTNode {
+public:
+	static bool classof(const ASTNode *node) {
+		return node->getKind() >= NodeKind::VAR_DECL;
+	}
+
+protected:
+	using ASTNode::ASTNode;
+};
 
 /// A possibly namespace-qualified identifier, e.g. `math::vec::dot`.
 /// `qualifiers` holds the leading segments ({"math", "vec"}) and `name`
@@ -64,6 +176,8 @@ struct QualifiedName {
 		out += name;
 		return out;
 	}
+
+	bool operator==(const QualifiedName &) const = default;
 };
 
 } // namespace frontend::ast
@@ -1,52 +1,71 @@
 #include "ast/decl.hpp"
 #include "ast/ast.hpp"
 #include "stmt.hpp"
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 
 namespace frontend::ast {
 DeclStmtAST::DeclStmtAST(std::unique_ptr<DeclAST> decl)
-    : decl(std::move(decl)) {}
+    : StmtAST(KIND), decl(std::move(decl)) {}
 
 VariableDeclarationAST::VariableDeclarationAST(
-    std::unique_ptr<types::Type> type, std::string name,
+    const types::Type *type, std::string name,
     std::unique_ptr<ExprAST> size, std::unique_ptr<ExprAST> init)
-    : type(std::move(type)), name(std::move(name)), size(std::move(size)),
-      initializer(std::move(init)) {}
+    : DeclAST(KIND), type(type), name(std::move(name)),
+      size(std::move(size)), initializer(std::move(init)) {}
 
 PrototypeAST::PrototypeAST(
     QualifiedName name,
-    std::vector<std::pair<std::unique_ptr<types::Type>, std::string>> params,
-    std::unique_ptr<types::Type> returnType)
+    std::vector<std::pair<const types::Type *, std::string>> params,
+    const types::Type *returnType)
     : name(std::move(name)), params(std::move(params)),
-      returnType(std::move(returnType)) {}
+      returnType(returnType) {}
 
 PrototypeAST::PrototypeAST(
     std::string name,
-    std::vector<std::pair<std::unique_ptr<types::Type>, std::string>> params,
-    std::unique_ptr<types::Type> returnType)
+    std::vector<std::pair<const types::Type *, std::string>> params,
+    const types::Type *returnType)
     : name(std::move(name)), params(std::move(params)),
-      returnType(std::move(returnType)) {}
+      returnType(returnType) {}
 
 FunctionAST::FunctionAST(std::unique_ptr<PrototypeAST> prototype,
 			 std::unique_ptr<BlockStmtAST> body)
-    : prototype(std::move(prototype)), body(std::move(body)) {}
+    : DeclAST(KIND), prototype(std::move(prototype)),
+      body(std::move(body)) {}
+
+FunctionAST::FunctionAST(std::unique_ptr<PrototypeAST> prototype,
+			 std::shared_ptr<const DeferredBodies> bodies,
+			 size_t open)
+    : DeclAST(KIND), prototype(std::move(prototype)),
+      deferred(std::move(bodies)), bodyToken(open) {}
+
+const std::unique_ptr<BlockStmtAST> &FunctionAST::getBody() const {
+	if (deferred != nullptr) {
+		body = deferred->parseBody(bodyToken);
+		deferred = nullptr;
+	}
+	return body;
+}
 
 FunctionAST::~FunctionAST() = default;
 FunctionAST::FunctionAST(FunctionAST &&) noexcept = default;
 FunctionAST &FunctionAST::operator=(FunctionAST &&) noexcept = default;
 
-StructAST::StructAST(
-    std::string name,
-    std::vector<std::unique_ptr<VariableDeclarationAST>> fields,
-    std::vector<std::unique_ptr<FunctionAST>> methods)
-    : name(std::move(name)), fields(std::move(fields)),
+StructAST::StructAST(std::string name, NodeList<VariableDeclarationAST> fields,
+		     NodeList<FunctionAST> methods)
+    : DeclAST(KIND), name(std::move(name)), fields(std::move(fields)),
       methods(std::move(methods)) {}
 
-NamespaceAST::NamespaceAST(std::string name,
-			   std::vector<std::unique_ptr<DeclAST>> declarations)
-    : name(std::move(name)), declarations(std::move(declarations)) {}
+NamespaceAST::NamespaceAST(std::string name, NodeList<DeclAST> declarations)
+    : DeclAST(KIND), name(std::move(name)),
+      declarations(std::move(declarations)) {}
+
+ErrorDeclAST::ErrorDeclAST(uint32_t begin, uint32_t end)
+    : DeclAST(KIND), begin(begin), end(end) {}
 
-ProgramAST::ProgramAST(std::vector<std::unique_ptr<DeclAST>> declarations)
-    : declarations(std::move(declarations)) {}
+ProgramAST::ProgramAST(NodeList<DeclAST> declarations)
+    : DeclAST(KIND), declarations(std::move(declarations)) {}
 } // namespace frontend::ast
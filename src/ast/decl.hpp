@@ -3,6 +3,8 @@
 #include "../types/type.hpp"
 #include "ast.hpp"
 #include "visitor.hpp"
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -13,6 +15,8 @@ class DeclStmtAST : public StmtAST {
 	std::unique_ptr<DeclAST> decl;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::DECL_STMT;
+
 	explicit DeclStmtAST(std::unique_ptr<DeclAST> decl);
 	[[nodiscard]] DeclAST *getDecl() const { return decl.get(); }
 	void accept(ASTVisitor &v) override { v.visit(*this); }
@@ -20,19 +24,20 @@ public:
 
 // Variable Declaration
 class VariableDeclarationAST : public DeclAST {
-	std::unique_ptr<types::Type> type;
+	const types::Type *type; // owned by its TypeContext
 	std::string name;
 	std::unique_ptr<ExprAST> size; // array[length + 1]
 	std::unique_ptr<ExprAST> initializer;
 
 public:
-	VariableDeclarationAST(std::unique_ptr<types::Type> type,
-			       std::string name,
+	static constexpr NodeKind KIND = NodeKind::VAR_DECL;
+
+	VariableDeclarationAST(const types::Type *type, std::string name,
 			       std::unique_ptr<ExprAST> size = nullptr,
 			       std::unique_ptr<ExprAST> initializer = nullptr);
 
-	[[nodiscard]] types::Type *getType() const noexcept {
-		return type.get();
+	[[nodiscard]] const types::Type *getType() const noexcept {
+		return type;
 	}
 	[[nodiscard]] std::string getName() const noexcept { return name; }
 	[[nodiscard]] ExprAST *getInit() const { return initializer.get(); }
@@ -50,21 +55,18 @@ public:
 /// Captures: name, parameters with types, and return type
 class PrototypeAST {
 	QualifiedName name;
-	std::vector<std::pair<std::unique_ptr<types::Type>, std::string>>
-	    params;
-	std::unique_ptr<types::Type> returnType;
+	std::vector<std::pair<const types::Type *, std::string>> params;
+	const types::Type *returnType;
 
 public:
 	PrototypeAST(
 	    QualifiedName name,
-	    std::vector<std::pair<std::unique_ptr<types::Type>, std::string>>
-		params,
-	    std::unique_ptr<types::Type> returnType);
+	    std::vector<std::pair<const types::Type *, std::string>> params,
+	    const types::Type *returnType);
 	PrototypeAST(
 	    std::string name,
-	    std::vector<std::pair<std::unique_ptr<types::Type>, std::string>>
-		params,
-	    std::unique_ptr<types::Type> returnType);
+	    std::vector<std::pair<const types::Type *, std::string>> params,
+	    const types::Type *returnType);
 
 	[[nodiscard]] const std::string &getName() const { return name.name; }
 	[[nodiscard]] const QualifiedName &getQualifiedName() const noexcept {
@@ -72,17 +74,42 @@ public:
 	}
 	[[nodiscard]] const auto &getParams() const { return params; }
 	[[nodiscard]] const types::Type *getReturnType() const {
-		return returnType.get();
+		return returnType;
 	}
 };
 
+/// Where the function bodies a parse skipped are parsed from later; one
+/// per parse, shared by all of its functions.
+class DeferredBodies {
+public:
+	/// Parses the body whose '{' is token `open`; null if it does not
+	/// parse.
+	[[nodiscard]] virtual std::unique_ptr<BlockStmtAST>
+	parseBody(size_t open) const = 0;
+
+protected:
+	DeferredBodies() = default;
+	~DeferredBodies() = default;
+	DeferredBodies(const DeferredBodies &) = default;
+	DeferredBodies &operator=(const DeferredBodies &) = default;
+};
+
 class FunctionAST : public DeclAST {
 	std::unique_ptr<PrototypeAST> prototype;
-	std::unique_ptr<BlockStmtAST> body;
+	// a deferred body is parsed by getBody(), which is otherwise const
+	mutable std::unique_ptr<BlockStmtAST> body;
+	mutable std::shared_ptr<const DeferredBodies> deferred;
+	size_t bodyToken = 0; // the '{' of a deferred body
 
 public:
+	static constexpr NodeKind KIND = NodeKind::FUNCTION;
+
 	FunctionAST(std::unique_ptr<PrototypeAST> prototype,
 		    std::unique_ptr<BlockStmtAST> body);
+	/// A function whose body, from token `open`, is parsed by `bodies`
+	/// the first time it is requested.
+	FunctionAST(std::unique_ptr<PrototypeAST> prototype,
+		    std::shared_ptr<const DeferredBodies> bodies, size_t open);
 	// Defined in decl.cpp where BlockStmtAST is complete, so the
 	// unique_ptr<BlockStmtAST> destructor isn't instantiated here
 	~FunctionAST() override;
@@ -94,33 +121,33 @@ public:
 	[[nodiscard]] const PrototypeAST *getProto() const {
 		return prototype.get();
 	}
-	[[nodiscard]] const std::unique_ptr<BlockStmtAST> &getBody() const {
-		return body;
+	/// Parses a deferred body on the first call, reporting its errors
+	/// then; not safe to call from two threads at once.
+	[[nodiscard]] const std::unique_ptr<BlockStmtAST> &getBody() const;
+	[[nodiscard]] bool isBodyParsed() const noexcept {
+		return deferred == nullptr;
 	}
 	void accept(ASTVisitor &v) override { v.visit(*this); }
 };
 
 class StructAST : public DeclAST {
 	std::string name;
-	std::vector<std::unique_ptr<VariableDeclarationAST>> fields;
-	std::vector<std::unique_ptr<FunctionAST>> methods;
+	NodeList<VariableDeclarationAST> fields;
+	NodeList<FunctionAST> methods;
 
 public:
-	StructAST(std::string name,
-		  std::vector<std::unique_ptr<VariableDeclarationAST>> fields =
-		      std::vector<std::unique_ptr<VariableDeclarationAST>>{},
+	static constexpr NodeKind KIND = NodeKind::STRUCT;
 
-		  std::vector<std::unique_ptr<FunctionAST>> methods =
-		      std::vector<std::unique_ptr<FunctionAST>>{});
+	StructAST(std::string name,
+		  NodeList<VariableDeclarationAST> fields = {},
+		  NodeList<FunctionAST> methods = {});
 
 	[[nodiscard]] std::string getName() const { return name; }
-	[[nodiscard]] const std::vector<
-	    std::unique_ptr<VariableDeclarationAST>> &
+	[[nodiscard]] const NodeList<VariableDeclarationAST> &
 	getFields() const {
 		return fields;
 	}
-	[[nodiscard]] const std::vector<std::unique_ptr<FunctionAST>> &
-	getMethods() const {
+	[[nodiscard]] const NodeList<FunctionAST> &getMethods() const {
 		return methods;
 	}
 	void accept(ASTVisitor &v) override { v.visit(*this); }
@@ -128,30 +155,51 @@ public:
 
 class NamespaceAST : public DeclAST {
 	std::string name;
-	std::vector<std::unique_ptr<DeclAST>> declarations;
+	NodeList<DeclAST> declarations;
 
 public:
-	NamespaceAST(std::string name,
-		     std::vector<std::unique_ptr<DeclAST>> declarations);
+	static constexpr NodeKind KIND = NodeKind::NAMESPACE;
+
+	NamespaceAST(std::string name, NodeList<DeclAST> declarations);
 	[[nodiscard]] std::string getName() const { return name; }
-	[[nodiscard]] const std::vector<std::unique_ptr<DeclAST>> &
-	getDeclarations() const {
+	[[nodiscard]] const NodeList<DeclAST> &getDeclarations() const {
 		return declarations;
 	}
 	void accept(ASTVisitor &v) override { v.visit(*this); }
 };
 
+/// Placeholder for a declaration that did not parse, left by error recovery
+/// in place of everything up to the next one. Holds only the bytes
+/// [begin, end) of source it covers.
+class ErrorDeclAST : public DeclAST {
+	uint32_t begin;
+	uint32_t end;
+
+public:
+	static constexpr NodeKind KIND = NodeKind::ERROR_DECL;
+
+	ErrorDeclAST(uint32_t begin, uint32_t end);
+	[[nodiscard]] uint32_t getBegin() const noexcept { return begin; }
+	[[nodiscard]] uint32_t getEnd() const noexcept { return end; }
+	void accept(ASTVisitor &v) override { v.visit(*this); }
+};
+
 class ProgramAST : public DeclAST {
-	std::vector<std::unique_ptr<DeclAST>> declarations;
+	NodeList<DeclAST> declarations;
 
 public:
-	explicit ProgramAST(
-	    std::vector<std::unique_ptr<DeclAST>> declarations = {});
-	[[nodiscard]] const std::vector<std::unique_ptr<DeclAST>> &
-	getDeclarations() const {
+	static constexpr NodeKind KIND = NodeKind::PROGRAM;
+
+	explicit ProgramAST(NodeList<DeclAST> declarations = {});
+	[[nodiscard]] const NodeList<DeclAST> &getDeclarations() const {
 		return declarations;
 	}
 	void accept(ASTVisitor &v) override { v.visit(*this); }
 };
 
+// Only children and scalars, all in the arena with the node
+template <> inline constexpr bool needsFinalizer<DeclStmtAST> = false;
+template <> inline constexpr bool needsFinalizer<ErrorDeclAST> = false;
+template <> inline constexpr bool needsFinalizer<ProgramAST> = false;
+
 } // namespace frontend::ast
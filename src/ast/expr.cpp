@@ -3,32 +3,37 @@
 
 namespace frontend::ast {
 
-NumberLiteralAST::NumberLiteralAST(double val) : value(val) {}
+NumberLiteralAST::NumberLiteralAST(double val)
+    : ExprAST(NodeKind::FLOAT_LITERAL), floatValue(val) {}
 
-StringLiteralAST::StringLiteralAST(std::string val) : value(std::move(val)) {}
+StringLiteralAST::StringLiteralAST(std::string val)
+    : ExprAST(KIND), value(std::move(val)) {}
 
-CharLiteralAST::CharLiteralAST(const char &val) : value(val) {}
+CharLiteralAST::CharLiteralAST(const char &val)
+    : ExprAST(KIND), value(val) {}
 
-BoolLiteralAST::BoolLiteralAST(bool val) : value(val) {}
+BoolLiteralAST::BoolLiteralAST(bool val) : ExprAST(KIND), value(val) {}
 
 UnaryExprAST::UnaryExprAST(UnaryOp op, std::unique_ptr<ExprAST> operand)
-    : op(op), operand(std::move(operand)) {}
+    : ExprAST(KIND), op(op), operand(std::move(operand)) {}
 
 BinaryExprAST::BinaryExprAST(BinaryOp op, std::unique_ptr<ExprAST> lhs,
 			     std::unique_ptr<ExprAST> rhs)
-    : op(op), lhs(std::move(lhs)), rhs(std::move(rhs)) {}
+    : ExprAST(KIND), op(op), lhs(std::move(lhs)), rhs(std::move(rhs)) {}
 
 TernaryExprAST::TernaryExprAST(std::unique_ptr<ExprAST> condition,
 			       std::unique_ptr<ExprAST> thenBranch,
 			       std::unique_ptr<ExprAST> elseBranch)
-    : condition(std::move(condition)), thenBranch(std::move(thenBranch)),
-      elseBranch(std::move(elseBranch)) {}
+    : ExprAST(KIND), condition(std::move(condition)),
+      thenBranch(std::move(thenBranch)), elseBranch(std::move(elseBranch)) {}
 
-VariableExprAST::VariableExprAST(std::string name) : name(std::move(name)) {}
+VariableExprAST::VariableExprAST(std::string name)
+    : ExprAST(KIND), name(std::move(name)) {}
 
-VariableExprAST::VariableExprAST(QualifiedName name) : name(std::move(name)) {}
+VariableExprAST::VariableExprAST(QualifiedName name)
+    : ExprAST(KIND), name(std::move(name)) {}
 
 CallExprAST::CallExprAST(std::unique_ptr<ExprAST> callee,
-			 std::vector<std::unique_ptr<ExprAST>> args)
-    : callee(std::move(callee)), args(std::move(args)) {}
+			 NodeList<ExprAST> args)
+    : ExprAST(KIND), callee(std::move(callee)), args(std::move(args)) {}
 } // namespace frontend::ast
@@ -2,17 +2,48 @@
 
 #include <ast/ast.hpp>
 #include <ast/visitor.hpp>
+#include <cassert>
+#include <concepts>
 #include <cstdint>
 #include <memory>
 
 namespace frontend::ast {
 
+// Integer literals keep their exact value; only literals written with a
+// fraction are doubles
 class NumberLiteralAST : public ExprAST {
-	double value;
+	// which one is held is the node's kind
+	union {
+		int64_t intValue;
+		double floatValue;
+	};
 
 public:
+	static bool classof(const ASTNode *node) {
+		return node->getKind() == NodeKind::INT_LITERAL ||
+		       node->getKind() == NodeKind::FLOAT_LITERAL;
+	}
+
+	NumberLiteralAST(std::integral auto val)
+	    : ExprAST(NodeKind::INT_LITERAL),
+	      intValue(static_cast<int64_t>(val)) {}
 	NumberLiteralAST(double val);
-	[[nodiscard]] double getValue() const noexcept { return value; }
+
+	[[nodiscard]] bool isInteger() const noexcept {
+		return getKind() == NodeKind::INT_LITERAL;
+	}
+	[[nodiscard]] int64_t getIntValue() const noexcept {
+		assert(isInteger());
+		return intValue;
+	}
+	[[nodiscard]] double getFloatValue() const noexcept {
+		assert(!isInteger());
+		return floatValue;
+	}
+	// Either kind of value as a double
+	[[nodiscard]] double getValue() const noexcept {
+		return isInteger() ? static_cast<double>(intValue) : floatValue;
+	}
 	void accept(ASTVisitor &v) override { v.visit(*this); }
 };
 
@@ -20,6 +51,8 @@ class StringLiteralAST : public ExprAST {
 	std::string value;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::STRING_LITERAL;
+
 	StringLiteralAST(std::string value);
 	[[nodiscard]] std::string getValue() const { return value; };
 	void accept(ASTVisitor &v) override { v.visit(*this); }
@@ -29,6 +62,8 @@ class CharLiteralAST : public ExprAST {
 	char value;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::CHAR_LITERAL;
+
 	CharLiteralAST(const char &value);
 	[[nodiscard]] char getValue() const noexcept { return value; }
 	void accept(ASTVisitor &v) override { v.visit(*this); }
@@ -38,6 +73,8 @@ class BoolLiteralAST : public ExprAST {
 	bool value;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::BOOL_LITERAL;
+
 	BoolLiteralAST(bool value);
 	[[nodiscard]] bool getValue() const noexcept { return value; }
 	void accept(ASTVisitor &v) override { v.visit(*this); }
@@ -59,6 +96,8 @@ class UnaryExprAST : public ExprAST {
 	std::unique_ptr<ExprAST> operand;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::UNARY;
+
 	UnaryExprAST(UnaryOp op, std::unique_ptr<ExprAST> operand);
 	[[nodiscard]] UnaryOp getOperator() const noexcept { return op; }
 	[[nodiscard]] ExprAST *getOperand() const { return operand.get(); }
@@ -91,6 +130,8 @@ class BinaryExprAST : public ExprAST {
 	std::unique_ptr<ExprAST> lhs, rhs;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::BINARY;
+
 	BinaryExprAST(BinaryOp op, std::unique_ptr<ExprAST> lhs,
 		      std::unique_ptr<ExprAST> rhs);
 
@@ -104,6 +145,8 @@ class TernaryExprAST : public ExprAST {
 	std::unique_ptr<ExprAST> condition, thenBranch, elseBranch;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::TERNARY;
+
 	TernaryExprAST(std::unique_ptr<ExprAST> condition,
 		       std::unique_ptr<ExprAST> thenBranch,
 		       std::unique_ptr<ExprAST> elseBranch);
@@ -122,6 +165,8 @@ class VariableExprAST : public ExprAST {
 	QualifiedName name;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::VARIABLE;
+
 	VariableExprAST(std::string name);
 	VariableExprAST(QualifiedName name);
 	[[nodiscard]] std::string getName() const { return name.name; }
@@ -133,19 +178,26 @@ public:
 
 class CallExprAST : public ExprAST {
 	std::unique_ptr<ExprAST> callee;
-	std::vector<std::unique_ptr<ExprAST>> args;
+	NodeList<ExprAST> args;
 
 public:
-	CallExprAST(std::unique_ptr<ExprAST> callee,
-		    std::vector<std::unique_ptr<ExprAST>> args);
+	static constexpr NodeKind KIND = NodeKind::CALL;
+
+	CallExprAST(std::unique_ptr<ExprAST> callee, NodeList<ExprAST> args);
 	[[nodiscard]] ExprAST *getCallee() const noexcept {
 		return callee.get();
 	}
-	[[nodiscard]] const std::vector<std::unique_ptr<ExprAST>> &
-	getArgs() const {
-		return args;
-	}
+	[[nodiscard]] const NodeList<ExprAST> &getArgs() const { return args; }
 	void accept(ASTVisitor &v) override { v.visit(*this); }
 };
 
+// Only children and scalars, all in the arena with the node
+template <> inline constexpr bool needsFinalizer<NumberLiteralAST> = false;
+template <> inline constexpr bool needsFinalizer<CharLiteralAST> = false;
+template <> inline constexpr bool needsFinalizer<BoolLiteralAST> = false;
+template <> inline constexpr bool needsFinalizer<UnaryExprAST> = false;
+template <> inline constexpr bool needsFinalizer<BinaryExprAST> = false;
+template <> inline constexpr bool needsFinalizer<TernaryExprAST> = false;
+template <> inline constexpr bool needsFinalizer<CallExprAST> = false;
+
 } // namespace frontend::ast
@@ -0,0 +1,631 @@
+#include "flat_ast.hpp"
+#include "ast.hpp"
+#include "decl.hpp"
+#include "expr.hpp"
+#include "stmt.hpp"
+#include "support/arena.hpp"
+#include "types/type.hpp"
+#include "visitor.hpp"
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace frontend::ast {
+
+namespace {
+// Copies a pointer AST into a FlatAST, children first
+class Flattener : public ASTVisitor {
+	FlatAST &flat;
+	NodeID last = NO_NODE;
+
+	NodeID of(ASTNode *node) {
+		if (node == nullptr) {
+			return NO_NODE;
+		}
+		node->accept(*this);
+		return last;
+	}
+	template <typename T> std::vector<NodeID> of(const NodeList<T> &list) {
+		std::vector<NodeID> ids;
+		ids.reserve(list.size());
+		for (const auto &node : list) {
+			ids.push_back(of(node.get()));
+		}
+		return ids;
+	}
+
+public:
+	explicit Flattener(FlatAST &flat) : flat(flat) {}
+
+	NodeID append(ASTNode &node) { return of(&node); }
+
+	void visit(NumberLiteralAST &node) override {
+		last = node.isInteger()
+			   ? flat.intLiteral(node.getIntValue())
+			   : flat.floatLiteral(node.getFloatValue());
+	}
+	void visit(StringLiteralAST &node) override {
+		last = flat.stringLiteral(node.getValue());
+	}
+	void visit(CharLiteralAST &node) override {
+		last = flat.charLiteral(node.getValue());
+	}
+	void visit(BoolLiteralAST &node) override {
+		last = flat.boolLiteral(node.getValue());
+	}
+	void visit(UnaryExprAST &node) override {
+		NodeID operand = of(node.getOperand());
+		last = flat.unary(node.getOperator(), operand);
+	}
+	void visit(BinaryExprAST &node) override {
+		NodeID lhs = of(node.getLhs());
+		NodeID rhs = of(node.getRhs());
+		last = flat.binary(node.getOperator(), lhs, rhs);
+	}
+	void visit(TernaryExprAST &node) override {
+		NodeID condition = of(node.getCondition());
+		NodeID thenBranch = of(node.getThenBranch());
+		NodeID elseBranch = of(node.getElseBranch());
+		last = flat.ternary(condition, thenBranch, elseBranch);
+	}
+	void visit(VariableExprAST &node) override {
+		last = flat.variable(node.getQualifiedName());
+	}
+	void visit(CallExprAST &node) override {
+		NodeID callee = of(node.getCallee());
+		std::vector<NodeID> args = of(node.getArgs());
+		last = flat.call(callee, args);
+	}
+
+	void visit(BlockStmtAST &node) override {
+		last = flat.block(of(node.getStmts()));
+	}
+	void visit(ReturnStmtAST &node) override {
+		last = flat.returnStmt(of(node.getValue()));
+	}
+	void visit(BreakStmtAST &) override { last = flat.breakStmt(); }
+	void visit(ContinueStmtAST &) override {
+		last = flat.continueStmt();
+	}
+	void visit(AssignmentStmtAST &node) override {
+		NodeID value = of(node.getValue());
+		last = flat.assignment(node.getVariableName(),
+				       node.getOperator(), value);
+	}
+	void visit(IfStmtAST &node) override {
+		NodeID condition = of(node.getCondition());
+		NodeID thenBranch = of(node.getThenBranch());
+		NodeID elseBranch = of(node.getElseBranch());
+		last = flat.ifStmt(condition, thenBranch, elseBranch);
+	}
+	void visit(ForStmtAST &node) override {
+		NodeID init = of(node.getInit());
+		NodeID condition = of(node.getCondition());
+		NodeID update = of(node.getUpdate());
+		NodeID body = of(node.getBody());
+		last = flat.forStmt(init, condition, update, body);
+	}
+	void visit(WhileStmtAST &node) override {
+		NodeID condition = of(node.getCondition());
+		NodeID body = of(node.getBody());
+		last = flat.whileStmt(condition, body);
+	}
+	void visit(DoStmtAST &node) override {
+		NodeID body = of(node.getBody());
+		NodeID condition = of(node.getCondition());
+		last = flat.doStmt(body, condition);
+	}
+	void visit(ErrorStmtAST &node) override {
+		last = flat.errorStmt(node.getBegin(), node.getEnd());
+	}
+
+	void visit(DeclStmtAST &node) override {
+		last = flat.declStmt(of(node.getDecl()));
+	}
+	void visit(VariableDeclarationAST &node) override {
+		NodeID size = of(node.getArraySize());
+		NodeID init = of(node.getInit());
+		last = flat.varDecl(node.getType(), node.getName(), size, init);
+	}
+	void visit(FunctionAST &node) override {
+		NodeID body = of(node.getBody().get());
+		const PrototypeAST *proto = node.getProto();
+		last = flat.function(proto->getQualifiedName(),
+				     proto->getParams(), proto->getReturnType(),
+				     body);
+	}
+	void visit(StructAST &node) override {
+		std::vector<NodeID> fields = of(node.getFields());
+		std::vector<NodeID> methods = of(node.getMethods());
+		last = flat.structDecl(node.getName(), fields, methods);
+	}
+	void visit(NamespaceAST &node) override {
+		std::vector<NodeID> decls = of(node.getDeclarations());
+		last = flat.namespaceDecl(node.getName(), decls);
+	}
+	void visit(ErrorDeclAST &node) override {
+		last = flat.errorDecl(node.getBegin(), node.getEnd());
+	}
+	void visit(ProgramAST &node) override {
+		last = flat.program(of(node.getDeclarations()));
+	}
+};
+
+// Rebuilds pointer-AST nodes from a FlatAST
+class Inflater {
+	const FlatAST &flat;
+	Arena *arena;
+
+	template <typename T, typename... Args>
+	std::unique_ptr<T> make(Args &&...args) {
+		return makeNode<T>(arena, std::forward<Args>(args)...);
+	}
+	template <typename T> NodeList<T> list(std::span<const NodeID> ids) {
+		NodeList<T> result(arena != nullptr
+				       ? arena
+				       : std::pmr::get_default_resource());
+		result.reserve(ids.size());
+		for (NodeID id : ids) {
+			result.push_back(as<T>(id));
+		}
+		return result;
+	}
+	std::unique_ptr<FunctionAST> function(NodeID id) {
+		std::vector<std::pair<const types::Type *, std::string>>
+		    params;
+		for (size_t i = 0; i < flat.paramCount(id); i++) {
+			params.emplace_back(flat.paramType(id, i),
+					    flat.paramName(id, i));
+		}
+		auto proto = std::make_unique<PrototypeAST>(
+		    flat.name(id), std::move(params), flat.type(id));
+		return make<FunctionAST>(std::move(proto),
+					 as<BlockStmtAST>(flat.child(id, 0)));
+	}
+
+public:
+	Inflater(const FlatAST &flat, Arena *arena)
+	    : flat(flat), arena(arena) {}
+
+	template <typename T> std::unique_ptr<T> as(NodeID id) {
+		if (id == NO_NODE) {
+			return nullptr;
+		}
+		// the flat tree was built from, or like, a well-typed one
+		return std::unique_ptr<T>(static_cast<T *>(node(id).release()));
+	}
+
+	std::unique_ptr<ASTNode> node(NodeID id) {
+		const FlatNode &n = flat.node(id);
+		auto child = [&](size_t slot) { return flat.child(id, slot); };
+		switch (n.kind) {
+		case NodeKind::INT_LITERAL:
+			return make<NumberLiteralAST>(flat.intValue(id));
+		case NodeKind::FLOAT_LITERAL:
+			return make<NumberLiteralAST>(flat.floatValue(id));
+		case NodeKind::STRING_LITERAL:
+			return make<StringLiteralAST>(flat.text(id));
+		case NodeKind::CHAR_LITERAL:
+			return make<CharLiteralAST>(static_cast<char>(n.op));
+		case NodeKind::BOOL_LITERAL:
+			return make<BoolLiteralAST>(n.op != 0);
+		case NodeKind::UNARY:
+			return make<UnaryExprAST>(static_cast<UnaryOp>(n.op),
+						  as<ExprAST>(child(0)));
+		case NodeKind::BINARY:
+			return make<BinaryExprAST>(static_cast<BinaryOp>(n.op),
+						   as<ExprAST>(child(0)),
+						   as<ExprAST>(child(1)));
+		case NodeKind::TERNARY:
+			return make<TernaryExprAST>(as<ExprAST>(child(0)),
+						    as<ExprAST>(child(1)),
+						    as<ExprAST>(child(2)));
+		case NodeKind::VARIABLE:
+			return make<VariableExprAST>(flat.name(id));
+		case NodeKind::CALL:
+			return make<CallExprAST>(
+			    as<ExprAST>(child(0)),
+			    list<ExprAST>(flat.children(id)));
+
+		case NodeKind::BLOCK:
+			return make<BlockStmtAST>(
+			    list<StmtAST>(flat.children(id)));
+		case NodeKind::RETURN:
+			return make<ReturnStmtAST>(as<ExprAST>(child(0)));
+		case NodeKind::BREAK:
+			return make<BreakStmtAST>();
+		case NodeKind::CONTINUE:
+			return make<ContinueStmtAST>();
+		case NodeKind::ASSIGNMENT:
+			return make<AssignmentStmtAST>(
+			    flat.text(id), static_cast<AssignOp>(n.op),
+			    as<ExprAST>(child(0)));
+		case NodeKind::IF:
+			return make<IfStmtAST>(as<ExprAST>(child(0)),
+					       as<BlockStmtAST>(child(1)),
+					       as<BlockStmtAST>(child(2)));
+		case NodeKind::FOR:
+			return make<ForStmtAST>(as<StmtAST>(child(0)),
+						as<ExprAST>(child(1)),
+						as<ExprAST>(child(2)),
+						as<BlockStmtAST>(child(3)));
+		case NodeKind::WHILE:
+			return make<WhileStmtAST>(as<ExprAST>(child(0)),
+						  as<BlockStmtAST>(child(1)));
+		case NodeKind::DO:
+			return make<DoStmtAST>(as<BlockStmtAST>(child(0)),
+					       as<ExprAST>(child(1)));
+		case NodeKind::ERROR_STMT:
+			return make<ErrorStmtAST>(flat.skipped(id).first,
+						  flat.skipped(id).second);
+
+		case NodeKind::DECL_STMT:
+			return make<DeclStmtAST>(as<DeclAST>(child(0)));
+		case NodeKind::VAR_DECL:
+			return make<VariableDeclarationAST>(
+			    flat.type(id), flat.text(id),
+			    as<ExprAST>(child(0)), as<ExprAST>(child(1)));
+		case NodeKind::FUNCTION:
+			return function(id);
+		case NodeKind::STRUCT:
+			return make<StructAST>(
+			    flat.text(id),
+			    list<VariableDeclarationAST>(flat.fields(id)),
+			    list<FunctionAST>(flat.methods(id)));
+		case NodeKind::NAMESPACE:
+			return make<NamespaceAST>(
+			    flat.text(id), list<DeclAST>(flat.children(id)));
+		case NodeKind::ERROR_DECL:
+			return make<ErrorDeclAST>(flat.skipped(id).first,
+						  flat.skipped(id).second);
+		case NodeKind::PROGRAM:
+			return make<ProgramAST>(
+			    list<DeclAST>(flat.children(id)));
+		}
+		std::unreachable();
+	}
+};
+} // namespace
+
+NodeID FlatAST::add(NodeKind kind, uint8_t op, uint32_t a, uint32_t b,
+		    uint32_t c) {
+	// NO_NODE is never a valid ID
+	assert(nodeArray.size() < NO_NODE);
+	nodeArray.push_back({kind, op, {a, b, c}});
+	return static_cast<NodeID>(nodeArray.size() - 1);
+}
+
+uint32_t FlatAST::addList(std::span<const NodeID> ids) {
+	auto start = static_cast<uint32_t>(extra.size());
+	extra.insert(extra.end(), ids.begin(), ids.end());
+	return start;
+}
+
+uint32_t FlatAST::addString(std::string text) {
+	auto [it, added] = stringIDs.try_emplace(
+	    text, static_cast<uint32_t>(strings.size()));
+	if (added) {
+		strings.push_back(std::move(text));
+	}
+	return it->second;
+}
+
+uint32_t FlatAST::addName(QualifiedName name) {
+	auto [it, added] = nameIDs.try_emplace(
+	    name.str(), static_cast<uint32_t>(names.size()));
+	if (added) {
+		names.push_back(std::move(name));
+	}
+	return it->second;
+}
+
+uint32_t FlatAST::addType(const types::Type *type) {
+	typeTable.push_back(type);
+	return static_cast<uint32_t>(typeTable.size() - 1);
+}
+
+NodeID FlatAST::intLiteral(int64_t value) {
+	auto bits = static_cast<uint64_t>(value);
+	return add(NodeKind::INT_LITERAL, 0, static_cast<uint32_t>(bits),
+		   static_cast<uint32_t>(bits >> 32));
+}
+
+NodeID FlatAST::floatLiteral(double value) {
+	auto bits = std::bit_cast<uint64_t>(value);
+	return add(NodeKind::FLOAT_LITERAL, 0, static_cast<uint32_t>(bits),
+		   static_cast<uint32_t>(bits >> 32));
+}
+
+NodeID FlatAST::stringLiteral(std::string value) {
+	return add(NodeKind::STRING_LITERAL, 0, addString(std::move(value)));
+}
+
+NodeID FlatAST::charLiteral(char value) {
+	return add(NodeKind::CHAR_LITERAL, static_cast<uint8_t>(value));
+}
+
+NodeID FlatAST::boolLiteral(bool value) {
+	return add(NodeKind::BOOL_LITERAL, value ? 1 : 0);
+}
+
+NodeID FlatAST::unary(UnaryOp op, NodeID operand) {
+	return add(NodeKind::UNARY, static_cast<uint8_t>(op), operand);
+}
+
+NodeID FlatAST::binary(BinaryOp op, NodeID lhs, NodeID rhs) {
+	return add(NodeKind::BINARY, static_cast<uint8_t>(op), lhs, rhs);
+}
+
+NodeID FlatAST::ternary(NodeID condition, NodeID thenBranch,
+			NodeID elseBranch) {
+	return add(NodeKind::TERNARY, 0, condition, thenBranch, elseBranch);
+}
+
+NodeID FlatAST::variable(QualifiedName name) {
+	return add(NodeKind::VARIABLE, 0, addName(std::move(name)));
+}
+
+NodeID FlatAST::call(NodeID callee, std::span<const NodeID> args) {
+	return add(NodeKind::CALL, 0, callee, addList(args),
+		   static_cast<uint32_t>(args.size()));
+}
+
+NodeID FlatAST::block(std::span<const NodeID> statements) {
+	return add(NodeKind::BLOCK, 0, NO_NODE, addList(statements),
+		   static_cast<uint32_t>(statements.size()));
+}
+
+NodeID FlatAST::returnStmt(NodeID value) {
+	return add(NodeKind::RETURN, 0, value);
+}
+
+NodeID FlatAST::breakStmt() { return add(NodeKind::BREAK, 0); }
+
+NodeID FlatAST::continueStmt() { return add(NodeKind::CONTINUE, 0); }
+
+NodeID FlatAST::assignment(std::string variable, AssignOp op, NodeID value) {
+	return add(NodeKind::ASSIGNMENT, static_cast<uint8_t>(op), value,
+		   addString(std::move(variable)));
+}
+
+NodeID FlatAST::ifStmt(NodeID condition, NodeID thenBranch,
+		       NodeID elseBranch) {
+	return add(NodeKind::IF, 0, condition, thenBranch, elseBranch);
+}
+
+NodeID FlatAST::forStmt(NodeID init, NodeID condition, NodeID update,
+			NodeID body) {
+	std::array<NodeID, 2> rest{update, body};
+	return add(NodeKind::FOR, 0, init, condition, addList(rest));
+}
+
+NodeID FlatAST::whileStmt(NodeID condition, NodeID body) {
+	return add(NodeKind::WHILE, 0, condition, body);
+}
+
+NodeID FlatAST::doStmt(NodeID body, NodeID condition) {
+	return add(NodeKind::DO, 0, body, condition);
+}
+
+NodeID FlatAST::errorStmt(uint32_t begin, uint32_t end) {
+	return add(NodeKind::ERROR_STMT, 0, begin, end);
+}
+
+NodeID FlatAST::declStmt(NodeID decl) {
+	return add(NodeKind::DECL_STMT, 0, decl);
+}
+
+NodeID FlatAST::varDecl(const types::Type *type, std::string name,
+			NodeID size, NodeID init) {
+	std::array<uint32_t, 2> rest{addType(type),
+				     addString(std::move(name))};
+	return add(NodeKind::VAR_DECL, 0, size, init, addList(rest));
+}
+
+NodeID FlatAST::function(
+    QualifiedName name,
+    std::span<const std::pair<const types::Type *, std::string>> params,
+    const types::Type *returnType, NodeID body) {
+	std::vector<uint32_t> signature{addType(returnType),
+					static_cast<uint32_t>(params.size())};
+	for (const auto &[type, paramName] : params) {
+		signature.push_back(addType(type));
+		signature.push_back(addString(paramName));
+	}
+	return add(NodeKind::FUNCTION, 0, body, addName(std::move(name)),
+		   addList(signature));
+}
+
+NodeID FlatAST::structDecl(std::string name, std::span<const NodeID> fields,
+			   std::span<const NodeID> methods) {
+	std::array<uint32_t, 2> counts{static_cast<uint32_t>(fields.size()),
+				       static_cast<uint32_t>(methods.size())};
+	uint32_t start = addList(counts);
+	addList(fields);
+	addList(methods);
+	return add(NodeKind::STRUCT, 0, addString(std::move(name)), start);
+}
+
+NodeID FlatAST::namespaceDecl(std::string name,
+			      std::span<const NodeID> decls) {
+	return add(NodeKind::NAMESPACE, 0, addString(std::move(name)),
+		   addList(decls), static_cast<uint32_t>(decls.size()));
+}
+
+NodeID FlatAST::errorDecl(uint32_t begin, uint32_t end) {
+	return add(NodeKind::ERROR_DECL, 0, begin, end);
+}
+
+NodeID FlatAST::program(std::span<const NodeID> decls) {
+	rootID = add(NodeKind::PROGRAM, 0, NO_NODE, addList(decls),
+		     static_cast<uint32_t>(decls.size()));
+	return rootID;
+}
+
+NodeID FlatAST::append(ASTNode &node) {
+	return Flattener(*this).append(node);
+}
+
+NodeID FlatAST::child(NodeID id, size_t slot) const {
+	const FlatNode &n = node(id);
+	if (n.kind == NodeKind::FOR && slot >= 2) {
+		return extra[n.data[2] + slot - 2];
+	}
+	assert(slot < n.data.size());
+	return n.data[slot];
+}
+
+std::span<const NodeID> FlatAST::children(NodeID id) const {
+	const FlatNode &n = node(id);
+	assert(n.kind == NodeKind::CALL || n.kind == NodeKind::BLOCK ||
+	       n.kind == NodeKind::NAMESPACE || n.kind == NodeKind::PROGRAM);
+	return list(n.data[1], n.data[2]);
+}
+
+std::span<const NodeID> FlatAST::fields(NodeID id) const {
+	const FlatNode &n = node(id);
+	assert(n.kind == NodeKind::STRUCT);
+	uint32_t start = n.data[1];
+	return list(start + 2, extra[start]);
+}
+
+std::span<const NodeID> FlatAST::methods(NodeID id) const {
+	const FlatNode &n = node(id);
+	assert(n.kind == NodeKind::STRUCT);
+	uint32_t start = n.data[1];
+	return list(start + 2 + extra[start], extra[start + 1]);
+}
+
+int64_t FlatAST::intValue(NodeID id) const {
+	const FlatNode &n = node(id);
+	assert(n.kind == NodeKind::INT_LITERAL);
+	return static_cast<int64_t>(n.data[0] |
+				    (static_cast<uint64_t>(n.data[1]) << 32));
+}
+
+double FlatAST::floatValue(NodeID id) const {
+	const FlatNode &n = node(id);
+	assert(n.kind == NodeKind::FLOAT_LITERAL);
+	return std::bit_cast<double>(n.data[0] |
+				     (static_cast<uint64_t>(n.data[1]) << 32));
+}
+
+const std::string &FlatAST::text(NodeID id) const {
+	const FlatNode &n = node(id);
+	switch (n.kind) {
+	case NodeKind::STRING_LITERAL:
+	case NodeKind::STRUCT:
+	case NodeKind::NAMESPACE:
+		return strings[n.data[0]];
+	case NodeKind::ASSIGNMENT:
+		return strings[n.data[1]];
+	case NodeKind::VAR_DECL:
+		return strings[extra[n.data[2] + 1]];
+	default:
+		assert(false && "FlatAST::text: node has no string");
+		std::unreachable();
+	}
+}
+
+const QualifiedName &FlatAST::name(NodeID id) const {
+	const FlatNode &n = node(id);
+	assert(n.kind == NodeKind::VARIABLE || n.kind == NodeKind::FUNCTION);
+	return names[n.kind == NodeKind::VARIABLE ? n.data[0] : n.data[1]];
+}
+
+const types::Type *FlatAST::type(NodeID id) const {
+	const FlatNode &n = node(id);
+	assert(n.kind == NodeKind::VAR_DECL || n.kind == NodeKind::FUNCTION);
+	return typeTable[extra[n.data[2]]];
+}
+
+size_t FlatAST::paramCount(NodeID id) const {
+	const FlatNode &n = node(id);
+	assert(n.kind == NodeKind::FUNCTION);
+	return extra[n.data[2] + 1];
+}
+
+const types::Type *FlatAST::paramType(NodeID id, size_t i) const {
+	assert(i < paramCount(id));
+	return typeTable[extra[node(id).data[2] + 2 + (2 * i)]];
+}
+
+const std::string &FlatAST::paramName(NodeID id, size_t i) const {
+	assert(i < paramCount(id));
+	return strings[extra[node(id).data[2] + 3 + (2 * i)]];
+}
+
+std::pair<uint32_t, uint32_t> FlatAST::skipped(NodeID id) const {
+	const FlatNode &n = node(id);
+	assert(n.kind == NodeKind::ERROR_STMT ||
+	       n.kind == NodeKind::ERROR_DECL);
+	return {n.data[0], n.data[1]};
+}
+
+std::unique_ptr<ASTNode> FlatAST::inflate(NodeID id, Arena *arena) const {
+	return Inflater(*this, arena).node(id);
+}
+
+namespace {
+// Characters of `text` that did not fit in the string itself
+size_t outOfLine(const std::string &text) noexcept {
+	static const size_t inlineCapacity = std::string().capacity();
+	return text.capacity() > inlineCapacity ? text.capacity() + 1 : 0;
+}
+
+// A hash map's buckets, and per entry its key and value with a next
+// pointer and a cached hash
+size_t indexBytes(
+    const std::unordered_map<std::string, uint32_t> &index) noexcept {
+	using Entry = std::unordered_map<std::string, uint32_t>::value_type;
+	size_t total = (index.bucket_count() * sizeof(void *)) +
+		       (index.size() *
+			(sizeof(Entry) + sizeof(void *) + sizeof(size_t)));
+	for (const Entry &entry : index) {
+		total += outOfLine(entry.first);
+	}
+	return total;
+}
+} // namespace
+
+size_t FlatAST::bytes() const noexcept {
+	size_t total = (nodeArray.size() * sizeof(FlatNode)) +
+		       (extra.size() * sizeof(uint32_t)) +
+		       (strings.size() * sizeof(std::string)) +
+		       (names.size() * sizeof(QualifiedName)) +
+		       (typeTable.size() * sizeof(const types::Type *)) +
+		       indexBytes(stringIDs) + indexBytes(nameIDs);
+	for (const std::string &text : strings) {
+		total += outOfLine(text);
+	}
+	for (const QualifiedName &name : names) {
+		total += outOfLine(name.name) +
+			 (name.qualifiers.size() * sizeof(std::string));
+		for (const std::string &qualifier : name.qualifiers) {
+			total += outOfLine(qualifier);
+		}
+	}
+	return total;
+}
+
+void FlatAST::accept(NodeID id, ASTVisitor &visitor) const {
+	Arena scratch;
+	std::unique_ptr<ASTNode> tree = inflate(id, &scratch);
+	tree->accept(visitor);
+}
+
+FlatAST flatten(ProgramAST &program) {
+	FlatAST flat;
+	flat.append(program);
+	return flat;
+}
+
+} // namespace frontend::ast
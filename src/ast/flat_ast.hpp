@@ -0,0 +1,206 @@
+#pragma once
+
+#include "ast.hpp"
+#include "decl.hpp"
+#include "expr.hpp"
+#include "stmt.hpp"
+#include "support/arena.hpp"
+#include "types/type.hpp"
+#include "visitor.hpp"
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace frontend::ast {
+
+/// Index of a node in a FlatAST.
+using NodeID = uint32_t;
+/// An absent optional child, such as a missing else branch.
+inline constexpr NodeID NO_NODE = std::numeric_limits<NodeID>::max();
+
+/// A node of a FlatAST: a kind byte, an operator byte and three 32-bit
+/// slots. What the slots hold depends on the kind:
+///
+///   INT/FLOAT_LITERAL  data[0..1] the 64 bits of the value
+///   STRING_LITERAL     data[0] string
+///   CHAR/BOOL_LITERAL  op is the value
+///   UNARY, BINARY      op; data[0] operand or lhs, data[1] rhs
+///   TERNARY, IF        data[0] condition, data[1] then, data[2] else
+///   VARIABLE           data[0] name
+///   CALL               data[0] callee; data[1..2] argument list
+///   BLOCK, PROGRAM     data[1..2] statement or declaration list
+///   RETURN, DECL_STMT  data[0] value or declaration
+///   ASSIGNMENT         op; data[0] value, data[1] string
+///   FOR                data[0] init, data[1] condition, data[2] extra
+///                      holding update and body
+///   WHILE              data[0] condition, data[1] body
+///   DO                 data[0] body, data[1] condition
+///   VAR_DECL           data[0] size, data[1] initializer, data[2] extra
+///                      holding type and string
+///   FUNCTION           data[0] body, data[1] name, data[2] extra holding
+///                      return type, parameter count and (type, string)
+///                      pairs
+///   STRUCT             data[0] string, data[1] extra holding field
+///                      count, method count, fields and methods
+///   NAMESPACE          data[0] string; data[1..2] declaration list
+///   ERROR_STMT/DECL    data[0..1] the bytes [begin, end) it covers
+///
+/// A list is a start offset and a count into the shared extra array.
+/// Strings, names and types are indices into side tables, where equal
+/// strings and names share one entry.
+struct FlatNode {
+	NodeKind kind;
+	uint8_t op = 0;
+	std::array<uint32_t, 3> data{NO_NODE, NO_NODE, NO_NODE};
+};
+static_assert(sizeof(FlatNode) == 16);
+
+/// Compact form of the AST: nodes are 16-byte records in one array,
+/// addressed by 32-bit IDs instead of pointers, with no vtables and no
+/// per-node allocation. Nodes are added children first, so a tree is laid
+/// out in post-order and a pass over every node is a linear scan of
+/// nodes().
+///
+/// Existing ASTVisitors run on it through accept(), which inflates the
+/// requested subtree into ordinary nodes in a scratch arena on every
+/// call.
+class FlatAST {
+	std::vector<FlatNode> nodeArray;
+	std::vector<uint32_t> extra;
+	std::vector<std::string> strings;
+	std::vector<QualifiedName> names;
+	std::vector<const types::Type *> typeTable; // owned by a TypeContext
+	// each distinct string and name is stored once; names by str()
+	std::unordered_map<std::string, uint32_t> stringIDs;
+	std::unordered_map<std::string, uint32_t> nameIDs;
+	NodeID rootID = NO_NODE;
+
+	NodeID add(NodeKind kind, uint8_t op, uint32_t a = NO_NODE,
+		   uint32_t b = NO_NODE, uint32_t c = NO_NODE);
+	// start of `ids` copied to the end of `extra`
+	uint32_t addList(std::span<const NodeID> ids);
+	uint32_t addString(std::string text);
+	uint32_t addName(QualifiedName name);
+	uint32_t addType(const types::Type *type);
+
+	[[nodiscard]] std::span<const uint32_t> list(uint32_t start,
+						     uint32_t count) const {
+		return {extra.data() + start, count};
+	}
+
+public:
+	FlatAST() = default;
+	FlatAST(const FlatAST &) = delete;
+	FlatAST &operator=(const FlatAST &) = delete;
+	FlatAST(FlatAST &&) = default;
+	FlatAST &operator=(FlatAST &&) = default;
+	~FlatAST() = default;
+
+	// Building: each call takes the IDs of children already added
+	NodeID intLiteral(int64_t value);
+	NodeID floatLiteral(double value);
+	NodeID stringLiteral(std::string value);
+	NodeID charLiteral(char value);
+	NodeID boolLiteral(bool value);
+	NodeID unary(UnaryOp op, NodeID operand);
+	NodeID binary(BinaryOp op, NodeID lhs, NodeID rhs);
+	NodeID ternary(NodeID condition, NodeID thenBranch, NodeID elseBranch);
+	NodeID variable(QualifiedName name);
+	NodeID call(NodeID callee, std::span<const NodeID> args);
+
+	NodeID block(std::span<const NodeID> statements);
+	NodeID returnStmt(NodeID value = NO_NODE);
+	NodeID breakStmt();
+	NodeID continueStmt();
+	NodeID assignment(std::string variable, AssignOp op, NodeID value);
+	NodeID ifStmt(NodeID condition, NodeID thenBranch,
+		      NodeID elseBranch = NO_NODE);
+	NodeID forStmt(NodeID init, NodeID condition, NodeID update,
+		       NodeID body);
+	NodeID whileStmt(NodeID condition, NodeID body);
+	NodeID doStmt(NodeID body, NodeID condition);
+	NodeID errorStmt(uint32_t begin, uint32_t end);
+
+	NodeID declStmt(NodeID decl);
+	NodeID varDecl(const types::Type *type, std::string name,
+		       NodeID size = NO_NODE, NodeID init = NO_NODE);
+	NodeID function(
+	    QualifiedName name,
+	    std::span<const std::pair<const types::Type *, std::string>> params,
+	    const types::Type *returnType, NodeID body);
+	NodeID structDecl(std::string name, std::span<const NodeID> fields,
+			  std::span<const NodeID> methods);
+	NodeID namespaceDecl(std::string name, std::span<const NodeID> decls);
+	NodeID errorDecl(uint32_t begin, uint32_t end);
+	/// Also makes the program the root.
+	NodeID program(std::span<const NodeID> decls);
+
+	/// Adds a copy of a pointer-AST subtree and returns its ID.
+	NodeID append(ASTNode &node);
+
+	// Reading
+	[[nodiscard]] NodeID root() const noexcept { return rootID; }
+	[[nodiscard]] size_t size() const noexcept { return nodeArray.size(); }
+	[[nodiscard]] std::span<const FlatNode> nodes() const noexcept {
+		return nodeArray;
+	}
+	[[nodiscard]] const FlatNode &node(NodeID id) const {
+		assert(id < nodeArray.size());
+		return nodeArray[id];
+	}
+	[[nodiscard]] NodeKind kind(NodeID id) const { return node(id).kind; }
+
+	/// Fixed child `slot` of a node, in the order the builder takes them
+	/// (FOR: init, condition, update, body); NO_NODE if absent.
+	[[nodiscard]] NodeID child(NodeID id, size_t slot) const;
+	/// Arguments of a CALL, statements of a BLOCK, declarations of a
+	/// NAMESPACE or PROGRAM.
+	[[nodiscard]] std::span<const NodeID> children(NodeID id) const;
+	[[nodiscard]] std::span<const NodeID> fields(NodeID id) const;
+	[[nodiscard]] std::span<const NodeID> methods(NodeID id) const;
+
+	[[nodiscard]] int64_t intValue(NodeID id) const;
+	[[nodiscard]] double floatValue(NodeID id) const;
+	/// Value of a STRING_LITERAL, variable of an ASSIGNMENT, name of a
+	/// VAR_DECL, STRUCT or NAMESPACE.
+	[[nodiscard]] const std::string &text(NodeID id) const;
+	/// Name of a VARIABLE or FUNCTION.
+	[[nodiscard]] const QualifiedName &name(NodeID id) const;
+	/// Type of a VAR_DECL, return type of a FUNCTION.
+	[[nodiscard]] const types::Type *type(NodeID id) const;
+	[[nodiscard]] size_t paramCount(NodeID id) const;
+	[[nodiscard]] const types::Type *paramType(NodeID id, size_t i) const;
+	[[nodiscard]] const std::string &paramName(NodeID id, size_t i) const;
+	/// Bytes [first, second) of source an ERROR_STMT or ERROR_DECL covers.
+	[[nodiscard]] std::pair<uint32_t, uint32_t> skipped(NodeID id) const;
+
+	/// Bytes held by the node and extra arrays, the string, name and
+	/// type tables and their indices, including characters stored
+	/// outside a string.
+	[[nodiscard]] size_t bytes() const noexcept;
+
+	// Adapter to the pointer AST
+	/// Rebuilds the subtree at `id` as ordinary nodes, in `arena` if
+	/// given.
+	[[nodiscard]] std::unique_ptr<ASTNode>
+	inflate(NodeID id, Arena *arena = nullptr) const;
+	/// Runs `visitor` on the subtree at `id` exactly as on the pointer
+	/// AST it was built from. Every call inflates the whole subtree into
+	/// a fresh arena first, so a visitor gets none of the flat layout's
+	/// locality; passes that should stream through nodes() have to read
+	/// the FlatAST directly.
+	void accept(NodeID id, ASTVisitor &visitor) const;
+};
+
+/// Flat copy of a parsed program; lazy function bodies are parsed.
+FlatAST flatten(ProgramAST &program);
+
+} // namespace frontend::ast
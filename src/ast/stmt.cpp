@@ -1,34 +1,45 @@
 #include "stmt.hpp"
+#include <cstdint>
 #include <memory>
 #include <string>
 
 namespace frontend::ast {
 
-BlockStmtAST::BlockStmtAST(std::vector<std::unique_ptr<StmtAST>> stmts)
-    : statements(std::move(stmts)) {}
+BlockStmtAST::BlockStmtAST(NodeList<StmtAST> stmts)
+    : StmtAST(KIND), statements(std::move(stmts)) {}
 
 ReturnStmtAST::ReturnStmtAST(std::unique_ptr<ExprAST> value)
-    : value(std::move(value)) {}
+    : StmtAST(KIND), value(std::move(value)) {}
 
 AssignmentStmtAST::AssignmentStmtAST(std::string varName, AssignOp op,
 				     std::unique_ptr<ExprAST> value)
-    : varName(std::move(varName)), op(op), value(std::move(value)) {}
+    : StmtAST(KIND), varName(std::move(varName)), op(op),
+      value(std::move(value)) {}
 
 IfStmtAST::IfStmtAST(std::unique_ptr<ExprAST> condition,
 		     std::unique_ptr<BlockStmtAST> thenBranch,
 		     std::unique_ptr<BlockStmtAST> elseBranch)
-    : condition(std::move(condition)), thenBranch(std::move(thenBranch)),
-      elseBranch(std::move(elseBranch)) {}
+    : StmtAST(KIND), condition(std::move(condition)),
+      thenBranch(std::move(thenBranch)), elseBranch(std::move(elseBranch)) {}
 
 ForStmtAST::ForStmtAST(std::unique_ptr<StmtAST> initialization,
 		       std::unique_ptr<ExprAST> condition,
 		       std::unique_ptr<ExprAST> update,
 		       std::unique_ptr<BlockStmtAST> body)
-    : initialization(std::move(initialization)),
+    : StmtAST(KIND), initialization(std::move(initialization)),
       condition(std::move(condition)), update(std::move(update)),
       body(std::move(body)) {}
 
 WhileStmtAST::WhileStmtAST(std::unique_ptr<ExprAST> condition,
 			   std::unique_ptr<BlockStmtAST> body)
-    : condition(std::move(condition)), body(std::move(body)) {}
+    : StmtAST(KIND), condition(std::move(condition)),
+      body(std::move(body)) {}
+
+DoStmtAST::DoStmtAST(std::unique_ptr<BlockStmtAST> body,
+		     std::unique_ptr<ExprAST> condition)
+    : StmtAST(KIND), body(std::move(body)),
+      condition(std::move(condition)) {}
+
+ErrorStmtAST::ErrorStmtAST(uint32_t begin, uint32_t end)
+    : StmtAST(KIND), begin(begin), end(end) {}
 } // namespace frontend::ast
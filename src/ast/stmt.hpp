@@ -9,12 +9,13 @@
 namespace frontend::ast {
 
 class BlockStmtAST : public StmtAST {
-	std::vector<std::unique_ptr<StmtAST>> statements;
+	NodeList<StmtAST> statements;
 
 public:
-	BlockStmtAST(std::vector<std::unique_ptr<StmtAST>> stmts = {});
-	[[nodiscard]] const std::vector<std::unique_ptr<StmtAST>> &
-	getStmts() const {
+	static constexpr NodeKind KIND = NodeKind::BLOCK;
+
+	BlockStmtAST(NodeList<StmtAST> stmts = {});
+	[[nodiscard]] const NodeList<StmtAST> &getStmts() const {
 		return statements;
 	}
 	void accept(ASTVisitor &v) override { v.visit(*this); }
@@ -24,6 +25,8 @@ class ReturnStmtAST : public StmtAST {
 	std::unique_ptr<ExprAST> value;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::RETURN;
+
 	ReturnStmtAST(std::unique_ptr<ExprAST> value = nullptr);
 	[[nodiscard]] ExprAST *getValue() const { return value.get(); }
 	void accept(ASTVisitor &v) override { v.visit(*this); }
@@ -31,11 +34,17 @@ public:
 
 class BreakStmtAST : public StmtAST {
 public:
+	static constexpr NodeKind KIND = NodeKind::BREAK;
+
+	BreakStmtAST() : StmtAST(KIND) {}
 	void accept(ASTVisitor &v) override { v.visit(*this); }
 };
 
 class ContinueStmtAST : public StmtAST {
 public:
+	static constexpr NodeKind KIND = NodeKind::CONTINUE;
+
+	ContinueStmtAST() : StmtAST(KIND) {}
 	void accept(ASTVisitor &v) override { v.visit(*this); }
 };
 
@@ -59,6 +68,8 @@ class AssignmentStmtAST : public StmtAST {
 	std::unique_ptr<ExprAST> value;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::ASSIGNMENT;
+
 	AssignmentStmtAST(std::string varName, AssignOp op,
 			  std::unique_ptr<ExprAST> value);
 	[[nodiscard]] std::string getVariableName() const { return varName; }
@@ -73,6 +84,8 @@ class IfStmtAST : public StmtAST {
 	std::unique_ptr<BlockStmtAST> elseBranch;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::IF;
+
 	IfStmtAST(std::unique_ptr<ExprAST> condition,
 		  std::unique_ptr<BlockStmtAST> thenBranch,
 		  std::unique_ptr<BlockStmtAST> elseBranch = nullptr);
@@ -96,6 +109,8 @@ class ForStmtAST : public StmtAST {
 	std::unique_ptr<BlockStmtAST> body;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::FOR;
+
 	ForStmtAST(std::unique_ptr<StmtAST> initialization,
 		   std::unique_ptr<ExprAST> condition,
 		   std::unique_ptr<ExprAST> update,
@@ -118,6 +133,8 @@ class WhileStmtAST : public StmtAST {
 	std::unique_ptr<BlockStmtAST> body;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::WHILE;
+
 	WhileStmtAST(std::unique_ptr<ExprAST> condition,
 		     std::unique_ptr<BlockStmtAST> body);
 	[[nodiscard]] ExprAST *getCondition() const { return condition.get(); }
@@ -130,6 +147,8 @@ class DoStmtAST : public StmtAST {
 	std::unique_ptr<ExprAST> condition;
 
 public:
+	static constexpr NodeKind KIND = NodeKind::DO;
+
 	DoStmtAST(std::unique_ptr<BlockStmtAST> body,
 		  std::unique_ptr<ExprAST> condition);
 	[[nodiscard]] BlockStmtAST *getBody() const { return body.get(); }
@@ -137,4 +156,31 @@ public:
 	void accept(ASTVisitor &v) override { v.visit(*this); }
 };
 
+/// Placeholder for a statement that did not parse, left by error recovery
+/// so the rest of its block is kept. Later passes skip it without looking
+/// inside: it holds only the bytes [begin, end) of source it covers.
+class ErrorStmtAST : public StmtAST {
+	uint32_t begin;
+	uint32_t end;
+
+public:
+	static constexpr NodeKind KIND = NodeKind::ERROR_STMT;
+
+	ErrorStmtAST(uint32_t begin, uint32_t end);
+	[[nodiscard]] uint32_t getBegin() const noexcept { return begin; }
+	[[nodiscard]] uint32_t getEnd() const noexcept { return end; }
+	void accept(ASTVisitor &v) override { v.visit(*this); }
+};
+
+// Only children and scalars, all in the arena with the node
+template <> inline constexpr bool needsFinalizer<BlockStmtAST> = false;
+template <> inline constexpr bool needsFinalizer<ReturnStmtAST> = false;
+template <> inline constexpr bool needsFinalizer<BreakStmtAST> = false;
+template <> inline constexpr bool needsFinalizer<ContinueStmtAST> = false;
+template <> inline constexpr bool needsFinalizer<IfStmtAST> = false;
+template <> inline constexpr bool needsFinalizer<ForStmtAST> = false;
+template <> inline constexpr bool needsFinalizer<WhileStmtAST> = false;
+template <> inline constexpr bool needsFinalizer<DoStmtAST> = false;
+template <> inline constexpr bool needsFinalizer<ErrorStmtAST> = false;
+
 } // namespace frontend::ast
@@ -23,6 +23,7 @@ class IfStmtAST;
 class ForStmtAST;
 class WhileStmtAST;
 class DoStmtAST;
+class ErrorStmtAST;
 
 // Declarations
 class DeclStmtAST;
@@ -30,6 +31,7 @@ class VariableDeclarationAST;
 class FunctionAST;
 class StructAST;
 class NamespaceAST;
+class ErrorDeclAST;
 class ProgramAST;
 
 class ASTVisitor {
@@ -62,6 +64,9 @@ public:
 	virtual void visit(ForStmtAST &node) = 0;
 	virtual void visit(WhileStmtAST &node) = 0;
 	virtual void visit(DoStmtAST &node) = 0;
+	// skipped source holds nothing to visit, so visitors that do not
+	// care about errors need not override these two
+	virtual void visit(ErrorStmtAST & /*node*/) {}
 
 	// Declarations
 	virtual void visit(DeclStmtAST &node) = 0;
@@ -69,6 +74,7 @@ public:
 	virtual void visit(FunctionAST &node) = 0;
 	virtual void visit(StructAST &node) = 0;
 	virtual void visit(NamespaceAST &node) = 0;
+	virtual void visit(ErrorDeclAST & /*node*/) {}
 	virtual void visit(ProgramAST &node) = 0;
 };
 
@@ -0,0 +1,326 @@
+#include "diagnostics.hpp"
+#include "lexer/keywords.hpp"
+#include "lexer/token.hpp"
+#include "source/line_table.hpp"
+#include "source/source_manager.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace frontend {
+
+namespace {
+
+struct DiagInfo {
+	ErrorPhase phase;
+	bool isWarning;
+	std::string_view format;
+};
+
+constexpr std::array DIAG_TABLE = {
+    // Lexer
+    DiagInfo{ErrorPhase::LEXER, false, "unterminated block comment"},
+    DiagInfo{ErrorPhase::LEXER, false, "floating literal is out of range"},
+    DiagInfo{ErrorPhase::LEXER, false, "integer literal is too large"},
+    DiagInfo{ErrorPhase::LEXER, false,
+	     "character literal must contain exactly one character"},
+    DiagInfo{ErrorPhase::LEXER, false, "unterminated char literal"},
+    DiagInfo{ErrorPhase::LEXER, false, "unterminated string literal"},
+    DiagInfo{ErrorPhase::LEXER, false, "unexpected character '%0'"},
+    DiagInfo{ErrorPhase::LEXER, false, "cannot read %f: %0"},
+    DiagInfo{ErrorPhase::LEXER, false,
+	     "%f is larger than 4 GiB; the rest is not read"},
+
+    // Parser
+    DiagInfo{ErrorPhase::PARSER, false, "Expected '%0' but got: %1"},
+    DiagInfo{ErrorPhase::PARSER, false,
+	     "Expected type after '%0' but got: %1"},
+    DiagInfo{ErrorPhase::PARSER, false,
+	     "Expected identifier after '%0' but got: %1"},
+    DiagInfo{ErrorPhase::PARSER, false,
+	     "Expected primitive type but got: %0"},
+    DiagInfo{ErrorPhase::PARSER, false, "Expected identifier but got: %0"},
+    DiagInfo{ErrorPhase::PARSER, false,
+	     "Expected identifier, literal or '(' but got: %0"},
+    DiagInfo{ErrorPhase::PARSER, false,
+	     "Expected '[', '(', '.', '::', '++', or '--' but got: %0"},
+    DiagInfo{ErrorPhase::PARSER, false, "Invalid unary operator"},
+    DiagInfo{ErrorPhase::PARSER, false, "Invalid assignment operator: %0"},
+    DiagInfo{ErrorPhase::PARSER, false,
+	     "Expected an assignment operator but got: %0"},
+    DiagInfo{ErrorPhase::PARSER, false,
+	     "Expected variable declaration or assignment in for-loop "
+	     "initializer but got: %0"},
+    DiagInfo{ErrorPhase::PARSER, false, "Expected 'if' or '{' but got: %0"},
+    DiagInfo{ErrorPhase::PARSER, false, "Expected statement but got: %0"},
+    DiagInfo{ErrorPhase::PARSER, false,
+	     "Expected parameter name but got: %0"},
+    DiagInfo{ErrorPhase::PARSER, false,
+	     "Expected function identifier but got: %0"},
+    DiagInfo{ErrorPhase::PARSER, false, "Expected struct name but got: %0"},
+    DiagInfo{ErrorPhase::PARSER, false,
+	     "Expected namespace identifier but got: %0"},
+    DiagInfo{ErrorPhase::PARSER, false,
+	     "Expected 'namespace', 'struct', or 'func' but got: %0"},
+    DiagInfo{ErrorPhase::PARSER, false,
+	     "Expected declaration but got: %0"},
+};
+static_assert(DIAG_TABLE.size() ==
+	      static_cast<size_t>(DiagID::EXPECTED_DECLARATION) + 1);
+
+constexpr const DiagInfo &info(DiagID id) noexcept {
+	return DIAG_TABLE[static_cast<size_t>(id)];
+}
+
+// What the tokens that are not keywords look like, or are called
+constexpr std::array<detail::KeywordEntry, 53> TOKEN_SPELLINGS = {{
+    {"+", TokenType::PLUS},
+    {"-", TokenType::MINUS},
+    {"*", TokenType::STAR},
+    {"/", TokenType::SLASH},
+    {"%", TokenType::PERCENT},
+    {"++", TokenType::PLUS_PLUS},
+    {"--", TokenType::MINUS_MINUS},
+    {"+=", TokenType::PLUS_EQUAL},
+    {"-=", TokenType::MINUS_EQUAL},
+    {"*=", TokenType::STAR_EQUAL},
+    {"/=", TokenType::SLASH_EQUAL},
+    {"%=", TokenType::PERCENT_EQUAL},
+    {"==", TokenType::EQUAL_EQUAL},
+    {"!=", TokenType::EXCLAMATION_EQUAL},
+    {">", TokenType::GREATER},
+    {">=", TokenType::GREATER_EQUAL},
+    {"<", TokenType::LESS},
+    {"<=", TokenType::LESS_EQUAL},
+    {"=", TokenType::EQUAL},
+    {"&&", TokenType::AMPERSAND_AMPERSAND},
+    {"||", TokenType::PIPE_PIPE},
+    {"!", TokenType::EXCLAMATION},
+    {"&", TokenType::AMPERSAND},
+    {"|", TokenType::PIPE},
+    {"^", TokenType::CARET},
+    {"~", TokenType::TILDE},
+    {"<<", TokenType::LESS_LESS},
+    {">>", TokenType::GREATER_GREATER},
+    {"&=", TokenType::AMPERSAND_EQUAL},
+    {"|=", TokenType::PIPE_EQUAL},
+    {"^=", TokenType::CARET_EQUAL},
+    {"<<=", TokenType::LESS_LESS_EQUAL},
+    {">>=", TokenType::GREATER_GREATER_EQUAL},
+    {"->", TokenType::ARROW},
+    {"@", TokenType::AT},
+    {".", TokenType::DOT},
+    {"?", TokenType::QUESTION},
+    {"::", TokenType::COLON_COLON},
+    {":", TokenType::COLON},
+    {";", TokenType::SEMICOLON},
+    {",", TokenType::COMMA},
+    {"{", TokenType::LBRACE},
+    {"}", TokenType::RBRACE},
+    {"(", TokenType::LPAREN},
+    {")", TokenType::RPAREN},
+    {"[", TokenType::LBRACKET},
+    {"]", TokenType::RBRACKET},
+    {"integer literal", TokenType::INT_LIT},
+    {"floating literal", TokenType::FLOAT_LIT},
+    {"string literal", TokenType::STRING_LIT},
+    {"char literal", TokenType::CHAR_LIT},
+    {"identifier", TokenType::IDENT},
+    {"end of file", TokenType::T_EOF},
+}};
+
+std::string_view spelling(TokenType type) noexcept {
+	for (const detail::KeywordEntry &keyword : detail::KEYWORD_LIST) {
+		if (keyword.type == type) {
+			return keyword.text;
+		}
+	}
+	for (const detail::KeywordEntry &token : TOKEN_SPELLINGS) {
+		if (token.type == type) {
+			return token.text;
+		}
+	}
+	return "invalid token";
+}
+
+// Flushed to the stream whenever it grows past this
+constexpr size_t PRINT_BUFFER_SIZE = 64 * 1024;
+
+bool locatedBefore(const CompilerError &a, const CompilerError &b) {
+	if (a.location.file.id != b.location.file.id) {
+		return a.location.file.id < b.location.file.id;
+	}
+	return a.location.offset < b.location.offset;
+}
+
+} // namespace
+
+ErrorPhase CompilerError::phase() const noexcept { return info(id).phase; }
+
+bool CompilerError::isWarning() const noexcept {
+	return info(id).isWarning;
+}
+
+std::string ErrorReporter::message(const CompilerError &err) const {
+	std::string_view format = info(err.id).format;
+	std::string out;
+	out.reserve(format.size());
+	for (size_t i = 0; i < format.size(); i++) {
+		if (format[i] != '%' || i + 1 == format.size()) {
+			out += format[i];
+			continue;
+		}
+		char spec = format[++i];
+		if (spec == 'f') {
+			out += sourceManager->name(err.location.file);
+			continue;
+		}
+		const DiagArg &arg = err.args[spec == '1' ? 1 : 0];
+		switch (arg.kind) {
+		case DiagArg::Kind::NONE:
+			break;
+		case DiagArg::Kind::TOKEN:
+			out += spelling(static_cast<TokenType>(arg.value));
+			break;
+		case DiagArg::Kind::LEXEME: {
+			// streamed files keep no text to take it from
+			std::string_view text =
+			    sourceManager->text(err.location.file);
+			if (err.location.offset <= text.size()) {
+				out += text.substr(err.location.offset,
+						   arg.value);
+			}
+			break;
+		}
+		case DiagArg::Kind::CHAR:
+			out += static_cast<char>(arg.value);
+			break;
+		case DiagArg::Kind::ERRNO:
+			out += std::strerror(static_cast<int>(arg.value));
+			break;
+		}
+	}
+	return out;
+}
+
+void ErrorReporter::printAll(std::ostream &out) const {
+	std::string buffer;
+	buffer.reserve(PRINT_BUFFER_SIZE);
+	for (const auto &err : errors) {
+		LineColumn where = locate(err);
+		buffer += sourceManager->name(err.location.file);
+		buffer += ':';
+		buffer += std::to_string(where.line);
+		buffer += ':';
+		buffer += std::to_string(where.column);
+		buffer += err.isWarning() ? ": warning: " : ": error: ";
+		buffer += message(err);
+		buffer += '\n';
+		if (buffer.size() >= PRINT_BUFFER_SIZE) {
+			out << buffer;
+			buffer.clear();
+		}
+	}
+	if (limitReached()) {
+		buffer += "too many errors emitted, stopping now "
+			  "[-ferror-limit=]\n";
+	}
+
+	if (errorCount > 0 || warningCount > 0) {
+		buffer += "\nCompilation ";
+		if (errorCount > 0) {
+			buffer += "failed with " + std::to_string(errorCount) +
+				  " error(s)";
+			if (warningCount > 0) {
+				buffer += ", " + std::to_string(warningCount) +
+					  " warning(s)";
+			}
+		}
+		else {
+			buffer += "succeeded with " +
+				  std::to_string(warningCount) + " warning(s)";
+		}
+		buffer += '\n';
+	}
+	out << buffer;
+}
+
+void ErrorReporter::keepRanked(const CompilerError &err) {
+	// counted already, so the count is the arrival order
+	lowest.push_back({err, errorCount + warningCount});
+	std::ranges::push_heap(lowest, std::less<>{}, rank);
+	if (!err.isWarning()) {
+		lowestErrors++;
+	}
+	// drop the highest while it is an error too many, or a warning after
+	// the last error kept
+	while (lowestErrors > lowestLimit ||
+	       (lowestErrors == lowestLimit &&
+		lowest.front().err.isWarning())) {
+		if (!lowest.front().err.isWarning()) {
+			lowestErrors--;
+		}
+		std::ranges::pop_heap(lowest, std::less<>{}, rank);
+		lowest.pop_back();
+	}
+}
+
+std::vector<CompilerError> ErrorReporter::takeSorted() {
+	std::vector<CompilerError> sorted;
+	if (lowestLimit == 0) {
+		sorted = std::move(errors);
+		errors.clear();
+		// stable, so the order they were reported in breaks ties
+		std::ranges::stable_sort(sorted, locatedBefore);
+		return sorted;
+	}
+	std::ranges::sort(lowest, std::less<>{}, rank);
+	sorted.reserve(lowest.size());
+	for (const Ranked &kept : lowest) {
+		sorted.push_back(kept.err);
+	}
+	lowest.clear();
+	lowestErrors = 0;
+	return sorted;
+}
+
+DiagnosticSink::DiagnosticSink(SourceManager &sources, size_t count,
+			       size_t errorLimit) {
+	shards.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		shards.push_back(Shard{ErrorReporter(sources)});
+		// one past the limit, to mark where the merge stops
+		if (errorLimit > 0) {
+			shards.back().errors.keepLowest(errorLimit + 1);
+		}
+	}
+}
+
+void DiagnosticSink::mergeInto(ErrorReporter &errors) {
+	std::vector<CompilerError> all;
+	for (Shard &shard : shards) {
+		std::vector<CompilerError> kept = shard.errors.takeSorted();
+		all.insert(all.end(), kept.begin(), kept.end());
+		errors.holdAll(shard.errors);
+		shard.errors.clear();
+	}
+	// stable, so each shard's own order breaks ties
+	std::ranges::stable_sort(all, locatedBefore);
+
+	for (const CompilerError &err : all) {
+		if (errors.limitReached()) {
+			break;
+		}
+		errors.report(err);
+	}
+}
+
+} // namespace frontend
@@ -1,95 +1,246 @@
 #pragma once
+#include "lexer/token.hpp"
+#include "source/line_table.hpp"
+#include "source/source_manager.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 namespace frontend {
 
-enum class ErrorPhase { LEXER, PARSER, SEMANTIC, CODEGEN };
+enum class ErrorPhase : std::uint8_t { LEXER, PARSER, SEMANTIC, CODEGEN };
+
+/// What a diagnostic says. Each ID has a phase, a severity and a message
+/// whose %0 and %1 are filled in from the diagnostic's arguments, and %f
+/// with the name of its file, but only when it is rendered; reporting one
+/// formats nothing.
+enum class DiagID : std::uint16_t {
+	// Lexer
+	UNTERMINATED_BLOCK_COMMENT,
+	FLOAT_OUT_OF_RANGE,
+	INT_TOO_LARGE,
+	CHAR_LITERAL_LENGTH,
+	UNTERMINATED_CHAR,
+	UNTERMINATED_STRING,
+	UNEXPECTED_CHARACTER, // %0 the character
+	CANNOT_READ,	      // %0 the system error
+	INPUT_TOO_LARGE,
+
+	// Parser; the last argument is the token found instead
+	EXPECTED_TOKEN,		   // %0 the token expected
+	EXPECTED_TYPE_AFTER,	   // %0 the keyword
+	EXPECTED_IDENTIFIER_AFTER, // %0 the keyword or '::'
+	EXPECTED_PRIMITIVE_TYPE,
+	EXPECTED_IDENTIFIER,
+	EXPECTED_PRIMARY,
+	EXPECTED_POSTFIX,
+	INVALID_UNARY_OPERATOR,
+	INVALID_ASSIGNMENT_OPERATOR,
+	EXPECTED_ASSIGNMENT_OPERATOR,
+	EXPECTED_FOR_INIT,
+	EXPECTED_ELSE_BODY,
+	EXPECTED_STATEMENT,
+	EXPECTED_PARAMETER_NAME,
+	EXPECTED_FUNCTION_NAME,
+	EXPECTED_STRUCT_NAME,
+	EXPECTED_NAMESPACE_NAME,
+	EXPECTED_DECL_KEYWORD,
+	EXPECTED_DECLARATION,
+};
+
+/// One argument of a diagnostic: a kind and a value to render it from,
+/// never the rendered text.
+struct DiagArg {
+	enum class Kind : std::uint8_t { NONE, TOKEN, LEXEME, CHAR, ERRNO };
+
+	Kind kind = Kind::NONE;
+	uint32_t value = 0;
+
+	/// How a token of `type` is spelled, or what it is called.
+	static constexpr DiagArg token(TokenType type) noexcept {
+		return {Kind::TOKEN, static_cast<uint32_t>(type)};
+	}
+	/// The `length` bytes of source at the diagnostic's location.
+	static constexpr DiagArg lexeme(size_t length) noexcept {
+		return {Kind::LEXEME, static_cast<uint32_t>(length)};
+	}
+	static constexpr DiagArg character(char c) noexcept {
+		return {Kind::CHAR, static_cast<unsigned char>(c)};
+	}
+	/// strerror() of `errnum`.
+	static constexpr DiagArg error(int errnum) noexcept {
+		return {Kind::ERRNO, static_cast<uint32_t>(errnum)};
+	}
+
+	bool operator==(const DiagArg &) const = default;
+};
 
 struct CompilerError {
-	ErrorPhase phase;
-	std::string message;
-	std::string filename;
-	size_t line;
-	size_t column;
-	bool isWarning;
-
-	CompilerError(ErrorPhase p, std::string msg, std::string file,
-		      size_t ln, size_t col, bool warn = false)
-	    : phase(p), message(std::move(msg)), filename(std::move(file)),
-	      line(ln), column(col), isWarning(warn) {}
+	DiagID id;
+	SourceLocation location;
+	std::array<DiagArg, 2> args{};
+
+	[[nodiscard]] ErrorPhase phase() const noexcept;
+	[[nodiscard]] bool isWarning() const noexcept;
 };
 
 class ErrorReporter {
 	std::vector<CompilerError> errors;
-	std::string currentFilename;
+	// files that diagnostics point into; private unless one is shared in
+	std::unique_ptr<SourceManager> ownedSources;
+	SourceManager *sourceManager;
+	// files kept registered for the diagnostics that point into them;
+	// after ownedSources, so released before it goes
+	std::vector<FileOwner> heldFiles;
 	size_t errorCount = 0;
 	size_t warningCount = 0;
+	size_t errorLimit = 0; // none if zero
+	// with keepLowest(), what is kept goes to a max-heap by (file,
+	// offset, arrival) instead of `errors`, so the next to drop is on top
+	struct Ranked {
+		CompilerError err;
+		size_t arrival;
+	};
+	static auto rank(const Ranked &kept) {
+		return std::tuple(kept.err.location.file.id,
+				  kept.err.location.offset, kept.arrival);
+	}
+	std::vector<Ranked> lowest;
+	size_t lowestLimit = 0; // errors the heap keeps; no heap if zero
+	size_t lowestErrors = 0;
+
+	void keepRanked(const CompilerError &err);
 
 public:
-	void setFilename(const std::string &filename) {
-		currentFilename = filename;
+	ErrorReporter()
+	    : ownedSources(std::make_unique<SourceManager>()),
+	      sourceManager(ownedSources.get()) {}
+	explicit ErrorReporter(SourceManager &sources)
+	    : sourceManager(&sources) {}
+
+	[[nodiscard]] SourceManager &sources() const { return *sourceManager; }
+
+	void report(DiagID id, SourceLocation location, DiagArg first = {},
+		    DiagArg second = {}) {
+		report(CompilerError{id, location, {first, second}});
 	}
 
-	void error(const std::string &message, size_t line, size_t column,
-		   ErrorPhase phase = ErrorPhase::PARSER) {
-		errors.emplace_back(phase, message, currentFilename, line,
-				    column, false);
-		errorCount++;
+	// Also passes on a diagnostic another reporter collected
+	void report(const CompilerError &err) {
+		if (err.isWarning()) {
+			warningCount++;
+		}
+		else {
+			errorCount++;
+		}
+		if (lowestLimit > 0) {
+			keepRanked(err);
+		}
+		// past the limit diagnostics are only counted
+		else if (!limitReached()) {
+			errors.push_back(err);
+		}
 	}
 
-	void warning(const std::string &message, size_t line, size_t column,
-		     ErrorPhase phase = ErrorPhase::PARSER) {
-		errors.emplace_back(phase, message, currentFilename, line,
-				    column, true);
-		warningCount++;
+	// Keeps only the first `limit` errors, and the warnings before them;
+	// zero keeps all of them
+	void setErrorLimit(size_t limit) { errorLimit = limit; }
+	[[nodiscard]] size_t getErrorLimit() const { return errorLimit; }
+	[[nodiscard]] bool limitReached() const {
+		return errorLimit > 0 && errorCount > errorLimit;
+	}
+	// Keeps only the `count` errors lowest by (file, offset), and the
+	// warnings before the last of them, whatever order they come in; for
+	// a reporter whose diagnostics are sorted afterwards. Never reaches
+	// its limit, so a parse reporting to it goes on to the end
+	void keepLowest(size_t count) { lowestLimit = count; }
+
+	// Line and column of a diagnostic, found by binary search
+	[[nodiscard]] LineColumn locate(const CompilerError &err) const {
+		return sourceManager->locate(err.location);
 	}
 
+	// The message of `err`, formatted from its arguments
+	[[nodiscard]] std::string message(const CompilerError &err) const;
+
 	bool hasErrors() const { return errorCount > 0; }
 	size_t getErrorCount() const { return errorCount; }
 	size_t getWarningCount() const { return warningCount; }
 
-	void printAll() const {
-		for (const auto &err : errors) {
-			std::cerr << err.filename << ":" << err.line << ":"
-				  << err.column << ": ";
+	// Renders every kept diagnostic and a summary to `out`, in a few
+	// large writes
+	void printAll(std::ostream &out = std::cerr) const;
 
-			if (err.isWarning) {
-				std::cerr << "warning: ";
-			}
-			else {
-				std::cerr << "error: ";
-			}
-
-			std::cerr << err.message << "\n";
-		}
-
-		if (errorCount > 0 || warningCount > 0) {
-			std::cerr << "\nCompilation ";
-			if (errorCount > 0) {
-				std::cerr << "failed with " << errorCount
-					  << " error(s)";
-				if (warningCount > 0) {
-					std::cerr << ", " << warningCount
-						  << " warning(s)";
-				}
-			}
-			else {
-				std::cerr << "succeeded with " << warningCount
-					  << " warning(s)";
-			}
-			std::cerr << "\n";
+	const std::vector<CompilerError> &getErrors() const { return errors; }
+	// Moves out what is kept, sorted by (file, offset) and then by the
+	// order it was reported in
+	[[nodiscard]] std::vector<CompilerError> takeSorted();
+
+	// Keeps `file` registered until the diagnostics are cleared, for a
+	// file whose owner goes away before they are rendered
+	void hold(FileOwner file) { heldFiles.push_back(std::move(file)); }
+	// Takes over the files `from` holds
+	void holdAll(ErrorReporter &from) {
+		for (FileOwner &file : from.heldFiles) {
+			heldFiles.push_back(std::move(file));
 		}
+		from.heldFiles.clear();
 	}
 
-	const std::vector<CompilerError> &getErrors() const { return errors; }
-
 	void clear() {
 		errors.clear();
+		lowest.clear();
+		lowestErrors = 0;
+		heldFiles.clear();
 		errorCount = 0;
 		warningCount = 0;
 	}
 };
 
+/// Diagnostics from many threads at once. Each concurrent task reports to
+/// its own shard, an ErrorReporter no other thread touches, so reporting
+/// takes no lock; mergeInto() then passes them all on in (file, offset)
+/// order.
+///
+/// Tasks need not report in offset order: a lexer reports a peeked
+/// token's errors before the parser's errors at the tokens before it, and
+/// a parallel lex reports a whole file's errors before its parse begins.
+/// So under an error limit N a shard keeps, in a bounded heap, the N + 1
+/// errors lowest by (file, offset) rather than the first ones; the last
+/// marks where a serial run would stop. The limit itself is applied only
+/// once the diagnostics are merged, so the output is a serial run's
+/// sorted by location.
+class DiagnosticSink {
+	// a cache line each, so neighbouring shards' counters never share one
+	struct alignas(64) Shard {
+		ErrorReporter errors;
+	};
+	std::vector<Shard> shards;
+
+public:
+	// `count` shards, each keeping what the merge may need under
+	// `errorLimit`; everything if zero
+	DiagnosticSink(SourceManager &sources, size_t count,
+		       size_t errorLimit = 0);
+
+	[[nodiscard]] size_t size() const noexcept { return shards.size(); }
+
+	// Only one thread at a time may report to a shard
+	[[nodiscard]] ErrorReporter &shard(size_t i) noexcept {
+		return shards[i].errors;
+	}
+
+	// Reports every shard's diagnostics to `errors` in (file, offset)
+	// order and empties the shards. Everything after the diagnostic that
+	// takes `errors` past its limit is dropped, as a serial parse stops
+	// there.
+	void mergeInto(ErrorReporter &errors);
+};
+
 } // namespace frontend
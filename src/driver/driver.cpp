@@ -0,0 +1,99 @@
+#include "driver.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/parallel_lexer.hpp"
+#include "lexer/token_buffer.hpp"
+#include "parser/builder.hpp"
+#include "parser/parallel_parser.hpp"
+#include "parser/parser.hpp"
+#include "source/source_manager.hpp"
+#include "support/arena.hpp"
+#include "support/thread_pool.hpp"
+#include "types/type_context.hpp"
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace frontend {
+
+namespace {
+// Parses one file, going on past syntax errors to report them all; with
+// `syntaxOnly` nothing is built and only the diagnostics are kept. The
+// tree is dropped with its arena and types on return, so memory peaks
+// with the largest file rather than the whole run
+void compile(FileID file, ErrorReporter &errors, bool syntaxOnly) {
+	Lexer lexer(file, errors);
+	if (syntaxOnly) {
+		SyntaxChecker checker(lexer, errors);
+		checker.setRecovery(ErrorRecovery::SYNCHRONIZE);
+		(void)checker.parseProgram();
+		return;
+	}
+	Arena arena;
+	types::TypeContext types;
+	Parser parser(lexer, errors, {types, &arena});
+	parser.setRecovery(ErrorRecovery::SYNCHRONIZE);
+	(void)parser.parseProgram();
+}
+
+// Parses one large file with every thread of `pool`, reporting what
+// compile() would under `errorLimit`; with `syntaxOnly` the runs check
+// their regions with the NullBuilder and nothing is built
+void compileParallel(FileID file, ErrorReporter &errors, ThreadPool &pool,
+		     size_t errorLimit, bool syntaxOnly) {
+	// the lex reports the whole file's errors before the parse starts, so
+	// each keeps its lowest and the merge interleaves them by offset
+	DiagnosticSink phases(errors.sources(), 2, errorLimit);
+	TokenBuffer tokens = lexParallel(file, phases.shard(0), pool);
+	if (syntaxOnly) {
+		std::vector<NullBuilder> checkers(pool.size());
+		(void)parseParallel<NullBuilder>(tokens, phases.shard(1), pool,
+						 checkers,
+						 ErrorRecovery::SYNCHRONIZE);
+	}
+	else {
+		std::vector<Arena> arenas(pool.size());
+		types::TypeContext types;
+		(void)parseParallel(tokens, phases.shard(1), types, pool,
+				    arenas, ErrorRecovery::SYNCHRONIZE);
+	}
+	phases.mergeInto(errors);
+}
+} // namespace
+
+void compileFiles(std::span<const FileID> files, ErrorReporter &errors,
+		  const CompileOptions &options) {
+	if (options.jobs <= 1) {
+		for (FileID file : files) {
+			compile(file, errors, options.syntaxOnly);
+			if (errors.limitReached()) {
+				break;
+			}
+		}
+		return;
+	}
+
+	// a shard per file, so no two threads share one; the limit applies
+	// to the merged, sorted diagnostics
+	SourceManager &sources = errors.sources();
+	ThreadPool pool(options.jobs);
+	DiagnosticSink sink(sources, files.size(), errors.getErrorLimit());
+	std::vector<size_t> small;
+	for (size_t i = 0; i < files.size(); i++) {
+		if (sources.text(files[i]).size() >= PARALLEL_FILE_SIZE) {
+			compileParallel(files[i], sink.shard(i), pool,
+					errors.getErrorLimit(),
+					options.syntaxOnly);
+		}
+		else {
+			small.push_back(i);
+		}
+	}
+	pool.forEach(small.size(), [&](size_t k) {
+		size_t i = small[k];
+		compile(files[i], sink.shard(i), options.syntaxOnly);
+	});
+	sink.mergeInto(errors);
+}
+
+} // namespace frontend
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "diagnostics/diagnostics.hpp"
+#include "source/source_manager.hpp"
+#include <cstddef>
+#include <span>
+
+namespace frontend {
+
+/// With more than one job, files at least this large are lexed and parsed
+/// by all the workers together instead of by one of them.
+inline constexpr size_t PARALLEL_FILE_SIZE = size_t{1} << 20;
+
+struct CompileOptions {
+	// recognize only, building no tree
+	bool syntaxOnly = false;
+	// threads, the caller included
+	size_t jobs = 1;
+};
+
+/// Lexes and parses `files` in order, going on past syntax errors to
+/// report them all to `errors` and stopping at its error limit. With more
+/// than one job the files are compiled concurrently and the diagnostics
+/// are those of one job sorted by location.
+void compileFiles(std::span<const FileID> files, ErrorReporter &errors,
+		  const CompileOptions &options);
+
+} // namespace frontend
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace frontend {
+namespace detail {
+
+enum CharClassBit : uint8_t {
+	CC_ALPHA = 1U << 0, // [A-Za-z]
+	CC_DIGIT = 1U << 1, // [0-9]
+	CC_IDENT = 1U << 2, // [A-Za-z0-9_]
+	CC_SPACE = 1U << 3, // ' ' \t \n \v \f \r
+};
+
+// Same answers as <cctype> in the "C" locale, without the locale lookup
+inline constexpr auto CHAR_CLASS = [] {
+	std::array<uint8_t, 256> table{};
+	for (int c = 'a'; c <= 'z'; c++) {
+		table[c] |= CC_ALPHA | CC_IDENT;
+		table[c - 'a' + 'A'] |= CC_ALPHA | CC_IDENT;
+	}
+	for (int c = '0'; c <= '9'; c++) {
+		table[c] |= CC_DIGIT | CC_IDENT;
+	}
+	table['_'] |= CC_IDENT;
+	for (unsigned char c : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+		table[c] |= CC_SPACE;
+	}
+	return table;
+}();
+
+constexpr bool hasClass(char c, uint8_t bits) noexcept {
+	return (CHAR_CLASS[static_cast<unsigned char>(c)] & bits) != 0;
+}
+
+inline constexpr uint64_t ONES = 0x0101010101010101ULL;
+inline constexpr uint64_t HIGHS = 0x8080808080808080ULL;
+
+// High bit of each byte of `word` set where the byte lies in [lo, hi].
+// Bytes >= 0x80 never match. Masking to seven bits first keeps every
+// per-byte sum below 0x100, so no carry crosses into a neighbour.
+constexpr uint64_t bytesInRange(uint64_t word, uint8_t lo,
+				uint8_t hi) noexcept {
+	uint64_t low7 = word & ~HIGHS;
+	uint64_t at_least_lo = low7 + ((0x80U - lo) * ONES);
+	uint64_t above_hi = low7 + ((0x7FU - hi) * ONES);
+	return at_least_lo & ~above_hi & ~word & HIGHS;
+}
+
+constexpr uint64_t identBytes(uint64_t word) noexcept {
+	return bytesInRange(word, 'a', 'z') | bytesInRange(word, 'A', 'Z') |
+	       bytesInRange(word, '0', '9') | bytesInRange(word, '_', '_');
+}
+
+constexpr uint64_t digitBytes(uint64_t word) noexcept {
+	return bytesInRange(word, '0', '9');
+}
+
+// End of the run of bytes starting at `pos` whose class `MatchBytes`
+// accepts, checked eight at a time and finished with the table
+template <uint64_t (*MatchBytes)(uint64_t), uint8_t Bits>
+size_t scanRun(std::string_view text, size_t pos) noexcept {
+	if constexpr (std::endian::native == std::endian::little) {
+		while (pos + sizeof(uint64_t) <= text.size()) {
+			uint64_t word = 0;
+			std::memcpy(&word, text.data() + pos, sizeof(word));
+			uint64_t stop = ~MatchBytes(word) & HIGHS;
+			if (stop != 0) {
+				return pos + (std::countr_zero(stop) / 8);
+			}
+			pos += sizeof(word);
+		}
+	}
+	while (pos < text.size() && hasClass(text[pos], Bits)) {
+		pos++;
+	}
+	return pos;
+}
+
+} // namespace detail
+
+constexpr bool isIdentStart(char c) noexcept {
+	return detail::hasClass(c, detail::CC_ALPHA);
+}
+constexpr bool isIdentContinue(char c) noexcept {
+	return detail::hasClass(c, detail::CC_IDENT);
+}
+constexpr bool isDigit(char c) noexcept {
+	return detail::hasClass(c, detail::CC_DIGIT);
+}
+constexpr bool isSpace(char c) noexcept {
+	return detail::hasClass(c, detail::CC_SPACE);
+}
+
+/// Position just past the [A-Za-z0-9_]* run that starts at `pos`.
+inline size_t scanIdentifier(std::string_view text, size_t pos) noexcept {
+	return detail::scanRun<detail::identBytes, detail::CC_IDENT>(text, pos);
+}
+
+/// Position just past the [0-9]* run that starts at `pos`.
+inline size_t scanDigits(std::string_view text, size_t pos) noexcept {
+	return detail::scanRun<detail::digitBytes, detail::CC_DIGIT>(text, pos);
+}
+
+} // namespace frontend
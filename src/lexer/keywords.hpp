@@ -0,0 +1,102 @@
+#pragma once
+
+#include "token.hpp"
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+namespace frontend {
+namespace detail {
+
+struct KeywordEntry {
+	std::string_view text;
+	TokenType type;
+};
+
+inline constexpr std::array<KeywordEntry, 29> KEYWORD_LIST = {{
+    {"func", TokenType::FUNC},
+    {"var", TokenType::VAR},
+    {"infer", TokenType::INFER},
+    {"if", TokenType::IF},
+    {"else", TokenType::ELSE},
+    {"for", TokenType::FOR},
+    {"do", TokenType::DO},
+    {"while", TokenType::WHILE},
+    {"return", TokenType::RETURN},
+    {"break", TokenType::BREAK},
+    {"continue", TokenType::CONTINUE},
+
+    {"switch", TokenType::SWITCH},
+    {"case", TokenType::CASE},
+    {"default", TokenType::DEFAULT},
+
+    {"struct", TokenType::STRUCT},
+    {"enum", TokenType::ENUM},
+
+    {"const", TokenType::CONST},
+    {"static", TokenType::STATIC},
+
+    {"namespace", TokenType::NAMESPACE},
+    {"import", TokenType::IMPORT},
+
+    {"int", TokenType::INT},
+    {"float", TokenType::FLOAT},
+    {"double", TokenType::DOUBLE},
+    {"char", TokenType::CHAR},
+    {"bool", TokenType::BOOL},
+    {"void", TokenType::VOID},
+    {"string", TokenType::STRING},
+    {"true", TokenType::TRUE},
+    {"false", TokenType::FALSE},
+}};
+
+inline constexpr size_t KEYWORD_MIN_LENGTH = 2;
+inline constexpr size_t KEYWORD_MAX_LENGTH = 9;
+inline constexpr size_t KEYWORD_TABLE_SIZE = 64;
+
+// Perfect over KEYWORD_LIST (checked below); the multipliers were found by
+// search. Callers guarantee KEYWORD_MIN_LENGTH <= text.size().
+constexpr size_t keywordHash(std::string_view text) noexcept {
+	auto byte = [&](size_t i) {
+		return static_cast<size_t>(static_cast<unsigned char>(text[i]));
+	};
+	return (text.size() + (4 * byte(0)) + byte(1) +
+		(11 * byte(text.size() - 1))) &
+	       (KEYWORD_TABLE_SIZE - 1);
+}
+
+inline constexpr auto KEYWORD_TABLE = [] {
+	std::array<KeywordEntry, KEYWORD_TABLE_SIZE> table{};
+	for (const auto &entry : KEYWORD_LIST) {
+		table[keywordHash(entry.text)] = entry;
+	}
+	return table;
+}();
+
+constexpr bool keywordTableIsPerfect() noexcept {
+	for (const auto &entry : KEYWORD_LIST) {
+		if (entry.text.size() < KEYWORD_MIN_LENGTH ||
+		    entry.text.size() > KEYWORD_MAX_LENGTH ||
+		    KEYWORD_TABLE[keywordHash(entry.text)].text != entry.text) {
+			return false;
+		}
+	}
+	return true;
+}
+static_assert(keywordTableIsPerfect(),
+	      "keyword hash collides; pick new multipliers in keywordHash");
+
+} // namespace detail
+
+/// Keyword TokenType for an identifier-shaped lexeme, or IDENT. One hash,
+/// one table load and one short compare; no allocation or static init.
+constexpr TokenType classifyIdentifier(std::string_view text) noexcept {
+	if (text.size() < detail::KEYWORD_MIN_LENGTH ||
+	    text.size() > detail::KEYWORD_MAX_LENGTH) {
+		return TokenType::IDENT;
+	}
+	const auto &entry = detail::KEYWORD_TABLE[detail::keywordHash(text)];
+	return entry.text == text ? entry.type : TokenType::IDENT;
+}
+
+} // namespace frontend
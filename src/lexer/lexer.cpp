@@ -1,37 +1,113 @@
 #include "lexer.hpp"
+#include "char_class.hpp"
 #include "diagnostics/diagnostics.hpp"
+#include "keywords.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
+#include "structural_index.hpp"
+#include "support/fatal.hpp"
 #include "token.hpp"
-#include <cctype>
+#include "token_buffer.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <charconv>
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
 
 namespace frontend {
-Lexer::Lexer(std::string src, ErrorReporter &errors)
-    : source(std::move(src)), errors(errors), src_length(source.length()),
-      position(0), line(1), column(1),
-      current(source.empty() ? '\0' : source[0]) {}
+Lexer::Lexer(FileID file, ErrorReporter &errors, LexerBackend backend)
+    : Lexer(errors.sources().text(file), file, 0, errors, backend) {}
+
+Lexer::Lexer(std::string src, ErrorReporter &errors, LexerBackend backend)
+    : Lexer(errors.sources().addBuffer(UNNAMED_INPUT,
+				       SourceBuffer(std::move(src))),
+	    errors, backend) {
+	owner = FileOwner(errors.sources(), file);
+	errorsBefore = errors.getErrors().size();
+}
 
-void Lexer::advance() noexcept {
-	if (current == '\n') {
-		line++;
-		column = 1;
+Lexer::Lexer(const SourceBuffer &src, ErrorReporter &errors,
+	     LexerBackend backend)
+    : Lexer(errors.sources().addBuffer(UNNAMED_INPUT,
+				       SourceBuffer::borrow(src.text())),
+	    errors, backend) {
+	owner = FileOwner(errors.sources(), file);
+	errorsBefore = errors.getErrors().size();
+}
+
+Lexer::Lexer(std::string_view slice, FileID file, uint32_t origin,
+	     ErrorReporter &errors, LexerBackend backend)
+    : file(file), source(slice), origin(origin), errors(errors),
+      src_length(source.length()), position(0),
+      current(source.empty() ? '\0' : source[0]), backend(backend),
+      index(source) {}
+
+Lexer::~Lexer() {
+	if (!owner) {
+		return;
 	}
-	else {
-		column++;
+	// diagnostics that point into the file keep it until they are cleared
+	const auto &kept = errors.getErrors();
+	auto first = kept.begin() + static_cast<std::ptrdiff_t>(
+					std::min(errorsBefore, kept.size()));
+	if (std::any_of(first, kept.end(), [this](const CompilerError &err) {
+		    return err.location.file == file;
+	    })) {
+		errors.hold(std::move(owner));
 	}
+}
 
+void Lexer::advance() noexcept {
 	position++;
 	current = (position < src_length) ? source[position] : '\0';
 }
 
+// Jumps forward to `end`
+void Lexer::advanceTo(size_t end) noexcept {
+	position = end;
+	current = (position < src_length) ? source[position] : '\0';
+}
+
+// Structural backend: moves to the first byte at or after `position` whose
+// bit is set in `select(masks)`, or to the end of input
+template <typename Select> void Lexer::skipUntil(Select select) noexcept {
+	while (position < src_length) {
+		size_t block = position / BLOCK_SIZE;
+		size_t base = block * BLOCK_SIZE;
+		size_t valid = std::min(src_length - base, BLOCK_SIZE);
+		const BlockMasks &masks = index.block(block);
+
+		uint64_t from = ~uint64_t{0} << (position - base);
+		uint64_t hits = select(masks) & from;
+		if (valid < BLOCK_SIZE) {
+			hits &= (uint64_t{1} << valid) - 1;
+		}
+		size_t stop = hits != 0 ? std::countr_zero(hits) : valid;
+		position = base + stop;
+
+		if (hits != 0) {
+			break;
+		}
+	}
+	current = (position < src_length) ? source[position] : '\0';
+}
+
 char Lexer::peekNext() noexcept {
-	return (position < src_length) ? source[position + 1] : '\0';
+	return (position + 1 < src_length) ? source[position + 1] : '\0';
 }
 
 void Lexer::skipWhitespace() noexcept {
-	while (position < src_length &&
-	       isspace(static_cast<unsigned char>(current)) != 0) {
+	if (backend == LexerBackend::STRUCTURAL) {
+		skipUntil([](const BlockMasks &m) { return ~m.space; });
+		return;
+	}
+	while (position < src_length && isSpace(current)) {
 		advance();
 	}
 }
@@ -40,6 +116,9 @@ void Lexer::skipSingleLineComment() noexcept {
 	advance(); // consume '/'
 	advance(); // consume '/'
 
+	if (backend == LexerBackend::STRUCTURAL) {
+		skipUntil([](const BlockMasks &m) { return m.newline; });
+	}
 	while (position < src_length && current != '\n') {
 		advance();
 	}
@@ -50,14 +129,17 @@ void Lexer::skipSingleLineComment() noexcept {
 }
 
 void Lexer::skipMultiLineComment() {
-	size_t start_line = line;
-	size_t start_column = column;
+	size_t start = position;
 
 	advance(); // consume '/'
 	advance(); // consume '*'
 
 	while (position < src_length &&
 	       !(current == '*' && peekNext() == '/')) {
+		if (backend == LexerBackend::STRUCTURAL && current != '*') {
+			skipUntil([](const BlockMasks &m) { return m.star; });
+			continue;
+		}
 		advance();
 	}
 
@@ -66,8 +148,7 @@ void Lexer::skipMultiLineComment() {
 		advance(); // consume '/'
 	}
 	else {
-		errors.error("unterminated block comment", start_line,
-			     start_column, ErrorPhase::LEXER);
+		errors.report(DiagID::UNTERMINATED_BLOCK_COMMENT, at(start));
 	}
 }
 
@@ -90,136 +171,123 @@ void Lexer::skipTrivia() {
 
 // Determines identifier
 Token Lexer::identifier() {
-	size_t startLine = line;
-	size_t startColumn = column;
-
-	std::string text;
-	text += current;
-	advance();
-
-	while (std::isalnum(static_cast<unsigned char>(current)) != 0 ||
-	       current == '_') {
-		text += current;
-		advance();
-	}
-
-	auto it = KEYWORDS.find(text);
-	if (it != KEYWORDS.end()) {
-		return {it->second, text, startLine, startColumn};
-	}
-	return {TokenType::IDENT, text, startLine, startColumn};
+	size_t start = position;
+	advanceTo(scanIdentifier(source, position + 1));
+	return tokenFrom(classifyIdentifier(lexemeFrom(start)), start);
 }
 
-// Determines number
+// Determines number and converts it while the digits are in cache
 Token Lexer::number() {
-	size_t startLine = line;
-	size_t startColumn = column;
+	size_t start = position;
+	advanceTo(scanDigits(source, position + 1));
 
-	std::string text;
-	text += current;
-	advance();
-
-	while (std::isdigit(static_cast<unsigned char>(current)) != 0) {
-		text += current;
-		advance();
+	// check for float or double
+	bool fraction = current == '.' && isDigit(peekNext());
+	if (fraction) {
+		advanceTo(scanDigits(source, position + 1));
 	}
 
-	// check for float or double
-	if (current == '.' &&
-	    std::isdigit(static_cast<unsigned char>(peekNext())) != 0) {
-		text += current;
-		advance();
-		while (std::isdigit(static_cast<unsigned char>(current)) != 0) {
-			text += current;
-			advance();
-		}
+	std::string_view digits = lexemeFrom(start);
+	const char *first = digits.data();
+	const char *last = first + digits.size();
+	Token token;
+	std::from_chars_result converted;
+	if (fraction) {
+		token = tokenFrom(TokenType::FLOAT_LIT, start);
+		converted = std::from_chars(first, last, token.floatValue,
+					    std::chars_format::fixed);
+	}
+	else {
+		token = tokenFrom(TokenType::INT_LIT, start);
+		converted = std::from_chars(first, last, token.intValue);
 	}
 
-	return {TokenType::NUMBER_LIT, text, startLine, startColumn};
+	if (converted.ec == std::errc::result_out_of_range) {
+		errors.report(fraction ? DiagID::FLOAT_OUT_OF_RANGE
+				       : DiagID::INT_TOO_LARGE,
+			      at(start));
+		return tokenFrom(TokenType::INVALID, start);
+	}
+	return token;
 }
 
 // Determine char literal
 Token Lexer::char_lit() {
-	size_t startLine = line;
-	size_t startColumn = column;
-
-	std::string text;
-	text += current; // Opening '
-	advance();
+	size_t start = position;
+	advance(); // Opening '
 
 	// Regular character
 	if (current != '\'' && position < src_length) {
-		text += current;
 		advance();
 	}
 
 	// Check for more than one character
 	if (current != '\'') {
 		while (current != '\'' && position < src_length) {
-			text += current;
 			advance();
 		}
 		if (current == '\'') {
-			text += current;
 			advance();
-			errors.error("character literal must contain exactly "
-				     "one character",
-				     startLine, startColumn, ErrorPhase::LEXER);
-			return {TokenType::INVALID, text, startLine,
-				startColumn};
+			errors.report(DiagID::CHAR_LITERAL_LENGTH, at(start));
+			return tokenFrom(TokenType::INVALID, start);
 		}
-		errors.error("unterminated char literal", startLine,
-			     startColumn, ErrorPhase::LEXER);
-		return {TokenType::INVALID, text, startLine, startColumn};
+		errors.report(DiagID::UNTERMINATED_CHAR, at(start));
+		return tokenFrom(TokenType::INVALID, start);
 	}
 
-	text += current; // Closing '
-	advance();
+	advance(); // Closing '
 
-	return {TokenType::CHAR_LIT, text, startLine, startColumn};
+	return tokenFrom(TokenType::CHAR_LIT, start);
 }
 
 // Determine string literal
 Token Lexer::string_lit() {
-	size_t startLine = line;
-	size_t startColumn = column;
-
-	std::string text;
-	text += current; // add open qoutes
-	advance();
+	size_t start = position;
+	advance(); // open qoutes
 
+	if (backend == LexerBackend::STRUCTURAL) {
+		skipUntil([](const BlockMasks &m) { return m.quote; });
+	}
 	while (current != '"' && position < src_length) {
-		text += current;
 		advance();
 	}
 	if (position >= src_length) {
-		errors.error("unterminated string literal", startLine,
-			     startColumn, ErrorPhase::LEXER);
-		return {TokenType::INVALID, text, startLine, startColumn};
+		errors.report(DiagID::UNTERMINATED_STRING, at(start));
+		return tokenFrom(TokenType::INVALID, start);
 	}
-	text += current; // add closing qoutes
-	advance();
-	return {TokenType::STRING_LIT, text, startLine, startColumn};
+	advance(); // closing qoutes
+	return tokenFrom(TokenType::STRING_LIT, start);
 }
 
-// Constructs token
-Token Lexer::makeToken(TokenType type, const std::string &lexme,
-		       size_t start_column) {
-	Token token(type, lexme, line, start_column);
+// View of the source consumed since `start`
+std::string_view Lexer::lexemeFrom(size_t start) const noexcept {
+	return source.substr(start, position - start);
+}
+
+SourceLocation Lexer::at(size_t offset) const noexcept {
+	return {file, origin + static_cast<uint32_t>(offset)};
+}
+
+// Token spanning the source consumed since `start`
+Token Lexer::tokenFrom(TokenType type, size_t start) const noexcept {
+	return {type, lexemeFrom(start), origin + static_cast<uint32_t>(start)};
+}
+
+// Consumes the current character and constructs a token ending with it
+Token Lexer::makeToken(TokenType type, size_t start) {
 	advance();
-	return token;
+	return tokenFrom(type, start);
 }
 
 // Tokenizer
 Token Lexer::tokenize() {
-	size_t start_line = line;
-	size_t start_column = column;
+	size_t start = position;
 
-	if (std::isalpha(static_cast<unsigned char>(current)) != 0) {
+	if (isIdentStart(current)) {
 		return identifier();
 	}
 
-	if (std::isdigit(static_cast<unsigned char>(current)) != 0) {
+	if (isDigit(current)) {
 		return number();
 	}
 
@@ -236,172 +304,193 @@ Token Lexer::tokenize() {
 	case '+':
 		advance();
 		if (current == '+') {
-			return makeToken(TokenType::PLUS_PLUS, "++",
-					 start_column);
+			return makeToken(TokenType::PLUS_PLUS, start);
 		}
 		if (current == '=') {
-			return makeToken(TokenType::PLUS_EQUAL,
-					 "+=", start_column);
+			return makeToken(TokenType::PLUS_EQUAL, start);
 		}
-		return {TokenType::PLUS, "+", start_line, start_column};
+		return tokenFrom(TokenType::PLUS, start);
 	case '-':
 		advance();
 		if (current == '-') {
-			return makeToken(TokenType::MINUS_MINUS, "--",
-					 start_column);
+			return makeToken(TokenType::MINUS_MINUS, start);
 		}
 		if (current == '=') {
-			return makeToken(TokenType::MINUS_EQUAL,
-					 "-=", start_column);
+			return makeToken(TokenType::MINUS_EQUAL, start);
 		}
 		if (current == '>') {
-			return makeToken(TokenType::ARROW, "->", start_column);
+			return makeToken(TokenType::ARROW, start);
 		}
-		return {TokenType::MINUS, "-", start_line, start_column};
+		return tokenFrom(TokenType::MINUS, start);
 	case '*':
 		advance();
 		if (current == '=') {
-			return makeToken(TokenType::STAR_EQUAL,
-					 "*=", start_column);
+			return makeToken(TokenType::STAR_EQUAL, start);
 		}
-		return {TokenType::STAR, "*", start_line, start_column};
+		return tokenFrom(TokenType::STAR, start);
 	case '/':
 		advance();
 		if (current == '=') {
-			return makeToken(TokenType::SLASH_EQUAL,
-					 "/=", start_column);
+			return makeToken(TokenType::SLASH_EQUAL, start);
 		}
-		return {TokenType::SLASH, "/", start_line, start_column};
+		return tokenFrom(TokenType::SLASH, start);
 	case '%':
 		advance();
 		if (current == '=') {
-			return makeToken(TokenType::PERCENT_EQUAL,
-					 "%=", start_column);
+			return makeToken(TokenType::PERCENT_EQUAL, start);
 		}
-		return {TokenType::PERCENT, "%", start_line, start_column};
+		return tokenFrom(TokenType::PERCENT, start);
 	case '=':
 		advance();
 		if (current == '=') {
-			return makeToken(TokenType::EQUAL_EQUAL,
-					 "==", start_column);
+			return makeToken(TokenType::EQUAL_EQUAL, start);
 		}
-		return {TokenType::EQUAL, "=", start_line, start_column};
+		return tokenFrom(TokenType::EQUAL, start);
 	case '!':
 		advance();
 		if (current == '=') {
-			return makeToken(TokenType::EXCLAMATION_EQUAL,
-					 "!=", start_column);
+			return makeToken(TokenType::EXCLAMATION_EQUAL, start);
 		}
-		return {TokenType::EXCLAMATION, "!", start_line, start_column};
+		return tokenFrom(TokenType::EXCLAMATION, start);
 	case '>':
 		advance();
 		if (current == '=') {
-			return makeToken(TokenType::GREATER_EQUAL,
-					 ">=", start_column);
+			return makeToken(TokenType::GREATER_EQUAL, start);
 		}
 		if (current == '>') {
 			advance();
 			if (current == '=') {
 				return makeToken(
-				    TokenType::GREATER_GREATER_EQUAL,
-				    ">>=", start_column);
+				    TokenType::GREATER_GREATER_EQUAL, start);
 			}
-			return {TokenType::GREATER_GREATER, ">>", start_line,
-				start_column};
+			return tokenFrom(TokenType::GREATER_GREATER, start);
 		}
-		return {TokenType::GREATER, ">", start_line, start_column};
+		return tokenFrom(TokenType::GREATER, start);
 	case '<':
 		advance();
 		if (current == '=') {
-			return makeToken(TokenType::LESS_EQUAL,
-					 "<=", start_column);
+			return makeToken(TokenType::LESS_EQUAL, start);
 		}
 		if (current == '<') {
 			advance();
 			if (current == '=') {
 				return makeToken(TokenType::LESS_LESS_EQUAL,
-						 "<<=", start_column);
+						 start);
 			}
-			return {TokenType::LESS_LESS, "<<", start_line,
-				start_column};
+			return tokenFrom(TokenType::LESS_LESS, start);
 		}
-		return {TokenType::LESS, "<", start_line, start_column};
+		return tokenFrom(TokenType::LESS, start);
 	case '&':
 		advance();
 		if (current == '&') {
-			return makeToken(TokenType::AMPERSAND_AMPERSAND, "&&",
-					 start_column);
+			return makeToken(TokenType::AMPERSAND_AMPERSAND, start);
 		}
 		if (current == '=') {
-			return makeToken(TokenType::AMPERSAND_EQUAL,
-					 "&=", start_column);
+			return makeToken(TokenType::AMPERSAND_EQUAL, start);
 		}
-		return {TokenType::AMPERSAND, "&", start_line, start_column};
+		return tokenFrom(TokenType::AMPERSAND, start);
 	case '|':
 		advance();
 		if (current == '|') {
-			return makeToken(TokenType::PIPE_PIPE, "||",
-					 start_column);
+			return makeToken(TokenType::PIPE_PIPE, start);
 		}
 		if (current == '=') {
-			return makeToken(TokenType::PIPE_EQUAL,
-					 "|=", start_column);
+			return makeToken(TokenType::PIPE_EQUAL, start);
 		}
-		return {TokenType::PIPE, "|", start_line, start_column};
+		return tokenFrom(TokenType::PIPE, start);
 	case '^':
 		advance();
 		if (current == '=') {
-			return makeToken(TokenType::CARET_EQUAL,
-					 "^=", start_column);
+			return makeToken(TokenType::CARET_EQUAL, start);
 		}
-		return {TokenType::CARET, "^", start_line, start_column};
+		return tokenFrom(TokenType::CARET, start);
 	case '~':
-		return makeToken(TokenType::TILDE, "~", start_column);
+		return makeToken(TokenType::TILDE, start);
 	case '@':
-		return makeToken(TokenType::AT, "@", start_column);
+		return makeToken(TokenType::AT, start);
 	case '.':
-		return makeToken(TokenType::DOT, ".", start_column);
+		return makeToken(TokenType::DOT, start);
 	case '?':
-		return makeToken(TokenType::QUESTION, "?", start_column);
+		return makeToken(TokenType::QUESTION, start);
 	// Delimiters
 	case ':':
 		advance();
 		if (current == ':') {
-			return makeToken(TokenType::COLON_COLON,
-					 "::", start_column);
+			return makeToken(TokenType::COLON_COLON, start);
 		}
-		return {TokenType::COLON, ":", start_line, start_column};
+		return tokenFrom(TokenType::COLON, start);
 	case ';':
-		return makeToken(TokenType::SEMICOLON, ";", start_column);
+		return makeToken(TokenType::SEMICOLON, start);
 	case ',':
-		return makeToken(TokenType::COMMA, ",", start_column);
+		return makeToken(TokenType::COMMA, start);
 	case '[':
-		return makeToken(TokenType::LBRACKET, "[", start_column);
+		return makeToken(TokenType::LBRACKET, start);
 	case ']':
-		return makeToken(TokenType::RBRACKET, "]", start_column);
+		return makeToken(TokenType::RBRACKET, start);
 	case '(':
-		return makeToken(TokenType::LPAREN, "(", start_column);
+		return makeToken(TokenType::LPAREN, start);
 	case ')':
-		return makeToken(TokenType::RPAREN, ")", start_column);
+		return makeToken(TokenType::RPAREN, start);
 	case '{':
-		return makeToken(TokenType::LBRACE, "{", start_column);
+		return makeToken(TokenType::LBRACE, start);
 	case '}':
-		return makeToken(TokenType::RBRACE, "}", start_column);
+		return makeToken(TokenType::RBRACE, start);
 	default:
-		errors.error("unexpected character '" +
-				 std::string(1, current) + "'",
-			     line, column, ErrorPhase::LEXER);
-		return makeToken(TokenType::INVALID, std::string(1, current),
-				 start_column);
+		errors.report(DiagID::UNEXPECTED_CHARACTER, at(start),
+			      DiagArg::character(current));
+		return makeToken(TokenType::INVALID, start);
 	}
 }
 
-Token Lexer::get() {
+Token Lexer::lex() {
 	skipTrivia();
 	if (position >= src_length) {
-		return {TokenType::T_EOF, "\0", line, column};
+		return {TokenType::T_EOF, std::string_view{},
+			origin + static_cast<uint32_t>(position)};
 	}
 	return tokenize();
 }
 
+Token Lexer::peek(size_t n) {
+	// the ring holds no more; further would overwrite buffered tokens
+	if (n >= MAX_PEEK) {
+		fatal("token lookahead past MAX_PEEK");
+	}
+	while (aheadCount <= n) {
+		ahead[(aheadHead + aheadCount) & (MAX_PEEK - 1)] = lex();
+		aheadCount++;
+	}
+	return ahead[(aheadHead + n) & (MAX_PEEK - 1)];
+}
+
+Token Lexer::get() {
+	if (aheadCount == 0) {
+		return lex();
+	}
+	Token token = ahead[aheadHead];
+	aheadHead = (aheadHead + 1) & (MAX_PEEK - 1);
+	aheadCount--;
+	return token;
+}
+
+void Lexer::seek(size_t offset) noexcept {
+	aheadCount = 0;
+	position = offset;
+	current = (position < src_length) ? source[position] : '\0';
+}
+
+TokenBuffer Lexer::lexAll() {
+	assert(origin == 0); // buffers index the whole file's text
+	TokenBuffer tokens(file, source, owner);
+	// about one token per four bytes of typical code; avoids most regrowth
+	tokens.reserve(((src_length - position) / 4) + 1);
+	while (true) {
+		Token token = get();
+		tokens.push(token);
+		if (token.type == TokenType::T_EOF) {
+			return tokens;
+		}
+	}
+}
+
 } // namespace frontend
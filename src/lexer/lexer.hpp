@@ -1,60 +1,53 @@
 #pragma once
 
 #include "diagnostics/diagnostics.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
+#include "structural_index.hpp"
 #include "token.hpp"
+#include "token_buffer.hpp"
+#include <array>
 #include <cstddef>
+#include <cstdint>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 
 namespace frontend {
+
+/// How the lexer walks whitespace, comments and string bodies: one byte at
+/// a time, or by jumping between set bits of the 64-byte block masks in a
+/// StructuralIndex. Tokens are classified by the same code either way, so
+/// both produce identical tokens and diagnostics.
+enum class LexerBackend : std::uint8_t { SCALAR, STRUCTURAL };
+
+/// How many tokens past the next one Lexer::peek() can see.
+inline constexpr size_t MAX_PEEK = 8;
+
 class Lexer {
 private:
-	std::string source; // source code
+	FileID file;
+	std::string_view source; // source code; token lexemes view into it
+	uint32_t origin = 0;     // offset of source[0] within `file`
 	ErrorReporter &errors;
 	size_t src_length;
 	size_t position;
-	size_t line;
-	size_t column;
 	char current;
+	LexerBackend backend;
+	StructuralIndex index;
+	// the unnamed file the lexer registered itself, if it did, and how
+	// many diagnostics were kept before it could have any
+	FileOwner owner;
+	size_t errorsBefore = 0;
 
-	// Initialize keyword map
-	static inline const std::unordered_map<std::string, TokenType>
-	    KEYWORDS = {{"func", TokenType::FUNC},
-			{"var", TokenType::VAR},
-			{"infer", TokenType::INFER},
-			{"if", TokenType::IF},
-			{"else", TokenType::ELSE},
-			{"for", TokenType::FOR},
-			{"do", TokenType::DO},
-			{"while", TokenType::WHILE},
-			{"return", TokenType::RETURN},
-			{"break", TokenType::BREAK},
-			{"continue", TokenType::CONTINUE},
-
-			{"switch", TokenType::SWITCH},
-			{"case", TokenType::CASE},
-			{"default", TokenType::DEFAULT},
-
-			{"struct", TokenType::STRUCT},
-			{"enum", TokenType::ENUM},
-
-			{"const", TokenType::CONST},
-			{"static", TokenType::STATIC},
-
-			{"namespace", TokenType::NAMESPACE},
-			{"import", TokenType::IMPORT},
-
-			{"int", TokenType::INT},
-			{"float", TokenType::FLOAT},
-			{"double", TokenType::DOUBLE},
-			{"char", TokenType::CHAR},
-			{"bool", TokenType::BOOL},
-			{"void", TokenType::VOID},
-			{"string", TokenType::STRING},
-			{"true", TokenType::TRUE},
-			{"false", TokenType::FALSE}};
+	// ring of tokens lexed by peek() but not yet returned by get()
+	static_assert((MAX_PEEK & (MAX_PEEK - 1)) == 0);
+	std::array<Token, MAX_PEEK> ahead;
+	size_t aheadHead = 0;
+	size_t aheadCount = 0;
 
 	void advance() noexcept;
+	void advanceTo(size_t end) noexcept;
+	template <typename Select> void skipUntil(Select select) noexcept;
 	char peekNext() noexcept;
 	void skipWhitespace() noexcept;
 	void skipSingleLineComment() noexcept;
@@ -66,15 +59,59 @@ private:
 	Token string_lit();
 	Token char_lit();
 
-	Token makeToken(TokenType type, const std::string &lexme,
-			size_t start_column);
+	[[nodiscard]] SourceLocation at(size_t offset) const noexcept;
+	[[nodiscard]] std::string_view lexemeFrom(size_t start) const noexcept;
+	[[nodiscard]] Token tokenFrom(TokenType type,
+				      size_t start) const noexcept;
+	Token makeToken(TokenType type, size_t start);
 	Token tokenize();
+	Token lex();
 
 public:
-	Lexer(std::string src, ErrorReporter &errors);
+	// Name given to text lexed without a file of its own
+	static constexpr const char *UNNAMED_INPUT = "<input>";
+
+	// Lexes a file registered with `errors.sources()`
+	Lexer(FileID file, ErrorReporter &errors,
+	      LexerBackend backend = LexerBackend::SCALAR);
+	// Registers a copy of `src` as an unnamed file. It is released once
+	// the lexer, every TokenBuffer from its lexAll() and the diagnostics
+	// `errors` kept for it by the time the lexer is destroyed are gone;
+	// ErrorReporter::clear() lets go of those
+	Lexer(std::string src, ErrorReporter &errors,
+	      LexerBackend backend = LexerBackend::SCALAR);
+	// Zero-copy: registers a view of `src`, which must outlive every
+	// token and diagnostic; released the same way
+	Lexer(const SourceBuffer &src, ErrorReporter &errors,
+	      LexerBackend backend = LexerBackend::SCALAR);
+	// Lexes `slice`, the part of `file` starting at byte `origin`, for
+	// callers that hold only a window of the file's text; tokens and
+	// diagnostics carry offsets into the whole file
+	Lexer(std::string_view slice, FileID file, uint32_t origin,
+	      ErrorReporter &errors,
+	      LexerBackend backend = LexerBackend::SCALAR);
 
-	Token peek();
+	// Tokens view into `source`, which must not move under them
+	Lexer(const Lexer &) = delete;
+	Lexer &operator=(const Lexer &) = delete;
+	Lexer(Lexer &&) = delete;
+	Lexer &operator=(Lexer &&) = delete;
+	~Lexer();
+
+	[[nodiscard]] FileID fileID() const noexcept { return file; }
+
+	// Token `n` places after the one get() returns next, for n below
+	// MAX_PEEK; anything further is a fatal error, in release builds too.
+	// O(1) apart from lexing it, never allocates. Diagnostics for peeked
+	// tokens are reported when they are lexed.
+	Token peek(size_t n = 0);
 	Token get();
+
+	// Restarts at `offset`, which must be 0 or the end of a token
+	void seek(size_t offset) noexcept;
+
+	// Lexes the rest of the input, through T_EOF, in a single pass
+	TokenBuffer lexAll();
 };
 
 } // namespace frontend
@@ -0,0 +1,190 @@
+#include "parallel_lexer.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer.hpp"
+#include "source/source_manager.hpp"
+#include "support/thread_pool.hpp"
+#include "token.hpp"
+#include "token_buffer.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace frontend {
+
+namespace {
+// How far into a chunk guessContext() looks
+constexpr size_t CONTEXT_WINDOW = 256;
+
+// Tokens one chunk produced from its guessed start, with what is needed
+// to splice a suffix of them into the true stream. Lexing of token i
+// began at `start` for i == 0 and at the end of token i - 1 otherwise.
+struct ChunkTokens {
+	TokenBuffer tokens;
+	uint32_t start = 0;
+	// (token index, diagnostics raised before lexing it) for each token
+	// whose lexing raised one
+	std::vector<std::pair<size_t, size_t>> errorMarks;
+	std::vector<CompilerError> errors;
+
+	ChunkTokens(FileID file, std::string_view text) : tokens(file, text) {}
+
+	[[nodiscard]] uint32_t resumeOf(size_t index) const noexcept {
+		return index == 0 ? start : tokens.end(index - 1);
+	}
+	// Index of the token whose lexing began at `resume`, or SIZE_MAX
+	[[nodiscard]] size_t find(uint32_t resume) const noexcept {
+		if (tokens.size() == 0 || resume < start) {
+			return SIZE_MAX;
+		}
+		if (resume == start) {
+			return 0;
+		}
+		size_t low = 0;
+		size_t high = tokens.size() - 1;
+		while (low < high) {
+			size_t mid = low + ((high - low) / 2);
+			if (tokens.end(mid) < resume) {
+				low = mid + 1;
+			}
+			else {
+				high = mid;
+			}
+		}
+		return tokens.end(low) == resume ? low + 1 : SIZE_MAX;
+	}
+	// Diagnostics raised before lexing token `index`
+	[[nodiscard]] size_t errorsBefore(size_t index) const noexcept {
+		for (const auto &[token, raised] : errorMarks) {
+			if (token >= index) {
+				return raised;
+			}
+		}
+		return errors.size();
+	}
+};
+
+// Lexes the tokens that start in [begin, end), from a guessed context
+ChunkTokens lexChunk(FileID file, SourceManager &sources, size_t begin,
+		     size_t end, LexerBackend backend) {
+	std::string_view text = sources.text(file);
+	size_t start = begin;
+	switch (guessContext(text, begin)) {
+	case ChunkContext::BLOCK_COMMENT:
+		start = text.find("*/", begin) + 2;
+		break;
+	case ChunkContext::STRING:
+		start = text.find('"', begin) + 1;
+		break;
+	case ChunkContext::CODE:
+		break;
+	}
+
+	ChunkTokens chunk(file, text);
+	chunk.start = static_cast<uint32_t>(start);
+	chunk.tokens.reserve(((end - begin) / 4) + 1);
+	ErrorReporter errors(sources);
+	Lexer lexer(file, errors, backend);
+	lexer.seek(start);
+	while (true) {
+		size_t raised = errors.getErrors().size();
+		Token token = lexer.get();
+		if (errors.getErrors().size() != raised) {
+			chunk.errorMarks.emplace_back(chunk.tokens.size(),
+						      raised);
+		}
+		if (token.type != TokenType::T_EOF && token.offset >= end) {
+			// diagnostics for that token belong to the next chunk
+			auto kept = errors.getErrors().begin() +
+				    static_cast<std::ptrdiff_t>(raised);
+			chunk.errors.assign(errors.getErrors().begin(), kept);
+			return chunk;
+		}
+		chunk.tokens.push(token);
+		if (token.type == TokenType::T_EOF) {
+			chunk.errors = errors.getErrors();
+			return chunk;
+		}
+	}
+}
+
+} // namespace
+
+ChunkContext guessContext(std::string_view text, size_t start) noexcept {
+	std::string_view window = text.substr(start, CONTEXT_WINDOW);
+	size_t close = window.find("*/");
+	if (close != std::string_view::npos && close < window.find("/*")) {
+		return ChunkContext::BLOCK_COMMENT;
+	}
+	std::string_view line = window.substr(0, window.find('\n'));
+	if (std::count(line.begin(), line.end(), '"') % 2 == 1) {
+		return ChunkContext::STRING;
+	}
+	return ChunkContext::CODE;
+}
+
+TokenBuffer lexParallel(FileID file, ErrorReporter &errors, ThreadPool &pool,
+			size_t chunkSize, LexerBackend backend) {
+	SourceManager &sources = errors.sources();
+	std::string_view text = sources.text(file);
+	size_t count = std::max<size_t>(1, (text.size() + chunkSize - 1) /
+						   chunkSize);
+
+	std::vector<ChunkTokens> chunks(count, ChunkTokens(file, text));
+	pool.forEach(count, [&](size_t k) {
+		// the last chunk also owns the EOF token at text.size()
+		size_t begin = k * chunkSize;
+		size_t end =
+		    k + 1 == count ? text.size() + 1 : begin + chunkSize;
+		chunks[k] = lexChunk(file, sources, begin, end, backend);
+	});
+
+	TokenBuffer tokens(file, text);
+	tokens.reserve((text.size() / 4) + 1);
+	Lexer lexer(file, errors, backend);
+	uint32_t resume = 0;
+
+	// Lexes one token of the true stream; false once it reaches EOF
+	auto lexOne = [&] {
+		lexer.seek(resume);
+		Token token = lexer.get();
+		tokens.push(token);
+		resume = tokens.end(tokens.size() - 1);
+		return token.type != TokenType::T_EOF;
+	};
+
+	for (const ChunkTokens &chunk : chunks) {
+		if (chunk.tokens.size() == 0) {
+			continue;
+		}
+		size_t last = chunk.tokens.size() - 1;
+		while (resume <= chunk.resumeOf(last)) {
+			size_t first = chunk.find(resume);
+			if (first == SIZE_MAX) {
+				if (!lexOne()) {
+					return tokens;
+				}
+				continue;
+			}
+
+			for (size_t e = chunk.errorsBefore(first);
+			     e < chunk.errors.size(); e++) {
+				errors.report(chunk.errors[e]);
+			}
+			tokens.append(chunk.tokens, first);
+			if (chunk.tokens.type(last) == TokenType::T_EOF) {
+				return tokens;
+			}
+			resume = chunk.tokens.end(last);
+			break;
+		}
+	}
+
+	while (lexOne()) {
+	}
+	return tokens;
+}
+
+} // namespace frontend
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "diagnostics/diagnostics.hpp"
+#include "lexer.hpp"
+#include "source/source_manager.hpp"
+#include "support/thread_pool.hpp"
+#include "token_buffer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace frontend {
+
+/// What a chunk boundary is guessed to fall inside of.
+enum class ChunkContext : std::uint8_t { CODE, BLOCK_COMMENT, STRING };
+
+/// Guesses the context at `start` from the text just after it: a "*/"
+/// before any "/*" means a block comment, an odd number of quotes before
+/// the end of the line means a string literal.
+ChunkContext guessContext(std::string_view text, size_t start) noexcept;
+
+/// Lexes `file` in chunks of at least `chunkSize` bytes on `pool` and
+/// returns exactly the tokens and diagnostics a sequential lexAll() would.
+///
+/// Each chunk is lexed from a guessed starting context, the way parallel
+/// CSV and JSON parsers speculate on quoting. The chunks are then stitched
+/// in order: because the lexer keeps no state between tokens, a chunk's
+/// tokens are adopted from the first point where it resumed lexing at the
+/// same offset as the true stream. A wrong guess only costs lexing the
+/// text up to that point sequentially.
+TokenBuffer lexParallel(FileID file, ErrorReporter &errors, ThreadPool &pool,
+			size_t chunkSize = 1 << 16,
+			LexerBackend backend = LexerBackend::SCALAR);
+
+} // namespace frontend
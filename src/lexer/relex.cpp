@@ -0,0 +1,77 @@
+#include "relex.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer.hpp"
+#include "source/source_manager.hpp"
+#include "token.hpp"
+#include "token_buffer.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace frontend {
+
+namespace {
+// How far past its end a token's lexing can look ("1" peeks at ".5")
+constexpr uint32_t MAX_LOOKAHEAD = 2;
+
+// First index in [low, high) for which `past` holds; `past` must be false
+// then true across the range
+template <typename Pred>
+size_t partitionPoint(size_t low, size_t high, Pred past) {
+	while (low < high) {
+		size_t mid = low + ((high - low) / 2);
+		if (past(mid)) {
+			high = mid;
+		}
+		else {
+			low = mid + 1;
+		}
+	}
+	return low;
+}
+} // namespace
+
+RelexRange relex(TokenBuffer &tokens, FileID edited, const TextEdit &edit,
+		 ErrorReporter &errors, LexerBackend backend) {
+	const size_t eof = tokens.size() - 1;
+	const int64_t shift =
+	    static_cast<int64_t>(edit.inserted) - edit.removed;
+	const size_t editEnd = static_cast<size_t>(edit.offset) + edit.inserted;
+
+	// tokens before `first` end early enough to be untouched
+	size_t first = partitionPoint(0, eof, [&](size_t i) {
+		return tokens.end(i) + MAX_LOOKAHEAD > edit.offset;
+	});
+	size_t resume = 0;
+	if (first > 0) {
+		resume = tokens.end(first - 1);
+	}
+
+	Lexer lexer(edited, errors, backend);
+	lexer.seek(resume);
+	TokenBuffer fresh(edited, errors.sources().text(edited));
+
+	size_t last = eof + 1;
+	while (true) {
+		Token token = lexer.get();
+		if (token.offset >= editEnd) {
+			// an old token at the same text means the rest matches
+			int64_t old = token.offset - shift;
+			size_t match = partitionPoint(
+			    first, eof + 1,
+			    [&](size_t i) { return tokens.offset(i) >= old; });
+			if (match <= eof && tokens.offset(match) == old) {
+				last = match;
+				break;
+			}
+		}
+		fresh.push(token);
+		if (token.type == TokenType::T_EOF) {
+			break;
+		}
+	}
+
+	tokens.splice(first, last, fresh, shift);
+	return {first, last - first, fresh.size()};
+}
+
+} // namespace frontend
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "diagnostics/diagnostics.hpp"
+#include "lexer.hpp"
+#include "source/source_manager.hpp"
+#include "token_buffer.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace frontend {
+
+/// One text replacement: `removed` bytes at `offset` became `inserted`
+/// bytes.
+struct TextEdit {
+	uint32_t offset;
+	uint32_t removed;
+	uint32_t inserted;
+};
+
+/// Tokens [first, first + removed) of the old stream were replaced by
+/// [first, first + inserted) of the new one; everything else is unchanged
+/// apart from offsets past the edit.
+struct RelexRange {
+	size_t first;
+	size_t removed;
+	size_t inserted;
+};
+
+/// Brings `tokens`, lexed from the text before `edit`, up to date with
+/// `edited`, the file in `errors.sources()` holding the text after it:
+/// another file, or the same one after SourceManager::replace().
+///
+/// The lexer carries no state between tokens, so the end of every token
+/// is a checkpoint it can resume from. Lexing restarts at the last token
+/// that ends far enough before the edit for lookahead not to reach it,
+/// and stops at the first new token past the edit that starts where an
+/// old token started: from there on both texts are identical, so are the
+/// tokens. An edit that opens or closes a block comment or string keeps
+/// going until that stops being true. Only diagnostics for the re-lexed
+/// range are reported to `errors`.
+RelexRange relex(TokenBuffer &tokens, FileID edited, const TextEdit &edit,
+		 ErrorReporter &errors,
+		 LexerBackend backend = LexerBackend::SCALAR);
+
+} // namespace frontend
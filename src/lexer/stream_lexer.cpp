@@ -0,0 +1,213 @@
+#include "stream_lexer.hpp"
+#include "char_class.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer.hpp"
+#include "source/line_table.hpp"
+#include "source/source_manager.hpp"
+#include "token.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <utility>
+
+namespace frontend {
+
+namespace {
+// The lexer looks at most this far past the end of a token
+constexpr size_t MAX_LOOKAHEAD = 2;
+} // namespace
+
+StreamLexer::StreamLexer(int fd, std::istream *in, std::string name,
+			 ErrorReporter &errors, size_t windowSize)
+    : fd(fd), in(in), errors(errors),
+      file(errors.sources().addStream(std::move(name))),
+      window(std::max(windowSize, MAX_LOOKAHEAD + 1)) {}
+
+StreamLexer::StreamLexer(int fd, std::string name, ErrorReporter &errors,
+			 size_t windowSize)
+    : StreamLexer(fd, nullptr, std::move(name), errors, windowSize) {}
+
+StreamLexer::StreamLexer(std::istream &in, std::string name,
+			 ErrorReporter &errors, size_t windowSize)
+    : StreamLexer(-1, &in, std::move(name), errors, windowSize) {}
+
+// Moves the unread bytes to the front of the window and reads more after
+// them; false once the input is exhausted
+bool StreamLexer::refill() {
+	if (exhausted) {
+		return false;
+	}
+	if (begin > 0) {
+		std::copy(window.begin() + static_cast<std::ptrdiff_t>(begin),
+			  window.begin() + static_cast<std::ptrdiff_t>(end),
+			  window.begin());
+		origin += static_cast<uint32_t>(begin);
+		end -= begin;
+		begin = 0;
+	}
+	if (end == window.size()) {
+		// a single token fills the whole window
+		window.resize(window.size() * 2);
+	}
+
+	// locations hold 32-bit offsets, so nothing past them is read
+	size_t room =
+	    size_t{std::numeric_limits<uint32_t>::max()} - origin - end;
+	if (room == 0) {
+		errors.sources().pin(at(end), locate(end));
+		errors.report(DiagID::INPUT_TOO_LARGE, at(end));
+		exhausted = true;
+		return false;
+	}
+	size_t wanted = std::min(window.size() - end, room);
+
+	size_t read = 0;
+	if (in != nullptr) {
+		in->read(window.data() + end,
+			 static_cast<std::streamsize>(wanted));
+		read = static_cast<size_t>(in->gcount());
+	}
+	else {
+		char *into = window.data() + end;
+		ssize_t n = 0;
+		do {
+			n = ::read(fd, into, wanted);
+		} while (n < 0 && errno == EINTR);
+		if (n < 0) {
+			errors.sources().pin(at(end), locate(end));
+			errors.report(DiagID::CANNOT_READ, at(end),
+				      DiagArg::error(errno));
+			n = 0;
+		}
+		read = static_cast<size_t>(n);
+	}
+
+	if (read == 0) {
+		exhausted = true;
+		return false;
+	}
+	end += read;
+	return true;
+}
+
+void StreamLexer::consume(size_t count) noexcept {
+	where = locate(begin + count);
+	begin += count;
+}
+
+SourceLocation StreamLexer::at(size_t index) const noexcept {
+	return {file, origin + static_cast<uint32_t>(index)};
+}
+
+// Line and column of window[index], counted on from window[begin]
+LineColumn StreamLexer::locate(size_t index) const noexcept {
+	LineColumn result = where;
+	for (size_t i = begin; i < index; i++) {
+		if (window[i] == '\n') {
+			result.line++;
+			result.column = 1;
+		}
+		else {
+			result.column++;
+		}
+	}
+	return result;
+}
+
+// Skips whitespace and comments the way Lexer does, discarding them from
+// the window as it goes
+void StreamLexer::skipTrivia() {
+	while (true) {
+		// "//" and "/*" need two bytes to recognize
+		while (end - begin < 2 && refill()) {
+		}
+		if (begin == end) {
+			return;
+		}
+
+		char c = window[begin];
+		char next = begin + 1 < end ? window[begin + 1] : '\0';
+		if (isSpace(c)) {
+			consume(1);
+			continue;
+		}
+		if (c != '/' || (next != '/' && next != '*')) {
+			return;
+		}
+
+		if (next == '/') {
+			consume(2);
+			while (true) {
+				std::string_view unread(window.data() + begin,
+							end - begin);
+				size_t newline = unread.find('\n');
+				if (newline != std::string_view::npos) {
+					consume(newline + 1);
+					break;
+				}
+				consume(end - begin);
+				if (!refill()) {
+					break;
+				}
+			}
+			continue;
+		}
+
+		SourceLocation start = at(begin);
+		LineColumn startWhere = where;
+		consume(2);
+		while (true) {
+			std::string_view unread(window.data() + begin,
+						end - begin);
+			size_t close = unread.find("*/");
+			if (close != std::string_view::npos) {
+				consume(close + 2);
+				break;
+			}
+			// a trailing '*' may be closed by the next byte read
+			size_t kept = unread.ends_with('*') ? 1 : 0;
+			consume(unread.size() - kept);
+			if (!refill()) {
+				errors.sources().pin(start, startWhere);
+				errors.report(
+				    DiagID::UNTERMINATED_BLOCK_COMMENT, start);
+				consume(end - begin);
+				return;
+			}
+		}
+	}
+}
+
+Token StreamLexer::get() {
+	skipTrivia();
+	while (true) {
+		std::string_view unread(window.data() + begin, end - begin);
+		ErrorReporter attempt(errors.sources());
+		Lexer lexer(unread, file, at(begin).offset, attempt);
+		Token token = lexer.get();
+
+		// the lexer may have stopped only because the window ended;
+		// a refill moves the text, so lex again even if it read nothing
+		if (!exhausted &&
+		    token.lexeme.size() + MAX_LOOKAHEAD > unread.size()) {
+			refill();
+			continue;
+		}
+
+		for (const CompilerError &err : attempt.getErrors()) {
+			errors.sources().pin(
+			    err.location, locate(err.location.offset - origin));
+			errors.report(err);
+		}
+		consume(token.lexeme.size());
+		return token;
+	}
+}
+
+} // namespace frontend
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "diagnostics/diagnostics.hpp"
+#include "source/line_table.hpp"
+#include "source/source_manager.hpp"
+#include "token.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace frontend {
+
+/// Bytes a StreamLexer reads per refill unless told otherwise.
+inline constexpr size_t STREAM_WINDOW = 1 << 16;
+
+/// Lexes input that is read once from a file descriptor or std::istream
+/// through a fixed-size window, so memory stays constant however large
+/// the input is.
+///
+/// Whitespace and comments are skipped as the window slides and never
+/// need to fit in it. Each token is lexed by an ordinary Lexer over the
+/// unread part of the window; a token that runs into the end of the window
+/// is lexed again after a refill, which moves it to the front. The window
+/// only grows when a single token, such as a very long string literal, is
+/// larger than it.
+///
+/// Produces the same tokens and diagnostics as a Lexer over the whole
+/// text. The input is registered with SourceManager::addStream() under
+/// `name`, and the line and column of each diagnostic are pinned while
+/// the text is still in the window.
+///
+/// Locations hold 32-bit offsets, so nothing past the first 4 GiB is read:
+/// lexing ends there with an INPUT_TOO_LARGE diagnostic, in release builds
+/// too.
+class StreamLexer {
+	int fd = -1;
+	std::istream *in = nullptr;
+	ErrorReporter &errors;
+	FileID file;
+
+	// unread input is window[begin, end); window[0] is at stream offset
+	// `origin`
+	std::vector<char> window;
+	size_t begin = 0;
+	size_t end = 0;
+	uint32_t origin = 0;
+	bool exhausted = false;
+	LineColumn where{1, 1}; // of window[begin]
+
+	StreamLexer(int fd, std::istream *in, std::string name,
+		    ErrorReporter &errors, size_t windowSize);
+
+	bool refill();
+	void consume(size_t count) noexcept;
+	[[nodiscard]] SourceLocation at(size_t index) const noexcept;
+	[[nodiscard]] LineColumn locate(size_t index) const noexcept;
+	void skipTrivia();
+
+public:
+	/// Reads from `fd`, which is left open.
+	StreamLexer(int fd, std::string name, ErrorReporter &errors,
+		    size_t windowSize = STREAM_WINDOW);
+	StreamLexer(std::istream &in, std::string name, ErrorReporter &errors,
+		    size_t windowSize = STREAM_WINDOW);
+
+	// Tokens view into the window
+	StreamLexer(const StreamLexer &) = delete;
+	StreamLexer &operator=(const StreamLexer &) = delete;
+	StreamLexer(StreamLexer &&) = delete;
+	StreamLexer &operator=(StreamLexer &&) = delete;
+	~StreamLexer() = default;
+
+	[[nodiscard]] FileID fileID() const noexcept { return file; }
+	/// Bytes currently held for the input.
+	[[nodiscard]] size_t capacity() const noexcept {
+		return window.size();
+	}
+
+	/// Next token; its lexeme stays valid until the following call.
+	Token get();
+};
+
+} // namespace frontend
@@ -0,0 +1,111 @@
+#include "structural_index.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace frontend {
+
+#if defined(__SSE2__)
+namespace {
+// One 64-bit mask from the four 16-byte lane compares of a block
+template <typename Compare>
+uint64_t blockMask(const __m128i (&lanes)[4], Compare compare) noexcept {
+	uint64_t mask = 0;
+	for (size_t i = 0; i < 4; i++) {
+		auto bits = static_cast<uint32_t>(
+		    _mm_movemask_epi8(compare(lanes[i])));
+		mask |= static_cast<uint64_t>(bits) << (16 * i);
+	}
+	return mask;
+}
+} // namespace
+
+BlockMasks classifyBlock(const char *block) noexcept {
+	__m128i lanes[4];
+	for (size_t i = 0; i < 4; i++) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		lanes[i] = _mm_loadu_si128(
+		    reinterpret_cast<const __m128i *>(block + (16 * i)));
+	}
+
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i star = _mm_set1_epi8('*');
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i blank = _mm_set1_epi8(' ');
+	// \t \n \v \f \r are 9..13; signed compares leave bytes >= 0x80 out
+	const __m128i below_tab = _mm_set1_epi8('\t' - 1);
+	const __m128i above_cr = _mm_set1_epi8('\r' + 1);
+
+	BlockMasks masks;
+	masks.quote = blockMask(
+	    lanes, [&](__m128i v) { return _mm_cmpeq_epi8(v, quote); });
+	masks.star = blockMask(
+	    lanes, [&](__m128i v) { return _mm_cmpeq_epi8(v, star); });
+	masks.newline = blockMask(
+	    lanes, [&](__m128i v) { return _mm_cmpeq_epi8(v, newline); });
+	masks.space = blockMask(lanes, [&](__m128i v) {
+		__m128i control = _mm_and_si128(_mm_cmpgt_epi8(v, below_tab),
+						_mm_cmplt_epi8(v, above_cr));
+		return _mm_or_si128(control, _mm_cmpeq_epi8(v, blank));
+	});
+	return masks;
+}
+#else
+BlockMasks classifyBlock(const char *block) noexcept {
+	BlockMasks masks;
+	for (size_t i = 0; i < BLOCK_SIZE; i++) {
+		uint64_t bit = uint64_t{1} << i;
+		switch (block[i]) {
+		case '"':
+			masks.quote |= bit;
+			break;
+		case '*':
+			masks.star |= bit;
+			break;
+		case '\n':
+			masks.newline |= bit;
+			masks.space |= bit;
+			break;
+		case ' ':
+		case '\t':
+		case '\v':
+		case '\f':
+		case '\r':
+			masks.space |= bit;
+			break;
+		default:
+			break;
+		}
+	}
+	return masks;
+}
+#endif
+
+const BlockMasks &StructuralIndex::block(size_t index) noexcept {
+	if (index == cachedBlock) {
+		return cached;
+	}
+
+	size_t begin = index * BLOCK_SIZE;
+	if (begin + BLOCK_SIZE <= text.size()) {
+		cached = classifyBlock(text.data() + begin);
+	}
+	else {
+		// pad the final partial block with NUL, which matches no mask
+		std::array<char, BLOCK_SIZE> tail{};
+		if (begin < text.size()) {
+			std::memcpy(tail.data(), text.data() + begin,
+				    text.size() - begin);
+		}
+		cached = classifyBlock(tail.data());
+	}
+	cachedBlock = index;
+	return cached;
+}
+
+} // namespace frontend
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace frontend {
+
+/// Stage-1 classification of one 64-byte block: bit i of each mask is set
+/// when byte i of the block is that kind of character.
+///
+/// Only the characters that end a run of trivia or string body have masks.
+/// Stage 2 does not cut the whole text into tokens from the masks, as a
+/// simdjson-style tokenizer would: Lexer is pulled a token at a time, and
+/// peek(), seek(), relex() and the parallel and streaming lexers all
+/// restart it at arbitrary offsets, which a precomputed list of boundaries
+/// would have to be rebuilt for. Tokens themselves are short, and
+/// identifiers and numbers are already scanned eight bytes at a time by
+/// char_class.hpp, so the masks are used where long runs are: whitespace,
+/// comments and string bodies. Comment-start and operator masks would have
+/// no reader and are left out.
+struct BlockMasks {
+	uint64_t quote = 0;   // '"'
+	uint64_t star = 0;    // '*'
+	uint64_t newline = 0; // '\n'
+	uint64_t space = 0;   // ' ' \t \n \v \f \r
+};
+
+inline constexpr size_t BLOCK_SIZE = 64;
+
+/// Classifies the 64 bytes at `block` (SSE2 when available).
+BlockMasks classifyBlock(const char *block) noexcept;
+
+/// Lazily classified view of a source buffer for the structural lexer
+/// backend. Blocks are aligned to the start of the text and computed on
+/// first use, so a lexer walking forward classifies every byte once;
+/// bytes past the end of the text read as NUL and match no mask.
+class StructuralIndex {
+	std::string_view text;
+	size_t cachedBlock = SIZE_MAX;
+	BlockMasks cached;
+
+public:
+	explicit StructuralIndex(std::string_view text) : text(text) {}
+
+	const BlockMasks &block(size_t index) noexcept;
+};
+
+} // namespace frontend
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <cstdint>
-#include <string>
+#include <string_view>
 
 namespace frontend {
 enum class TokenType : std::uint8_t {
@@ -91,7 +91,8 @@ enum class TokenType : std::uint8_t {
 	RBRACKET,  // ']'
 
 	// Literals
-	NUMBER_LIT,
+	INT_LIT,   // digits; the token carries the value
+	FLOAT_LIT, // digits '.' digits; the token carries the value
 	STRING_LIT,
 	CHAR_LIT,
 	IDENT,
@@ -103,13 +104,22 @@ enum class TokenType : std::uint8_t {
 	INVALID
 };
 
+/// `lexeme` views the lexer's source buffer rather than owning a copy, so
+/// a token must not outlive the buffer it was lexed from. The location is
+/// only a byte offset; a LineTable turns it into line/column on demand.
 struct Token {
-	TokenType type;
-	std::string lexeme;
-	size_t line;
-	size_t column;
+	TokenType type = TokenType::INVALID;
+	uint32_t offset = 0;
+	std::string_view lexeme;
+	// converted once by the lexer: intValue for INT_LIT, floatValue for
+	// FLOAT_LIT
+	union {
+		int64_t intValue = 0;
+		double floatValue;
+	};
 
-	Token(TokenType t, std::string lex, size_t ln, size_t col)
-	    : type(t), lexeme(std::move(lex)), line(ln), column(col) {}
+	Token() = default;
+	Token(TokenType t, std::string_view lex, uint32_t off)
+	    : type(t), offset(off), lexeme(lex) {}
 };
 } // namespace frontend
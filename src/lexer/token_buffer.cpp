@@ -0,0 +1,167 @@
+#include "token_buffer.hpp"
+#include "source/source_manager.hpp"
+#include "token.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace frontend {
+
+TokenBuffer::TokenBuffer(FileID file, std::string_view source,
+			 FileOwner owner)
+    : file(file), source(source), owner(std::move(owner)) {
+	// offsets are 32-bit to keep the arrays dense
+	assert(source.size() <= std::numeric_limits<uint32_t>::max());
+}
+
+void TokenBuffer::reserve(size_t count) {
+	head.types.reserve(count);
+	head.offsets.reserve(count);
+	head.lengths.reserve(count);
+}
+
+namespace {
+bool hasValue(TokenType type) noexcept {
+	return type == TokenType::INT_LIT || type == TokenType::FLOAT_LIT;
+}
+} // namespace
+
+void TokenBuffer::push(const Token &token) {
+	moveGap(size());
+	if (token.type == TokenType::INT_LIT) {
+		head.literals.push_back(
+		    {head.types.size(), static_cast<uint64_t>(token.intValue)});
+	}
+	else if (token.type == TokenType::FLOAT_LIT) {
+		head.literals.push_back(
+		    {head.types.size(),
+		     std::bit_cast<uint64_t>(token.floatValue)});
+	}
+	head.types.push_back(token.type);
+	head.offsets.push_back(token.offset);
+	head.lengths.push_back(static_cast<uint32_t>(token.lexeme.size()));
+}
+
+void TokenBuffer::append(const TokenBuffer &from, size_t first) {
+	moveGap(size());
+	insertAtGap(from, first);
+}
+
+void TokenBuffer::insertAtGap(const TokenBuffer &from, size_t first) {
+	// the part of `from` before its own gap in bulk, the rest one by one
+	const Run &run = from.head;
+	size_t gap = run.types.size();
+	if (first < gap) {
+		size_t shift = head.types.size() - first;
+		for (auto it = run.literalFrom(first); it != run.literals.end();
+		     ++it) {
+			head.literals.push_back({it->token + shift, it->bits});
+		}
+		auto begin = static_cast<std::ptrdiff_t>(first);
+		head.types.insert(head.types.end(), run.types.begin() + begin,
+				  run.types.end());
+		head.offsets.insert(head.offsets.end(),
+				    run.offsets.begin() + begin,
+				    run.offsets.end());
+		head.lengths.insert(head.lengths.end(),
+				    run.lengths.begin() + begin,
+				    run.lengths.end());
+	}
+	for (size_t i = std::max(first, gap); i < from.size(); i++) {
+		TokenType type = from.type(i);
+		if (hasValue(type)) {
+			head.literals.push_back(
+			    {head.types.size(), from.literalBits(i)});
+		}
+		head.types.push_back(type);
+		head.offsets.push_back(from.offset(i));
+		head.lengths.push_back(from.length(i));
+	}
+}
+
+void TokenBuffer::moveGap(size_t index) {
+	size_t gap = head.types.size();
+	while (gap > index) {
+		gap--;
+		std::vector<Literal> &literals = head.literals;
+		if (!literals.empty() && literals.back().token == gap) {
+			tail.literals.push_back(
+			    {tail.types.size(), literals.back().bits});
+			literals.pop_back();
+		}
+		tail.types.push_back(head.types.back());
+		tail.offsets.push_back(head.offsets.back() - tailShift);
+		tail.lengths.push_back(head.lengths.back());
+		head.truncate(gap);
+	}
+	while (gap < index) {
+		size_t last = tail.types.size() - 1;
+		std::vector<Literal> &literals = tail.literals;
+		if (!literals.empty() && literals.back().token == last) {
+			head.literals.push_back({gap, literals.back().bits});
+			literals.pop_back();
+		}
+		head.types.push_back(tail.types.back());
+		head.offsets.push_back(tail.offsets.back() + tailShift);
+		head.lengths.push_back(tail.lengths.back());
+		tail.truncate(last);
+		gap++;
+	}
+}
+
+void TokenBuffer::splice(size_t first, size_t last, const TokenBuffer &fresh,
+			 int64_t shift) {
+	assert(first <= last && last <= size());
+	moveGap(last);
+	head.literals.erase(head.literalFrom(first), head.literals.end());
+	head.truncate(first);
+	// the tail keeps its stored offsets; a negative shift wraps around
+	tailShift += static_cast<uint32_t>(shift);
+	insertAtGap(fresh, 0);
+	file = fresh.file;
+	source = fresh.source;
+	owner = fresh.owner;
+}
+
+void TokenBuffer::Run::truncate(size_t count) {
+	types.resize(count);
+	offsets.resize(count);
+	lengths.resize(count);
+}
+
+std::vector<TokenBuffer::Literal>::const_iterator
+TokenBuffer::Run::literalFrom(size_t index) const noexcept {
+	return std::lower_bound(literals.begin(), literals.end(), index,
+				[](const Literal &literal, size_t token) {
+					return literal.token < token;
+				});
+}
+
+uint64_t TokenBuffer::literalBits(size_t index) const noexcept {
+	bool inHead = index < head.types.size();
+	const Run &run = inHead ? head : tail;
+	size_t at = inHead ? index : fromEnd(index);
+	auto literal = run.literalFrom(at);
+	assert(literal != run.literals.end() && literal->token == at);
+	return literal->bits;
+}
+
+Token TokenBuffer::at(size_t index) const noexcept {
+	size_t i = clamp(index);
+	Token token(type(i), lexeme(i), offset(i));
+	if (token.type == TokenType::INT_LIT) {
+		token.intValue = static_cast<int64_t>(literalBits(i));
+	}
+	else if (token.type == TokenType::FLOAT_LIT) {
+		token.floatValue = std::bit_cast<double>(literalBits(i));
+	}
+	return token;
+}
+
+} // namespace frontend
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "source/source_manager.hpp"
+#include "token.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace frontend {
+
+/// Whole-file token stream in structure-of-arrays form, filled by
+/// Lexer::lexAll(). Token i is (type(i), offset(i), length(i)); the last
+/// entry is always T_EOF, so indexing past the end is clamped to it.
+/// Values of numeric literals are kept on the side, since few tokens
+/// have one.
+///
+/// The arrays have a gap where the last splice() was: tokens before it
+/// are in `head` in order, tokens after it in `tail` last token first,
+/// with their offsets stored less `tailShift`. An edit moves the gap to
+/// itself and shifts the tail by adjusting `tailShift`, so it costs the
+/// tokens it replaces and those between it and the previous edit, not
+/// the rest of the file. A buffer that was never spliced has no tail.
+class TokenBuffer {
+	struct Literal {
+		size_t token; // index in its run
+		uint64_t bits; // intValue, or the bits of floatValue
+	};
+	struct Run {
+		std::vector<TokenType> types;
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> lengths;
+		std::vector<Literal> literals; // sorted by token
+
+		// First literal of a token at or after `index`
+		[[nodiscard]] std::vector<Literal>::const_iterator
+		literalFrom(size_t index) const noexcept;
+		void truncate(size_t count);
+	};
+
+	FileID file;
+	std::string_view source;
+	FileOwner owner;
+	Run head;
+	Run tail;
+	uint32_t tailShift = 0; // added to tail offsets, modulo 2^32
+
+public:
+	// With an `owner`, the file stays registered while the buffer lives
+	TokenBuffer(FileID file, std::string_view source,
+		    FileOwner owner = {});
+
+	void reserve(size_t count);
+	void push(const Token &token);
+	/// Appends tokens [first, from.size()) of a buffer over the same text.
+	void append(const TokenBuffer &from, size_t first);
+
+	/// Replaces tokens [first, last) with every token of `fresh` and takes
+	/// over its file, text and owner; offsets of the tokens after the range
+	/// move by `shift` bytes.
+	void splice(size_t first, size_t last, const TokenBuffer &fresh,
+		    int64_t shift);
+
+	[[nodiscard]] FileID fileID() const noexcept { return file; }
+	[[nodiscard]] size_t size() const noexcept {
+		return head.types.size() + tail.types.size();
+	}
+	[[nodiscard]] TokenType type(size_t index) const noexcept {
+		size_t i = clamp(index);
+		return i < head.types.size() ? head.types[i]
+					     : tail.types[fromEnd(i)];
+	}
+	[[nodiscard]] uint32_t offset(size_t index) const noexcept {
+		size_t i = clamp(index);
+		return i < head.types.size()
+			   ? head.offsets[i]
+			   : tail.offsets[fromEnd(i)] + tailShift;
+	}
+	[[nodiscard]] uint32_t length(size_t index) const noexcept {
+		size_t i = clamp(index);
+		return i < head.types.size() ? head.lengths[i]
+					     : tail.lengths[fromEnd(i)];
+	}
+	[[nodiscard]] uint32_t end(size_t index) const noexcept {
+		return offset(index) + length(index);
+	}
+	[[nodiscard]] std::string_view lexeme(size_t index) const noexcept {
+		return source.substr(offset(index), length(index));
+	}
+
+	/// Rebuilds the AoS view of token `index` for code that wants one.
+	[[nodiscard]] Token at(size_t index) const noexcept;
+
+private:
+	// Moves the gap to before token `index`
+	void moveGap(size_t index);
+	// Appends at the gap, which must be at the end or be followed by the
+	// tokens that come after `from`'s
+	void insertAtGap(const TokenBuffer &from, size_t first);
+	// Value of the literal token `index`
+	[[nodiscard]] uint64_t literalBits(size_t index) const noexcept;
+
+	[[nodiscard]] size_t clamp(size_t index) const noexcept {
+		size_t count = size();
+		return index < count ? index : count - 1;
+	}
+	// Position in `tail` of token `index`, which is past the gap
+	[[nodiscard]] size_t fromEnd(size_t index) const noexcept {
+		return size() - 1 - index;
+	}
+};
+
+} // namespace frontend
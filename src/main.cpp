@@ -1,6 +1,93 @@
+#include "diagnostics/diagnostics.hpp"
+#include "driver/driver.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
 
-int main() {
-	std::cout << "Adequate-C";
-	return 0;
+namespace {
+constexpr const char *USAGE =
+    "usage: adequatec [--syntax-only] [-ferror-limit=N] [-jN] file...\n";
+constexpr std::string_view ERROR_LIMIT = "-ferror-limit=";
+constexpr std::string_view JOBS = "-j";
+
+// Reads all of `value` as a count
+bool parseCount(std::string_view value, size_t &count) {
+	const char *last = value.data() + value.size();
+	auto [end, ec] = std::from_chars(value.data(), last, count);
+	return ec == std::errc() && end == last;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+	bool syntaxOnly = false;
+	size_t errorLimit = 0;
+	size_t jobs = 1;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		std::string_view arg = argv[i];
+		if (arg == "--syntax-only") {
+			syntaxOnly = true;
+		}
+		else if (arg.starts_with(ERROR_LIMIT)) {
+			std::string_view value = arg.substr(ERROR_LIMIT.size());
+			if (!parseCount(value, errorLimit)) {
+				std::cerr << "adequatec: invalid error limit '"
+					  << value << "'\n";
+				return 2;
+			}
+		}
+		else if (arg.starts_with(JOBS)) {
+			std::string_view value = arg.substr(JOBS.size());
+			if (!parseCount(value, jobs)) {
+				std::cerr << "adequatec: invalid job count '"
+					  << value << "'\n";
+				return 2;
+			}
+		}
+		else if (arg.starts_with("-")) {
+			std::cerr << "adequatec: unknown option '" << arg
+				  << "'\n"
+				  << USAGE;
+			return 2;
+		}
+		else {
+			paths.emplace_back(arg);
+		}
+	}
+	if (paths.empty()) {
+		std::cout << "Adequate-C\n" << USAGE;
+		return 0;
+	}
+
+	frontend::SourceManager sources;
+	frontend::ErrorReporter errors(sources);
+	errors.setErrorLimit(errorLimit);
+	std::vector<frontend::FileID> files;
+	for (const std::string &path : paths) {
+		std::optional<frontend::FileID> file = sources.addFile(path);
+		if (!file) {
+			// registered empty, so the diagnostic can name it
+			int err = errno;
+			frontend::FileID unread =
+			    sources.addBuffer(path, frontend::SourceBuffer());
+			errors.report(frontend::DiagID::CANNOT_READ,
+				      {unread, 0},
+				      frontend::DiagArg::error(err));
+			errors.printAll();
+			return 2;
+		}
+		files.push_back(*file);
+	}
+
+	frontend::compileFiles(files, errors, {syntaxOnly, jobs});
+	errors.printAll();
+	return errors.hasErrors() ? 1 : 0;
 }
@@ -0,0 +1,377 @@
+#include "builder.hpp"
+#include "ast/ast.hpp"
+#include "ast/flat_ast.hpp"
+#include "lexer/token_buffer.hpp"
+#include "syntax_tree.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace frontend {
+
+namespace {
+// A green node of `kind` with no children yet
+GreenNode leaf(ast::NodeKind kind, uint8_t op = 0) {
+	GreenNode node{};
+	node.kind = kind;
+	node.op = op;
+	return node;
+}
+} // namespace
+
+FlatRef FlatBuilder::build(Tag<ast::NumberLiteralAST>, int64_t value) {
+	return FlatRef(flat->intLiteral(value));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::NumberLiteralAST>, double value) {
+	return FlatRef(flat->floatLiteral(value));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::StringLiteralAST>, std::string_view value) {
+	return FlatRef(flat->stringLiteral(std::string(value)));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::CharLiteralAST>, char value) {
+	return FlatRef(flat->charLiteral(value));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::BoolLiteralAST>, bool value) {
+	return FlatRef(flat->boolLiteral(value));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::UnaryExprAST>, ast::UnaryOp op,
+			   FlatRef operand) {
+	return FlatRef(flat->unary(op, operand.id()));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::BinaryExprAST>, ast::BinaryOp op,
+			   FlatRef lhs, FlatRef rhs) {
+	return FlatRef(flat->binary(op, lhs.id(), rhs.id()));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::TernaryExprAST>, FlatRef condition,
+			   FlatRef thenBranch, FlatRef elseBranch) {
+	return FlatRef(flat->ternary(condition.id(), thenBranch.id(),
+				     elseBranch.id()));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::VariableExprAST>,
+			   ast::QualifiedName name) {
+	return FlatRef(flat->variable(std::move(name)));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::CallExprAST>, FlatRef callee,
+			   const Ids &args) {
+	return FlatRef(flat->call(callee.id(), args));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::BlockStmtAST>, const Ids &stmts) {
+	return FlatRef(flat->block(stmts));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::ReturnStmtAST>, FlatRef value) {
+	return FlatRef(flat->returnStmt(value.id()));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::BreakStmtAST>) {
+	return FlatRef(flat->breakStmt());
+}
+
+FlatRef FlatBuilder::build(Tag<ast::ContinueStmtAST>) {
+	return FlatRef(flat->continueStmt());
+}
+
+FlatRef FlatBuilder::build(Tag<ast::AssignmentStmtAST>,
+			   std::string_view variable, ast::AssignOp op,
+			   FlatRef value) {
+	return FlatRef(flat->assignment(std::string(variable), op, value.id()));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::IfStmtAST>, FlatRef condition,
+			   FlatRef thenBranch, FlatRef elseBranch) {
+	return FlatRef(flat->ifStmt(condition.id(), thenBranch.id(),
+				    elseBranch.id()));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::ForStmtAST>, FlatRef init,
+			   FlatRef condition, FlatRef update, FlatRef body) {
+	return FlatRef(flat->forStmt(init.id(), condition.id(), update.id(),
+				     body.id()));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::WhileStmtAST>, FlatRef condition,
+			   FlatRef body) {
+	return FlatRef(flat->whileStmt(condition.id(), body.id()));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::DeclStmtAST>, FlatRef decl) {
+	return FlatRef(flat->declStmt(decl.id()));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::ErrorStmtAST>, uint32_t begin,
+			   uint32_t end) {
+	return FlatRef(flat->errorStmt(begin, end));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::VariableDeclarationAST>, TypeRef type,
+			   std::string_view name, FlatRef size, FlatRef init) {
+	return FlatRef(
+	    flat->varDecl(type, std::string(name), size.id(), init.id()));
+}
+
+std::unique_ptr<FlatBuilder::Prototype>
+FlatBuilder::build(Tag<ast::PrototypeAST>, ast::QualifiedName name,
+		   Params params, TypeRef returnType) {
+	return std::make_unique<Prototype>(
+	    Prototype{std::move(name), std::move(params), returnType});
+}
+
+FlatRef FlatBuilder::build(Tag<ast::FunctionAST>,
+			   std::unique_ptr<Prototype> proto, FlatRef body) {
+	return FlatRef(flat->function(std::move(proto->name), proto->params,
+				      proto->returnType, body.id()));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::StructAST>, std::string_view name,
+			   const Ids &fields, const Ids &methods) {
+	return FlatRef(flat->structDecl(std::string(name), fields, methods));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::NamespaceAST>, std::string_view name,
+			   const Ids &decls) {
+	return FlatRef(flat->namespaceDecl(std::string(name), decls));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::ErrorDeclAST>, uint32_t begin,
+			   uint32_t end) {
+	return FlatRef(flat->errorDecl(begin, end));
+}
+
+FlatRef FlatBuilder::build(Tag<ast::ProgramAST>, const Ids &decls) {
+	return FlatRef(flat->program(decls));
+}
+
+GreenRef GreenBuilder::finish(TokenSpan span, GreenNode node,
+			      std::span<const GreenRef> children) const {
+	size_t first = span.first;
+	for (const GreenRef &child : children) {
+		if (child && child.first < first) {
+			first = child.first;
+		}
+	}
+	uint32_t start = tokens->offset(first);
+	node.width = static_cast<uint32_t>(span.end - first);
+	node.length =
+	    span.end > first ? tokens->end(span.end - 1) - start : 0;
+	node.children.reserve(children.size());
+	for (const GreenRef &child : children) {
+		if (!child) {
+			node.children.push_back({});
+			continue;
+		}
+		node.children.push_back(
+		    {static_cast<uint32_t>(child.first - first),
+		     tokens->offset(child.first) - start, child.node});
+	}
+	return {std::make_shared<const GreenNode>(std::move(node)), first};
+}
+
+GreenRef GreenBuilder::build(Tag<ast::NumberLiteralAST>, TokenSpan span,
+			     int64_t value) const {
+	GreenNode node = leaf(ast::NodeKind::INT_LITERAL);
+	node.value = value;
+	return finish(span, std::move(node), {});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::NumberLiteralAST>, TokenSpan span,
+			     double value) const {
+	GreenNode node = leaf(ast::NodeKind::FLOAT_LITERAL);
+	node.value = value;
+	return finish(span, std::move(node), {});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::StringLiteralAST>, TokenSpan span,
+			     std::string_view value) const {
+	GreenNode node = leaf(ast::NodeKind::STRING_LITERAL);
+	node.value = std::string(value);
+	return finish(span, std::move(node), {});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::CharLiteralAST>, TokenSpan span,
+			     char value) const {
+	return finish(span,
+		      leaf(ast::NodeKind::CHAR_LITERAL,
+			   static_cast<uint8_t>(value)),
+		      {});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::BoolLiteralAST>, TokenSpan span,
+			     bool value) const {
+	return finish(span, leaf(ast::NodeKind::BOOL_LITERAL, value ? 1 : 0),
+		      {});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::UnaryExprAST>, TokenSpan span,
+			     ast::UnaryOp op, GreenRef operand) const {
+	return finish(span,
+		      leaf(ast::NodeKind::UNARY, static_cast<uint8_t>(op)),
+		      std::array{std::move(operand)});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::BinaryExprAST>, TokenSpan span,
+			     ast::BinaryOp op, GreenRef lhs,
+			     GreenRef rhs) const {
+	return finish(span,
+		      leaf(ast::NodeKind::BINARY, static_cast<uint8_t>(op)),
+		      std::array{std::move(lhs), std::move(rhs)});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::TernaryExprAST>, TokenSpan span,
+			     GreenRef condition, GreenRef thenBranch,
+			     GreenRef elseBranch) const {
+	return finish(span, leaf(ast::NodeKind::TERNARY),
+		      std::array{std::move(condition), std::move(thenBranch),
+				 std::move(elseBranch)});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::VariableExprAST>, TokenSpan span,
+			     ast::QualifiedName name) const {
+	GreenNode node = leaf(ast::NodeKind::VARIABLE);
+	node.value = std::move(name);
+	return finish(span, std::move(node), {});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::CallExprAST>, TokenSpan span,
+			     GreenRef callee, const Refs &args) const {
+	Refs children{std::move(callee)};
+	children.insert(children.end(), args.begin(), args.end());
+	return finish(span, leaf(ast::NodeKind::CALL), children);
+}
+
+GreenRef GreenBuilder::build(Tag<ast::BlockStmtAST>, TokenSpan span,
+			     const Refs &stmts) const {
+	return finish(span, leaf(ast::NodeKind::BLOCK), stmts);
+}
+
+GreenRef GreenBuilder::build(Tag<ast::ReturnStmtAST>, TokenSpan span,
+			     GreenRef value) const {
+	return finish(span, leaf(ast::NodeKind::RETURN),
+		      std::array{std::move(value)});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::BreakStmtAST>, TokenSpan span) const {
+	return finish(span, leaf(ast::NodeKind::BREAK), {});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::ContinueStmtAST>, TokenSpan span) const {
+	return finish(span, leaf(ast::NodeKind::CONTINUE), {});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::AssignmentStmtAST>, TokenSpan span,
+			     std::string_view variable, ast::AssignOp op,
+			     GreenRef value) const {
+	GreenNode node =
+	    leaf(ast::NodeKind::ASSIGNMENT, static_cast<uint8_t>(op));
+	node.value = std::string(variable);
+	return finish(span, std::move(node), std::array{std::move(value)});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::IfStmtAST>, TokenSpan span,
+			     GreenRef condition, GreenRef thenBranch,
+			     GreenRef elseBranch) const {
+	return finish(span, leaf(ast::NodeKind::IF),
+		      std::array{std::move(condition), std::move(thenBranch),
+				 std::move(elseBranch)});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::ForStmtAST>, TokenSpan span,
+			     GreenRef init, GreenRef condition,
+			     GreenRef update, GreenRef body) const {
+	return finish(span, leaf(ast::NodeKind::FOR),
+		      std::array{std::move(init), std::move(condition),
+				 std::move(update), std::move(body)});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::WhileStmtAST>, TokenSpan span,
+			     GreenRef condition, GreenRef body) const {
+	return finish(span, leaf(ast::NodeKind::WHILE),
+		      std::array{std::move(condition), std::move(body)});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::DeclStmtAST>, TokenSpan span,
+			     GreenRef decl) const {
+	return finish(span, leaf(ast::NodeKind::DECL_STMT),
+		      std::array{std::move(decl)});
+}
+
+// A green node's bytes are its tokens', so the range is not kept twice
+GreenRef GreenBuilder::build(Tag<ast::ErrorStmtAST>, TokenSpan span,
+			     uint32_t /*begin*/, uint32_t /*end*/) const {
+	return finish(span, leaf(ast::NodeKind::ERROR_STMT), {});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::VariableDeclarationAST>, TokenSpan span,
+			     TypeRef type, std::string_view name, GreenRef size,
+			     GreenRef init) const {
+	GreenNode node = leaf(ast::NodeKind::VAR_DECL);
+	node.typed.push_back({type, std::string(name)});
+	return finish(span, std::move(node),
+		      std::array{std::move(size), std::move(init)});
+}
+
+std::unique_ptr<GreenBuilder::Prototype>
+GreenBuilder::build(Tag<ast::PrototypeAST>, TokenSpan span,
+		    ast::QualifiedName name, Params params,
+		    TypeRef returnType) {
+	return std::make_unique<Prototype>(Prototype{
+	    std::move(name), std::move(params), returnType, span.first});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::FunctionAST>, TokenSpan span,
+			     std::unique_ptr<Prototype> proto,
+			     GreenRef body) const {
+	GreenNode node = leaf(ast::NodeKind::FUNCTION);
+	node.value = std::move(proto->name);
+	node.typed.push_back({proto->returnType, {}});
+	for (auto &[type, name] : proto->params) {
+		node.typed.push_back({type, std::move(name)});
+	}
+	span.first = std::min(span.first, proto->first);
+	return finish(span, std::move(node), std::array{std::move(body)});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::StructAST>, TokenSpan span,
+			     std::string_view name, const Refs &fields,
+			     const Refs &methods) const {
+	GreenNode node = leaf(ast::NodeKind::STRUCT);
+	node.value = std::string(name);
+	node.fieldCount = static_cast<uint32_t>(fields.size());
+	Refs children = fields;
+	children.insert(children.end(), methods.begin(), methods.end());
+	return finish(span, std::move(node), children);
+}
+
+GreenRef GreenBuilder::build(Tag<ast::NamespaceAST>, TokenSpan span,
+			     std::string_view name, const Refs &decls) const {
+	GreenNode node = leaf(ast::NodeKind::NAMESPACE);
+	node.value = std::string(name);
+	return finish(span, std::move(node), decls);
+}
+
+GreenRef GreenBuilder::build(Tag<ast::ErrorDeclAST>, TokenSpan span,
+			     uint32_t /*begin*/, uint32_t /*end*/) const {
+	return finish(span, leaf(ast::NodeKind::ERROR_DECL), {});
+}
+
+GreenRef GreenBuilder::build(Tag<ast::ProgramAST>, TokenSpan span,
+			     const Refs &decls) const {
+	return finish(span, leaf(ast::NodeKind::PROGRAM), decls);
+}
+
+} // namespace frontend
@@ -0,0 +1,461 @@
+#pragma once
+
+#include "ast/ast.hpp"
+#include "ast/decl.hpp"
+#include "ast/expr.hpp"
+#include "ast/flat_ast.hpp"
+#include "ast/stmt.hpp"
+#include "lexer/token_buffer.hpp"
+#include "support/arena.hpp"
+#include "syntax_tree.hpp"
+#include "types/type.hpp"
+#include "types/type_context.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace frontend {
+
+// Tokens [first, end) of the buffer a node was parsed from; meaningless
+// when the parser pulls from a Lexer
+struct TokenSpan {
+	size_t first;
+	size_t end;
+};
+
+// A Builder is the policy BasicParser constructs its results through. Each
+// one provides:
+//
+//   Node<T>            what a parse of a T returns; compares equal to
+//                      nullptr when the parse failed
+//   List<T>            a list of Node<T>
+//   TypeRef, Params    a parsed type and a function's parameter list;
+//                      types come from the TypeContext it was given
+//   Name               a name, qualified or not
+//   LAZY_BODIES        whether function bodies may be deferred; if so
+//                      share<T>(args...) makes the one T the deferred
+//                      bodies of a parse are parsed from
+//   make<T>(span, args...)
+//                      a T spanning `span` from the arguments of T's
+//                      constructor
+//   list<T>(), append(list, node), cast<T>(node)
+//   type<T>(args...), params(), param(params, type, name)
+//   name(text), qualify(name, text)
+//                      a name, and the same name under `::text`
+//
+// Names and string literals are passed as views of the source text, so a
+// builder that keeps them copies them and one that does not allocates
+// nothing for them.
+
+// Builds the pointer AST, in `arena` if there is one
+class TreeBuilder {
+	types::TypeContext *typeContext;
+	Arena *arena = nullptr;
+
+	// the tree owns its text, so views of the source are copied
+	template <typename Arg> static decltype(auto) own(Arg &&arg) {
+		if constexpr (std::is_same_v<std::remove_cvref_t<Arg>,
+					     std::string_view>) {
+			return std::string(arg);
+		}
+		else {
+			return std::forward<Arg>(arg);
+		}
+	}
+
+public:
+	template <typename T> using Node = std::unique_ptr<T>;
+	template <typename T> using List = ast::NodeList<T>;
+	using TypeRef = const types::Type *;
+	using Params = std::vector<std::pair<TypeRef, std::string>>;
+	using Name = ast::QualifiedName;
+	static constexpr bool LAZY_BODIES = true;
+
+	// implicit, so a Parser can be given just the TypeContext
+	TreeBuilder(types::TypeContext &types, Arena *arena = nullptr) noexcept
+	    : typeContext(&types), arena(arena) {}
+
+	template <typename T, typename... Args>
+	std::unique_ptr<T> make(TokenSpan /*span*/, Args &&...args) const {
+		if constexpr (std::is_base_of_v<ast::ASTNode, T>) {
+			return ast::makeNode<T>(
+			    arena, own(std::forward<Args>(args))...);
+		}
+		else {
+			return std::make_unique<T>(
+			    own(std::forward<Args>(args))...);
+		}
+	}
+	template <typename T> [[nodiscard]] List<T> list() const {
+		return List<T>(arena != nullptr
+				   ? arena
+				   : std::pmr::get_default_resource());
+	}
+	// A T for many nodes to share, in the arena and not counted if
+	// there is one, so it lives as long as the tree either way
+	template <typename T, typename... Args>
+	std::shared_ptr<T> share(Args &&...args) const {
+		if (arena != nullptr) {
+			return std::shared_ptr<T>(
+			    std::shared_ptr<void>(),
+			    arena->create<T>(std::forward<Args>(args)...));
+		}
+		return std::make_shared<T>(std::forward<Args>(args)...);
+	}
+	template <typename T, typename U>
+	static void append(List<T> &list, Node<U> node) {
+		list.push_back(std::move(node));
+	}
+	// `node` must be a T
+	template <typename T, typename U> static Node<T> cast(Node<U> node) {
+		return Node<T>(static_cast<T *>(node.release()));
+	}
+
+	template <typename T, typename... Args>
+	TypeRef type(Args &&...args) const {
+		return typeContext->get<T>(std::forward<Args>(args)...);
+	}
+	[[nodiscard]] static Params params() { return {}; }
+	static void param(Params &params, TypeRef type, std::string_view name) {
+		params.emplace_back(type, std::string(name));
+	}
+	[[nodiscard]] static Name name(std::string_view text) {
+		return Name(std::string(text));
+	}
+	static void qualify(Name &name, std::string_view text) {
+		name.qualifiers.push_back(std::move(name.name));
+		name.name = std::string(text);
+	}
+};
+
+// A node of a FlatAST under construction; null if its parse failed
+class FlatRef {
+	ast::NodeID nodeID = ast::NO_NODE;
+
+public:
+	constexpr FlatRef() noexcept = default;
+	constexpr FlatRef(std::nullptr_t) noexcept {}
+	constexpr explicit FlatRef(ast::NodeID id) noexcept : nodeID(id) {}
+
+	[[nodiscard]] constexpr ast::NodeID id() const noexcept {
+		return nodeID;
+	}
+	constexpr explicit operator bool() const noexcept {
+		return nodeID != ast::NO_NODE;
+	}
+	constexpr bool operator==(std::nullptr_t) const noexcept {
+		return nodeID == ast::NO_NODE;
+	}
+};
+
+// Builds a FlatAST directly, without pointer nodes in between. Bodies are
+// always parsed eagerly.
+class FlatBuilder {
+	ast::FlatAST *flat;
+	types::TypeContext *typeContext;
+
+public:
+	using TypeRef = const types::Type *;
+	using Params = std::vector<std::pair<TypeRef, std::string>>;
+	// a FUNCTION node is added once its body is parsed
+	struct Prototype {
+		ast::QualifiedName name;
+		Params params;
+		TypeRef returnType;
+	};
+	template <typename T>
+	using Node = std::conditional_t<std::is_same_v<T, ast::PrototypeAST>,
+					std::unique_ptr<Prototype>, FlatRef>;
+	template <typename T> using List = std::vector<ast::NodeID>;
+	using Name = ast::QualifiedName;
+	static constexpr bool LAZY_BODIES = false;
+
+	FlatBuilder(ast::FlatAST &flat, types::TypeContext &types) noexcept
+	    : flat(&flat), typeContext(&types) {}
+
+	template <typename T, typename... Args>
+	Node<T> make(TokenSpan /*span*/, Args &&...args) {
+		return build(std::type_identity<T>{},
+			     std::forward<Args>(args)...);
+	}
+	template <typename T> [[nodiscard]] static List<T> list() {
+		return {};
+	}
+	static void append(std::vector<ast::NodeID> &list, FlatRef node) {
+		list.push_back(node.id());
+	}
+	template <typename T> static FlatRef cast(FlatRef node) {
+		return node;
+	}
+
+	template <typename T, typename... Args>
+	TypeRef type(Args &&...args) const {
+		return typeContext->get<T>(std::forward<Args>(args)...);
+	}
+	[[nodiscard]] static Params params() { return {}; }
+	static void param(Params &params, TypeRef type, std::string_view name) {
+		params.emplace_back(type, std::string(name));
+	}
+	[[nodiscard]] static Name name(std::string_view text) {
+		return Name(std::string(text));
+	}
+	static void qualify(Name &name, std::string_view text) {
+		name.qualifiers.push_back(std::move(name.name));
+		name.name = std::string(text);
+	}
+
+private:
+	using Ids = std::vector<ast::NodeID>;
+	template <typename T> using Tag = std::type_identity<T>;
+
+	FlatRef build(Tag<ast::NumberLiteralAST>, int64_t value);
+	FlatRef build(Tag<ast::NumberLiteralAST>, double value);
+	FlatRef build(Tag<ast::StringLiteralAST>, std::string_view value);
+	FlatRef build(Tag<ast::CharLiteralAST>, char value);
+	FlatRef build(Tag<ast::BoolLiteralAST>, bool value);
+	FlatRef build(Tag<ast::UnaryExprAST>, ast::UnaryOp op, FlatRef operand);
+	FlatRef build(Tag<ast::BinaryExprAST>, ast::BinaryOp op, FlatRef lhs,
+		      FlatRef rhs);
+	FlatRef build(Tag<ast::TernaryExprAST>, FlatRef condition,
+		      FlatRef thenBranch, FlatRef elseBranch);
+	FlatRef build(Tag<ast::VariableExprAST>, ast::QualifiedName name);
+	FlatRef build(Tag<ast::CallExprAST>, FlatRef callee, const Ids &args);
+
+	FlatRef build(Tag<ast::BlockStmtAST>, const Ids &stmts);
+	FlatRef build(Tag<ast::ReturnStmtAST>, FlatRef value = nullptr);
+	FlatRef build(Tag<ast::BreakStmtAST>);
+	FlatRef build(Tag<ast::ContinueStmtAST>);
+	FlatRef build(Tag<ast::AssignmentStmtAST>, std::string_view variable,
+		      ast::AssignOp op, FlatRef value);
+	FlatRef build(Tag<ast::IfStmtAST>, FlatRef condition,
+		      FlatRef thenBranch, FlatRef elseBranch);
+	FlatRef build(Tag<ast::ForStmtAST>, FlatRef init, FlatRef condition,
+		      FlatRef update, FlatRef body);
+	FlatRef build(Tag<ast::WhileStmtAST>, FlatRef condition, FlatRef body);
+	FlatRef build(Tag<ast::DeclStmtAST>, FlatRef decl);
+	FlatRef build(Tag<ast::ErrorStmtAST>, uint32_t begin, uint32_t end);
+
+	FlatRef build(Tag<ast::VariableDeclarationAST>, TypeRef type,
+		      std::string_view name, FlatRef size = nullptr,
+		      FlatRef init = nullptr);
+	static std::unique_ptr<Prototype> build(Tag<ast::PrototypeAST>,
+						ast::QualifiedName name,
+						Params params,
+						TypeRef returnType);
+	FlatRef build(Tag<ast::FunctionAST>, std::unique_ptr<Prototype> proto,
+		      FlatRef body);
+	FlatRef build(Tag<ast::StructAST>, std::string_view name,
+		      const Ids &fields, const Ids &methods);
+	FlatRef build(Tag<ast::NamespaceAST>, std::string_view name,
+		      const Ids &decls);
+	FlatRef build(Tag<ast::ErrorDeclAST>, uint32_t begin, uint32_t end);
+	FlatRef build(Tag<ast::ProgramAST>, const Ids &decls);
+};
+
+// A node of a green tree under construction, with the index of its first
+// token; null if its parse failed
+struct GreenRef {
+	GreenNode::Ptr node;
+	size_t first = 0;
+
+	GreenRef() noexcept = default;
+	GreenRef(std::nullptr_t) noexcept {}
+	GreenRef(GreenNode::Ptr node, size_t first) noexcept
+	    : node(std::move(node)), first(first) {}
+
+	explicit operator bool() const noexcept { return node != nullptr; }
+	bool operator==(std::nullptr_t) const noexcept {
+		return node == nullptr;
+	}
+};
+
+// Builds the green tree IncrementalParser reparses pieces of: every node
+// records how many tokens it spans. Bodies are always parsed eagerly.
+class GreenBuilder {
+	const TokenBuffer *tokens;
+	types::TypeContext *typeContext;
+
+public:
+	using TypeRef = const types::Type *;
+	using Params = std::vector<std::pair<TypeRef, std::string>>;
+	// a FUNCTION node is made once its body is parsed
+	struct Prototype {
+		ast::QualifiedName name;
+		Params params;
+		TypeRef returnType;
+		size_t first;
+	};
+	template <typename T>
+	using Node = std::conditional_t<std::is_same_v<T, ast::PrototypeAST>,
+					std::unique_ptr<Prototype>, GreenRef>;
+	template <typename T> using List = std::vector<GreenRef>;
+	using Name = ast::QualifiedName;
+	static constexpr bool LAZY_BODIES = false;
+
+	// `tokens` is the buffer the parser walks
+	GreenBuilder(const TokenBuffer &tokens,
+		     types::TypeContext &types) noexcept
+	    : tokens(&tokens), typeContext(&types) {}
+
+	template <typename T, typename... Args>
+	Node<T> make(TokenSpan span, Args &&...args) const {
+		return build(std::type_identity<T>{}, span,
+			     std::forward<Args>(args)...);
+	}
+	template <typename T> [[nodiscard]] static List<T> list() {
+		return {};
+	}
+	static void append(std::vector<GreenRef> &list, GreenRef node) {
+		list.push_back(std::move(node));
+	}
+	template <typename T> static GreenRef cast(GreenRef node) {
+		return node;
+	}
+
+	template <typename T, typename... Args>
+	TypeRef type(Args &&...args) const {
+		return typeContext->get<T>(std::forward<Args>(args)...);
+	}
+	[[nodiscard]] static Params params() { return {}; }
+	static void param(Params &params, TypeRef type, std::string_view name) {
+		params.emplace_back(type, std::string(name));
+	}
+	[[nodiscard]] static Name name(std::string_view text) {
+		return Name(std::string(text));
+	}
+	static void qualify(Name &name, std::string_view text) {
+		name.qualifiers.push_back(std::move(name.name));
+		name.name = std::string(text);
+	}
+
+private:
+	using Refs = std::vector<GreenRef>;
+	template <typename T> using Tag = std::type_identity<T>;
+
+	// `node` over `span`, or from its first child if that came earlier,
+	// with `children` in order
+	GreenRef finish(TokenSpan span, GreenNode node,
+			std::span<const GreenRef> children) const;
+
+	GreenRef build(Tag<ast::NumberLiteralAST>, TokenSpan span,
+		       int64_t value) const;
+	GreenRef build(Tag<ast::NumberLiteralAST>, TokenSpan span,
+		       double value) const;
+	GreenRef build(Tag<ast::StringLiteralAST>, TokenSpan span,
+		       std::string_view value) const;
+	GreenRef build(Tag<ast::CharLiteralAST>, TokenSpan span,
+		       char value) const;
+	GreenRef build(Tag<ast::BoolLiteralAST>, TokenSpan span,
+		       bool value) const;
+	GreenRef build(Tag<ast::UnaryExprAST>, TokenSpan span, ast::UnaryOp op,
+		       GreenRef operand) const;
+	GreenRef build(Tag<ast::BinaryExprAST>, TokenSpan span,
+		       ast::BinaryOp op, GreenRef lhs, GreenRef rhs) const;
+	GreenRef build(Tag<ast::TernaryExprAST>, TokenSpan span,
+		       GreenRef condition, GreenRef thenBranch,
+		       GreenRef elseBranch) const;
+	GreenRef build(Tag<ast::VariableExprAST>, TokenSpan span,
+		       ast::QualifiedName name) const;
+	GreenRef build(Tag<ast::CallExprAST>, TokenSpan span, GreenRef callee,
+		       const Refs &args) const;
+
+	GreenRef build(Tag<ast::BlockStmtAST>, TokenSpan span,
+		       const Refs &stmts) const;
+	GreenRef build(Tag<ast::ReturnStmtAST>, TokenSpan span,
+		       GreenRef value = nullptr) const;
+	GreenRef build(Tag<ast::BreakStmtAST>, TokenSpan span) const;
+	GreenRef build(Tag<ast::ContinueStmtAST>, TokenSpan span) const;
+	GreenRef build(Tag<ast::AssignmentStmtAST>, TokenSpan span,
+		       std::string_view variable, ast::AssignOp op,
+		       GreenRef value) const;
+	GreenRef build(Tag<ast::IfStmtAST>, TokenSpan span, GreenRef condition,
+		       GreenRef thenBranch, GreenRef elseBranch) const;
+	GreenRef build(Tag<ast::ForStmtAST>, TokenSpan span, GreenRef init,
+		       GreenRef condition, GreenRef update,
+		       GreenRef body) const;
+	GreenRef build(Tag<ast::WhileStmtAST>, TokenSpan span,
+		       GreenRef condition, GreenRef body) const;
+	GreenRef build(Tag<ast::DeclStmtAST>, TokenSpan span,
+		       GreenRef decl) const;
+	GreenRef build(Tag<ast::ErrorStmtAST>, TokenSpan span, uint32_t begin,
+		       uint32_t end) const;
+
+	GreenRef build(Tag<ast::VariableDeclarationAST>, TokenSpan span,
+		       TypeRef type, std::string_view name,
+		       GreenRef size = nullptr, GreenRef init = nullptr) const;
+	static std::unique_ptr<Prototype>
+	build(Tag<ast::PrototypeAST>, TokenSpan span, ast::QualifiedName name,
+	      Params params, TypeRef returnType);
+	GreenRef build(Tag<ast::FunctionAST>, TokenSpan span,
+		       std::unique_ptr<Prototype> proto, GreenRef body) const;
+	GreenRef build(Tag<ast::StructAST>, TokenSpan span,
+		       std::string_view name, const Refs &fields,
+		       const Refs &methods) const;
+	GreenRef build(Tag<ast::NamespaceAST>, TokenSpan span,
+		       std::string_view name, const Refs &decls) const;
+	GreenRef build(Tag<ast::ErrorDeclAST>, TokenSpan span, uint32_t begin,
+		       uint32_t end) const;
+	GreenRef build(Tag<ast::ProgramAST>, TokenSpan span,
+		       const Refs &decls) const;
+};
+
+// What the NullBuilder returns in place of a node: only whether the parse
+// succeeded
+class Recognized {
+	bool ok = false;
+
+public:
+	constexpr Recognized() noexcept = default;
+	constexpr Recognized(std::nullptr_t) noexcept {}
+	constexpr explicit Recognized(bool ok) noexcept : ok(ok) {}
+
+	constexpr explicit operator bool() const noexcept { return ok; }
+	constexpr bool operator==(std::nullptr_t) const noexcept {
+		return !ok;
+	}
+};
+
+// Builds nothing and allocates nothing, so the parser only checks the
+// syntax and reports errors
+class NullBuilder {
+public:
+	template <typename T> using Node = Recognized;
+	template <typename T> using List = Recognized;
+	using TypeRef = Recognized;
+	using Params = Recognized;
+	using Name = Recognized;
+	static constexpr bool LAZY_BODIES = false;
+
+	template <typename T, typename... Args>
+	static Recognized make(TokenSpan /*span*/, Args &&.../*args*/) {
+		return Recognized(true);
+	}
+	template <typename T> [[nodiscard]] static Recognized list() {
+		return Recognized(true);
+	}
+	static void append(Recognized /*list*/, Recognized /*node*/) {}
+	template <typename T> static Recognized cast(Recognized node) {
+		return node;
+	}
+
+	template <typename T, typename... Args>
+	static Recognized type(Args &&.../*args*/) {
+		return Recognized(true);
+	}
+	[[nodiscard]] static Recognized params() { return Recognized(true); }
+	static void param(Recognized /*params*/, Recognized /*type*/,
+			  std::string_view /*name*/) {}
+	[[nodiscard]] static Recognized name(std::string_view /*text*/) {
+		return Recognized(true);
+	}
+	static void qualify(Recognized /*name*/, std::string_view /*text*/) {}
+};
+
+} // namespace frontend
@@ -0,0 +1,249 @@
+#include "incremental_parser.hpp"
+#include "ast/flat_ast.hpp"
+#include "builder.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/relex.hpp"
+#include "lexer/token.hpp"
+#include "parser.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
+#include "syntax_tree.hpp"
+#include "types/type_context.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace frontend {
+
+IncrementalParser::IncrementalParser(FileID file, ErrorReporter &errors)
+    : file(file), source(errors.sources().source(file)),
+      tokenBuffer(Lexer(source->text(), file, 0, errors).lexAll()) {
+	parseAll(errors);
+}
+
+std::shared_ptr<const SyntaxSnapshot> IncrementalParser::snapshot() const {
+	std::lock_guard lock(publishMutex);
+	return published;
+}
+
+SyntaxNode IncrementalParser::edit(const TextEdit &edit, SourceBuffer edited,
+				   ErrorReporter &errors) {
+	// the old text stays alive in `source` until relex() is done with
+	// the tokens that view it
+	errors.sources().replace(file, std::move(edited));
+	std::shared_ptr<const SourceBuffer> previous =
+	    std::exchange(source, errors.sources().source(file));
+	RelexRange range = relex(tokenBuffer, file, edit, errors);
+	edits++;
+	if (!green) {
+		return parseAll(errors);
+	}
+	damage(range);
+
+	std::vector<Located> path = damagedPath();
+	for (size_t i = path.size(); i-- > 0;) {
+		Reparse result = reparse(path[i], errors);
+		if (result.escalate) {
+			continue;
+		}
+		if (!result.node) {
+			return {};
+		}
+		path.resize(i + 1);
+		replace(path, std::move(result.node));
+
+		SyntaxNode node = root();
+		for (size_t j = 1; j < path.size(); j++) {
+			node = node.child(path[j].slot);
+		}
+		return node;
+	}
+	// the root is always reparsed and never escalates
+	assert(false);
+	return {};
+}
+
+SyntaxNode IncrementalParser::root() const {
+	if (!valid()) {
+		return {};
+	}
+	return SyntaxNode::root(green, tokenBuffer.offset(0));
+}
+
+SyntaxNode IncrementalParser::parseAll(ErrorReporter &errors) {
+	typeContext = std::make_shared<types::TypeContext>();
+	GreenParser parser(tokenBuffer, errors,
+			   GreenBuilder(tokenBuffer, *typeContext));
+	green = parser.parseProgram().node;
+	damaged = false;
+	shift = 0;
+	publish();
+	return root();
+}
+
+void IncrementalParser::publish() {
+	if (!green) {
+		return;
+	}
+	auto snapshot = std::make_shared<const SyntaxSnapshot>(SyntaxSnapshot{
+	    green, file, source, typeContext, tokenBuffer.offset(0), edits});
+	// swapped, so the previous one is freed outside the lock
+	std::lock_guard lock(publishMutex);
+	published.swap(snapshot);
+}
+
+void IncrementalParser::damage(const RelexRange &range) {
+	size_t end = range.first + range.removed;
+	if (!damaged) {
+		damageFirst = range.first;
+		damageEnd = end;
+	}
+	else {
+		// before the damage the two trees' indices agree, after it they
+		// differ by `shift`, and inside it every token is new anyway
+		damageFirst = std::min(damageFirst, range.first);
+		auto oldEnd = static_cast<ptrdiff_t>(end) - shift;
+		if (oldEnd > static_cast<ptrdiff_t>(damageEnd)) {
+			damageEnd = static_cast<size_t>(oldEnd);
+		}
+	}
+	damaged = true;
+	shift += static_cast<ptrdiff_t>(range.inserted) -
+		 static_cast<ptrdiff_t>(range.removed);
+}
+
+std::vector<IncrementalParser::Located>
+IncrementalParser::damagedPath() const {
+	std::vector<Located> path{{green, 0, 0}};
+	bool descended = true;
+	while (descended) {
+		descended = false;
+		const Located &at = path.back();
+		const auto &children = at.node->children;
+		for (size_t slot = 0; slot < children.size(); slot++) {
+			const GreenNode::Child &child = children[slot];
+			size_t first = at.first + child.offset;
+			if (child.node && first <= damageFirst &&
+			    damageEnd <= first + child.node->width) {
+				path.push_back({child.node, first, slot});
+				descended = true;
+				break;
+			}
+		}
+	}
+	return path;
+}
+
+IncrementalParser::Reparse
+IncrementalParser::reparse(const Located &unit, ErrorReporter &errors) const {
+	// where the unit ends now, if its shape is unchanged
+	auto width = static_cast<ptrdiff_t>(unit.node->width) + shift;
+	size_t end = unit.first + static_cast<size_t>(width);
+	ErrorReporter local(errors.sources());
+	GreenParser parser(tokenBuffer, local,
+			   GreenBuilder(tokenBuffer, *typeContext));
+	parser.seek(unit.first);
+
+	// Each entry point is only taken where the enclosing production would
+	// take it too, deciding on the same token
+	GreenRef node;
+	TokenType start = tokenBuffer.type(unit.first);
+	switch (unit.node->kind) {
+	case ast::NodeKind::BLOCK:
+		// not the block an `else if` is wrapped in
+		if (unit.first == 0 ||
+		    tokenBuffer.type(unit.first - 1) != TokenType::LBRACE) {
+			return {nullptr, true};
+		}
+		node = parser.parseStmtList();
+		break;
+	case ast::NodeKind::FUNCTION:
+		if (start != TokenType::FUNC) {
+			return {nullptr, true};
+		}
+		node = parser.parseFunc();
+		break;
+	case ast::NodeKind::STRUCT:
+		if (start != TokenType::STRUCT) {
+			return {nullptr, true};
+		}
+		node = parser.parseStruct();
+		break;
+	case ast::NodeKind::NAMESPACE:
+		if (start != TokenType::NAMESPACE) {
+			return {nullptr, true};
+		}
+		node = parser.parseNamespace();
+		break;
+	case ast::NodeKind::PROGRAM:
+		node = parser.parseProgram();
+		break;
+	default:
+		return {nullptr, true};
+	}
+	// A failure is final: the parser stops at the first one and nothing
+	// above a unit adds to its errors, so they are a full parse's.
+	// Success ending anywhere but `end` means the unit changed shape
+	if (node && unit.node->kind != ast::NodeKind::PROGRAM &&
+	    parser.position() != end) {
+		return {nullptr, true};
+	}
+	for (const CompilerError &err : local.getErrors()) {
+		errors.report(err);
+	}
+	assert(!node || node.first == unit.first);
+	return {std::move(node.node), false};
+}
+
+void IncrementalParser::replace(const std::vector<Located> &path,
+				GreenNode::Ptr node) {
+	for (size_t i = path.size() - 1; i > 0; i--) {
+		const Located &old = path[i];
+		const Located &parent = path[i - 1];
+		// children starting past the old one move with the tokens
+		size_t oldEnd = old.first - parent.first + old.node->width;
+
+		GreenNode copy = *parent.node;
+		copy.width = static_cast<uint32_t>(
+		    static_cast<ptrdiff_t>(copy.width) + shift);
+		for (size_t slot = 0; slot < copy.children.size(); slot++) {
+			GreenNode::Child &child = copy.children[slot];
+			if (slot == old.slot) {
+				child.node = node;
+			}
+			else if (child.node && child.offset >= oldEnd) {
+				child.offset = static_cast<uint32_t>(
+				    static_cast<ptrdiff_t>(child.offset) +
+				    shift);
+			}
+		}
+		// bytes are measured in the new text, which may have moved
+		// even this node's first token
+		uint32_t start = tokenBuffer.offset(parent.first);
+		copy.length = 0;
+		if (copy.width > 0) {
+			size_t last = parent.first + copy.width - 1;
+			copy.length = tokenBuffer.end(last) - start;
+		}
+		for (GreenNode::Child &child : copy.children) {
+			if (child.node) {
+				child.byteOffset =
+				    tokenBuffer.offset(parent.first +
+						       child.offset) -
+				    start;
+			}
+		}
+		node = std::make_shared<const GreenNode>(std::move(copy));
+	}
+	green = std::move(node);
+	damaged = false;
+	shift = 0;
+	publish();
+}
+
+} // namespace frontend
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/relex.hpp"
+#include "lexer/token_buffer.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
+#include "syntax_tree.hpp"
+#include "types/type_context.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace frontend {
+
+/// The syntax tree of one file, kept up to date as it is edited.
+///
+/// Each edit is re-lexed with relex(), then the parser reruns only on the
+/// smallest enclosing unit that can be parsed on its own: a braced
+/// statement list, a function, a struct, a namespace, or failing all of
+/// those the whole file. A unit whose reparse consumes exactly its new
+/// tokens replaces the old one; the nodes above it are copied with their
+/// widths and offsets moved, and every other subtree is shared with the
+/// previous tree. A unit whose reparse ends anywhere else changed shape,
+/// and the unit enclosing it is tried instead.
+///
+/// Reparsing starts where a full parse would be in the same state, so the
+/// tree and the diagnostics are the ones parsing the edited file from
+/// scratch gives. While the text does not parse there is no tree; the
+/// last one is kept, and the tokens changed since are reparsed together
+/// once it parses again.
+///
+/// Edits come from one thread at a time. Every tree that parses is also
+/// published as a SyntaxSnapshot, which any other thread can take at any
+/// time without waiting for an edit in progress.
+class IncrementalParser {
+	// A node of the current tree with the index of its first token and
+	// its place in its parent's children
+	struct Located {
+		GreenNode::Ptr node;
+		size_t first;
+		size_t slot;
+	};
+	// What reparsing a unit came to: its replacement, or none if it did
+	// not parse, or that the unit enclosing it has to be reparsed
+	struct Reparse {
+		GreenNode::Ptr node;
+		bool escalate;
+	};
+
+	FileID file;
+	// the version of the text `tokenBuffer` views, kept alive here
+	// whatever the SourceManager does with the file
+	std::shared_ptr<const SourceBuffer> source;
+	TokenBuffer tokenBuffer;
+	// the types of `green`, shared with the snapshots of it; a full parse
+	// starts a new one, so names typed only in dropped trees go with them
+	std::shared_ptr<types::TypeContext> typeContext;
+	GreenNode::Ptr green; // the last tree that parsed
+	// Tokens [damageFirst, damageEnd) of the tree in `green` have changed
+	// since it parsed, and the ones after moved by `shift`
+	bool damaged = false;
+	size_t damageFirst = 0;
+	size_t damageEnd = 0;
+	ptrdiff_t shift = 0;
+	uint64_t edits = 0;
+	// held only to copy or swap the pointer, never while parsing
+	mutable std::mutex publishMutex;
+	std::shared_ptr<const SyntaxSnapshot> published;
+
+public:
+	/// Lexes and parses `file`, reporting to `errors`.
+	IncrementalParser(FileID file, ErrorReporter &errors);
+
+	/// Applies `edit`, which turned the text into `edited`, and makes
+	/// that the file's text in `errors.sources()` with
+	/// SourceManager::replace(), so the file keeps its id however often
+	/// it is edited. Returns the node that was reparsed, or null if the
+	/// text does not parse; only diagnostics for the reparsed tokens are
+	/// reported.
+	SyntaxNode edit(const TextEdit &edit, SourceBuffer edited,
+			ErrorReporter &errors);
+
+	/// Whether the current text parses, so root() has a tree.
+	[[nodiscard]] bool valid() const noexcept { return !damaged && green; }
+	/// The tree of the current text; null unless valid().
+	[[nodiscard]] SyntaxNode root() const;
+	[[nodiscard]] const TokenBuffer &tokens() const noexcept {
+		return tokenBuffer;
+	}
+
+	/// The latest tree that parsed, or null if none has yet. Safe to
+	/// call from any thread, concurrently with edit(): it only copies a
+	/// reference, and never waits for a parse.
+	[[nodiscard]] std::shared_ptr<const SyntaxSnapshot> snapshot() const;
+
+private:
+	// Parses the whole buffer, with nothing to reuse
+	SyntaxNode parseAll(ErrorReporter &errors);
+	// Merges tokens `range` of the current buffer into the damage
+	void damage(const RelexRange &range);
+	// Nodes from the root down to the innermost one covering the damage
+	[[nodiscard]] std::vector<Located> damagedPath() const;
+	Reparse reparse(const Located &unit, ErrorReporter &errors) const;
+	// Puts `node` in place of the last node of `path`
+	void replace(const std::vector<Located> &path, GreenNode::Ptr node);
+	// Makes the current tree the one snapshot() returns
+	void publish();
+};
+
+} // namespace frontend
@@ -0,0 +1,190 @@
+#include "parallel_parser.hpp"
+#include "ast/ast.hpp"
+#include "ast/decl.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/token.hpp"
+#include "lexer/token_buffer.hpp"
+#include "parser.hpp"
+#include "support/arena.hpp"
+#include "support/thread_pool.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace frontend {
+
+namespace {
+// Declarations one run of regions produced, and the diagnostics of the
+// regions they came from. Parsing stops at the first region that fails
+// or runs past its boundary.
+template <typename Builder> struct RunResult {
+	std::vector<typename Builder::template Node<ast::DeclAST>> decls;
+	std::vector<CompilerError> errors;
+	size_t failedRegion = SIZE_MAX;
+};
+
+// Moves the declarations of `from` to the end of `to`; lists of a builder
+// that keeps no nodes are not ranges, and nothing is moved
+template <typename Builder, typename From, typename To>
+void appendAll(const Builder &builder, To &to, From &from) {
+	if constexpr (std::ranges::range<From>) {
+		for (auto &decl : from) {
+			builder.append(to, std::move(decl));
+		}
+	}
+}
+
+std::vector<size_t> splitRuns(const std::vector<size_t> &starts,
+			      size_t tokenCount, size_t runs) {
+	std::vector<size_t> bounds{0};
+	size_t target = (tokenCount + runs - 1) / runs;
+	for (size_t r = 1; r < starts.size(); r++) {
+		if (bounds.size() < runs &&
+		    starts[r] >= target * bounds.size()) {
+			bounds.push_back(r);
+		}
+	}
+	bounds.push_back(starts.size());
+	return bounds;
+}
+
+template <typename Builder>
+RunResult<Builder> parseRun(const TokenBuffer &tokens, SourceManager &sources,
+			    const std::vector<size_t> &starts, size_t first,
+			    size_t last, const Builder &builder,
+			    ErrorRecovery recovery, size_t errorLimit) {
+	RunResult<Builder> run;
+	ErrorReporter errors(sources);
+	// a run that alone passes the limit stops and is reparsed in order,
+	// which stops at the diagnostic that passes it overall
+	errors.setErrorLimit(errorLimit == 0 ? 0 : errorLimit + 1);
+	BasicParser<Builder> parser(tokens, errors, builder);
+	parser.setRecovery(recovery);
+	size_t kept = 0; // diagnostics of the regions that parsed
+	for (size_t r = first; r < last; r++) {
+		size_t end =
+		    r + 1 < starts.size() ? starts[r + 1] : tokens.size();
+		parser.seek(starts[r]);
+		auto decls = parser.parseDeclRange(end);
+		// a declaration that ran past the boundary is reparsed in
+		// order, along with the rest of the file
+		if (!decls || parser.position() > end) {
+			run.failedRegion = r;
+			break;
+		}
+		if constexpr (std::ranges::range<decltype(*decls)>) {
+			for (auto &decl : *decls) {
+				run.decls.push_back(std::move(decl));
+			}
+		}
+		kept = errors.getErrors().size();
+	}
+	run.errors = errors.getErrors();
+	run.errors.resize(kept);
+	return run;
+}
+} // namespace
+
+std::vector<size_t> topLevelDecls(const TokenBuffer &tokens) {
+	std::vector<size_t> starts{0};
+	size_t depth = 0;
+	for (size_t i = 0; i < tokens.size(); i++) {
+		switch (tokens.type(i)) {
+		case TokenType::LBRACE:
+			depth++;
+			break;
+		case TokenType::RBRACE:
+			// a stray '}' is an error the parser reports
+			depth = depth > 0 ? depth - 1 : 0;
+			break;
+		case TokenType::FUNC:
+		case TokenType::STRUCT:
+		case TokenType::NAMESPACE:
+			if (depth == 0 && i > 0) {
+				starts.push_back(i);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	return starts;
+}
+
+template <typename Builder>
+typename Builder::template Node<ast::ProgramAST>
+parseParallel(const TokenBuffer &tokens, ErrorReporter &errors,
+	      ThreadPool &pool, std::span<const Builder> builders,
+	      ErrorRecovery recovery) {
+	assert(!builders.empty());
+	std::vector<size_t> starts = topLevelDecls(tokens);
+	std::vector<size_t> bounds =
+	    splitRuns(starts, tokens.size(), builders.size());
+
+	std::vector<RunResult<Builder>> runs(bounds.size() - 1);
+	pool.forEach(runs.size(), [&](size_t k) {
+		runs[k] = parseRun(tokens, errors.sources(), starts, bounds[k],
+				   bounds[k + 1], builders[k], recovery,
+				   errors.getErrorLimit());
+	});
+	const Builder &shared = builders.front();
+
+	// the runs are done, so the first builder is free to build the rest
+	auto decls = shared.template list<ast::DeclAST>();
+	for (RunResult<Builder> &run : runs) {
+		appendAll(shared, decls, run.decls);
+		for (const CompilerError &err : run.errors) {
+			errors.report(err);
+		}
+		if (run.failedRegion == SIZE_MAX) {
+			continue;
+		}
+
+		// parse the rest in order for the sequential diagnostics
+		BasicParser<Builder> parser(tokens, errors, shared);
+		parser.setRecovery(recovery);
+		parser.seek(starts[run.failedRegion]);
+		auto rest = parser.parseDeclRange(tokens.size());
+		if (!rest) {
+			return nullptr;
+		}
+		appendAll(shared, decls, *rest);
+		break;
+	}
+	return shared.template make<ast::ProgramAST>(
+	    TokenSpan{0, tokens.size()}, std::move(decls));
+}
+
+template TreeBuilder::Node<ast::ProgramAST>
+parseParallel(const TokenBuffer &, ErrorReporter &, ThreadPool &,
+	      std::span<const TreeBuilder>, ErrorRecovery);
+template NullBuilder::Node<ast::ProgramAST>
+parseParallel(const TokenBuffer &, ErrorReporter &, ThreadPool &,
+	      std::span<const NullBuilder>, ErrorRecovery);
+
+std::unique_ptr<ast::ProgramAST> parseParallel(const TokenBuffer &tokens,
+					       ErrorReporter &errors,
+					       types::TypeContext &types,
+					       ThreadPool &pool,
+					       std::span<Arena> arenas,
+					       ErrorRecovery recovery) {
+	// a builder per arena, or one heap builder per pool thread
+	std::vector<TreeBuilder> builders;
+	for (Arena &arena : arenas) {
+		builders.emplace_back(types, &arena);
+	}
+	if (builders.empty()) {
+		builders.resize(std::max<size_t>(pool.size(), 1),
+				TreeBuilder(types));
+	}
+	return parseParallel<TreeBuilder>(tokens, errors, pool, builders,
+					  recovery);
+}
+
+} // namespace frontend
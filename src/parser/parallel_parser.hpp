@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ast/decl.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/token_buffer.hpp"
+#include "builder.hpp"
+#include "parser.hpp"
+#include "support/arena.hpp"
+#include "support/thread_pool.hpp"
+#include "types/type_context.hpp"
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace frontend {
+
+/// Indices of the tokens that begin a top-level declaration region: token
+/// 0, then every `func`, `struct` or `namespace` at brace depth zero. Each
+/// region runs up to the next one.
+std::vector<size_t> topLevelDecls(const TokenBuffer &tokens);
+
+/// Parses `tokens` into the ProgramAST that Parser::parseProgram() builds,
+/// with the same diagnostics, parsing the top-level declarations on `pool`.
+///
+/// A brace-matching pre-pass splits the file at topLevelDecls(), and the
+/// regions are grouped into runs of about equal token counts that are
+/// parsed concurrently and assembled in source order. A region that fails
+/// to parse, or that a declaration runs past, is parsed again together
+/// with the rest of the file on the calling thread, so malformed input
+/// gets exactly the sequential parser's errors.
+///
+/// `recovery` is the mode of Parser::setRecovery(). With SYNCHRONIZE a
+/// region that recovers from its errors and still ends at its boundary
+/// keeps its ErrorDeclAST and ErrorStmtAST nodes and diagnostics, since a
+/// sequential parse reaches the boundary in the same state.
+///
+/// With `arenas`, there is one run per arena and each run allocates from
+/// its own, so no arena is shared between threads; the arenas must
+/// outlive the tree. Without, there is one run per pool thread and nodes
+/// come from the heap. Every run makes its types in `types`, which must
+/// outlive the tree too.
+std::unique_ptr<ast::ProgramAST> parseParallel(const TokenBuffer &tokens,
+					       ErrorReporter &errors,
+					       types::TypeContext &types,
+					       ThreadPool &pool,
+					       std::span<Arena> arenas = {},
+					       ErrorRecovery recovery =
+						   ErrorRecovery::STOP);
+
+/// The same with any builder: one run per entry of `builders`, which must
+/// not be empty, and the first also builds what the runs could not. With
+/// the NullBuilder nothing is built, and the result only says whether
+/// the file parsed, as from SyntaxChecker::parseProgram(). Instantiated
+/// for the TreeBuilder and the NullBuilder.
+template <typename Builder>
+typename Builder::template Node<ast::ProgramAST>
+parseParallel(const TokenBuffer &tokens, ErrorReporter &errors,
+	      ThreadPool &pool, std::span<const Builder> builders,
+	      ErrorRecovery recovery = ErrorRecovery::STOP);
+
+} // namespace frontend
@@ -5,12 +5,15 @@
 #include "ast/stmt.hpp"
 #include "diagnostics/diagnostics.hpp"
 #include "lexer/token.hpp"
+#include "support/fatal.hpp"
 #include "types/type.hpp"
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <execution>
-#include <iostream>
 #include <memory>
+#include <string_view>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -18,58 +21,184 @@
 
 namespace frontend {
 
-Parser::Parser(Lexer &lex, ErrorReporter &errors)
-    : lexer(lex), current(lexer.get()), errors(errors) {}
+template <typename Builder>
+BasicParser<Builder>::BasicParser(Lexer &lex, ErrorReporter &errors,
+				  Builder builder)
+    : lexer(&lex), file(lex.fileID()), current(lex.get()), errors(errors),
+      builder(std::move(builder)) {}
+
+template <typename Builder>
+BasicParser<Builder>::BasicParser(const TokenBuffer &tokens,
+				  ErrorReporter &errors, Builder builder,
+				  BodyParsing bodies)
+    : tokens(&tokens), file(tokens.fileID()), current(tokens.at(0)),
+      errors(errors), builder(std::move(builder)), bodies(bodies) {}
+
+template <typename Builder>
+void BasicParser<Builder>::advance() {
+	consumedEnd =
+	    current.offset + static_cast<uint32_t>(current.lexeme.size());
+	if (tokens != nullptr) {
+		// the buffer ends in T_EOF, which stays current once reached
+		if (index + 1 < tokens->size()) {
+			index++;
+		}
+		current = tokens->at(index);
+		return;
+	}
+	current = lexer->get();
+}
+
+template <typename Builder>
+void BasicParser<Builder>::seek(size_t to) {
+	assert(tokens != nullptr);
+	index = std::min(to, tokens->size() - 1);
+	current = tokens->at(index);
+	// as if every token before it had been advanced past
+	consumedEnd = index > 0 ? tokens->end(index - 1) : 0;
+}
 
-void Parser::advance() { current = lexer.get(); }
+template <typename Builder>
+Token BasicParser<Builder>::peek(size_t n) {
+	// bounded as the lexer's ring is, so both sources see as far
+	if (n >= MAX_PEEK) {
+		fatal("token lookahead past MAX_PEEK");
+	}
+	if (tokens != nullptr) {
+		return tokens->at(index + 1 + n);
+	}
+	return lexer->peek(n);
+}
 
-bool Parser::expect(TokenType type) {
+template <typename Builder>
+void BasicParser<Builder>::unexpected(DiagID id, DiagArg arg) {
+	// past the limit the parse is only unwinding
+	if (panicking || errors.limitReached()) {
+		return;
+	}
+	DiagArg got = DiagArg::lexeme(current.lexeme.size());
+	if (arg.kind == DiagArg::Kind::NONE) {
+		errors.report(id, location(), got);
+	}
+	else {
+		errors.report(id, location(), arg, got);
+	}
+	// an error past the limit ends recovery, so it is the last one
+	panicking = recovering();
+}
+
+template <typename Builder>
+bool BasicParser<Builder>::expect(TokenType type) {
 	if (type != current.type) {
-		std::cerr << "Expected " << static_cast<int>(type)
-			  << " but got " << static_cast<int>(current.type)
-			  << "\n";
+		unexpected(DiagID::EXPECTED_TOKEN, DiagArg::token(type));
 		return false;
 	}
 	return true;
 }
 
-std::unique_ptr<ast::ExprAST> Parser::parseLiteral() {
-	switch (current.type) {
-	case TokenType::NUMBER_LIT: {
-		auto result = std::make_unique<ast::NumberLiteralAST>(
-		    std::stod(current.lexeme));
-		advance();
-		return result;
+template <typename Builder>
+void BasicParser<Builder>::skipUnexpected() {
+	if (recovering() && (current.type == TokenType::SEMICOLON ||
+			     current.type == TokenType::LBRACE ||
+			     current.type == TokenType::RBRACE ||
+			     current.type == TokenType::T_EOF ||
+			     isDeclKeyword(current.type))) {
+		return;
 	}
-	case TokenType::STRING_LIT: {
-		auto result = std::make_unique<ast::StringLiteralAST>(
-		    std::move(current.lexeme));
-		advance();
-		return result;
+	advance();
+}
+
+template <typename Builder>
+bool BasicParser<Builder>::closeBrace() {
+	if (!expect(TokenType::RBRACE)) {
+		skipUnexpected();
+		return false;
 	}
-	case TokenType::CHAR_LIT: {
-		std::string temp = current.lexeme;
-		char value = temp[1];
-		auto result = std::make_unique<ast::CharLiteralAST>(value);
+	advance();
+	return true;
+}
+
+template <typename Builder>
+bool BasicParser<Builder>::isDeclKeyword(TokenType type) {
+	return type == TokenType::FUNC || type == TokenType::STRUCT ||
+	       type == TokenType::NAMESPACE;
+}
+
+// Up to and past a ';' or a whole braced block, or up to a '}' closing the
+// enclosing one. Statements never contain a declaration keyword, so one is
+// where the block was left open and is stopped at however deep. Lexer errors
+// past the limit stop it too, as the parse is then abandoned
+template <typename Builder>
+void BasicParser<Builder>::skipStatement() {
+	size_t depth = 0;
+	while (current.type != TokenType::T_EOF &&
+	       !isDeclKeyword(current.type) && !errors.limitReached()) {
+		if (current.type == TokenType::RBRACE) {
+			if (depth == 0) {
+				return;
+			}
+			depth--;
+			if (depth == 0) {
+				advance();
+				return;
+			}
+		}
+		else if (current.type == TokenType::LBRACE) {
+			depth++;
+		}
+		else if (current.type == TokenType::SEMICOLON && depth == 0) {
+			advance();
+			return;
+		}
 		advance();
-		return result;
 	}
-	case TokenType::TRUE: {
-		auto result = std::make_unique<ast::BoolLiteralAST>(true);
+}
+
+// Up to the next declaration keyword or '}' outside any block it opened
+template <typename Builder>
+void BasicParser<Builder>::skipDeclaration() {
+	size_t depth = 0;
+	while (current.type != TokenType::T_EOF && !errors.limitReached()) {
+		if (depth == 0 && (isDeclKeyword(current.type) ||
+				   current.type == TokenType::RBRACE)) {
+			return;
+		}
+		depth += current.type == TokenType::LBRACE ? 1 : 0;
+		depth -= current.type == TokenType::RBRACE ? 1 : 0;
 		advance();
-		return result;
 	}
-	case TokenType::FALSE: {
-		auto result = std::make_unique<ast::BoolLiteralAST>(false);
+}
+
+template <typename Builder>
+auto BasicParser<Builder>::parseLiteral() -> Expr {
+	size_t first = index;
+	Token literal = current;
+	switch (literal.type) {
+	case TokenType::INT_LIT:
 		advance();
-		return result;
-	}
+		return make<ast::NumberLiteralAST>(first, literal.intValue);
+	case TokenType::FLOAT_LIT:
+		advance();
+		return make<ast::NumberLiteralAST>(first, literal.floatValue);
+	case TokenType::STRING_LIT:
+		advance();
+		return make<ast::StringLiteralAST>(first, literal.lexeme);
+	case TokenType::CHAR_LIT:
+		advance();
+		return make<ast::CharLiteralAST>(first, literal.lexeme[1]);
+	case TokenType::TRUE:
+		advance();
+		return make<ast::BoolLiteralAST>(first, true);
+	case TokenType::FALSE:
+		advance();
+		return make<ast::BoolLiteralAST>(first, false);
 	default:
 		return nullptr;
 	}
 }
 
-bool Parser::unaryOperator() const {
+template <typename Builder>
+bool BasicParser<Builder>::unaryOperator() const {
 	return current.type == TokenType::AMPERSAND ||
 	       current.type == TokenType::STAR ||
 	       current.type == TokenType::PLUS ||
@@ -78,7 +207,8 @@ bool Parser::unaryOperator() const {
 	       current.type == TokenType::EXCLAMATION;
 }
 
-bool Parser::assignmentOperator() const {
+template <typename Builder>
+bool BasicParser<Builder>::assignmentOperator() const {
 	return current.type == TokenType::EQUAL ||
 	       current.type == TokenType::STAR_EQUAL ||
 	       current.type == TokenType::SLASH_EQUAL ||
@@ -92,79 +222,77 @@ bool Parser::assignmentOperator() const {
 	       current.type == TokenType::PIPE_EQUAL;
 }
 
-std::unique_ptr<types::Type> Parser::parsePrimitiveType() {
+template <typename Builder>
+auto BasicParser<Builder>::parsePrimitiveType() -> TypeRef {
 	switch (current.type) {
 	case TokenType::INT: {
 		advance();
-		return std::make_unique<types::IntType>();
+		return makeType<types::IntType>();
 	}
 	case TokenType::STRING: {
 		advance();
-		return std::make_unique<types::StringType>();
+		return makeType<types::StringType>();
 	}
 	case TokenType::CHAR: {
 		advance();
-		return std::make_unique<types::CharType>();
+		return makeType<types::CharType>();
 	}
 	case TokenType::BOOL: {
 		advance();
-		return std::make_unique<types::BoolType>();
+		return makeType<types::BoolType>();
 	}
 	case TokenType::FLOAT: {
 		advance();
-		return std::make_unique<types::FloatType>();
+		return makeType<types::FloatType>();
 	}
 	case TokenType::DOUBLE: {
 		advance();
-		return std::make_unique<types::DoubleType>();
+		return makeType<types::DoubleType>();
 	}
 	case TokenType::VOID: {
 		advance();
-		return std::make_unique<types::VoidType>();
+		return makeType<types::VoidType>();
 	}
 	default:
-		errors.error("Expected primitive type but got " +
-				 current.lexeme,
-			     current.line, current.column);
+		unexpected(DiagID::EXPECTED_PRIMITIVE_TYPE);
 		return nullptr;
 	}
 }
 
-std::unique_ptr<types::Type> Parser::parseType() {
+template <typename Builder>
+auto BasicParser<Builder>::parseType() -> TypeRef {
 	switch (current.type) {
 	case TokenType::CONST: {
 		advance();
 		if (auto inner_type = parseType(); inner_type) {
-			return std::make_unique<types::ConstType>(
+			return makeType<types::ConstType>(
 			    std::move(inner_type));
 		}
-		errors.error("Expected type after 'const' but got " +
-				 current.lexeme,
-			     current.line, current.column);
+		unexpected(DiagID::EXPECTED_TYPE_AFTER,
+			   DiagArg::token(TokenType::CONST));
 		return nullptr;
 	}
 	case TokenType::STATIC: {
 		advance();
 		if (auto inner_type = parseType(); inner_type) {
-			return std::make_unique<types::StaticType>(
+			return makeType<types::StaticType>(
 			    std::move(inner_type));
 		}
-		errors.error("Expected type after 'static' but got " +
-				 current.lexeme,
-			     current.line, current.column);
+		unexpected(DiagID::EXPECTED_TYPE_AFTER,
+			   DiagArg::token(TokenType::STATIC));
 		return nullptr;
 	}
 	case TokenType::STRUCT: {
 		advance();
 		if (current.type == TokenType::IDENT) {
-			std::string struct_name = current.lexeme;
+			// looked up by the lexeme, copied only the first time
+			auto struct_type =
+			    makeType<types::StructType>(current.lexeme);
 			advance();
-			return std::make_unique<types::StructType>(
-			    std::move(struct_name));
+			return struct_type;
 		}
-		errors.error("Expected identifier after 'struct' but got " +
-				 current.lexeme,
-			     current.line, current.column);
+		unexpected(DiagID::EXPECTED_IDENTIFIER_AFTER,
+			   DiagArg::token(TokenType::STRUCT));
 		return nullptr;
 	}
 	default:
@@ -173,35 +301,34 @@ std::unique_ptr<types::Type> Parser::parseType() {
 }
 
 // Parses `IDENT (:: IDENT)*`.
-std::optional<ast::QualifiedName> Parser::parseQualifiedName() {
+template <typename Builder>
+auto BasicParser<Builder>::parseQualifiedName() -> std::optional<Name> {
 	assert(current.type == TokenType::IDENT);
-	ast::QualifiedName name;
-	name.name = std::move(current.lexeme);
+	Name name = builder.name(current.lexeme);
 	advance();
 
 	while (current.type == TokenType::COLON_COLON) {
 		advance();
 		if (current.type != TokenType::IDENT) {
-			errors.error(
-			    "Expected identifier after '::' but got: " +
-				current.lexeme,
-			    current.line, current.column);
+			unexpected(DiagID::EXPECTED_IDENTIFIER_AFTER,
+				   DiagArg::token(TokenType::COLON_COLON));
 			return std::nullopt;
 		}
-		name.qualifiers.push_back(std::move(name.name));
-		name.name = std::move(current.lexeme);
+		builder.qualify(name, current.lexeme);
 		advance();
 	}
 	return name;
 }
 
-std::unique_ptr<ast::ExprAST> Parser::parsePrimaryExpr() {
+template <typename Builder>
+auto BasicParser<Builder>::parsePrimaryExpr() -> Expr {
+	size_t first = index;
 	if (current.type == TokenType::IDENT) {
 		auto name = parseQualifiedName();
 		if (!name) {
 			return nullptr;
 		}
-		return std::make_unique<ast::VariableExprAST>(std::move(*name));
+		return make<ast::VariableExprAST>(first, std::move(*name));
 	}
 	if (current.type == TokenType::LPAREN) {
 		advance();
@@ -210,8 +337,8 @@ std::unique_ptr<ast::ExprAST> Parser::parsePrimaryExpr() {
 				advance();
 				return expr;
 			}
-			errors.error("Expected ')' but got " + current.lexeme,
-				     current.line, current.column);
+			unexpected(DiagID::EXPECTED_TOKEN,
+				   DiagArg::token(TokenType::RPAREN));
 			return nullptr;
 		}
 		return nullptr;
@@ -219,46 +346,44 @@ std::unique_ptr<ast::ExprAST> Parser::parsePrimaryExpr() {
 	if (auto lit = parseLiteral(); lit) {
 		return lit;
 	}
-	errors.error("Expected identifier, literal or '(' but got " +
-			 current.lexeme,
-		     current.line, current.column);
+	unexpected(DiagID::EXPECTED_PRIMARY);
 	return nullptr;
 }
 
-std::vector<std::unique_ptr<ast::ExprAST>>
-Parser::parseArgListTail(std::unique_ptr<ast::ExprAST> expr) {
-	std::vector<std::unique_ptr<ast::ExprAST>> args;
-	args.emplace_back(std::move(expr));
+template <typename Builder>
+auto BasicParser<Builder>::parseArgListTail(Expr expr) -> List<ast::ExprAST> {
+	auto args = makeList<ast::ExprAST>();
+	builder.append(args, std::move(expr));
 
 	while (current.type == TokenType::COMMA) {
 		advance();
 		auto next_expr = parseExpression();
 		if (next_expr) {
-			args.emplace_back(std::move(next_expr));
+			builder.append(args, std::move(next_expr));
 		}
 		else {
 			return args;
 		}
 	}
-	if (current.type != TokenType::RPAREN) {
-		errors.error("Expected ')' but got " + current.lexeme,
-			     current.line, current.column);
+	if (!expect(TokenType::RPAREN)) {
 		return args;
 	}
 	return args;
 }
 
-std::vector<std::unique_ptr<ast::ExprAST>> Parser::parseArgList() {
+template <typename Builder>
+auto BasicParser<Builder>::parseArgList() -> List<ast::ExprAST> {
 	auto expr = parseExpression();
 	if (expr) {
 		auto arg_list_t = parseArgListTail(std::move(expr));
 		return arg_list_t;
 	}
-	return {};
+	return makeList<ast::ExprAST>();
 }
 
-std::unique_ptr<ast::ExprAST>
-Parser::parsePostfixExprTail(std::unique_ptr<ast::ExprAST> primary_expr) {
+template <typename Builder>
+auto BasicParser<Builder>::parsePostfixExprTail(Expr primary_expr) -> Expr {
+	size_t first = index;
 	if (current.type == TokenType::LBRACKET) {
 		advance();
 		auto expr = parseExpression();
@@ -266,8 +391,8 @@ Parser::parsePostfixExprTail(std::unique_ptr<ast::ExprAST> primary_expr) {
 			if (current.type == TokenType::RBRACKET) {
 				return expr;
 			}
-			errors.error("Expected ']' but got " + current.lexeme,
-				     current.line, current.column);
+			unexpected(DiagID::EXPECTED_TOKEN,
+				   DiagArg::token(TokenType::RBRACKET));
 			return nullptr;
 		}
 		return nullptr;
@@ -278,28 +403,30 @@ Parser::parsePostfixExprTail(std::unique_ptr<ast::ExprAST> primary_expr) {
 		auto args = parseArgList();
 		if (current.type == TokenType::RPAREN) {
 			advance();
-			return std::make_unique<ast::CallExprAST>(
-			    std::move(primary_expr), std::move(args));
+			return make<ast::CallExprAST>(
+			    first, std::move(primary_expr), std::move(args));
 		}
 	}
 	if (current.type == TokenType::DOT) {
 		advance();
 		if (current.type == TokenType::IDENT) {
-			auto name = std::move(current.lexeme);
+			Name name = builder.name(current.lexeme);
 			advance();
-			return std::make_unique<ast::VariableExprAST>(
-			    std::move(name));
+			return make<ast::VariableExprAST>(first,
+							  std::move(name));
 		}
 	}
 	if (current.type == TokenType::PLUS_PLUS) {
 		advance();
-		return std::make_unique<ast::UnaryExprAST>(
-		    ast::UnaryOp::POST_INCREMENT, std::move(primary_expr));
+		return make<ast::UnaryExprAST>(
+		    first, ast::UnaryOp::POST_INCREMENT,
+		    std::move(primary_expr));
 	}
 	if (current.type == TokenType::MINUS_MINUS) {
 		advance();
-		return std::make_unique<ast::UnaryExprAST>(
-		    ast::UnaryOp::POST_DECREMENT, std::move(primary_expr));
+		return make<ast::UnaryExprAST>(
+		    first, ast::UnaryOp::POST_DECREMENT,
+		    std::move(primary_expr));
 	}
 	switch (current.type) {
 	case TokenType::STAR:
@@ -327,25 +454,25 @@ Parser::parsePostfixExprTail(std::unique_ptr<ast::ExprAST> primary_expr) {
 	case TokenType::SEMICOLON:
 		return primary_expr;
 	default:
-		errors.error(
-		    "Expected '[', '(', '.', '::', '++', or '--' but got " +
-			current.lexeme,
-		    current.line, current.column);
+		unexpected(DiagID::EXPECTED_POSTFIX);
 		return nullptr;
 	}
 }
 
-std::unique_ptr<ast::ExprAST> Parser::parsePostfixExpr() {
-	std::unique_ptr<ast::ExprAST> lhs_opt = parsePrimaryExpr();
+template <typename Builder>
+auto BasicParser<Builder>::parsePostfixExpr() -> Expr {
+	Expr lhs_opt = parsePrimaryExpr();
 	if (!lhs_opt) {
 		return nullptr;
 	}
 
-	std::unique_ptr<ast::ExprAST> lhs = std::move(lhs_opt);
+	Expr lhs = std::move(lhs_opt);
 	return parsePostfixExprTail(std::move(lhs));
 }
 
-std::unique_ptr<ast::ExprAST> Parser::parseUnaryExpr() {
+template <typename Builder>
+auto BasicParser<Builder>::parseUnaryExpr() -> Expr {
+	size_t first = index;
 	if (auto is_unary_op = unaryOperator(); is_unary_op) {
 		ast::UnaryOp unary_op{};
 
@@ -369,299 +496,83 @@ std::unique_ptr<ast::ExprAST> Parser::parseUnaryExpr() {
 			unary_op = ast::UnaryOp::BIT_NOT;
 			break;
 		default:
-			errors.error("Invalid unary operator", current.line,
-				     current.column);
+			unexpected(DiagID::INVALID_UNARY_OPERATOR);
 			return nullptr;
 		}
 		advance();
 
 		if (auto postfix_expr = parsePostfixExpr()) {
-			return std::make_unique<ast::UnaryExprAST>(
-			    unary_op, std::move(postfix_expr));
+			return make<ast::UnaryExprAST>(first, unary_op,
+						       std::move(postfix_expr));
 		}
 		return nullptr;
 	}
 	return parsePostfixExpr();
 }
 
-static ast::BinaryOp tokenToBinaryOp(TokenType token) {
-	switch (token) {
-	case TokenType::PLUS:
-		return ast::BinaryOp::ADD;
-	case TokenType::MINUS:
-		return ast::BinaryOp::SUB;
-	case TokenType::STAR:
-		return ast::BinaryOp::MUL;
-	case TokenType::SLASH:
-		return ast::BinaryOp::DIV;
-	case TokenType::PERCENT:
-		return ast::BinaryOp::MOD;
-	case TokenType::EQUAL_EQUAL:
-		return ast::BinaryOp::EQ;
-	case TokenType::EXCLAMATION_EQUAL:
-		return ast::BinaryOp::NEQ;
-	case TokenType::LESS:
-		return ast::BinaryOp::LT;
-	case TokenType::GREATER:
-		return ast::BinaryOp::GT;
-	case TokenType::LESS_EQUAL:
-		return ast::BinaryOp::LE;
-	case TokenType::GREATER_EQUAL:
-		return ast::BinaryOp::GE;
-	case TokenType::AMPERSAND_AMPERSAND:
-		return ast::BinaryOp::AND;
-	case TokenType::PIPE_PIPE:
-		return ast::BinaryOp::OR;
-	case TokenType::AMPERSAND:
-		return ast::BinaryOp::BIT_AND;
-	case TokenType::PIPE:
-		return ast::BinaryOp::BIT_OR;
-	case TokenType::CARET:
-		return ast::BinaryOp::BIT_XOR;
-	case TokenType::LESS_LESS:
-		return ast::BinaryOp::SHL;
-	case TokenType::GREATER_GREATER:
-		return ast::BinaryOp::SHR;
-	default:
-		assert(false &&
-		       "tokenToBinaryOp: token is not a binary operator");
-		std::unreachable();
-	}
-}
-
-std::unique_ptr<ast::ExprAST> Parser::parseMultiplicativeExpr() {
+template <typename Builder>
+auto BasicParser<Builder>::parseBinaryExpr(Precedence min) -> Expr {
 	auto lhs = parseUnaryExpr();
 	if (!lhs) {
 		return nullptr;
 	}
-
-	while (current.type == TokenType::STAR ||
-	       current.type == TokenType::SLASH ||
-	       current.type == TokenType::PERCENT) {
-
-		ast::BinaryOp op = tokenToBinaryOp(current.type);
-		advance();
-
-		auto rhs = parseUnaryExpr();
-		if (!rhs) {
-			return nullptr;
-		}
-
-		lhs = std::make_unique<ast::BinaryExprAST>(op, std::move(lhs),
-							   std::move(rhs));
-	}
-	return lhs;
-}
-
-std::unique_ptr<ast::ExprAST> Parser::parseAdditiveExpr() {
-	auto lhs = parseMultiplicativeExpr();
-	if (!lhs) {
-		return nullptr;
-	}
-
-	while (current.type == TokenType::PLUS ||
-	       current.type == TokenType::MINUS) {
-
-		ast::BinaryOp op = tokenToBinaryOp(current.type);
-		advance();
-
-		auto rhs = parseMultiplicativeExpr();
-		if (!rhs) {
-			return nullptr;
-		}
-
-		lhs = std::make_unique<ast::BinaryExprAST>(op, std::move(lhs),
-							   std::move(rhs));
-	}
-	return lhs;
-}
-
-std::unique_ptr<ast::ExprAST> Parser::parseShiftExpr() {
-	auto lhs = parseAdditiveExpr();
-	if (!lhs) {
-		return nullptr;
-	}
-
-	while (current.type == TokenType::LESS_LESS ||
-	       current.type == TokenType::GREATER_GREATER) {
-
-		ast::BinaryOp op = tokenToBinaryOp(current.type);
-		advance();
-
-		auto rhs = parseAdditiveExpr();
-		if (!rhs) {
-			return nullptr;
-		}
-
-		lhs = std::make_unique<ast::BinaryExprAST>(op, std::move(lhs),
-							   std::move(rhs));
-	}
-	return lhs;
-}
-
-std::unique_ptr<ast::ExprAST> Parser::parseRelationalExpr() {
-	auto lhs = parseShiftExpr();
-	if (!lhs) {
-		return nullptr;
-	}
-
-	while (current.type == TokenType::LESS ||
-	       current.type == TokenType::GREATER ||
-	       current.type == TokenType::LESS_EQUAL ||
-	       current.type == TokenType::GREATER_EQUAL) {
-
-		ast::BinaryOp op = tokenToBinaryOp(current.type);
-		advance();
-
-		auto rhs = parseShiftExpr();
-		if (!rhs) {
-			return nullptr;
-		}
-
-		lhs = std::make_unique<ast::BinaryExprAST>(op, std::move(lhs),
-							   std::move(rhs));
-	}
-	return lhs;
-}
-
-std::unique_ptr<ast::ExprAST> Parser::parseEqualityExpr() {
-	auto lhs = parseRelationalExpr();
-	if (!lhs) {
-		return nullptr;
-	}
-
-	while (current.type == TokenType::EQUAL_EQUAL ||
-	       current.type == TokenType::EXCLAMATION_EQUAL) {
-
-		ast::BinaryOp op = tokenToBinaryOp(current.type);
-		advance();
-
-		auto rhs = parseRelationalExpr();
-		if (!rhs) {
-			return nullptr;
-		}
-
-		lhs = std::make_unique<ast::BinaryExprAST>(op, std::move(lhs),
-							   std::move(rhs));
-	}
-	return lhs;
-}
-
-std::unique_ptr<ast::ExprAST> Parser::parseAndExpr() {
-	auto lhs = parseEqualityExpr();
-	if (!lhs) {
-		return nullptr;
-	}
-
-	while (current.type == TokenType::AMPERSAND) {
-		ast::BinaryOp op = tokenToBinaryOp(current.type);
-		advance();
-
-		auto rhs = parseEqualityExpr();
-		if (!rhs) {
-			return nullptr;
-		}
-
-		lhs = std::make_unique<ast::BinaryExprAST>(op, std::move(lhs),
-							   std::move(rhs));
-	}
-	return lhs;
-}
-
-std::unique_ptr<ast::ExprAST> Parser::parseXORExpr() {
-	auto lhs = parseAndExpr();
-	if (!lhs) {
-		return nullptr;
-	}
-
-	while (current.type == TokenType::CARET) {
-		ast::BinaryOp op = tokenToBinaryOp(current.type);
-		advance();
-
-		auto rhs = parseAndExpr();
-		if (!rhs) {
-			return nullptr;
-		}
-
-		lhs = std::make_unique<ast::BinaryExprAST>(op, std::move(lhs),
-							   std::move(rhs));
-	}
-	return lhs;
+	return parseBinaryExprTail(std::move(lhs), min);
 }
 
-std::unique_ptr<ast::ExprAST> Parser::parseInclusiveOrExpr() {
-	auto lhs = parseXORExpr();
-	if (!lhs) {
-		return nullptr;
-	}
-
-	while (current.type == TokenType::PIPE) {
-		ast::BinaryOp op = tokenToBinaryOp(current.type);
-		advance();
-
-		auto rhs = parseXORExpr();
-		if (!rhs) {
-			return nullptr;
+// Precedence climbing: folds operators binding at least as tightly as
+// `min` into `lhs`, and recurses only where the next operator binds tighter
+// than the one just read, so each operator costs one table lookup
+template <typename Builder>
+auto BasicParser<Builder>::parseBinaryExprTail(Expr lhs, Precedence min)
+    -> Expr {
+	size_t first = index;
+	while (true) {
+		const BinaryOperator &info = binaryOperator(current.type);
+		if (info.precedence == Precedence::NONE ||
+		    info.precedence < min) {
+			return lhs;
 		}
-
-		lhs = std::make_unique<ast::BinaryExprAST>(op, std::move(lhs),
-							   std::move(rhs));
-	}
-	return lhs;
-}
-
-std::unique_ptr<ast::ExprAST> Parser::parseLogicalAndExpr() {
-	auto lhs = parseInclusiveOrExpr();
-	if (!lhs) {
-		return nullptr;
-	}
-
-	while (current.type == TokenType::AMPERSAND_AMPERSAND) {
-		ast::BinaryOp op = tokenToBinaryOp(current.type);
 		advance();
 
-		auto rhs = parseInclusiveOrExpr();
+		auto rhs = parseUnaryExpr();
 		if (!rhs) {
 			return nullptr;
 		}
 
-		lhs = std::make_unique<ast::BinaryExprAST>(op, std::move(lhs),
-							   std::move(rhs));
-	}
-	return lhs;
-}
-
-std::unique_ptr<ast::ExprAST> Parser::parseLogicalOrExpr() {
-	auto lhs = parseLogicalAndExpr();
-	if (!lhs) {
-		return nullptr;
-	}
-
-	while (current.type == TokenType::PIPE_PIPE) {
-		ast::BinaryOp op = tokenToBinaryOp(current.type);
-		advance();
-
-		auto rhs = parseLogicalAndExpr();
-		if (!rhs) {
-			return nullptr;
+		while (true) {
+			const BinaryOperator &next =
+			    binaryOperator(current.type);
+			bool tighter = next.precedence > info.precedence;
+			bool rightward =
+			    next.precedence == info.precedence &&
+			    next.associativity == Associativity::RIGHT;
+			if (!tighter && !rightward) {
+				break;
+			}
+			rhs = parseBinaryExprTail(std::move(rhs),
+						  next.precedence);
+			if (!rhs) {
+				return nullptr;
+			}
 		}
 
-		lhs = std::make_unique<ast::BinaryExprAST>(op, std::move(lhs),
-							   std::move(rhs));
+		lhs = make<ast::BinaryExprAST>(first, info.op, std::move(lhs),
+					       std::move(rhs));
 	}
-	return lhs;
 }
 
-std::unique_ptr<ast::ExprAST> Parser::parseExpression() {
-	auto lhs = parseLogicalOrExpr();
+template <typename Builder>
+auto BasicParser<Builder>::parseExpression() -> Expr {
+	auto lhs = parseBinaryExpr(Precedence::LOGICAL_OR);
 	if (!lhs) {
 		return nullptr;
 	}
 	return parseExpressionTail(std::move(lhs));
 }
 
-std::unique_ptr<ast::ExprAST>
-Parser::parseExpressionTail(std::unique_ptr<ast::ExprAST> lhs) {
+template <typename Builder>
+auto BasicParser<Builder>::parseExpressionTail(Expr lhs) -> Expr {
+	size_t first = index;
 	if (current.type == TokenType::QUESTION) {
 		advance();
 
@@ -671,16 +582,15 @@ Parser::parseExpressionTail(std::unique_ptr<ast::ExprAST> lhs) {
 				advance();
 				auto else_branch = parseExpression();
 				if (else_branch != nullptr) {
-					return std::make_unique<
-					    ast::TernaryExprAST>(
-					    std::move(lhs),
+					return make<ast::TernaryExprAST>(
+					    first, std::move(lhs),
 					    std::move(then_branch),
 					    std::move(else_branch));
 				}
 				return nullptr;
 			}
-			errors.error("Expected ':' but got: " + current.lexeme,
-				     current.line, current.column);
+			unexpected(DiagID::EXPECTED_TOKEN,
+				   DiagArg::token(TokenType::COLON));
 			return nullptr;
 		}
 		return nullptr;
@@ -688,11 +598,11 @@ Parser::parseExpressionTail(std::unique_ptr<ast::ExprAST> lhs) {
 	return lhs;
 }
 
-std::unique_ptr<ast::DeclAST> Parser::parseVarDecl() {
-	if (current.type != TokenType::VAR) {
-		errors.error("Expected 'var' got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+template <typename Builder>
+auto BasicParser<Builder>::parseVarDecl() -> Decl {
+	size_t first = index;
+	if (!expect(TokenType::VAR)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
@@ -701,111 +611,105 @@ std::unique_ptr<ast::DeclAST> Parser::parseVarDecl() {
 		return nullptr;
 	}
 	if (current.type != TokenType::IDENT) {
-		errors.error("Expected identifier but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+		unexpected(DiagID::EXPECTED_IDENTIFIER);
+		skipUnexpected();
 		return nullptr;
 	}
-	std::string name = current.lexeme;
+	std::string_view name = current.lexeme;
 	advance();
 
 	// variable declaration tail
 	if (current.type == TokenType::SEMICOLON) {
 		advance();
-		return std::make_unique<ast::VariableDeclarationAST>(
-		    std::move(type), std::move(name));
+		return make<ast::VariableDeclarationAST>(first, std::move(type),
+							 name);
 	}
 	if (current.type == TokenType::EQUAL) {
 		advance();
 		auto expr = parseExpression();
-		if (current.type != TokenType::SEMICOLON) {
-			errors.error("Expected ';' but got: " + current.lexeme,
-				     current.line, current.column);
-			advance();
+		if (!expect(TokenType::SEMICOLON)) {
+			skipUnexpected();
 			return nullptr;
 		}
 		advance();
-		return std::make_unique<ast::VariableDeclarationAST>(
-		    std::move(type), std::move(name), nullptr, std::move(expr));
+		return make<ast::VariableDeclarationAST>(
+		    first, std::move(type), name, nullptr,
+		    std::move(expr));
 	}
 	// array variable
-	if (current.type != TokenType::LBRACKET) {
-		errors.error("Expected '[' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::LBRACKET)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
 	auto array_size = parseExpression();
-	if (current.type != TokenType::RBRACKET) {
-		errors.error("Expected ']' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::RBRACKET)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
-	if (current.type != TokenType::SEMICOLON) {
-		errors.error("Expected ';' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::SEMICOLON)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
-	return std::make_unique<ast::VariableDeclarationAST>(
-	    std::move(type), std::move(name), std::move(array_size));
+	return make<ast::VariableDeclarationAST>(
+	    first, std::move(type), name, std::move(array_size));
 }
 
-std::unique_ptr<ast::StmtAST> Parser::parseContinueStmt() {
+template <typename Builder>
+auto BasicParser<Builder>::parseContinueStmt() -> Stmt {
+	size_t first = index;
 	assert(current.type == TokenType::CONTINUE);
 	advance();
 
-	if (current.type != TokenType::SEMICOLON) {
-		errors.error("Expected ';' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::SEMICOLON)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
-	return std::make_unique<ast::ContinueStmtAST>();
+	return make<ast::ContinueStmtAST>(first);
 }
 
-std::unique_ptr<ast::StmtAST> Parser::parseBreakStmt() {
+template <typename Builder>
+auto BasicParser<Builder>::parseBreakStmt() -> Stmt {
+	size_t first = index;
 	assert(current.type == TokenType::BREAK);
 	advance();
 
-	if (current.type != TokenType::SEMICOLON) {
-		errors.error("Expected ';' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::SEMICOLON)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
-	return std::make_unique<ast::BreakStmtAST>();
+	return make<ast::BreakStmtAST>(first);
 }
 
-std::unique_ptr<ast::StmtAST> Parser::parseReturnStmt() {
+template <typename Builder>
+auto BasicParser<Builder>::parseReturnStmt() -> Stmt {
+	size_t first = index;
 	assert(current.type == TokenType::RETURN);
 	advance();
 
 	if (current.type == TokenType::SEMICOLON) {
 		advance();
-		return std::make_unique<ast::ReturnStmtAST>();
+		return make<ast::ReturnStmtAST>(first);
 	}
 
 	auto ret_value = parseExpression();
-	if (current.type != TokenType::SEMICOLON) {
-		errors.error("Expected ';' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::SEMICOLON)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
-	return std::make_unique<ast::ReturnStmtAST>(std::move(ret_value));
+	return make<ast::ReturnStmtAST>(first, std::move(ret_value));
 }
 
-std::unique_ptr<ast::StmtAST> Parser::parseAssignmentStmt() {
+template <typename Builder>
+auto BasicParser<Builder>::parseAssignmentStmt() -> Stmt {
+	size_t first = index;
 	assert(current.type == TokenType::IDENT);
-	std::string var_name = std::move(current.lexeme);
+	std::string_view var_name = current.lexeme;
 	advance();
 
 	if (auto is_assignmement_op = assignmentOperator();
@@ -847,39 +751,33 @@ std::unique_ptr<ast::StmtAST> Parser::parseAssignmentStmt() {
 			assignment_op = ast::AssignOp::BIT_OR_ASSIGN;
 			break;
 		default:
-			errors.error("Invalid assignment operator: " +
-					 current.lexeme,
-				     current.line, current.column);
-			advance();
+			unexpected(DiagID::INVALID_ASSIGNMENT_OPERATOR);
+			skipUnexpected();
 			return nullptr;
 		}
 		advance();
 
 		auto expr = parseExpression();
 
-		if (current.type != TokenType::SEMICOLON) {
-			errors.error("Expected ';' but got: " + current.lexeme,
-				     current.line, current.column);
-			advance();
+		if (!expect(TokenType::SEMICOLON)) {
+			skipUnexpected();
 			return nullptr;
 		}
 		advance();
-		return std::make_unique<ast::AssignmentStmtAST>(
-		    std::move(var_name), assignment_op, std::move(expr));
+		return make<ast::AssignmentStmtAST>(
+		    first, var_name, assignment_op, std::move(expr));
 	}
-	errors.error("Expected an assignment operator but got: " +
-			 current.lexeme,
-		     current.line, current.column);
+	unexpected(DiagID::EXPECTED_ASSIGNMENT_OPERATOR);
 	return nullptr;
 }
-std::unique_ptr<ast::StmtAST> Parser::parseWhileStmt() {
+template <typename Builder>
+auto BasicParser<Builder>::parseWhileStmt() -> Stmt {
+	size_t first = index;
 	assert(current.type == TokenType::WHILE);
 	advance();
 
-	if (current.type != TokenType::LPAREN) {
-		errors.error("Expected '(' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::LPAREN)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
@@ -889,18 +787,14 @@ std::unique_ptr<ast::StmtAST> Parser::parseWhileStmt() {
 		return nullptr;
 	}
 
-	if (current.type != TokenType::RPAREN) {
-		errors.error("Expected ')' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::RPAREN)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
 
-	if (current.type != TokenType::LBRACE) {
-		errors.error("Expected '{' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::LBRACE)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
@@ -910,25 +804,23 @@ std::unique_ptr<ast::StmtAST> Parser::parseWhileStmt() {
 		return nullptr;
 	}
 
-	if (current.type != TokenType::RBRACE) {
-		errors.error("Expected '}' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!closeBrace()) {
 		return nullptr;
 	}
-	advance();
-	return std::make_unique<ast::WhileStmtAST>(std::move(condition),
-						   std::move(stmt_list));
+	return make<ast::WhileStmtAST>(first, std::move(condition),
+				       std::move(stmt_list));
 }
 
-std::unique_ptr<ast::StmtAST> Parser::parseForInit() {
+template <typename Builder>
+auto BasicParser<Builder>::parseForInit() -> Stmt {
+	size_t first = index;
 	switch (current.type) {
 	case TokenType::VAR: {
 		auto var_dec = parseVarDecl();
 		if (var_dec == nullptr) {
 			return nullptr;
 		}
-		return std::make_unique<ast::DeclStmtAST>(std::move(var_dec));
+		return make<ast::DeclStmtAST>(first, std::move(var_dec));
 	}
 	case TokenType::IDENT: {
 		auto assignment = parseAssignmentStmt();
@@ -938,16 +830,14 @@ std::unique_ptr<ast::StmtAST> Parser::parseForInit() {
 		return assignment;
 	}
 	default: {
-		errors.error("Expected variable declaration or assignment in "
-			     "for-loop initializer but got: " +
-				 current.lexeme,
-			     current.line, current.column);
+		unexpected(DiagID::EXPECTED_FOR_INIT);
 		return nullptr;
 	}
 	}
 }
 
-std::unique_ptr<ast::ExprAST> Parser::parseForUpdate() {
+template <typename Builder>
+auto BasicParser<Builder>::parseForUpdate() -> Expr {
 	auto expr = parseExpression();
 	if (expr == nullptr) {
 		return nullptr;
@@ -955,14 +845,14 @@ std::unique_ptr<ast::ExprAST> Parser::parseForUpdate() {
 	return expr;
 }
 
-std::unique_ptr<ast::StmtAST> Parser::parseForStmt() {
+template <typename Builder>
+auto BasicParser<Builder>::parseForStmt() -> Stmt {
+	size_t first = index;
 	assert(current.type == TokenType::FOR);
 	advance();
 
-	if (current.type != TokenType::LPAREN) {
-		errors.error("Expected '(' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::LPAREN)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
@@ -977,10 +867,8 @@ std::unique_ptr<ast::StmtAST> Parser::parseForStmt() {
 		return nullptr;
 	}
 
-	if (current.type != TokenType::SEMICOLON) {
-		errors.error("Expected ';' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::SEMICOLON)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
@@ -989,18 +877,14 @@ std::unique_ptr<ast::StmtAST> Parser::parseForStmt() {
 	if (for_update == nullptr) {
 		return nullptr;
 	}
-	if (current.type != TokenType::RPAREN) {
-		errors.error("Expected ')' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::RPAREN)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
 
-	if (current.type != TokenType::LBRACE) {
-		errors.error("Expected '{' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::LBRACE)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
@@ -1009,33 +893,30 @@ std::unique_ptr<ast::StmtAST> Parser::parseForStmt() {
 	if (stmt_list == nullptr) {
 		return nullptr;
 	}
-	if (current.type != TokenType::RBRACE) {
-		errors.error("Expected '}' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!closeBrace()) {
 		return nullptr;
 	}
-	advance();
 
-	return std::make_unique<ast::ForStmtAST>(
-	    std::move(for_init), std::move(expr), std::move(for_update),
-	    std::move(stmt_list));
+	return make<ast::ForStmtAST>(first, std::move(for_init),
+				     std::move(expr), std::move(for_update),
+				     std::move(stmt_list));
 }
 
-std::unique_ptr<ast::BlockStmtAST> Parser::parseElseStmt() {
+template <typename Builder>
+auto BasicParser<Builder>::parseElseStmt() -> Block {
+	size_t first = index;
 	if (current.type == TokenType::IF) {
 		auto if_stmt = parseIfStmt();
 		if (if_stmt == nullptr) {
 			return nullptr;
 		}
-		std::vector<std::unique_ptr<ast::StmtAST>> stmts;
-		stmts.push_back(std::move(if_stmt));
-		return std::make_unique<ast::BlockStmtAST>(std::move(stmts));
+		auto stmts = makeList<ast::StmtAST>();
+		builder.append(stmts, std::move(if_stmt));
+		return make<ast::BlockStmtAST>(first, std::move(stmts));
 	}
 	if (current.type != TokenType::LBRACE) {
-		errors.error("Expected 'if' or '{' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+		unexpected(DiagID::EXPECTED_ELSE_BODY);
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
@@ -1044,17 +925,14 @@ std::unique_ptr<ast::BlockStmtAST> Parser::parseElseStmt() {
 	if (stmt_list == nullptr) {
 		return nullptr;
 	}
-	if (current.type != TokenType::RBRACE) {
-		errors.error("Expected '}' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!closeBrace()) {
 		return nullptr;
 	}
-	advance();
 	return stmt_list;
 }
 
-std::unique_ptr<ast::BlockStmtAST> Parser::parseIfStmtTail() {
+template <typename Builder>
+auto BasicParser<Builder>::parseIfStmtTail() -> Block {
 	if (current.type != TokenType::ELSE) {
 		return nullptr;
 	}
@@ -1062,14 +940,14 @@ std::unique_ptr<ast::BlockStmtAST> Parser::parseIfStmtTail() {
 	return parseElseStmt();
 }
 
-std::unique_ptr<ast::StmtAST> Parser::parseIfStmt() {
+template <typename Builder>
+auto BasicParser<Builder>::parseIfStmt() -> Stmt {
+	size_t first = index;
 	assert(current.type == TokenType::IF);
 	advance();
 
-	if (current.type != TokenType::LPAREN) {
-		errors.error("Expected '(' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::LPAREN)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
@@ -1079,18 +957,14 @@ std::unique_ptr<ast::StmtAST> Parser::parseIfStmt() {
 		return nullptr;
 	}
 
-	if (current.type != TokenType::RPAREN) {
-		errors.error("Expected ')' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::RPAREN)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
 
-	if (current.type != TokenType::LBRACE) {
-		errors.error("Expected '{' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::LBRACE)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
@@ -1099,21 +973,19 @@ std::unique_ptr<ast::StmtAST> Parser::parseIfStmt() {
 	if (then_branch == nullptr) {
 		return nullptr;
 	}
-	if (current.type != TokenType::RBRACE) {
-		errors.error("Expected '}' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!closeBrace()) {
 		return nullptr;
 	}
-	advance();
 	auto else_branch = parseIfStmtTail();
 
-	return std::make_unique<ast::IfStmtAST>(std::move(condition),
-						std::move(then_branch),
-						std::move(else_branch));
+	return make<ast::IfStmtAST>(first, std::move(condition),
+				    std::move(then_branch),
+				    std::move(else_branch));
 }
 
-std::unique_ptr<ast::StmtAST> Parser::parseStmt() {
+template <typename Builder>
+auto BasicParser<Builder>::parseStmt() -> Stmt {
+	size_t first = index;
 	switch (current.type) {
 	case TokenType::IF: {
 		return parseIfStmt();
@@ -1141,46 +1013,62 @@ std::unique_ptr<ast::StmtAST> Parser::parseStmt() {
 		if (variable == nullptr) {
 			return nullptr;
 		}
-		return std::make_unique<ast::DeclStmtAST>(std::move(variable));
+		return make<ast::DeclStmtAST>(first, std::move(variable));
 	}
 	default: {
-		errors.error("Expected statement but got: " + current.lexeme,
-			     current.line, current.column);
+		unexpected(DiagID::EXPECTED_STATEMENT);
 		return nullptr;
 	}
 	}
 }
 
-std::unique_ptr<ast::BlockStmtAST> Parser::parseStmtList() {
-	std::vector<std::unique_ptr<ast::StmtAST>> stmts;
+template <typename Builder>
+auto BasicParser<Builder>::parseStmtList() -> Block {
+	size_t first = index;
+	auto stmts = makeList<ast::StmtAST>();
 
 	while (current.type != TokenType::RBRACE &&
 	       current.type != TokenType::T_EOF) {
+		// lexer errors can reach the limit too
+		if (errors.limitReached()) {
+			return nullptr;
+		}
+		// the block was left open; its '}' is reported missing
+		if (recovering() && isDeclKeyword(current.type)) {
+			break;
+		}
+		size_t start = index;
+		uint32_t begin = current.offset;
+		panicking = false;
 		auto stmt = parseStmt();
 		if (stmt == nullptr) {
-			return nullptr;
+			if (!recovering()) {
+				return nullptr;
+			}
+			// never empty: no statement starts at a token
+			// skipStatement() stops at without consuming
+			skipStatement();
+			stmt = make<ast::ErrorStmtAST>(start, begin,
+						       consumedEnd);
 		}
-		stmts.push_back(std::move(stmt));
+		builder.append(stmts, std::move(stmt));
 	}
-	return std::make_unique<ast::BlockStmtAST>(std::move(stmts));
+	return make<ast::BlockStmtAST>(first, std::move(stmts));
 }
 
-std::vector<std::pair<std::unique_ptr<types::Type>, std::string>>
-Parser::parseParamList() {
-	std::vector<std::pair<std::unique_ptr<types::Type>, std::string>>
-	    params;
+template <typename Builder>
+auto BasicParser<Builder>::parseParamList() -> Params {
+	Params params = builder.params();
 	auto param_type = parseType();
 	if (param_type == nullptr) {
 		return params;
 	}
 	if (current.type != TokenType::IDENT) {
-		errors.error("Expected parameter name but got: " +
-				 current.lexeme,
-			     current.line, current.column);
+		unexpected(DiagID::EXPECTED_PARAMETER_NAME);
 		advance();
 		return params;
 	}
-	params.emplace_back(std::move(param_type), std::move(current.lexeme));
+	builder.param(params, std::move(param_type), current.lexeme);
 	advance();
 
 	// <param-list-tail>
@@ -1191,61 +1079,51 @@ Parser::parseParamList() {
 			return params;
 		}
 		if (current.type != TokenType::IDENT) {
-			errors.error("Expected parameter name but got: " +
-					 current.lexeme,
-				     current.line, current.column);
+			unexpected(DiagID::EXPECTED_PARAMETER_NAME);
 			advance();
 			return params;
 		}
-		params.emplace_back(std::move(param_type),
-				    std::move(current.lexeme));
+		builder.param(params, std::move(param_type), current.lexeme);
 		advance();
 	}
 	return params;
 }
 
-std::unique_ptr<ast::PrototypeAST> Parser::parseProto() {
+template <typename Builder>
+auto BasicParser<Builder>::parseProto() -> Node<ast::PrototypeAST> {
+	size_t first = index;
 	assert(current.type == TokenType::FUNC);
 	advance();
 
 	if (current.type != TokenType::IDENT) {
-		errors.error("Expected function identifier but got: " +
-				 current.lexeme,
-			     current.line, current.column);
-		advance();
+		unexpected(DiagID::EXPECTED_FUNCTION_NAME);
+		skipUnexpected();
 		return nullptr;
 	}
 	auto func_name = parseQualifiedName();
 	if (!func_name) {
-		advance();
+		skipUnexpected();
 		return nullptr;
 	}
 
-	if (current.type != TokenType::LPAREN) {
-		errors.error("Expected '(' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::LPAREN)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
 
-	std::vector<std::pair<std::unique_ptr<types::Type>, std::string>>
-	    params;
+	Params params = builder.params();
 	if (current.type != TokenType::RPAREN) {
 		params = parseParamList();
 	}
-	if (current.type != TokenType::RPAREN) {
-		errors.error("Expected ')' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::RPAREN)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
 
-	if (current.type != TokenType::ARROW) {
-		errors.error("Expected '->' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::ARROW)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
@@ -1254,11 +1132,33 @@ std::unique_ptr<ast::PrototypeAST> Parser::parseProto() {
 	if (return_type == nullptr) {
 		return nullptr;
 	}
-	return std::make_unique<ast::PrototypeAST>(
-	    std::move(*func_name), std::move(params), std::move(return_type));
+	return make<ast::PrototypeAST>(first, std::move(*func_name),
+				       std::move(params),
+				       std::move(return_type));
 }
 
-std::unique_ptr<ast::DeclAST> Parser::parseFunc() {
+template <typename Builder>
+auto BasicParser<Builder>::parseFuncBody() -> Block {
+	if (!expect(TokenType::LBRACE)) {
+		skipUnexpected();
+		return nullptr;
+	}
+	advance();
+
+	auto body = parseStmtList();
+	if (body == nullptr) {
+		return nullptr;
+	}
+
+	if (!closeBrace()) {
+		return nullptr;
+	}
+	return body;
+}
+
+template <typename Builder>
+auto BasicParser<Builder>::parseFunc() -> Decl {
+	size_t first = index;
 	assert(current.type == TokenType::FUNC); // no advance
 
 	auto prototype = parseProto();
@@ -1266,54 +1166,104 @@ std::unique_ptr<ast::DeclAST> Parser::parseFunc() {
 		return nullptr;
 	}
 
-	if (current.type != TokenType::LBRACE) {
-		errors.error("Expected '{' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
-		return nullptr;
+	if constexpr (Builder::LAZY_BODIES) {
+		if (bodies == BodyParsing::LAZY &&
+		    current.type == TokenType::LBRACE) {
+			return parseLazyFunc(std::move(prototype));
+		}
 	}
-	advance();
 
-	auto body = parseStmtList();
+	auto body = parseFuncBody();
 	if (body == nullptr) {
 		return nullptr;
 	}
+	return make<ast::FunctionAST>(first, std::move(prototype),
+				      std::move(body));
+}
 
-	if (current.type != TokenType::RBRACE) {
-		errors.error("Expected '}' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+namespace {
+// Parses the bodies one parse deferred, each with a parser of its own
+// that picks up where the skipped '{' was
+template <typename Builder>
+class LazyBodies final : public ast::DeferredBodies {
+	const TokenBuffer *tokens;
+	ErrorReporter *errors;
+	Builder builder;
+	ErrorRecovery recovery;
+
+public:
+	LazyBodies(const TokenBuffer &tokens, ErrorReporter &errors,
+		   Builder builder, ErrorRecovery recovery)
+	    : tokens(&tokens), errors(&errors), builder(builder),
+	      recovery(recovery) {}
+
+	[[nodiscard]] std::unique_ptr<ast::BlockStmtAST>
+	parseBody(size_t open) const override {
+		BasicParser<Builder> parser(*tokens, *errors, builder);
+		parser.setRecovery(recovery);
+		parser.seek(open);
+		return parser.parseFuncBody();
+	}
+};
+} // namespace
+
+// Skips to the '}' matching `current` and defers the body to its first
+// use; an unbalanced body is parsed now so its errors come out in order
+template <typename Builder>
+auto BasicParser<Builder>::parseLazyFunc(Node<ast::PrototypeAST> prototype)
+    -> Decl
+	requires Builder::LAZY_BODIES
+{
+	size_t first = index;
+	size_t open = index;
+	size_t depth = 0;
+	for (size_t i = open; i < tokens->size(); i++) {
+		TokenType type = tokens->type(i);
+		depth += type == TokenType::LBRACE ? 1 : 0;
+		depth -= type == TokenType::RBRACE ? 1 : 0;
+		if (depth > 0) {
+			continue;
+		}
+		seek(i + 1);
+		if (deferred == nullptr) {
+			deferred = builder.template share<LazyBodies<Builder>>(
+			    *tokens, errors, builder, recovery);
+		}
+		return make<ast::FunctionAST>(first, std::move(prototype),
+					      deferred, open);
+	}
+
+	auto body = parseFuncBody();
+	if (body == nullptr) {
 		return nullptr;
 	}
-	advance();
-	return std::make_unique<ast::FunctionAST>(std::move(prototype),
-						  std::move(body));
+	return make<ast::FunctionAST>(first, std::move(prototype),
+				      std::move(body));
 }
 
-std::unique_ptr<ast::DeclAST> Parser::parseStruct() {
+template <typename Builder>
+auto BasicParser<Builder>::parseStruct() -> Decl {
+	size_t first = index;
 	assert(current.type == TokenType::STRUCT);
 	advance();
 
 	if (current.type != TokenType::IDENT) {
-		errors.error("Expected struct name but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+		unexpected(DiagID::EXPECTED_STRUCT_NAME);
+		skipUnexpected();
 		return nullptr;
 	}
-	std::string name = std::move(current.lexeme);
+	std::string_view name = current.lexeme;
 	advance();
 
-	if (current.type != TokenType::LBRACE) {
-		errors.error("Expected '{' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::LBRACE)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
 
 	// <struct-body>
-	std::vector<std::unique_ptr<ast::VariableDeclarationAST>> fields;
-	std::vector<std::unique_ptr<ast::FunctionAST>> methods;
+	auto fields = makeList<ast::VariableDeclarationAST>();
+	auto methods = makeList<ast::FunctionAST>();
 
 	while (current.type == TokenType::VAR ||
 	       current.type == TokenType::FUNC) {
@@ -1322,51 +1272,46 @@ std::unique_ptr<ast::DeclAST> Parser::parseStruct() {
 			if (field == nullptr) {
 				return nullptr;
 			}
-			fields.push_back(
-			    std::unique_ptr<ast::VariableDeclarationAST>(
-				static_cast<ast::VariableDeclarationAST *>(
-				    field.release())));
+			builder.append(
+			    fields,
+			    builder.template cast<ast::VariableDeclarationAST>(
+				std::move(field)));
 		}
 		else {
 			auto method = parseFunc();
 			if (method == nullptr) {
 				return nullptr;
 			}
-			methods.push_back(std::unique_ptr<ast::FunctionAST>(
-			    static_cast<ast::FunctionAST *>(method.release())));
+			builder.append(methods,
+				       builder.template cast<ast::FunctionAST>(
+					   std::move(method)));
 		}
 	}
 
-	if (current.type != TokenType::RBRACE) {
-		errors.error("Expected '}' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!closeBrace()) {
 		return nullptr;
 	}
-	advance();
 
-	return std::make_unique<ast::StructAST>(
-	    std::move(name), std::move(fields), std::move(methods));
+	return make<ast::StructAST>(first, name, std::move(fields),
+				    std::move(methods));
 }
 
-std::unique_ptr<ast::DeclAST> Parser::parseNamespace() {
+template <typename Builder>
+auto BasicParser<Builder>::parseNamespace() -> Decl {
+	size_t first = index;
 	assert(current.type == TokenType::NAMESPACE);
 	advance();
 
 	if (current.type != TokenType::IDENT) {
-		errors.error("Expected namespace identifier but got: " +
-				 current.lexeme,
-			     current.line, current.column);
-		advance();
+		unexpected(DiagID::EXPECTED_NAMESPACE_NAME);
+		skipUnexpected();
 		return nullptr;
 	}
-	auto name = std::move(current.lexeme);
+	std::string_view name = current.lexeme;
 	advance();
 
-	if (current.type != TokenType::LBRACE) {
-		errors.error("Expected '{' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!expect(TokenType::LBRACE)) {
+		skipUnexpected();
 		return nullptr;
 	}
 	advance();
@@ -1376,18 +1321,15 @@ std::unique_ptr<ast::DeclAST> Parser::parseNamespace() {
 		return nullptr;
 	}
 
-	if (current.type != TokenType::RBRACE) {
-		errors.error("Expected '}' but got: " + current.lexeme,
-			     current.line, current.column);
-		advance();
+	if (!closeBrace()) {
 		return nullptr;
 	}
-	advance();
-	return std::make_unique<ast::NamespaceAST>(std::move(name),
-						   std::move(*decl_list));
+	return make<ast::NamespaceAST>(first, name,
+				       std::move(*decl_list));
 }
 
-std::unique_ptr<ast::DeclAST> Parser::parseDecl() {
+template <typename Builder>
+auto BasicParser<Builder>::parseDecl() -> Decl {
 	switch (current.type) {
 	case TokenType::NAMESPACE:
 		return parseNamespace();
@@ -1396,41 +1338,88 @@ std::unique_ptr<ast::DeclAST> Parser::parseDecl() {
 	case TokenType::FUNC:
 		return parseFunc();
 	default:
-		errors.error(
-		    "Expected 'namespace', 'struct', or 'func' but got: " +
-			current.lexeme,
-		    current.line, current.column);
-		advance();
+		unexpected(DiagID::EXPECTED_DECL_KEYWORD);
+		skipUnexpected();
 		return nullptr;
 	}
 }
 
-std::optional<std::vector<std::unique_ptr<ast::DeclAST>>>
-Parser::parseDeclList() {
-	std::vector<std::unique_ptr<ast::DeclAST>> decls;
-
-	while (current.type != TokenType::T_EOF &&
+template <typename Builder>
+bool BasicParser<Builder>::parseDeclsInto(List<ast::DeclAST> &decls,
+					  size_t end) {
+	while (index < end && current.type != TokenType::T_EOF &&
 	       current.type != TokenType::RBRACE) {
+		if (errors.limitReached()) {
+			return false;
+		}
+		size_t start = index;
+		uint32_t begin = current.offset;
+		panicking = false;
 		auto decl = parseDecl();
 		if (decl == nullptr) {
-			return std::nullopt;
+			if (!recovering()) {
+				return false;
+			}
+			// never empty, as with statements
+			skipDeclaration();
+			decl = make<ast::ErrorDeclAST>(start, begin,
+						       consumedEnd);
 		}
-		decls.push_back(std::move(decl));
+		builder.append(decls, std::move(decl));
+	}
+	return true;
+}
+
+template <typename Builder>
+auto BasicParser<Builder>::parseDeclList()
+    -> std::optional<List<ast::DeclAST>> {
+	auto decls = makeList<ast::DeclAST>();
+	if (!parseDeclsInto(decls)) {
+		return std::nullopt;
 	}
 	return decls;
 }
 
-std::unique_ptr<ast::ProgramAST> Parser::parseProgram() {
-	auto decls = parseDeclList();
-	if (!decls) {
-		return nullptr;
+template <typename Builder>
+auto BasicParser<Builder>::parseDeclRange(size_t end)
+    -> std::optional<List<ast::DeclAST>> {
+	auto decls = makeList<ast::DeclAST>();
+	if (!parseDeclsInto(decls, end)) {
+		return std::nullopt;
+	}
+	// a '}' closing nothing is skipped on its own
+	while (recovering() && index < end &&
+	       current.type == TokenType::RBRACE) {
+		size_t start = index;
+		uint32_t begin = current.offset;
+		panicking = false;
+		unexpected(DiagID::EXPECTED_DECLARATION);
+		advance();
+		builder.append(decls, make<ast::ErrorDeclAST>(start, begin,
+							     consumedEnd));
+		parseDeclsInto(decls, end);
+	}
+	if (index < end && current.type != TokenType::T_EOF) {
+		unexpected(DiagID::EXPECTED_DECLARATION);
+		return std::nullopt;
 	}
-	if (current.type != TokenType::T_EOF) {
-		errors.error("Expected declaration but got: " + current.lexeme,
-			     current.line, current.column);
+	return decls;
+}
+
+template <typename Builder>
+auto BasicParser<Builder>::parseProgram() -> Node<ast::ProgramAST> {
+	size_t first = index;
+	// a lexer-fed parser stays at index 0, so this runs to T_EOF
+	auto decls = parseDeclRange(SIZE_MAX);
+	if (!decls) {
 		return nullptr;
 	}
-	return std::make_unique<ast::ProgramAST>(std::move(*decls));
+	return make<ast::ProgramAST>(first, std::move(*decls));
 }
 
+template class BasicParser<TreeBuilder>;
+template class BasicParser<FlatBuilder>;
+template class BasicParser<NullBuilder>;
+template class BasicParser<GreenBuilder>;
+
 } // namespace frontend
@@ -4,93 +4,211 @@
 #include "ast/decl.hpp"
 #include "ast/expr.hpp"
 #include "ast/stmt.hpp"
+#include "builder.hpp"
 #include "diagnostics/diagnostics.hpp"
 #include "lexer/lexer.hpp"
 #include "lexer/token.hpp"
+#include "lexer/token_buffer.hpp"
+#include "precedence.hpp"
+#include "source/source_manager.hpp"
+#include "support/arena.hpp"
 #include "types/type.hpp"
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <utility>
 
 namespace frontend {
-class Parser {
+/// Whether function bodies are parsed along with their declarations, or
+/// skipped by brace matching and parsed by FunctionAST::getBody() the first
+/// time they are requested.
+enum class BodyParsing : std::uint8_t { EAGER, LAZY };
+
+/// What the parser does after a syntax error. STOP gives up on the file at
+/// the first one. SYNCHRONIZE skips to the next ';', '}' or declaration
+/// keyword, leaves an ErrorStmtAST or ErrorDeclAST for what it skipped and
+/// goes on, so one pass reports an error per broken statement or
+/// declaration and still returns a tree. Either way parsing stops, with
+/// no tree, at the first statement or declaration after the reporter's
+/// error limit is passed.
+enum class ErrorRecovery : std::uint8_t { STOP, SYNCHRONIZE };
+
+// Recursive-descent parser for one file. What it returns is decided at
+// compile time by `Builder` (see builder.hpp): the pointer AST, a FlatAST,
+// a green tree, or with the NullBuilder nothing at all, only diagnostics
+template <typename Builder> class BasicParser {
 public:
-	explicit Parser(Lexer &lex, ErrorReporter &errors);
-
-	std::unique_ptr<ast::ExprAST> parseLiteral();
-	std::optional<ast::QualifiedName> parseQualifiedName();
+	template <typename T> using Node = typename Builder::template Node<T>;
+	template <typename T> using List = typename Builder::template List<T>;
+	using TypeRef = typename Builder::TypeRef;
+	using Params = typename Builder::Params;
+	using Name = typename Builder::Name;
+	using Expr = Node<ast::ExprAST>;
+	using Stmt = Node<ast::StmtAST>;
+	using Block = Node<ast::BlockStmtAST>;
+	using Decl = Node<ast::DeclAST>;
+
+	// A TreeBuilder given an arena allocates every node and child list
+	// from it; the arena, and the builder's TypeContext, must outlive the
+	// trees the parser returns
+	explicit BasicParser(Lexer &lex, ErrorReporter &errors,
+			     Builder builder = {});
+	// Walks a pre-lexed buffer by index instead of pulling from a Lexer.
+	// Lazy bodies are parsed later from `tokens`, reporting to `errors`
+	// and building with `builder`, so all three and what the builder was
+	// given must outlive the tree.
+	// Builders without LAZY_BODIES parse every body eagerly
+	explicit BasicParser(const TokenBuffer &tokens, ErrorReporter &errors,
+			     Builder builder = {},
+			     BodyParsing bodies = BodyParsing::EAGER);
+
+	// Token `n` places after `current`, without consuming; n must be
+	// below MAX_PEEK in both modes, as for Lexer::peek()
+	Token peek(size_t n = 0);
+	// Makes token `index` of the buffer current; buffer mode only
+	void seek(size_t index);
+	// Index of `current` in the buffer; buffer mode only
+	[[nodiscard]] size_t position() const noexcept { return index; }
+	// STOP unless set; lazy bodies are parsed the same way
+	void setRecovery(ErrorRecovery mode) noexcept { recovery = mode; }
+
+	Expr parseLiteral();
+	std::optional<Name> parseQualifiedName();
 	[[nodiscard]] bool unaryOperator() const;
 	[[nodiscard]] bool assignmentOperator() const;
 
-	std::unique_ptr<types::Type> parsePrimitiveType();
-	std::unique_ptr<types::Type> parseType();
-
-	std::vector<std::unique_ptr<ast::ExprAST>> parseArgList();
-	std::vector<std::unique_ptr<ast::ExprAST>>
-	    parseArgListTail(std::unique_ptr<ast::ExprAST>);
-
-	std::unique_ptr<ast::ExprAST> parseUnaryExpr();
-	std::unique_ptr<ast::ExprAST> parseVarExpr();
-	std::unique_ptr<ast::ExprAST> parsePostfixExpr();
-	std::unique_ptr<ast::ExprAST>
-	    parsePostfixExprTail(std::unique_ptr<ast::ExprAST>);
-
-	std::unique_ptr<ast::ExprAST> parsePrimaryExpr();
-
-	std::unique_ptr<ast::ExprAST> parseMultiplicativeExpr();
-	std::unique_ptr<ast::ExprAST> parseAdditiveExpr();
-	std::unique_ptr<ast::ExprAST> parseShiftExpr();
-	std::unique_ptr<ast::ExprAST> parseRelationalExpr();
-	std::unique_ptr<ast::ExprAST> parseEqualityExpr();
-	std::unique_ptr<ast::ExprAST> parseAndExpr();
-	std::unique_ptr<ast::ExprAST> parseXORExpr();
-	std::unique_ptr<ast::ExprAST> parseInclusiveOrExpr();
-	std::unique_ptr<ast::ExprAST> parseLogicalAndExpr();
-	std::unique_ptr<ast::ExprAST> parseLogicalOrExpr();
-
-	std::unique_ptr<ast::ExprAST> parseExpression();
-	std::unique_ptr<ast::ExprAST>
-	    parseExpressionTail(std::unique_ptr<ast::ExprAST>);
-
-	std::unique_ptr<ast::DeclAST> parseVarDecl();
-	std::unique_ptr<ast::StmtAST> parseContinueStmt();
-	std::unique_ptr<ast::StmtAST> parseBreakStmt();
-	std::unique_ptr<ast::StmtAST> parseReturnStmt();
-	std::unique_ptr<ast::StmtAST> parseAssignmentStmt();
-	std::unique_ptr<ast::StmtAST> parseWhileStmt();
-
-	std::unique_ptr<ast::StmtAST> parseForStmt();
-	std::unique_ptr<ast::StmtAST> parseForInit();
-	std::unique_ptr<ast::ExprAST> parseForUpdate();
-
-	std::unique_ptr<ast::StmtAST> parseIfStmt();
-	std::unique_ptr<ast::BlockStmtAST> parseIfStmtTail();
-	std::unique_ptr<ast::BlockStmtAST> parseElseStmt();
-
-	std::unique_ptr<ast::StmtAST> parseStmt();
-	std::unique_ptr<ast::BlockStmtAST> parseStmtList();
-
-	std::vector<std::pair<std::unique_ptr<types::Type>, std::string>>
-	parseParamList();
-	std::unique_ptr<ast::PrototypeAST> parseProto();
-	std::unique_ptr<ast::DeclAST> parseFunc();
-
-	std::unique_ptr<ast::DeclAST> parseStruct();
-	std::unique_ptr<ast::DeclAST> parseNamespace();
-	std::unique_ptr<ast::DeclAST> parseDecl();
-	std::optional<std::vector<std::unique_ptr<ast::DeclAST>>>
-	parseDeclList();
-
-	std::unique_ptr<ast::ProgramAST> parseProgram();
+	TypeRef parsePrimitiveType();
+	TypeRef parseType();
+
+	List<ast::ExprAST> parseArgList();
+	List<ast::ExprAST> parseArgListTail(Expr);
+
+	Expr parseUnaryExpr();
+	Expr parseVarExpr();
+	Expr parsePostfixExpr();
+	Expr parsePostfixExprTail(Expr);
+
+	Expr parsePrimaryExpr();
+
+	// Binary operators binding at least as tightly as `min`, driven by
+	// the precedence table instead of one function per level
+	Expr parseBinaryExpr(Precedence min = Precedence::LOGICAL_OR);
+	Expr parseBinaryExprTail(Expr, Precedence min);
+
+	Expr parseExpression();
+	Expr parseExpressionTail(Expr);
+
+	Decl parseVarDecl();
+	Stmt parseContinueStmt();
+	Stmt parseBreakStmt();
+	Stmt parseReturnStmt();
+	Stmt parseAssignmentStmt();
+	Stmt parseWhileStmt();
+
+	Stmt parseForStmt();
+	Stmt parseForInit();
+	Expr parseForUpdate();
+
+	Stmt parseIfStmt();
+	Block parseIfStmtTail();
+	Block parseElseStmt();
+
+	Stmt parseStmt();
+	Block parseStmtList();
+
+	Params parseParamList();
+	Node<ast::PrototypeAST> parseProto();
+	Decl parseFunc();
+	Decl parseLazyFunc(Node<ast::PrototypeAST> prototype)
+		requires Builder::LAZY_BODIES;
+	// '{' stmt-list '}'
+	Block parseFuncBody();
+
+	Decl parseStruct();
+	Decl parseNamespace();
+	Decl parseDecl();
+	std::optional<List<ast::DeclAST>> parseDeclList();
+	// Declarations from `current` up to token `end` of the buffer, with
+	// the diagnostics parseProgram() gives for that stretch of a file,
+	// recovering from errors the same way
+	std::optional<List<ast::DeclAST>> parseDeclRange(size_t end);
+
+	Node<ast::ProgramAST> parseProgram();
 
 private:
-	Lexer &lexer;
+	Lexer *lexer = nullptr;
+	const TokenBuffer *tokens = nullptr;
+	size_t index = 0; // position of `current` in `tokens`
+	FileID file;
 	Token current;
 	ErrorReporter &errors;
-
+	Builder builder;
+	BodyParsing bodies = BodyParsing::EAGER;
+	ErrorRecovery recovery = ErrorRecovery::STOP;
+	// made by the first body deferred, for all of this parse's
+	std::shared_ptr<const ast::DeferredBodies> deferred;
+	uint32_t consumedEnd = 0; // byte after the last token advanced past
+	// while recovering, set from an error until the next statement or
+	// declaration starts, so one mistake is reported once
+	bool panicking = false;
+
+	// A node parsed from token `first`, or from its first child if that
+	// came earlier, up to `current`
+	template <typename T, typename... Args>
+	Node<T> make(size_t first, Args &&...args) {
+		return builder.template make<T>(TokenSpan{first, index},
+						std::forward<Args>(args)...);
+	}
+	template <typename T, typename... Args>
+	TypeRef makeType(Args &&...args) {
+		return builder.template type<T>(std::forward<Args>(args)...);
+	}
+	template <typename T> [[nodiscard]] List<T> makeList() const {
+		return builder.template list<T>();
+	}
+
+	[[nodiscard]] SourceLocation location() const noexcept {
+		return {file, current.offset};
+	}
 	void advance();
 	bool match(TokenType type);
 	static bool isType(TokenType type);
 	static bool isLiteral(TokenType type);
+	// Reports `id` at the current token, whose text is the message's last
+	// argument, after `arg` if there is one
+	void unexpected(DiagID id, DiagArg arg = {});
+	// Reports EXPECTED_TOKEN unless the current token is a `type`
 	bool expect(TokenType type);
+	// Steps past the token an error was reported at, unless recovery
+	// resumes from it
+	void skipUnexpected();
+	// Consumes the '}' closing a block, or reports what is there instead
+	bool closeBrace();
+
+	// Once `errors` is past its limit nothing more would be kept, so the
+	// parse stops as under STOP instead of recovering
+	[[nodiscard]] bool recovering() const noexcept {
+		return recovery == ErrorRecovery::SYNCHRONIZE &&
+		       !errors.limitReached();
+	}
+	static bool isDeclKeyword(TokenType type);
+	// Skip the rest of a statement or declaration that did not parse
+	void skipStatement();
+	void skipDeclaration();
+	// Appends declarations to `decls` up to a '}', the end of the file
+	// or token `end` of the buffer
+	bool parseDeclsInto(List<ast::DeclAST> &decls, size_t end = SIZE_MAX);
 };
+
+// The pointer-AST parser everything but syntax-only checking uses
+using Parser = BasicParser<TreeBuilder>;
+using FlatParser = BasicParser<FlatBuilder>;
+using SyntaxChecker = BasicParser<NullBuilder>;
+using GreenParser = BasicParser<GreenBuilder>;
+
+extern template class BasicParser<TreeBuilder>;
+extern template class BasicParser<FlatBuilder>;
+extern template class BasicParser<NullBuilder>;
+extern template class BasicParser<GreenBuilder>;
 } // namespace frontend
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ast/expr.hpp"
+#include "lexer/token.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace frontend {
+
+/// Binding strength of binary operators, loosest first. NONE marks tokens
+/// that are not binary operators and ends every operator loop.
+enum class Precedence : std::uint8_t {
+	NONE,
+	LOGICAL_OR,	// ||
+	LOGICAL_AND,	// &&
+	INCLUSIVE_OR,	// |
+	XOR,		// ^
+	AND,		// &
+	EQUALITY,	// == !=
+	RELATIONAL,	// < > <= >=
+	SHIFT,		// << >>
+	ADDITIVE,	// + -
+	MULTIPLICATIVE, // * / %
+};
+
+enum class Associativity : std::uint8_t { LEFT, RIGHT };
+
+struct BinaryOperator {
+	Precedence precedence = Precedence::NONE;
+	Associativity associativity = Associativity::LEFT;
+	ast::BinaryOp op{};
+};
+
+namespace detail {
+
+inline constexpr size_t TOKEN_TYPE_COUNT =
+    static_cast<size_t>(TokenType::INVALID) + 1;
+
+inline constexpr auto BINARY_OPERATORS = [] {
+	std::array<BinaryOperator, TOKEN_TYPE_COUNT> table{};
+	auto set = [&](TokenType type, Precedence precedence,
+		       ast::BinaryOp op) {
+		table[static_cast<size_t>(type)] = {precedence,
+						    Associativity::LEFT, op};
+	};
+	set(TokenType::PIPE_PIPE, Precedence::LOGICAL_OR, ast::BinaryOp::OR);
+	set(TokenType::AMPERSAND_AMPERSAND, Precedence::LOGICAL_AND,
+	    ast::BinaryOp::AND);
+	set(TokenType::PIPE, Precedence::INCLUSIVE_OR, ast::BinaryOp::BIT_OR);
+	set(TokenType::CARET, Precedence::XOR, ast::BinaryOp::BIT_XOR);
+	set(TokenType::AMPERSAND, Precedence::AND, ast::BinaryOp::BIT_AND);
+	set(TokenType::EQUAL_EQUAL, Precedence::EQUALITY, ast::BinaryOp::EQ);
+	set(TokenType::EXCLAMATION_EQUAL, Precedence::EQUALITY,
+	    ast::BinaryOp::NEQ);
+	set(TokenType::LESS, Precedence::RELATIONAL, ast::BinaryOp::LT);
+	set(TokenType::GREATER, Precedence::RELATIONAL, ast::BinaryOp::GT);
+	set(TokenType::LESS_EQUAL, Precedence::RELATIONAL, ast::BinaryOp::LE);
+	set(TokenType::GREATER_EQUAL, Precedence::RELATIONAL,
+	    ast::BinaryOp::GE);
+	set(TokenType::LESS_LESS, Precedence::SHIFT, ast::BinaryOp::SHL);
+	set(TokenType::GREATER_GREATER, Precedence::SHIFT, ast::BinaryOp::SHR);
+	set(TokenType::PLUS, Precedence::ADDITIVE, ast::BinaryOp::ADD);
+	set(TokenType::MINUS, Precedence::ADDITIVE, ast::BinaryOp::SUB);
+	set(TokenType::STAR, Precedence::MULTIPLICATIVE, ast::BinaryOp::MUL);
+	set(TokenType::SLASH, Precedence::MULTIPLICATIVE, ast::BinaryOp::DIV);
+	set(TokenType::PERCENT, Precedence::MULTIPLICATIVE,
+	    ast::BinaryOp::MOD);
+	return table;
+}();
+
+} // namespace detail
+
+/// Precedence, associativity and AST operator of `type` as a binary
+/// operator; precedence is NONE for any other token. One table load.
+constexpr const BinaryOperator &binaryOperator(TokenType type) noexcept {
+	return detail::BINARY_OPERATORS[static_cast<size_t>(type)];
+}
+
+} // namespace frontend
@@ -0,0 +1,70 @@
+#include "syntax_tree.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace frontend {
+
+bool GreenNode::equals(const GreenNode &other) const {
+	if (this == &other) {
+		return true;
+	}
+	if (kind != other.kind || op != other.op || width != other.width ||
+	    length != other.length || fieldCount != other.fieldCount ||
+	    value != other.value ||
+	    typed.size() != other.typed.size() ||
+	    children.size() != other.children.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < typed.size(); i++) {
+		const Typed &a = typed[i];
+		const Typed &b = other.typed[i];
+		if (a.name != b.name || a.type != b.type) {
+			return false;
+		}
+	}
+	for (size_t i = 0; i < children.size(); i++) {
+		const Child &a = children[i];
+		const Child &b = other.children[i];
+		if (a.offset != b.offset || a.byteOffset != b.byteOffset ||
+		    !a.node != !b.node ||
+		    (a.node && !a.node->equals(*b.node))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+SyntaxNode SyntaxNode::root(GreenNode::Ptr green, uint32_t offset) {
+	return SyntaxNode(std::make_shared<const Data>(
+	    Data{nullptr, std::move(green), 0, offset}));
+}
+
+SyntaxNode SyntaxNode::parent() const { return SyntaxNode(data->parent); }
+
+SyntaxNode SyntaxNode::child(size_t i) const {
+	const GreenNode::Child &child = data->green->children[i];
+	if (!child.node) {
+		return {};
+	}
+	return SyntaxNode(std::make_shared<const Data>(
+	    Data{data, child.node, data->first + child.offset,
+		 data->offset + child.byteOffset}));
+}
+
+SyntaxNode SyntaxNode::find(uint32_t offset) const {
+	if (offset < this->offset() || offset >= endOffset()) {
+		return {};
+	}
+	for (size_t i = 0; i < childCount(); i++) {
+		if (SyntaxNode child = this->child(i)) {
+			if (SyntaxNode found = child.find(offset)) {
+				return found;
+			}
+		}
+	}
+	return *this;
+}
+
+} // namespace frontend
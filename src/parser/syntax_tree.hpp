@@ -0,0 +1,143 @@
+#pragma once
+
+#include "ast/ast.hpp"
+#include "ast/flat_ast.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
+#include "types/type.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace frontend {
+
+/// Immutable node of a green tree: what was parsed and how many tokens and
+/// bytes it spans, with its children at offsets from its own first token.
+/// Nothing in it is absolute, so a subtree an edit did not touch is shared
+/// as is by every version of the tree it appears in.
+///
+/// Children follow the FlatAST's order for each kind (CALL: callee then
+/// arguments; FOR: init, condition, update, body; STRUCT: fields then
+/// methods), with a null node for an absent optional child.
+struct GreenNode {
+	using Ptr = std::shared_ptr<const GreenNode>;
+
+	struct Child {
+		uint32_t offset = 0;     // tokens from the parent's first
+		uint32_t byteOffset = 0; // bytes from the parent's start
+		Ptr node;
+	};
+	struct Typed {
+		const types::Type *type = nullptr; // unique, so shared
+		std::string name;
+	};
+
+	ast::NodeKind kind;
+	uint8_t op = 0; // operator, or the value of a CHAR/BOOL_LITERAL
+	uint32_t width = 0;  // tokens
+	uint32_t length = 0; // bytes, from its first token to its last
+	uint32_t fieldCount = 0; // STRUCT: children before the methods
+	// INT/FLOAT/STRING_LITERAL the literal; VARIABLE and FUNCTION the
+	// name; ASSIGNMENT the variable; STRUCT and NAMESPACE the name
+	std::variant<std::monostate, int64_t, double, std::string,
+		     ast::QualifiedName>
+	    value;
+	// VAR_DECL its type and name; FUNCTION the return type, then the
+	// parameters
+	std::vector<Typed> typed;
+	std::vector<Child> children;
+
+	/// Same tree, node for node and offset for offset. Shared subtrees
+	/// compare without being walked.
+	[[nodiscard]] bool equals(const GreenNode &other) const;
+};
+
+/// Red view of a green node: where in the file it is and what contains it.
+/// Made on demand while walking down from a root, and cheap to copy. It
+/// keeps the nodes it was made from alive and shares nothing mutable, so
+/// it can be handed to another thread; the text its offsets point into
+/// is kept by the SyntaxSnapshot it came from.
+class SyntaxNode {
+	struct Data {
+		std::shared_ptr<const Data> parent;
+		GreenNode::Ptr green;
+		size_t first;    // token index
+		uint32_t offset; // byte offset in the file
+	};
+	std::shared_ptr<const Data> data;
+
+	explicit SyntaxNode(std::shared_ptr<const Data> data) noexcept
+	    : data(std::move(data)) {}
+
+public:
+	/// A null node, as child() returns for an absent child.
+	SyntaxNode() noexcept = default;
+	/// The root of `green`, whose first token is token 0 and starts at
+	/// byte `offset`.
+	static SyntaxNode root(GreenNode::Ptr green, uint32_t offset);
+
+	explicit operator bool() const noexcept { return data != nullptr; }
+
+	[[nodiscard]] const GreenNode &green() const noexcept {
+		return *data->green;
+	}
+	[[nodiscard]] const GreenNode::Ptr &greenPtr() const noexcept {
+		return data->green;
+	}
+	[[nodiscard]] ast::NodeKind kind() const noexcept {
+		return data->green->kind;
+	}
+
+	/// Null for the root.
+	[[nodiscard]] SyntaxNode parent() const;
+	[[nodiscard]] size_t childCount() const noexcept {
+		return data->green->children.size();
+	}
+	/// Null if child `i` is an absent optional child.
+	[[nodiscard]] SyntaxNode child(size_t i) const;
+
+	/// Tokens [firstToken(), endToken()) of the file's token stream.
+	[[nodiscard]] size_t firstToken() const noexcept { return data->first; }
+	[[nodiscard]] size_t endToken() const noexcept {
+		return data->first + data->green->width;
+	}
+	/// Bytes [offset(), endOffset()) of the file.
+	[[nodiscard]] uint32_t offset() const noexcept { return data->offset; }
+	[[nodiscard]] uint32_t endOffset() const noexcept {
+		return data->offset + data->green->length;
+	}
+
+	/// The innermost node at or below this one whose tokens cover byte
+	/// `offset`; null if this one does not.
+	[[nodiscard]] SyntaxNode find(uint32_t offset) const;
+};
+
+/// One version of a file's syntax tree, with the text it was parsed from.
+/// Nothing in it changes once made, so any number of threads can read it
+/// while newer versions are parsed. Its nodes, its text and the types its
+/// nodes name are reference counted: the nodes it shares with other
+/// versions go away with the last version holding them, and its text and
+/// types with the last snapshot of them, even though the file's text has
+/// been replaced since.
+struct SyntaxSnapshot {
+	GreenNode::Ptr green;
+	FileID file; // for its name; its current text may be newer
+	std::shared_ptr<const SourceBuffer> source;
+	std::shared_ptr<const types::TypeContext> types;
+	uint32_t offset;  // of its first token
+	uint64_t version; // edits made to the file before it
+
+	[[nodiscard]] SyntaxNode root() const {
+		return SyntaxNode::root(green, offset);
+	}
+	/// The text the offsets of root() and its nodes point into.
+	[[nodiscard]] std::string_view text() const noexcept {
+		return source->text();
+	}
+};
+
+} // namespace frontend
@@ -0,0 +1,37 @@
+#include "line_table.hpp"
+#include "lexer/structural_index.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace frontend {
+
+LineTable::LineTable(std::string_view text) {
+	lineStarts.push_back(0);
+
+	// newline bits come from the lexer's SIMD block classifier; only set
+	// bits are visited, so the cost is per block plus per line
+	StructuralIndex index(text);
+	size_t blocks = (text.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	for (size_t block = 0; block < blocks; block++) {
+		size_t base = block * BLOCK_SIZE;
+		uint64_t newlines = index.block(block).newline;
+		while (newlines != 0) {
+			size_t end = base + std::countr_zero(newlines);
+			lineStarts.push_back(static_cast<uint32_t>(end + 1));
+			newlines &= newlines - 1;
+		}
+	}
+}
+
+LineColumn LineTable::locate(uint32_t offset) const noexcept {
+	auto next = std::upper_bound(lineStarts.begin(), lineStarts.end(),
+				     offset);
+	auto line = std::distance(lineStarts.begin(), next);
+	return {static_cast<size_t>(line), offset - *std::prev(next) + 1};
+}
+
+} // namespace frontend
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace frontend {
+
+/// 1-based line and column of a byte offset.
+struct LineColumn {
+	size_t line;
+	size_t column;
+};
+
+/// Start offset of every line in a source text, so tokens can carry a bare
+/// byte offset and have line/column recovered by binary search only when
+/// a diagnostic needs them.
+class LineTable {
+	std::vector<uint32_t> lineStarts;
+
+public:
+	explicit LineTable(std::string_view text);
+
+	[[nodiscard]] LineColumn locate(uint32_t offset) const noexcept;
+	[[nodiscard]] size_t lineCount() const noexcept {
+		return lineStarts.size();
+	}
+};
+
+} // namespace frontend
@@ -0,0 +1,107 @@
+#include "source_buffer.hpp"
+#include <cerrno>
+#include <cstddef>
+#include <fcntl.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace frontend {
+
+SourceBuffer::SourceBuffer(const char *data, size_t length, Storage storage)
+    : data(data), length(length), storage(storage) {}
+
+SourceBuffer::SourceBuffer(std::string text)
+    : owned(std::move(text)), data(owned.data()), length(owned.size()),
+      storage(Storage::OWNED) {}
+
+std::optional<SourceBuffer> SourceBuffer::mapFile(const std::string &path) {
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return std::nullopt;
+	}
+
+	struct stat info {};
+	bool statted = ::fstat(fd, &info) == 0;
+	if (!statted || !S_ISREG(info.st_mode)) {
+		// a directory or device opens fine but cannot be mapped
+		int err = errno;
+		if (statted) {
+			err = S_ISDIR(info.st_mode) ? EISDIR : ENODEV;
+		}
+		::close(fd);
+		errno = err;
+		return std::nullopt;
+	}
+
+	// mmap rejects zero-length mappings
+	auto size = static_cast<size_t>(info.st_size);
+	if (size == 0) {
+		::close(fd);
+		return SourceBuffer(std::string());
+	}
+
+	void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	int err = errno;
+	::close(fd);
+	if (mapping == MAP_FAILED) {
+		errno = err;
+		return std::nullopt;
+	}
+	::madvise(mapping, size, MADV_SEQUENTIAL);
+
+	return SourceBuffer(static_cast<const char *>(mapping), size,
+			    Storage::MAPPED);
+}
+
+SourceBuffer SourceBuffer::borrow(std::string_view text) noexcept {
+	return {text.data(), text.size(), Storage::BORROWED};
+}
+
+void SourceBuffer::release() noexcept {
+	if (storage == Storage::MAPPED) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+		::munmap(const_cast<char *>(data), length);
+	}
+	owned.clear();
+	data = nullptr;
+	length = 0;
+	storage = Storage::BORROWED;
+}
+
+SourceBuffer::~SourceBuffer() { release(); }
+
+SourceBuffer::SourceBuffer(SourceBuffer &&other) noexcept
+    : owned(std::move(other.owned)), data(other.data), length(other.length),
+      storage(other.storage) {
+	// a moved std::string may relocate its characters (SSO)
+	if (storage == Storage::OWNED) {
+		data = owned.data();
+	}
+	other.data = nullptr;
+	other.length = 0;
+	other.storage = Storage::BORROWED;
+}
+
+SourceBuffer &SourceBuffer::operator=(SourceBuffer &&other) noexcept {
+	if (this != &other) {
+		release();
+		owned = std::move(other.owned);
+		data = other.data;
+		length = other.length;
+		storage = other.storage;
+		if (storage == Storage::OWNED) {
+			data = owned.data();
+		}
+		other.data = nullptr;
+		other.length = 0;
+		other.storage = Storage::BORROWED;
+	}
+	return *this;
+}
+
+} // namespace frontend
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace frontend {
+
+/// Read-only bytes of one source file. Files are mmap'd so token lexemes
+/// can point straight into the mapping instead of into a copy; text built
+/// in memory is owned, and `borrow` wraps caller storage without copying.
+class SourceBuffer {
+	enum class Storage : unsigned char { OWNED, MAPPED, BORROWED };
+
+	std::string owned;
+	const char *data = nullptr;
+	size_t length = 0;
+	Storage storage = Storage::BORROWED;
+
+	SourceBuffer(const char *data, size_t length, Storage storage);
+	void release() noexcept;
+
+public:
+	SourceBuffer() = default;
+	explicit SourceBuffer(std::string text);
+
+	/// Maps `path` read-only; nullopt, with errno set, if it cannot be
+	/// opened or mapped.
+	static std::optional<SourceBuffer> mapFile(const std::string &path);
+
+	/// Wraps `text` without copying; `text` must outlive the buffer and
+	/// every token lexed from it.
+	static SourceBuffer borrow(std::string_view text) noexcept;
+
+	~SourceBuffer();
+	SourceBuffer(SourceBuffer &&other) noexcept;
+	SourceBuffer &operator=(SourceBuffer &&other) noexcept;
+	SourceBuffer(const SourceBuffer &) = delete;
+	SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+	[[nodiscard]] std::string_view text() const noexcept {
+		return {data, length};
+	}
+	[[nodiscard]] size_t size() const noexcept { return length; }
+	[[nodiscard]] bool isMapped() const noexcept {
+		return storage == Storage::MAPPED;
+	}
+};
+
+} // namespace frontend
@@ -0,0 +1,165 @@
+#include "source_manager.hpp"
+#include "line_table.hpp"
+#include "source_buffer.hpp"
+#include "support/fatal.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace frontend {
+
+SourceManager::~SourceManager() {
+	for (auto &segment : segments) {
+		delete[] segment.load(std::memory_order_relaxed);
+	}
+}
+
+const SourceManager::Entry &
+SourceManager::entry(FileID file) const noexcept {
+	assert(file.isValid());
+	size_t index = file.id - 1;
+	const Entry *segment =
+	    segments[index / SEGMENT_SIZE].load(std::memory_order_acquire);
+	assert(segment != nullptr);
+	const Entry &found = segment[index % SEGMENT_SIZE];
+	if (found.generation.load(std::memory_order_relaxed) !=
+	    file.generation) {
+		fatal("use of a released source file");
+	}
+	return found;
+}
+
+std::optional<FileID> SourceManager::addFile(const std::string &path) {
+	auto buffer = SourceBuffer::mapFile(path);
+	if (!buffer) {
+		return std::nullopt;
+	}
+	if (buffer->size() > MAX_FILE_SIZE) {
+		errno = EFBIG;
+		return std::nullopt;
+	}
+	return addBuffer(path, std::move(*buffer));
+}
+
+FileID SourceManager::addBuffer(std::string name, SourceBuffer buffer) {
+	return add(std::move(name), std::move(buffer), false);
+}
+
+FileID SourceManager::addStream(std::string name) {
+	return add(std::move(name), SourceBuffer(), true);
+}
+
+FileID SourceManager::add(std::string name, SourceBuffer buffer,
+			  bool streamed) {
+	// locations hold 32-bit offsets
+	if (buffer.size() > MAX_FILE_SIZE) {
+		fatal("source text larger than 4 GiB");
+	}
+
+	std::lock_guard<std::mutex> lock(addMutex);
+	size_t index = fileCount;
+	if (!released.empty()) {
+		index = released.back();
+		released.pop_back();
+	}
+	else if (index >= MAX_FILES) {
+		fatal("too many source files");
+	}
+	else {
+		fileCount++;
+	}
+
+	auto &slot = segments[index / SEGMENT_SIZE];
+	Entry *segment = slot.load(std::memory_order_relaxed);
+	if (segment == nullptr) {
+		segment = new Entry[SEGMENT_SIZE];
+		slot.store(segment, std::memory_order_release);
+	}
+
+	Entry &added = segment[index % SEGMENT_SIZE];
+	added.name = std::move(name);
+	added.text.store(std::make_shared<const Text>(std::move(buffer)));
+	added.streamed = streamed;
+	return FileID{static_cast<uint32_t>(index + 1),
+		      added.generation.load(std::memory_order_relaxed)};
+}
+
+void SourceManager::pin(SourceLocation loc, LineColumn where) {
+	const Entry &file = entry(loc.file);
+	assert(file.streamed);
+	std::lock_guard<std::mutex> lock(file.pinMutex);
+	auto after = std::upper_bound(
+	    file.pins.begin(), file.pins.end(), loc.offset,
+	    [](uint32_t offset, const auto &pin) {
+		    return offset < pin.first;
+	    });
+	file.pins.emplace(after, loc.offset, where);
+}
+
+void SourceManager::replace(FileID file, SourceBuffer buffer) {
+	if (buffer.size() > MAX_FILE_SIZE) {
+		fatal("source text larger than 4 GiB");
+	}
+	const Entry &edited = entry(file);
+	assert(!edited.streamed);
+	// the previous version goes with its last reader
+	edited.text.store(std::make_shared<const Text>(std::move(buffer)));
+}
+
+std::shared_ptr<const SourceBuffer> SourceManager::source(FileID file) const {
+	std::shared_ptr<const Text> text = entry(file).text.load();
+	// shares the version's ownership, line table included
+	return {text, &text->buffer};
+}
+
+void SourceManager::release(FileID file) {
+	// nobody may read it any more, so it can be written in place
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+	auto &freed = const_cast<Entry &>(entry(file));
+	std::lock_guard<std::mutex> lock(addMutex);
+	freed.name.clear();
+	freed.text.store(nullptr);
+	freed.streamed = false;
+	freed.pins.clear();
+	// FileIDs still held for it no longer match the entry
+	freed.generation.store(file.generation + 1, std::memory_order_relaxed);
+	released.push_back(file.id - 1);
+}
+
+LineColumn SourceManager::locate(SourceLocation loc) const {
+	const Entry &file = entry(loc.file);
+	if (file.streamed) {
+		std::lock_guard<std::mutex> lock(file.pinMutex);
+		auto pinned = std::lower_bound(
+		    file.pins.begin(), file.pins.end(), loc.offset,
+		    [](const auto &pin, uint32_t offset) {
+			    return pin.first < offset;
+		    });
+		if (pinned != file.pins.end() && pinned->first == loc.offset) {
+			return pinned->second;
+		}
+		return {1, size_t{loc.offset} + 1};
+	}
+	std::shared_ptr<const Text> held = file.text.load();
+	const Text &text = *held;
+	std::call_once(text.linesOnce,
+		       [&text] { text.lines.emplace(text.buffer.text()); });
+	return text.lines->locate(loc.offset);
+}
+
+FileOwner::FileOwner(SourceManager &sources, FileID file)
+    : owned(new FileID(file), [&sources](const FileID *last) {
+	      sources.release(*last);
+	      delete last;
+      }) {}
+
+} // namespace frontend
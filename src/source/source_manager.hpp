@@ -0,0 +1,159 @@
+#pragma once
+
+#include "line_table.hpp"
+#include "source_buffer.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace frontend {
+
+/// Handle for a file registered with a SourceManager. Zero is never handed
+/// out, so a default FileID means "no file". An id given back by release()
+/// is handed out again under the next generation, so a FileID kept past
+/// its file's release never names the file that reuses the id.
+struct FileID {
+	uint32_t id = 0;
+	uint32_t generation = 0;
+
+	[[nodiscard]] bool isValid() const noexcept { return id != 0; }
+	bool operator==(const FileID &) const = default;
+};
+
+/// Compact location: which file, and a byte offset into it.
+struct SourceLocation {
+	FileID file;
+	uint32_t offset = 0;
+};
+
+/// Owns the buffers of every file in a compilation and maps FileIDs back
+/// to names, text and line/column.
+///
+/// Files are added under a mutex and never move, so lookups by FileID
+/// take no lock and any number of lexers and parsers may read
+/// concurrently while other files are still being added. Entries live in
+/// fixed-size segments published through atomic pointers; an id is only
+/// valid in a thread that learned it from addFile/addBuffer through some
+/// synchronizing handoff, which also orders the entry's construction.
+/// A file that is released gives its id back to be handed out again, and
+/// looking up a FileID of the released file is a fatal error.
+///
+/// A file's text can be replaced, as an editor does on every keystroke.
+/// Each version is reference counted: the entry holds the current one,
+/// and readers that took a version with source() keep it alive after it
+/// is replaced, so the last of them frees it.
+class SourceManager {
+	// One version of a file's text
+	struct Text {
+		SourceBuffer buffer;
+		// line table is built by whichever reader first needs it
+		mutable std::once_flag linesOnce;
+		mutable std::optional<LineTable> lines;
+
+		explicit Text(SourceBuffer buffer)
+		    : buffer(std::move(buffer)) {}
+	};
+	struct Entry {
+		std::string name;
+		// swapped whole by replace() while other threads read it;
+		// libstdc++ guards it with a lock bit TSan cannot see, hence
+		// tests/tsan.supp
+		mutable std::atomic<std::shared_ptr<const Text>> text;
+		// streamed files keep no text, only the positions of the
+		// offsets their diagnostics point at, sorted by offset
+		bool streamed = false;
+		mutable std::mutex pinMutex;
+		mutable std::vector<std::pair<uint32_t, LineColumn>> pins;
+		// bumped by release(); written under addMutex, read by lookups
+		std::atomic<uint32_t> generation = 0;
+	};
+
+	static constexpr size_t SEGMENT_SIZE = 256;
+	static constexpr size_t MAX_SEGMENTS = 1024;
+
+	std::array<std::atomic<Entry *>, MAX_SEGMENTS> segments{};
+	std::mutex addMutex;
+	uint32_t fileCount = 0;		// guarded by addMutex
+	std::vector<uint32_t> released; // guarded by addMutex
+
+	[[nodiscard]] const Entry &entry(FileID file) const noexcept;
+	FileID add(std::string name, SourceBuffer buffer, bool streamed);
+
+public:
+	/// Largest file a 32-bit SourceLocation offset can point into.
+	static constexpr size_t MAX_FILE_SIZE =
+	    std::numeric_limits<uint32_t>::max();
+	/// How many files can be registered at once.
+	static constexpr size_t MAX_FILES = SEGMENT_SIZE * MAX_SEGMENTS;
+
+	SourceManager() = default;
+	~SourceManager();
+	SourceManager(const SourceManager &) = delete;
+	SourceManager &operator=(const SourceManager &) = delete;
+	SourceManager(SourceManager &&) = delete;
+	SourceManager &operator=(SourceManager &&) = delete;
+
+	/// Maps `path` and registers it; nullopt, with errno set, if it cannot
+	/// be read or is larger than MAX_FILE_SIZE.
+	std::optional<FileID> addFile(const std::string &path);
+	/// Registers text that is already in memory under `name`. Text past
+	/// MAX_FILE_SIZE, or a file beyond MAX_FILES, is a fatal error.
+	FileID addBuffer(std::string name, SourceBuffer buffer);
+	/// Registers a file that is read once as a stream and never held in
+	/// memory; its text() is empty and locate() answers only for offsets
+	/// given to pin().
+	FileID addStream(std::string name);
+	/// Records where `loc` falls in a streamed file, while its reader
+	/// still knows.
+	void pin(SourceLocation loc, LineColumn where);
+	/// Frees the text of `file` and lets a later add reuse its id. No
+	/// thread may look `file` up afterwards, nor render a diagnostic
+	/// that points into it; doing so stops with a fatal error instead of
+	/// reading whichever file has the id by then.
+	void release(FileID file);
+	/// Makes `buffer` the text of `file`, keeping its id and name, as
+	/// after an edit. Diagnostics are located and rendered in the current
+	/// text, so those of the previous one must be rendered first.
+	void replace(FileID file, SourceBuffer buffer);
+
+	[[nodiscard]] std::string_view name(FileID file) const noexcept {
+		return entry(file).name;
+	}
+	/// The current text of `file`; the view lasts until the file is
+	/// replaced or released, unless a source() of it is still held.
+	[[nodiscard]] std::string_view text(FileID file) const noexcept {
+		return entry(file).text.load()->buffer.text();
+	}
+	/// The current text of `file`, kept alive for as long as the result
+	/// is held, whatever happens to the file.
+	[[nodiscard]] std::shared_ptr<const SourceBuffer>
+	source(FileID file) const;
+
+	/// Line and column of `loc`; the file's line table is built on the
+	/// first call for that file. An offset of a streamed file that was
+	/// never pinned maps to line 1 at its byte offset.
+	[[nodiscard]] LineColumn locate(SourceLocation loc) const;
+};
+
+/// Shared ownership of a registered file: it is released when the last
+/// copy goes away. The SourceManager must outlive every copy.
+class FileOwner {
+	std::shared_ptr<const FileID> owned;
+
+public:
+	FileOwner() noexcept = default;
+	FileOwner(SourceManager &sources, FileID file);
+
+	explicit operator bool() const noexcept { return owned != nullptr; }
+};
+
+} // namespace frontend
@@ -0,0 +1,109 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+
+namespace frontend {
+
+namespace {
+constexpr size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+size_t alignUp(size_t value, size_t alignment) noexcept {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+} // namespace
+
+Arena::Arena(ArenaOptions options)
+    : options(options), nextChunkSize(firstChunkSize()) {}
+
+Arena::~Arena() { release(); }
+
+size_t Arena::firstChunkSize() const noexcept {
+	if (options.hugePages) {
+		return alignUp(std::max(options.chunkSize, HUGE_PAGE),
+			       HUGE_PAGE);
+	}
+	return options.chunkSize;
+}
+
+void *Arena::do_allocate(size_t bytes, size_t alignment) {
+	auto address = reinterpret_cast<uintptr_t>(cursor);
+	auto aligned = alignUp(address, alignment);
+	if (cursor == nullptr ||
+	    aligned + bytes > reinterpret_cast<uintptr_t>(limit)) {
+		return grow(bytes, alignment);
+	}
+	cursor = reinterpret_cast<char *>(aligned + bytes);
+	used += bytes;
+	return reinterpret_cast<void *>(aligned);
+}
+
+// Starts a new chunk with room for `bytes` at `alignment`
+void *Arena::grow(size_t bytes, size_t alignment) {
+	size_t header = alignUp(sizeof(Chunk), alignof(std::max_align_t));
+	size_t needed = header + bytes + alignment;
+	size_t size = std::max(nextChunkSize, needed);
+	if (options.hugePages) {
+		size = alignUp(size, HUGE_PAGE);
+	}
+	nextChunkSize = std::min(nextChunkSize * 2, MAX_CHUNK);
+
+	Chunk *chunk = newChunk(size);
+	chunk->next = chunks;
+	chunks = chunk;
+	cursor = reinterpret_cast<char *>(chunk) + header;
+	limit = reinterpret_cast<char *>(chunk) + size;
+	return do_allocate(bytes, alignment);
+}
+
+Arena::Chunk *Arena::newChunk(size_t size) {
+	void *memory = nullptr;
+	bool mapped = false;
+	if (options.hugePages) {
+		memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory != MAP_FAILED) {
+			// only advice: without THP the chunk simply keeps
+			// normal pages
+			::madvise(memory, size, MADV_HUGEPAGE);
+			mapped = true;
+		}
+	}
+	if (!mapped) {
+		memory = ::operator new(size);
+	}
+
+	auto *chunk = static_cast<Chunk *>(memory);
+	chunk->size = size;
+	chunk->mapped = mapped;
+	return chunk;
+}
+
+void Arena::release() noexcept {
+	for (Finalizer *entry = finalizers; entry != nullptr;) {
+		// the entry lives in a chunk, which stays until the loop ends
+		Finalizer *next = entry->next;
+		entry->run(entry->object);
+		entry = next;
+	}
+	finalizers = nullptr;
+
+	while (chunks != nullptr) {
+		Chunk *next = chunks->next;
+		if (chunks->mapped) {
+			::munmap(chunks, chunks->size);
+		}
+		else {
+			::operator delete(chunks);
+		}
+		chunks = next;
+	}
+	cursor = nullptr;
+	limit = nullptr;
+	used = 0;
+	nextChunkSize = firstChunkSize();
+}
+
+} // namespace frontend
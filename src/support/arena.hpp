@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace frontend {
+
+struct ArenaOptions {
+	/// Bytes in the first chunk; later chunks double up to MAX_CHUNK.
+	size_t chunkSize = 64 * 1024;
+	/// Map chunks with mmap and advise the kernel to back them with
+	/// transparent huge pages, which cuts TLB misses when walking a large
+	/// tree. Chunks are then at least 2 MiB.
+	bool hugePages = false;
+};
+
+/// Bump allocator for data that lives and dies together, such as the AST
+/// of one compilation.
+///
+/// Allocation is a pointer increment within the current chunk and freeing
+/// a single object does nothing; release() hands every chunk back at once.
+/// Objects that still own memory elsewhere can register a finalizer, and
+/// release() runs those in one flat loop, newest first, before freeing
+/// the chunks. As a std::pmr::memory_resource the arena also backs
+/// containers, so the child arrays of arena nodes come from it too.
+///
+/// Not thread-safe: use one arena per thread.
+class Arena : public std::pmr::memory_resource {
+	struct Chunk {
+		Chunk *next;
+		size_t size; // including this header
+		bool mapped;
+	};
+	struct Finalizer {
+		void (*run)(void *object);
+		void *object;
+		Finalizer *next;
+	};
+
+	ArenaOptions options;
+	Chunk *chunks = nullptr;
+	char *cursor = nullptr;
+	char *limit = nullptr;
+	size_t nextChunkSize;
+	size_t used = 0;
+	Finalizer *finalizers = nullptr;
+
+	[[nodiscard]] size_t firstChunkSize() const noexcept;
+	void *grow(size_t bytes, size_t alignment);
+	Chunk *newChunk(size_t size);
+
+protected:
+	void *do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void *, size_t, size_t) override {}
+	[[nodiscard]] bool
+	do_is_equal(const std::pmr::memory_resource &other) const noexcept
+	    override {
+		return this == &other;
+	}
+
+public:
+	/// Largest chunk the arena grows to on its own; bigger requests get
+	/// a chunk of their own size.
+	static constexpr size_t MAX_CHUNK = 16 * 1024 * 1024;
+
+	explicit Arena(ArenaOptions options = {});
+	~Arena() override;
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+	Arena(Arena &&) = delete;
+	Arena &operator=(Arena &&) = delete;
+
+	/// Constructs a T in the arena. Its destructor runs on release() if
+	/// it has one that does anything.
+	template <typename T, typename... Args> T *create(Args &&...args) {
+		void *storage = allocate(sizeof(T), alignof(T));
+		T *object = ::new (storage) T(std::forward<Args>(args)...);
+		if constexpr (!std::is_trivially_destructible_v<T>) {
+			finalize(object);
+		}
+		return object;
+	}
+
+	/// Runs `object`'s destructor on release(); for objects placed in the
+	/// arena that own memory outside of it.
+	template <typename T> void finalize(T *object) {
+		auto *entry = static_cast<Finalizer *>(
+		    allocate(sizeof(Finalizer), alignof(Finalizer)));
+		entry->run = [](void *p) { static_cast<T *>(p)->~T(); };
+		entry->object = object;
+		entry->next = finalizers;
+		finalizers = entry;
+	}
+
+	/// Runs the finalizers and frees every chunk; the arena can be
+	/// reused afterwards.
+	void release() noexcept;
+
+	/// Bytes handed out since construction or the last release().
+	[[nodiscard]] size_t bytesUsed() const noexcept { return used; }
+	[[nodiscard]] bool usesHugePages() const noexcept {
+		return options.hugePages;
+	}
+};
+
+} // namespace frontend
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cassert>
+#include <concepts>
+#include <type_traits>
+
+namespace frontend {
+
+/// Checked casts for the AST and type hierarchies, after LLVM's. Both tag
+/// every object with its kind, so these are a compare of that byte and
+/// never need RTTI. A class that is one kind says which in a static
+/// `KIND`; one that covers several, like ExprAST, has a static `classof`
+/// taking its root's pointer.
+
+namespace detail {
+template <typename From, typename To>
+using CastResult = std::conditional_t<std::is_const_v<From>, const To, To>;
+} // namespace detail
+
+/// Whether `value`, which must not be null, is a To.
+template <typename To, typename From>
+	requires std::derived_from<To, From> || std::derived_from<From, To>
+[[nodiscard]] bool isa(const From *value) {
+	assert(value != nullptr);
+	if constexpr (std::derived_from<From, To>) {
+		return true;
+	}
+	else if constexpr (requires { To::KIND; }) {
+		return value->getKind() == To::KIND;
+	}
+	else {
+		return To::classof(value);
+	}
+}
+
+/// `value` as a To, which it must be.
+template <typename To, typename From>
+[[nodiscard]] detail::CastResult<From, To> *cast(From *value) {
+	assert(isa<To>(value));
+	return static_cast<detail::CastResult<From, To> *>(value);
+}
+
+/// `value` as a To, or null when it is something else. `value` must not be
+/// null.
+template <typename To, typename From>
+[[nodiscard]] detail::CastResult<From, To> *dyn_cast(From *value) {
+	using Result = detail::CastResult<From, To>;
+	return isa<To>(value) ? static_cast<Result *>(value) : nullptr;
+}
+
+} // namespace frontend
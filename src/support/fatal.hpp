@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace frontend {
+
+/// Stops on a limit no caller can recover from; unlike assert() it is
+/// still checked in release builds.
+[[noreturn]] inline void fatal(const char *what) noexcept {
+	std::fprintf(stderr, "adequatec: fatal: %s\n", what);
+	std::abort();
+}
+
+} // namespace frontend
@@ -0,0 +1,80 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace frontend {
+
+ThreadPool::ThreadPool(size_t threads) {
+	if (threads == 0) {
+		threads = std::max(1U, std::thread::hardware_concurrency());
+	}
+	workers.reserve(threads - 1);
+	for (size_t i = 1; i < threads; i++) {
+		workers.emplace_back([this] { workerLoop(); });
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	// jthreads join on destruction
+}
+
+// Runs indices of the current batch until none are left
+void ThreadPool::drain() {
+	for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+		(*job)(i);
+	}
+}
+
+void ThreadPool::workerLoop() {
+	uint64_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] {
+				return stopping || generation != seen;
+			});
+			if (stopping) {
+				return;
+			}
+			seen = generation;
+		}
+
+		drain();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--busy == 0) {
+			finished.notify_one();
+		}
+	}
+}
+
+void ThreadPool::forEach(size_t count,
+			 const std::function<void(size_t)> &fn) {
+	std::lock_guard<std::mutex> batch(batchMutex);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &fn;
+		this->count = count;
+		next = 0;
+		busy = workers.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	drain();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [&] { return busy == 0; });
+	job = nullptr;
+}
+
+} // namespace frontend
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace frontend {
+
+/// Fixed set of worker threads that run one indexed batch at a time.
+class ThreadPool {
+	std::vector<std::jthread> workers;
+
+	std::mutex batchMutex; // one forEach() at a time
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+
+	// current batch, guarded by `mutex` apart from `next`
+	const std::function<void(size_t)> *job = nullptr;
+	size_t count = 0;
+	std::atomic<size_t> next = 0;
+	size_t busy = 0;
+	uint64_t generation = 0;
+	bool stopping = false;
+
+	void workerLoop();
+	void drain();
+
+public:
+	/// `threads` includes the caller, which works on its own batches;
+	/// zero means one per hardware thread.
+	explicit ThreadPool(size_t threads = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+	ThreadPool(ThreadPool &&) = delete;
+	ThreadPool &operator=(ThreadPool &&) = delete;
+
+	[[nodiscard]] size_t size() const noexcept {
+		return workers.size() + 1;
+	}
+
+	/// Calls `fn(i)` for every i in [0, count) across the pool and
+	/// returns once all calls have finished.
+	void forEach(size_t count, const std::function<void(size_t)> &fn);
+};
+
+} // namespace frontend
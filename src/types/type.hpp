@@ -1,182 +1,206 @@
 #pragma once
-#include <memory>
+#include "support/casting.hpp"
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include <utility>
 
 namespace frontend::types {
 
+class TypeContext;
+
+/// What a type is, kept in every type so classifying one is a byte compare
+/// (see support/casting.hpp). The primitives come first.
+enum class TypeKind : std::uint8_t {
+	INT,
+	FLOAT,
+	DOUBLE,
+	BOOL,
+	CHAR,
+	STRING,
+	VOID,
+	ARRAY,
+	STRUCT,
+	CONST,
+	STATIC,
+};
+
+/// A type. Types are unique: TypeContext makes the only instance of each,
+/// so two types are the same exactly when their pointers are. They are
+/// immutable and live as long as their context, and trees only point at
+/// them.
 class Type {
+	TypeKind kind;
+
 public:
 	virtual ~Type() = default;
+	Type(const Type &) = delete;
+	Type &operator=(const Type &) = delete;
 
 	[[nodiscard]] virtual std::string toString() const = 0;
-	[[nodiscard]] virtual bool equals(const Type *other) const = 0;
+	// A pointer compare, as types are unique
+	[[nodiscard]] bool equals(const Type *other) const noexcept {
+		return this == other;
+	}
+
+	[[nodiscard]] TypeKind getKind() const noexcept { return kind; }
 
 	// Type predicates
-	[[nodiscard]] virtual bool isPrimitive() const { return false; }
-	[[nodiscard]] virtual bool isArray() const { return false; }
-	[[nodiscard]] virtual bool isStruct() const { return false; }
+	[[nodiscard]] bool isPrimitive() const noexcept {
+		return kind <= TypeKind::VOID;
+	}
+	[[nodiscard]] bool isArray() const noexcept {
+		return kind == TypeKind::ARRAY;
+	}
+	[[nodiscard]] bool isStruct() const noexcept {
+		return kind == TypeKind::STRUCT;
+	}
 	[[nodiscard]] virtual bool isNullable() const { return false; }
 	[[nodiscard]] virtual bool isFunction() const { return false; }
 
 protected:
-	Type() = default;
+	constexpr explicit Type(TypeKind kind) : kind(kind) {}
 };
 
 // Primitive types
 class IntType : public Type {
+	friend class TypeContext;
+	constexpr IntType() : Type(KIND) {}
+
 public:
-	[[nodiscard]] std::string toString() const override { return "int"; }
-	[[nodiscard]] bool equals(const Type *other) const override {
-		return dynamic_cast<const IntType *>(other) != nullptr;
-	}
+	static constexpr TypeKind KIND = TypeKind::INT;
 
-	[[nodiscard]] bool isPrimitive() const override { return true; }
+	[[nodiscard]] std::string toString() const override { return "int"; }
 };
 
 class FloatType : public Type {
+	friend class TypeContext;
+	constexpr FloatType() : Type(KIND) {}
+
 public:
-	[[nodiscard]] std::string toString() const override { return "float"; }
-	[[nodiscard]] bool equals(const Type *other) const override {
-		return dynamic_cast<const FloatType *>(other) != nullptr;
-	}
+	static constexpr TypeKind KIND = TypeKind::FLOAT;
 
-	[[nodiscard]] bool isPrimitive() const override { return true; }
+	[[nodiscard]] std::string toString() const override { return "float"; }
 };
 
 class DoubleType : public Type {
+	friend class TypeContext;
+	constexpr DoubleType() : Type(KIND) {}
+
 public:
-	[[nodiscard]] std::string toString() const override { return "double"; }
-	[[nodiscard]] bool equals(const Type *other) const override {
-		return dynamic_cast<const DoubleType *>(other) != nullptr;
-	}
+	static constexpr TypeKind KIND = TypeKind::DOUBLE;
 
-	[[nodiscard]] bool isPrimitive() const override { return true; }
+	[[nodiscard]] std::string toString() const override { return "double"; }
 };
 
 class BoolType : public Type {
+	friend class TypeContext;
+	constexpr BoolType() : Type(KIND) {}
+
 public:
-	[[nodiscard]] std::string toString() const override { return "bool"; }
-	[[nodiscard]] bool equals(const Type *other) const override {
-		return dynamic_cast<const BoolType *>(other) != nullptr;
-	}
+	static constexpr TypeKind KIND = TypeKind::BOOL;
 
-	[[nodiscard]] bool isPrimitive() const override { return true; }
+	[[nodiscard]] std::string toString() const override { return "bool"; }
 };
 
 class CharType : public Type {
+	friend class TypeContext;
+	constexpr CharType() : Type(KIND) {}
+
 public:
-	[[nodiscard]] std::string toString() const override { return "char"; }
-	[[nodiscard]] bool equals(const Type *other) const override {
-		return dynamic_cast<const CharType *>(other) != nullptr;
-	}
+	static constexpr TypeKind KIND = TypeKind::CHAR;
 
-	[[nodiscard]] bool isPrimitive() const override { return true; }
+	[[nodiscard]] std::string toString() const override { return "char"; }
 };
 
 class StringType : public Type {
+	friend class TypeContext;
+	constexpr StringType() : Type(KIND) {}
+
 public:
-	[[nodiscard]] std::string toString() const override { return "string"; }
-	[[nodiscard]] bool equals(const Type *other) const override {
-		return dynamic_cast<const StringType *>(other) != nullptr;
-	}
+	static constexpr TypeKind KIND = TypeKind::STRING;
 
-	[[nodiscard]] bool isPrimitive() const override { return true; }
+	[[nodiscard]] std::string toString() const override { return "string"; }
 };
 
 class VoidType : public Type {
+	friend class TypeContext;
+	constexpr VoidType() : Type(KIND) {}
+
 public:
-	[[nodiscard]] std::string toString() const override { return "void"; }
-	[[nodiscard]] bool equals(const Type *other) const override {
-		return dynamic_cast<const VoidType *>(other) != nullptr;
-	}
+	static constexpr TypeKind KIND = TypeKind::VOID;
 
-	[[nodiscard]] bool isPrimitive() const override { return true; }
+	[[nodiscard]] std::string toString() const override { return "void"; }
 };
 
 class ArrayType : public Type {
-	std::unique_ptr<Type> elementType;
+	friend class TypeContext;
+	const Type *elementType;
 	size_t size;
 
+	ArrayType(const Type *elem, size_t sz)
+	    : Type(KIND), elementType(elem), size(sz) {}
+
 public:
-	ArrayType(std::unique_ptr<Type> elem, size_t sz)
-	    : elementType(std::move(elem)), size(sz) {}
+	static constexpr TypeKind KIND = TypeKind::ARRAY;
 
 	[[nodiscard]] std::string toString() const override {
 		return elementType->toString() + "[" + std::to_string(size) +
 		       "]";
 	}
 
-	[[nodiscard]] Type *getElementType() const { return elementType.get(); }
-	[[nodiscard]] size_t getSize() const { return size; }
-	bool equals(const Type *other) const override {
-		auto arr = dynamic_cast<const ArrayType *>(other);
-		if (!arr) {
-			return false;
-		}
-		return size == arr->size &&
-		       elementType->equals(arr->elementType.get());
+	[[nodiscard]] const Type *getElementType() const {
+		return elementType;
 	}
-	[[nodiscard]] bool isPrimitive() const override { return false; }
+	[[nodiscard]] size_t getSize() const { return size; }
 };
 
 class StructType : public Type {
+	friend class TypeContext;
 	std::string name;
 
+	explicit StructType(std::string n) : Type(KIND), name(std::move(n)) {}
+
 public:
-	StructType(std::string n) : name(std::move(n)) {}
+	static constexpr TypeKind KIND = TypeKind::STRUCT;
 
 	[[nodiscard]] std::string toString() const override {
 		return "struct " + name;
 	}
 
-	bool equals(const Type *other) const override {
-		auto s = dynamic_cast<const StructType *>(other);
-		return s && s->name == name;
-	}
 	[[nodiscard]] std::string_view getName() const { return name; }
-	[[nodiscard]] bool isPrimitive() const override { return false; }
-	[[nodiscard]] bool isStruct() const override { return true; }
 };
 
 class ConstType : public Type {
-	std::unique_ptr<Type> innerType;
+	friend class TypeContext;
+	const Type *innerType;
+
+	explicit ConstType(const Type *inner) : Type(KIND), innerType(inner) {}
 
 public:
-	ConstType(std::unique_ptr<Type> inner) : innerType(std::move(inner)) {}
+	static constexpr TypeKind KIND = TypeKind::CONST;
 
-	[[nodiscard]] Type *getInnerType() const { return innerType.get(); }
+	[[nodiscard]] const Type *getInnerType() const { return innerType; }
 
 	[[nodiscard]] std::string toString() const override {
 		return "const " + innerType->toString();
 	}
-
-	bool equals(const Type *other) const override {
-		if (auto *constType = dynamic_cast<const ConstType *>(other)) {
-			return innerType->equals(constType->innerType.get());
-		}
-		return false;
-	}
 };
 
 class StaticType : public Type {
-	std::unique_ptr<Type> innerType;
+	friend class TypeContext;
+	const Type *innerType;
+
+	explicit StaticType(const Type *inner) : Type(KIND), innerType(inner) {}
 
 public:
-	StaticType(std::unique_ptr<Type> inner) : innerType(std::move(inner)) {}
+	static constexpr TypeKind KIND = TypeKind::STATIC;
 
-	[[nodiscard]] Type *getInnerType() const { return innerType.get(); }
+	[[nodiscard]] const Type *getInnerType() const { return innerType; }
 
 	[[nodiscard]] std::string toString() const override {
 		return "static " + innerType->toString();
 	}
-
-	bool equals(const Type *other) const override {
-		if (auto *staticType =
-			dynamic_cast<const StaticType *>(other)) {
-			return innerType->equals(staticType->innerType.get());
-		}
-		return false;
-	}
 };
 } // namespace frontend::types
@@ -0,0 +1,88 @@
+#include "type_context.hpp"
+#include "type.hpp"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace frontend::types {
+
+size_t TypeContext::KeyHash::operator()(const Key &key) const noexcept {
+	size_t hash = std::hash<const Type *>{}(key.inner);
+	hash ^= std::hash<size_t>{}(key.size) + 0x9e3779b97f4a7c15 +
+		(hash << 6) + (hash >> 2);
+	return hash ^ static_cast<size_t>(key.kind);
+}
+
+TypeContext::~TypeContext() = default;
+
+const Type *TypeContext::composite(Key key) {
+	{
+		std::shared_lock lock(mutex);
+		if (auto it = composites.find(key); it != composites.end()) {
+			return it->second.get();
+		}
+	}
+	std::unique_lock lock(mutex);
+	// another thread may have made it between the two locks
+	auto [it, added] = composites.try_emplace(key);
+	if (added) {
+		switch (key.kind) {
+		case TypeKind::ARRAY:
+			it->second.reset(new ArrayType(key.inner, key.size));
+			break;
+		case TypeKind::CONST:
+			it->second.reset(new ConstType(key.inner));
+			break;
+		case TypeKind::STATIC:
+			it->second.reset(new StaticType(key.inner));
+			break;
+		default:
+			std::unreachable();
+		}
+	}
+	return it->second.get();
+}
+
+const ArrayType *TypeContext::getArray(const Type *element, size_t size) {
+	return static_cast<const ArrayType *>(
+	    composite({TypeKind::ARRAY, element, size}));
+}
+
+const ConstType *TypeContext::getConst(const Type *inner) {
+	return static_cast<const ConstType *>(
+	    composite({TypeKind::CONST, inner, 0}));
+}
+
+const StaticType *TypeContext::getStatic(const Type *inner) {
+	return static_cast<const StaticType *>(
+	    composite({TypeKind::STATIC, inner, 0}));
+}
+
+const StructType *TypeContext::getStruct(std::string_view name) {
+	{
+		std::shared_lock lock(mutex);
+		if (auto it = structs.find(name); it != structs.end()) {
+			return it->second.get();
+		}
+	}
+	std::unique_lock lock(mutex);
+	if (auto it = structs.find(name); it != structs.end()) {
+		return it->second.get();
+	}
+	std::unique_ptr<StructType> type(new StructType(std::string(name)));
+	const StructType *made = type.get();
+	structs.emplace(made->getName(), std::move(type));
+	return made;
+}
+
+size_t TypeContext::size() const {
+	std::shared_lock lock(mutex);
+	return composites.size() + structs.size();
+}
+
+} // namespace frontend::types
@@ -0,0 +1,106 @@
+#pragma once
+#include "type.hpp"
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace frontend::types {
+
+/// Makes and owns types, one instance of each. Primitives are singletons
+/// shared by every context; arrays, structs and qualified types are
+/// hash-consed, looked up by what they are made of before one is made, so
+/// asking twice for `const int` gives the same pointer. Their parts are
+/// unique already, so the lookup hashes pointers, never whole types.
+///
+/// There is one per compilation, owned by its caller and handed to the
+/// parser's builder like the arena: it must outlive the trees whose types
+/// it made, and types from two contexts only compare by pointer if they
+/// are primitives.
+///
+/// Safe to use from any number of threads: a lookup that finds its type
+/// takes a shared lock, only making a new one takes it exclusively.
+class TypeContext {
+	template <typename T> static const T primitive;
+
+	// an ARRAY, CONST or STATIC type, by its parts
+	struct Key {
+		TypeKind kind;
+		const Type *inner;
+		size_t size;
+
+		bool operator==(const Key &) const = default;
+	};
+	struct KeyHash {
+		size_t operator()(const Key &key) const noexcept;
+	};
+
+	mutable std::shared_mutex mutex;
+	std::unordered_map<Key, std::unique_ptr<Type>, KeyHash> composites;
+	// keyed by the name each StructType holds
+	std::unordered_map<std::string_view, std::unique_ptr<StructType>>
+	    structs;
+
+	const Type *composite(Key key);
+
+public:
+	TypeContext() = default;
+	TypeContext(const TypeContext &) = delete;
+	TypeContext &operator=(const TypeContext &) = delete;
+	~TypeContext();
+
+	static const IntType *getInt() noexcept { return &primitive<IntType>; }
+	static const FloatType *getFloat() noexcept {
+		return &primitive<FloatType>;
+	}
+	static const DoubleType *getDouble() noexcept {
+		return &primitive<DoubleType>;
+	}
+	static const BoolType *getBool() noexcept {
+		return &primitive<BoolType>;
+	}
+	static const CharType *getChar() noexcept {
+		return &primitive<CharType>;
+	}
+	static const StringType *getString() noexcept {
+		return &primitive<StringType>;
+	}
+	static const VoidType *getVoid() noexcept {
+		return &primitive<VoidType>;
+	}
+
+	const ArrayType *getArray(const Type *element, size_t size);
+	const StructType *getStruct(std::string_view name);
+	const ConstType *getConst(const Type *inner);
+	const StaticType *getStatic(const Type *inner);
+
+	/// The T made from `args`, which are what T's constructor takes.
+	template <typename T, typename... Args> const T *get(Args &&...args) {
+		if constexpr (std::is_same_v<T, ArrayType>) {
+			return getArray(std::forward<Args>(args)...);
+		}
+		else if constexpr (std::is_same_v<T, StructType>) {
+			return getStruct(std::forward<Args>(args)...);
+		}
+		else if constexpr (std::is_same_v<T, ConstType>) {
+			return getConst(std::forward<Args>(args)...);
+		}
+		else if constexpr (std::is_same_v<T, StaticType>) {
+			return getStatic(std::forward<Args>(args)...);
+		}
+		else {
+			static_assert(sizeof...(Args) == 0);
+			return &primitive<T>;
+		}
+	}
+
+	/// Composite types made so far.
+	[[nodiscard]] size_t size() const;
+};
+
+template <typename T> constinit const T TypeContext::primitive{};
+
+} // namespace frontend::types
@@ -3,13 +3,19 @@
 // and the diagnostics produced along the way.
 #include "../test_helpers.hpp"
 #include "ast/ast.hpp"
+#include "ast/decl.hpp"
 #include "ast/expr.hpp"
 #include "diagnostics/diagnostics.hpp"
+#include "driver/driver.hpp"
 #include "lexer/lexer.hpp"
+#include "lexer/token_buffer.hpp"
 #include "parser/parser.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
 #include "gtest/gtest.h"
 #include <algorithm>
 #include <memory>
+#include <sstream>
 #include <string>
 
 using namespace frontend;
@@ -17,9 +23,10 @@ using namespace frontend::ast;
 
 namespace {
 std::unique_ptr<ExprAST> parsePipeline(const std::string &src,
-				       ErrorReporter &errors) {
+				       ErrorReporter &errors,
+				       types::TypeContext &types) {
 	Lexer lexer(src, errors);
-	Parser parser(lexer, errors);
+	Parser parser(lexer, errors, types);
 	return parser.parseExpression();
 }
 } // namespace
@@ -27,7 +34,8 @@ std::unique_ptr<ExprAST> parsePipeline(const std::string &src,
 // result + compute(x, y) * 2  =>  result + (compute(x, y) * 2)
 TEST(LexerParserIntegration, CallInsideArithmetic) {
 	ErrorReporter errors;
-	auto expr = parsePipeline("result + compute(x, y) * 2;", errors);
+	types::TypeContext types;
+	auto expr = parsePipeline("result + compute(x, y) * 2;", errors, types);
 
 	auto *add = expectNode<BinaryExprAST>(expr.get());
 	ASSERT_NE(add, nullptr);
@@ -58,7 +66,8 @@ TEST(LexerParserIntegration, CallInsideArithmetic) {
 // (a + b) * (c - d)
 TEST(LexerParserIntegration, ParenthesizedGroups) {
 	ErrorReporter errors;
-	auto expr = parsePipeline("(a + b) * (c - d);", errors);
+	types::TypeContext types;
+	auto expr = parsePipeline("(a + b) * (c - d);", errors, types);
 
 	auto *mul = expectNode<BinaryExprAST>(expr.get());
 	ASSERT_NE(mul, nullptr);
@@ -78,8 +87,9 @@ TEST(LexerParserIntegration, ParenthesizedGroups) {
 // Comments and newlines between tokens must be invisible to the parser
 TEST(LexerParserIntegration, CommentsAndWhitespaceAreSkipped) {
 	ErrorReporter errors;
-	auto expr =
-	    parsePipeline("1 /* mid */ + // to end of line\n\t 2;", errors);
+	types::TypeContext types;
+	auto expr = parsePipeline("1 /* mid */ + // to end of line\n\t 2;",
+				  errors, types);
 
 	auto *add = expectNode<BinaryExprAST>(expr.get());
 	ASSERT_NE(add, nullptr);
@@ -90,7 +100,8 @@ TEST(LexerParserIntegration, CommentsAndWhitespaceAreSkipped) {
 // Redundant parentheses collapse to the inner expression
 TEST(LexerParserIntegration, DeeplyNestedParens) {
 	ErrorReporter errors;
-	auto expr = parsePipeline("((((42))));", errors);
+	types::TypeContext types;
+	auto expr = parsePipeline("((((42))));", errors, types);
 
 	auto *literal = expectNode<NumberLiteralAST>(expr.get());
 	ASSERT_NE(literal, nullptr);
@@ -101,7 +112,8 @@ TEST(LexerParserIntegration, DeeplyNestedParens) {
 // a < b == c < d  =>  (a < b) == (c < d)
 TEST(LexerParserIntegration, RelationalBindsTighterThanEquality) {
 	ErrorReporter errors;
-	auto expr = parsePipeline("a < b == c < d;", errors);
+	types::TypeContext types;
+	auto expr = parsePipeline("a < b == c < d;", errors, types);
 
 	auto *eq = expectNode<BinaryExprAST>(expr.get());
 	ASSERT_NE(eq, nullptr);
@@ -121,7 +133,8 @@ TEST(LexerParserIntegration, RelationalBindsTighterThanEquality) {
 // -a * !b  =>  (-a) * (!b)
 TEST(LexerParserIntegration, UnaryInsideBinary) {
 	ErrorReporter errors;
-	auto expr = parsePipeline("-a * !b;", errors);
+	types::TypeContext types;
+	auto expr = parsePipeline("-a * !b;", errors, types);
 
 	auto *mul = expectNode<BinaryExprAST>(expr.get());
 	ASSERT_NE(mul, nullptr);
@@ -143,7 +156,8 @@ TEST(LexerParserIntegration, UnaryInsideBinary) {
 // in the same ErrorReporter.
 TEST(LexerParserIntegration, ErrorsFromBothPhasesAccumulate) {
 	ErrorReporter errors;
-	auto expr = parsePipeline("1 + $;", errors);
+	types::TypeContext types;
+	auto expr = parsePipeline("1 + $;", errors, types);
 
 	EXPECT_EQ(expr, nullptr);
 	ASSERT_TRUE(errors.hasErrors());
@@ -151,18 +165,19 @@ TEST(LexerParserIntegration, ErrorsFromBothPhasesAccumulate) {
 
 	const auto &all = errors.getErrors();
 	EXPECT_TRUE(std::ranges::any_of(all, [](const CompilerError &err) {
-		return err.phase == ErrorPhase::LEXER;
+		return err.phase() == ErrorPhase::LEXER;
 	}));
 	EXPECT_TRUE(std::ranges::any_of(all, [](const CompilerError &err) {
-		return err.phase == ErrorPhase::PARSER;
+		return err.phase() == ErrorPhase::PARSER;
 	}));
 }
 
 // Literals of every kind survive the whole pipeline inside one call
 TEST(LexerParserIntegration, MixedLiteralArguments) {
 	ErrorReporter errors;
-	auto expr =
-	    parsePipeline("log(42, 3.14, 'c', \"msg\", true, false);", errors);
+	types::TypeContext types;
+	auto expr = parsePipeline("log(42, 3.14, 'c', \"msg\", true, false);",
+				  errors, types);
 
 	auto *call = expectNode<CallExprAST>(expr.get());
 	ASSERT_NE(call, nullptr);
@@ -177,3 +192,87 @@ TEST(LexerParserIntegration, MixedLiteralArguments) {
 	EXPECT_NE(expectNode<BoolLiteralAST>(args[5].get()), nullptr);
 	EXPECT_FALSE(errors.hasErrors());
 }
+
+// Batch mode: lex everything up front, then parse by index
+TEST(LexerParserIntegration, ParseFromTokenBuffer) {
+	ErrorReporter errors;
+	types::TypeContext types;
+	Lexer lexer("namespace geo { struct Point { var int x; } }"
+		    "func geo::len(int a) -> int { return a * 2; }",
+		    errors);
+	TokenBuffer tokens = lexer.lexAll();
+	Parser parser(tokens, errors, types);
+	auto program = parser.parseProgram();
+
+	ASSERT_NE(program, nullptr);
+	ASSERT_EQ(program->getDeclarations().size(), 2);
+	EXPECT_NE(expectNode<NamespaceAST>(program->getDeclarations()[0].get()),
+		  nullptr);
+	auto *func =
+	    expectNode<FunctionAST>(program->getDeclarations()[1].get());
+	ASSERT_NE(func, nullptr);
+	EXPECT_EQ(func->getProto()->getQualifiedName().str(), "geo::len");
+	EXPECT_FALSE(errors.hasErrors());
+}
+
+// Lookahead sees the same tokens whether the parser pulls from a lexer or
+// walks a pre-lexed buffer
+TEST(LexerParserIntegration, PeekPastCurrent) {
+	const std::string src = "var int x = a + 1;";
+	ErrorReporter errors;
+	types::TypeContext types;
+	Lexer streaming(src, errors);
+	Parser fromLexer(streaming, errors, types);
+	Lexer batch(src, errors);
+	TokenBuffer tokens = batch.lexAll();
+	Parser fromBuffer(tokens, errors, types);
+
+	for (Parser *parser : {&fromLexer, &fromBuffer}) {
+		EXPECT_EQ(parser->peek().type, TokenType::INT);
+		EXPECT_EQ(parser->peek(1).lexeme, "x");
+		EXPECT_EQ(parser->peek(5).type, TokenType::INT_LIT);
+		EXPECT_EQ(parser->peek(7).type, TokenType::T_EOF);
+
+		auto decl = parser->parseVarDecl();
+		ASSERT_NE(decl, nullptr);
+		EXPECT_EQ(parser->peek().type, TokenType::T_EOF);
+	}
+	EXPECT_FALSE(errors.hasErrors());
+}
+
+// A file large enough to be lexed and parsed by every job together still
+// reports, under an error limit, the first errors a single job reports:
+// the lexer's are not allowed to crowd out the parser's
+TEST(LexerParserIntegration, ParallelFileKeepsSerialErrorsUnderLimit) {
+	std::string text;
+	for (size_t i = 0; text.size() <= PARALLEL_FILE_SIZE; i++) {
+		std::string name = "f" + std::to_string(i);
+		if (i % 700 == 3) {
+			text += "func " + name + "( -> int { return 1; }\n";
+		}
+		else if (i % 900 == 5) {
+			text += "func " + name + "() -> int { return $; }\n";
+		}
+		else {
+			text += "func " + name +
+				"(int a) -> int { var int b = a * 2; "
+				"return b + 1; }\n";
+		}
+	}
+
+	auto run = [&](size_t jobs) {
+		SourceManager sources;
+		FileID file =
+		    sources.addBuffer("big.ac", SourceBuffer(std::string(text)));
+		ErrorReporter errors(sources);
+		errors.setErrorLimit(5);
+		compileFiles({&file, 1}, errors, {.jobs = jobs});
+		std::ostringstream out;
+		errors.printAll(out);
+		return out.str();
+	};
+	std::string serial = run(1);
+	EXPECT_NE(serial.find("Expected"), std::string::npos);
+	EXPECT_NE(serial.find("unexpected character"), std::string::npos);
+	EXPECT_EQ(run(4), serial);
+}
@@ -23,8 +23,9 @@ void testFile(const std::string &filename) {
 	std::cout << "Source:\n" << source << "\n\n";
 
 	ErrorReporter error;
+	types::TypeContext types;
 	Lexer lexer(source, error);
-	Parser parser(lexer, error);
+	Parser parser(lexer, error, types);
 
 	auto varDecl = parser.parseVarDecl();
 
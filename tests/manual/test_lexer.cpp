@@ -1,9 +1,9 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include "lexer/lexer.hpp"
 #include "lexer/token.hpp"
 #include "diagnostics/diagnostics.hpp"
+#include "source/line_table.hpp"
+#include "source/source_buffer.hpp"
 
 using namespace frontend;
 
@@ -86,7 +86,8 @@ const char* tokenTypeToString(TokenType type) {
 	case TokenType::RPAREN: return "RPAREN";
 	case TokenType::LBRACKET: return "LBRACKET";
 	case TokenType::RBRACKET: return "RBRACKET";
-	case TokenType::NUMBER_LIT: return "NUMBER_LIT";
+	case TokenType::INT_LIT: return "INT_LIT";
+	case TokenType::FLOAT_LIT: return "FLOAT_LIT";
 	case TokenType::STRING_LIT: return "STRING_LIT";
 	case TokenType::CHAR_LIT: return "CHAR_LIT";
 	case TokenType::IDENT: return "IDENT";
@@ -99,30 +100,28 @@ const char* tokenTypeToString(TokenType type) {
 void testFile(const std::string& filename) {
 	std::cout << "\n=== Testing: " << filename << " ===\n";
 
-	// Read file
-	std::ifstream file(filename);
-	if (!file.is_open()) {
+	// Map file
+	auto source = SourceBuffer::mapFile(filename);
+	if (!source) {
 		std::cerr << "ERROR: Could not open file: " << filename << "\n";
 		return;
 	}
 
-	std::stringstream buffer;
-	buffer << file.rdbuf();
-	std::string source = buffer.str();
-
-	std::cout << "Source:\n" << source << "\n\n";
+	std::cout << "Source:\n" << source->text() << "\n\n";
 	std::cout << "Tokens:\n";
 
 	ErrorReporter error;
 
 	// Tokenize
-	Lexer lexer(source, error);
+	Lexer lexer(*source, error);
+	LineTable lines(source->text());
 	Token token = lexer.get();
 
 	while (token.type != TokenType::T_EOF) {
+		LineColumn where = lines.locate(token.offset);
 		std::cout << tokenTypeToString(token.type)
 		          << "\t'" << token.lexeme << "'"
-		          << "\t[" << token.line << ":" << token.column << "]\n";
+		          << "\t[" << where.line << ":" << where.column << "]\n";
 		token = lexer.get();
 	}
 
@@ -1,18 +1,88 @@
 #pragma once
 
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/token.hpp"
+#include "lexer/token_buffer.hpp"
+#include "source/line_table.hpp"
+#include "support/casting.hpp"
 #include "gtest/gtest.h"
 #include <concepts>
-#include <typeinfo>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 // Checked downcast for tests: asserts the node is of type T and returns it.
 // The derived_from constraint rejects casts across unrelated hierarchies
-// at compile time, where a raw dynamic_cast would compile and silently yield
-// nullptr at runtime.
+// at compile time, where a cast that compiled would only fail at runtime.
+// A const node gives a const result.
 template <typename T, typename U>
-	requires std::derived_from<T, U>
-T *expectNode(U *node) {
-	auto *typed = dynamic_cast<T *>(node);
+	requires std::derived_from<T, std::remove_const_t<U>>
+auto *expectNode(U *node) {
+	using Result = frontend::detail::CastResult<U, T>;
+	if (node == nullptr) {
+		ADD_FAILURE() << "expected a node but got null";
+		return static_cast<Result *>(nullptr);
+	}
+	Result *typed = frontend::dyn_cast<T>(node);
 	EXPECT_NE(typed, nullptr)
-	    << "expected node of type " << typeid(T).name();
+	    << "got a node of kind " << static_cast<int>(node->getKind());
 	return typed;
 }
+
+// Each kept diagnostic as "offset: message", enough to compare the
+// diagnostics of two runs; with `phase`, only those of that phase
+inline std::vector<std::string>
+messages(const frontend::ErrorReporter &errors,
+	 std::optional<frontend::ErrorPhase> phase = std::nullopt) {
+	std::vector<std::string> result;
+	for (const frontend::CompilerError &err : errors.getErrors()) {
+		if (!phase || err.phase() == *phase) {
+			result.push_back(std::to_string(err.location.offset) +
+					 ": " + errors.message(err));
+		}
+	}
+	return result;
+}
+
+// Two lexes of the same text must agree token for token, down to the
+// values of literals, and be of the same file
+inline void expectSameTokens(const frontend::TokenBuffer &got,
+			     const frontend::TokenBuffer &want) {
+	using frontend::TokenType;
+	ASSERT_EQ(got.size(), want.size());
+	for (size_t i = 0; i < want.size(); i++) {
+		SCOPED_TRACE("token #" + std::to_string(i));
+		ASSERT_EQ(got.type(i), want.type(i));
+		ASSERT_EQ(got.offset(i), want.offset(i));
+		ASSERT_EQ(got.lexeme(i), want.lexeme(i));
+		if (want.type(i) == TokenType::INT_LIT) {
+			ASSERT_EQ(got.at(i).intValue, want.at(i).intValue);
+		}
+		if (want.type(i) == TokenType::FLOAT_LIT) {
+			ASSERT_EQ(got.at(i).floatValue, want.at(i).floatValue);
+		}
+	}
+	EXPECT_EQ(got.fileID(), want.fileID());
+}
+
+// Two runs over the same text must report the same diagnostics in the
+// same order, each at the same offset, line and column
+inline void expectSameDiagnostics(const frontend::ErrorReporter &got,
+				  const frontend::ErrorReporter &want) {
+	const auto &gotErrors = got.getErrors();
+	const auto &wantErrors = want.getErrors();
+	ASSERT_EQ(gotErrors.size(), wantErrors.size());
+	for (size_t i = 0; i < wantErrors.size(); i++) {
+		SCOPED_TRACE("diagnostic #" + std::to_string(i));
+		EXPECT_EQ(got.message(gotErrors[i]),
+			  want.message(wantErrors[i]));
+		EXPECT_EQ(gotErrors[i].location.offset,
+			  wantErrors[i].location.offset);
+		frontend::LineColumn gotWhere = got.locate(gotErrors[i]);
+		frontend::LineColumn wantWhere = want.locate(wantErrors[i]);
+		EXPECT_EQ(gotWhere.line, wantWhere.line);
+		EXPECT_EQ(gotWhere.column, wantWhere.column);
+	}
+}
@@ -0,0 +1,162 @@
+#include "../test_helpers.hpp"
+#include "ast/ast.hpp"
+#include "ast/decl.hpp"
+#include "ast/expr.hpp"
+#include "ast/stmt.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "parser/parser.hpp"
+#include "support/arena.hpp"
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace frontend;
+using namespace frontend::ast;
+
+namespace {
+// Records its destruction so tests can see when finalizers run
+struct Tracked {
+	std::vector<int> *log;
+	int id;
+	Tracked(std::vector<int> *log, int id) : log(log), id(id) {}
+	Tracked(const Tracked &) = delete;
+	Tracked &operator=(const Tracked &) = delete;
+	~Tracked() { log->push_back(id); }
+};
+
+const char *const PROGRAM =
+    "namespace config { struct Limit { var int max; } }\n"
+    "func add(int a, int b) -> int {\n"
+    "\tvar int sum = a + b * 2;\n"
+    "\tif (sum > 10) { return 10; }\n"
+    "\telse if (sum < 0) { return 0; }\n"
+    "\treturn add(sum, -1);\n"
+    "}\n"
+    "struct Point { var int x; var int y; }\n";
+} // namespace
+
+TEST(arenaTest, AllocationsAreAlignedAndChunksGrow) {
+	Arena arena({.chunkSize = 256});
+	for (size_t alignment : {1, 2, 4, 8, 16, 32, 64}) {
+		void *p = arena.allocate(3, alignment);
+		EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignment, 0)
+		    << alignment;
+	}
+	// consecutive small allocations are adjacent within a chunk
+	auto *a = static_cast<char *>(arena.allocate(8, 8));
+	auto *b = static_cast<char *>(arena.allocate(8, 8));
+	EXPECT_EQ(b, a + 8);
+
+	// requests larger than any chunk still succeed
+	auto *big = static_cast<char *>(arena.allocate(10000, 16));
+	big[0] = big[9999] = 'x';
+	for (int i = 0; i < 1000; i++) {
+		EXPECT_NE(arena.allocate(64, 8), nullptr);
+	}
+	EXPECT_GE(arena.bytesUsed(), 10000 + 1000 * 64);
+
+	arena.release();
+	EXPECT_EQ(arena.bytesUsed(), 0);
+	EXPECT_NE(arena.allocate(8, 8), nullptr);
+}
+
+TEST(arenaTest, ReleaseRunsFinalizersNewestFirst) {
+	std::vector<int> log;
+	{
+		Arena arena;
+		arena.create<Tracked>(&log, 1);
+		arena.create<Tracked>(&log, 2);
+		// trivially destructible objects do not register anything
+		arena.create<int>(3);
+		arena.release();
+		EXPECT_EQ(log, (std::vector<int>{2, 1}));
+
+		arena.create<Tracked>(&log, 4);
+	}
+	// the destructor releases whatever is left
+	EXPECT_EQ(log, (std::vector<int>{2, 1, 4}));
+}
+
+TEST(arenaTest, HugePageChunks) {
+	Arena arena({.chunkSize = 4096, .hugePages = true});
+	EXPECT_TRUE(arena.usesHugePages());
+	auto *p = static_cast<char *>(arena.allocate(3 * 1024 * 1024, 64));
+	ASSERT_NE(p, nullptr);
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % 64, 0);
+	p[0] = p[3 * 1024 * 1024 - 1] = 'x';
+	EXPECT_NE(arena.allocate(16, 16), nullptr);
+}
+
+TEST(arenaTest, NodesAreReleasedWithTheArena) {
+	Arena arena;
+	auto node = makeNode<VariableExprAST>(&arena, "counter");
+	VariableExprAST *raw = node.get();
+	// the owning pointer lets go without freeing or destroying the node
+	node.reset();
+	EXPECT_EQ(raw->getName(), "counter");
+
+	auto heap = makeNode<VariableExprAST>(nullptr, "counter");
+	EXPECT_EQ(heap->getName(), "counter");
+}
+
+TEST(arenaTest, DeepTreesTearDownWithoutRecursion) {
+	// deep enough that recursive destructors would exhaust the stack
+	constexpr int DEPTH = 1'000'000;
+	Arena arena;
+	std::unique_ptr<ExprAST> expr = makeNode<NumberLiteralAST>(&arena, 1);
+	for (int i = 0; i < DEPTH; i++) {
+		expr = makeNode<UnaryExprAST>(&arena, UnaryOp::MINUS,
+					      std::move(expr));
+	}
+	expr.reset();
+	arena.release();
+	EXPECT_EQ(arena.bytesUsed(), 0);
+}
+
+TEST(arenaTest, ParserBuildsTheSameTree) {
+	types::TypeContext types;
+	ErrorReporter heapErrors;
+	Lexer heapLexer(PROGRAM, heapErrors);
+	Parser heapParser(heapLexer, heapErrors, types);
+	auto heap = heapParser.parseProgram();
+
+	Arena arena;
+	ErrorReporter arenaErrors;
+	Lexer arenaLexer(PROGRAM, arenaErrors);
+	Parser arenaParser(arenaLexer, arenaErrors, {types, &arena});
+	auto inArena = arenaParser.parseProgram();
+
+	ASSERT_NE(heap, nullptr);
+	ASSERT_NE(inArena, nullptr);
+	EXPECT_FALSE(heapErrors.hasErrors());
+	EXPECT_FALSE(arenaErrors.hasErrors());
+	EXPECT_GT(arena.bytesUsed(), 0);
+
+	const auto &want = heap->getDeclarations();
+	const auto &got = inArena->getDeclarations();
+	ASSERT_EQ(got.size(), want.size());
+	EXPECT_EQ(got.get_allocator().resource(), &arena);
+
+	auto *config = expectNode<NamespaceAST>(got[0].get());
+	ASSERT_NE(config, nullptr);
+	EXPECT_EQ(config->getName(), "config");
+	auto *add = expectNode<FunctionAST>(got[1].get());
+	ASSERT_NE(add, nullptr);
+	EXPECT_EQ(add->getProto()->getName(), "add");
+	auto *wantAdd = expectNode<FunctionAST>(want[1].get());
+	ASSERT_NE(wantAdd, nullptr);
+	EXPECT_EQ(add->getBody()->getStmts().size(),
+		  wantAdd->getBody()->getStmts().size());
+	auto *point = expectNode<StructAST>(got[2].get());
+	ASSERT_NE(point, nullptr);
+	EXPECT_EQ(point->getFields().size(), 2);
+
+	// dropping the tree before the arena leaves everything to release()
+	inArena.reset();
+	arena.release();
+}
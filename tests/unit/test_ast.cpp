@@ -4,6 +4,7 @@
 #include "ast/expr.hpp"
 #include "ast/stmt.hpp"
 #include "types/type.hpp"
+#include "types/type_context.hpp"
 #include "gtest/gtest.h"
 #include <algorithm>
 #include <filesystem>
@@ -13,6 +14,9 @@
 
 using namespace frontend::ast;
 using namespace frontend::types;
+using frontend::cast;
+using frontend::dyn_cast;
+using frontend::isa;
 
 TEST(astTest, NumberExpr) {
 	auto expr = std::make_unique<NumberLiteralAST>(42.0);
@@ -74,7 +78,7 @@ TEST(astTest, FunctionCallExpr) {
 	auto twelve = std::make_unique<NumberLiteralAST>(12);
 	auto testStr = std::make_unique<StringLiteralAST>("test");
 	auto bool_lit = std::make_unique<BoolLiteralAST>(true);
-	std::vector<std::unique_ptr<ExprAST>> args;
+	NodeList<ExprAST> args;
 
 	args.push_back(std::move(twelve));
 	args.push_back(std::move(testStr));
@@ -127,7 +131,7 @@ TEST(astTest, ReturnStmt) {
 }
 
 TEST(astTest, BlockStmt) {
-	std::vector<std::unique_ptr<StmtAST>> stmts;
+	NodeList<StmtAST> stmts;
 	stmts.emplace_back(std::make_unique<BreakStmtAST>());
 	stmts.emplace_back(std::make_unique<ContinueStmtAST>());
 
@@ -143,11 +147,11 @@ TEST(astTest, BlockStmt) {
 TEST(astTest, IfStmt) {
 	auto cond = std::make_unique<BoolLiteralAST>(true);
 
-	std::vector<std::unique_ptr<StmtAST>> then_stmts;
+	NodeList<StmtAST> then_stmts;
 	then_stmts.emplace_back(std::make_unique<BreakStmtAST>());
 	auto then_block = std::make_unique<BlockStmtAST>(std::move(then_stmts));
 
-	std::vector<std::unique_ptr<StmtAST>> else_stmts;
+	NodeList<StmtAST> else_stmts;
 	else_stmts.emplace_back(std::make_unique<ContinueStmtAST>());
 	auto else_block = std::make_unique<BlockStmtAST>(std::move(else_stmts));
 
@@ -159,7 +163,7 @@ TEST(astTest, IfStmt) {
 	auto if_no_else = std::make_unique<IfStmtAST>(
 	    std::make_unique<BoolLiteralAST>(false),
 	    std::make_unique<BlockStmtAST>(
-		std::vector<std::unique_ptr<StmtAST>>{}));
+		NodeList<StmtAST>{}));
 	ASSERT_NE(if_no_else, nullptr);
 }
 
@@ -167,7 +171,7 @@ TEST(astTest, IfStmt) {
 TEST(astTest, WhileStmt) {
 	auto cond = std::make_unique<BoolLiteralAST>(true);
 
-	std::vector<std::unique_ptr<StmtAST>> body_stmts;
+	NodeList<StmtAST> body_stmts;
 	body_stmts.emplace_back(std::make_unique<BreakStmtAST>());
 	auto body = std::make_unique<BlockStmtAST>(std::move(body_stmts));
 
@@ -180,7 +184,7 @@ TEST(astTest, WhileStmt) {
 TEST(astTest, ForStmt) {
 	auto init = std::make_unique<DeclStmtAST>(
 	    std::make_unique<VariableDeclarationAST>(
-		std::make_unique<IntType>(), "i",
+		TypeContext::getInt(), "i",
 		std::make_unique<NumberLiteralAST>(0)));
 
 	auto cond = std::make_unique<BinaryExprAST>(
@@ -191,7 +195,7 @@ TEST(astTest, ForStmt) {
 	    UnaryOp::POST_INCREMENT, std::make_unique<VariableExprAST>("i"));
 
 	auto body = std::make_unique<BlockStmtAST>(
-	    std::vector<std::unique_ptr<StmtAST>>{});
+	    NodeList<StmtAST>{});
 
 	auto for_stmt =
 	    std::make_unique<ForStmtAST>(std::move(init), std::move(cond),
@@ -201,9 +205,8 @@ TEST(astTest, ForStmt) {
 
 TEST(astTest, VarDec) {
 	auto expr = std::make_unique<NumberLiteralAST>(42.0);
-	auto integer_type = std::make_unique<frontend::types::IntType>();
 	auto var_dec = std::make_unique<VariableDeclarationAST>(
-	    std::move(integer_type), "x", nullptr, std::move(expr));
+	    TypeContext::getInt(), "x", nullptr, std::move(expr));
 	ASSERT_NE(var_dec, nullptr);
 	ASSERT_NE(var_dec->getType(), nullptr);
 	ASSERT_EQ(var_dec->getName(), "x");
@@ -211,6 +214,37 @@ TEST(astTest, VarDec) {
 	ASSERT_EQ(var_dec->hasInit(), true);
 }
 
+TEST(astTest, KindsClassifyNodes) {
+	auto integer = std::make_unique<NumberLiteralAST>(1);
+	auto real = std::make_unique<NumberLiteralAST>(0.5);
+	EXPECT_EQ(integer->getKind(), NodeKind::INT_LITERAL);
+	EXPECT_EQ(real->getKind(), NodeKind::FLOAT_LITERAL);
+
+	const ASTNode *node = integer.get();
+	EXPECT_TRUE(isa<ExprAST>(node));
+	EXPECT_TRUE(isa<NumberLiteralAST>(node));
+	EXPECT_FALSE(isa<StmtAST>(node));
+	EXPECT_FALSE(isa<DeclAST>(node));
+	EXPECT_EQ(cast<NumberLiteralAST>(node)->getIntValue(), 1);
+	EXPECT_EQ(dyn_cast<BoolLiteralAST>(node), nullptr);
+
+	// a declaration statement is a statement holding a declaration
+	auto stmt = std::make_unique<DeclStmtAST>(
+	    std::make_unique<VariableDeclarationAST>(TypeContext::getInt(),
+						     "x"));
+	EXPECT_TRUE(isa<StmtAST>(stmt.get()));
+	EXPECT_FALSE(isa<DeclAST>(static_cast<ASTNode *>(stmt.get())));
+	EXPECT_TRUE(isa<DeclAST>(stmt->getDecl()));
+	EXPECT_NE(dyn_cast<VariableDeclarationAST>(stmt->getDecl()), nullptr);
+
+	ProgramAST program;
+	EXPECT_TRUE(isa<DeclAST>(static_cast<ASTNode *>(&program)));
+
+	// moving a node keeps what it is
+	BreakStmtAST moved(BreakStmtAST{});
+	EXPECT_EQ(moved.getKind(), NodeKind::BREAK);
+}
+
 TEST(astTest, Comprehensive) {
 	// ========== BUILD ADD FUNCTION ==========
 	auto add_a = std::make_unique<VariableExprAST>("a");
@@ -220,15 +254,14 @@ TEST(astTest, Comprehensive) {
 	auto add_return_stmt =
 	    std::make_unique<ReturnStmtAST>(std::move(a_plus_b));
 
-	std::vector<std::pair<std::unique_ptr<Type>, std::string>> add_params;
-	add_params.push_back({std::make_unique<IntType>(), "a"});
-	add_params.push_back({std::make_unique<IntType>(), "b"});
+	std::vector<std::pair<const Type *, std::string>> add_params;
+	add_params.push_back({TypeContext::getInt(), "a"});
+	add_params.push_back({TypeContext::getInt(), "b"});
 
-	auto add_return_type = std::make_unique<IntType>();
 	auto add_proto = std::make_unique<PrototypeAST>(
-	    "add", std::move(add_params), std::move(add_return_type));
+	    "add", std::move(add_params), TypeContext::getInt());
 
-	std::vector<std::unique_ptr<StmtAST>> add_body;
+	NodeList<StmtAST> add_body;
 	add_body.emplace_back(std::move(add_return_stmt));
 	auto add_func = std::make_unique<FunctionAST>(
 	    std::move(add_proto),
@@ -241,22 +274,21 @@ TEST(astTest, Comprehensive) {
 	    BinaryOp::MUL, std::move(mul_a), std::move(mul_b));
 	auto return_stmt = std::make_unique<ReturnStmtAST>(std::move(a_mul_b));
 
-	std::vector<std::pair<std::unique_ptr<Type>, std::string>> mul_params;
-	mul_params.push_back({std::make_unique<IntType>(), "a"});
-	mul_params.push_back({std::make_unique<IntType>(), "b"});
+	std::vector<std::pair<const Type *, std::string>> mul_params;
+	mul_params.push_back({TypeContext::getInt(), "a"});
+	mul_params.push_back({TypeContext::getInt(), "b"});
 
-	auto mul_return_type = std::make_unique<IntType>();
 	auto mul_proto = std::make_unique<PrototypeAST>(
-	    "multiply", std::move(mul_params), std::move(mul_return_type));
+	    "multiply", std::move(mul_params), TypeContext::getInt());
 
-	std::vector<std::unique_ptr<StmtAST>> mul_body;
+	NodeList<StmtAST> mul_body;
 	mul_body.push_back(std::move(return_stmt));
 	auto multiply_func = std::make_unique<FunctionAST>(
 	    std::move(mul_proto),
 	    std::make_unique<BlockStmtAST>(std::move(mul_body)));
 
 	// ========== BUILD MATH NAMESPACE ==========
-	std::vector<std::unique_ptr<DeclAST>> decls;
+	NodeList<DeclAST> decls;
 	decls.emplace_back(std::move(add_func));
 	decls.emplace_back(std::move(multiply_func));
 	auto math_namespace =
@@ -341,11 +373,11 @@ TEST(astTest, Comprehensive) {
 
 	// ========== BUILD STRUCT ==========
 	auto x = std::make_unique<VariableDeclarationAST>(
-	    std::make_unique<IntType>(), "x");
+	    TypeContext::getInt(), "x");
 	auto y = std::make_unique<VariableDeclarationAST>(
-	    std::make_unique<IntType>(), "y");
+	    TypeContext::getInt(), "y");
 
-	std::vector<std::unique_ptr<VariableDeclarationAST>> fields;
+	NodeList<VariableDeclarationAST> fields;
 	fields.push_back(std::move(x));
 	fields.push_back(std::move(y));
 
@@ -365,7 +397,7 @@ TEST(astTest, Comprehensive) {
 
 	// ========== BUILD MAIN FUNCTION VARIABLES ==========
 	// Call: add(5, 3)
-	std::vector<std::unique_ptr<ExprAST>> args;
+	NodeList<ExprAST> args;
 	args.emplace_back(std::make_unique<NumberLiteralAST>(5));
 	args.emplace_back(std::make_unique<NumberLiteralAST>(3));
 
@@ -374,7 +406,7 @@ TEST(astTest, Comprehensive) {
 						      std::move(args));
 
 	auto sum = std::make_unique<VariableDeclarationAST>(
-	    std::make_unique<IntType>(), "sum", nullptr, std::move(sum_call));
+	    TypeContext::getInt(), "sum", nullptr, std::move(sum_call));
 
 	// ===== TEST SUM VARIABLE =====
 	ASSERT_NE(sum, nullptr);
@@ -402,7 +434,7 @@ TEST(astTest, Comprehensive) {
 	EXPECT_DOUBLE_EQ(sum_arg2->getValue(), 3.0);
 
 	// Call: multiply(4, 7)
-	std::vector<std::unique_ptr<ExprAST>> args2;
+	NodeList<ExprAST> args2;
 	args2.emplace_back(std::make_unique<NumberLiteralAST>(4));
 	args2.emplace_back(std::make_unique<NumberLiteralAST>(7));
 
@@ -412,7 +444,7 @@ TEST(astTest, Comprehensive) {
 	    std::make_unique<CallExprAST>(std::move(mul_var), std::move(args2));
 
 	auto product = std::make_unique<VariableDeclarationAST>(
-	    std::make_unique<IntType>(), "product", nullptr,
+	    TypeContext::getInt(), "product", nullptr,
 	    std::move(mul_call));
 
 	// ===== TEST PRODUCT VARIABLE =====
@@ -440,8 +472,9 @@ TEST(astTest, Comprehensive) {
 	EXPECT_DOUBLE_EQ(prod_arg2->getValue(), 7.0);
 
 	// Struct variable
+	TypeContext types;
 	auto p = std::make_unique<VariableDeclarationAST>(
-	    std::make_unique<StructType>("Point"), "p");
+	    types.getStruct("Point"), "p");
 
 	// ===== TEST STRUCT VARIABLE =====
 	ASSERT_NE(p, nullptr);
@@ -0,0 +1,133 @@
+#include "../test_helpers.hpp"
+#include "ast/ast.hpp"
+#include "ast/flat_ast.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/token_buffer.hpp"
+#include "parser/builder.hpp"
+#include "parser/parser.hpp"
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace ::frontend;
+using namespace ::frontend::ast;
+
+namespace {
+const char *const PROGRAM =
+    "struct Point { var int x; var float y = 1.5;"
+    "  func len() -> int { return x; } }\n"
+    "namespace geo {\n"
+    "  func area(int w, const int h) -> double {\n"
+    "    var int cells[4];\n"
+    "    var string s = \"hi\";\n"
+    "    var bool b = !false;\n"
+    "    for (var int i = 0; i < w; i + 1) {\n"
+    "      if (i == 2) { continue; } else if (b) { break; }\n"
+    "    }\n"
+    "    while (w > 0) { w -= 1; }\n"
+    "    return geo::scale(w * h, 2.5, s);\n"
+    "  }\n"
+    "}\n";
+} // namespace
+
+TEST(builderTest, SyntaxCheckerMatchesParser) {
+	for (const std::string &src :
+	     {std::string(PROGRAM), std::string(""),
+	      std::string("func f( -> int { return 1; }"),
+	      std::string("func f() -> int { return 1 }"),
+	      std::string("struct S { var int x }"),
+	      std::string("namespace n { var int x; }"),
+	      std::string("func f() -> int { if (x) { return 1; } else }"),
+	      std::string("func f() -> int { for (x; ; ) { } }"),
+	      std::string("}")}) {
+		SCOPED_TRACE(src);
+		ErrorReporter treeErrors;
+		types::TypeContext types;
+		Lexer treeLexer(src, treeErrors);
+		Parser parser(treeLexer, treeErrors, types);
+		auto program = parser.parseProgram();
+
+		ErrorReporter checkErrors;
+		Lexer checkLexer(src, checkErrors);
+		SyntaxChecker checker(checkLexer, checkErrors);
+		Recognized recognized = checker.parseProgram();
+
+		EXPECT_EQ(static_cast<bool>(recognized), program != nullptr);
+		EXPECT_EQ(messages(checkErrors), messages(treeErrors));
+	}
+}
+
+TEST(builderTest, SyntaxCheckerParsesLazyBodies) {
+	// the null builder has nothing to defer a body to
+	ErrorReporter errors;
+	TokenBuffer tokens =
+	    Lexer("func f() -> int { return 1 }", errors).lexAll();
+	SyntaxChecker checker(tokens, errors, {}, BodyParsing::LAZY);
+	EXPECT_EQ(checker.parseProgram(), nullptr);
+	EXPECT_TRUE(errors.hasErrors());
+}
+
+// Names reach the builder as views of the source, so the checker copies
+// none of them while the tree builder owns its own
+TEST(builderTest, OnlyTreeBuildersCopyNames) {
+	static_assert(std::is_same_v<SyntaxChecker::Name, Recognized>);
+
+	const std::string src = "geo::shapes::area";
+	ErrorReporter errors;
+	types::TypeContext types;
+	Lexer checkLexer(src, errors);
+	SyntaxChecker checker(checkLexer, errors);
+	EXPECT_TRUE(checker.parseQualifiedName().value());
+
+	Lexer treeLexer(src, errors);
+	Parser parser(treeLexer, errors, types);
+	auto name = parser.parseQualifiedName();
+	ASSERT_TRUE(name);
+	EXPECT_EQ(name->str(), src);
+	EXPECT_FALSE(errors.hasErrors());
+}
+
+TEST(builderTest, FlatParserMatchesFlatten) {
+	ErrorReporter errors;
+	types::TypeContext types;
+	Lexer treeLexer(PROGRAM, errors);
+	Parser parser(treeLexer, errors, types);
+	auto program = parser.parseProgram();
+	ASSERT_NE(program, nullptr);
+	FlatAST expected = flatten(*program);
+
+	FlatAST flat;
+	Lexer flatLexer(PROGRAM, errors);
+	FlatParser flatParser(flatLexer, errors, FlatBuilder(flat, types));
+	FlatRef root = flatParser.parseProgram();
+	ASSERT_NE(root, nullptr);
+	EXPECT_FALSE(errors.hasErrors());
+	EXPECT_EQ(root.id(), flat.root());
+
+	// both add children first in source order, so the arrays match
+	ASSERT_EQ(flat.size(), expected.size());
+	for (NodeID id = 0; id < flat.size(); id++) {
+		EXPECT_EQ(flat.node(id).kind, expected.node(id).kind) << id;
+		EXPECT_EQ(flat.node(id).op, expected.node(id).op) << id;
+		EXPECT_EQ(flat.node(id).data, expected.node(id).data) << id;
+	}
+	NodeID area = flat.children(flat.children(flat.root())[1])[0];
+	EXPECT_EQ(flat.name(area).str(), "area");
+	ASSERT_EQ(flat.paramCount(area), 2);
+	EXPECT_EQ(flat.paramType(area, 1)->toString(), "const int");
+	EXPECT_EQ(flat.paramName(area, 1), "h");
+}
+
+TEST(builderTest, FlatParserFailsLikeParser) {
+	ErrorReporter errors;
+	types::TypeContext types;
+	FlatAST flat;
+	Lexer lexer("func f() -> int { return 1 }", errors);
+	FlatParser parser(lexer, errors, FlatBuilder(flat, types));
+	EXPECT_EQ(parser.parseProgram(), nullptr);
+	EXPECT_TRUE(errors.hasErrors());
+	EXPECT_EQ(flat.root(), NO_NODE);
+}
@@ -0,0 +1,52 @@
+#include "lexer/char_class.hpp"
+#include <cctype>
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace ::frontend;
+
+namespace {
+// Byte-at-a-time reference for the word-at-a-time scanners
+size_t scalarIdentEnd(const std::string &text, size_t pos) {
+	while (pos < text.size() &&
+	       (std::isalnum(static_cast<unsigned char>(text[pos])) != 0 ||
+		text[pos] == '_')) {
+		pos++;
+	}
+	return pos;
+}
+} // namespace
+
+TEST(charClassTest, MatchesCLocaleCctype) {
+	for (int c = 0; c < 256; c++) {
+		auto ch = static_cast<char>(c);
+		EXPECT_EQ(isIdentStart(ch), std::isalpha(c) != 0) << c;
+		EXPECT_EQ(isDigit(ch), std::isdigit(c) != 0) << c;
+		EXPECT_EQ(isSpace(ch), std::isspace(c) != 0) << c;
+		EXPECT_EQ(isIdentContinue(ch), std::isalnum(c) != 0 || c == '_')
+		    << c;
+	}
+}
+
+TEST(charClassTest, ScanIdentifierEveryStopByte) {
+	// put each possible byte at each offset of a 20-byte run, so the
+	// stop lands in the first word, the second word and the scalar tail
+	for (int c = 0; c < 256; c++) {
+		for (size_t at = 0; at < 20; at++) {
+			std::string text(20, 'a');
+			text[at] = static_cast<char>(c);
+			EXPECT_EQ(scanIdentifier(text, 0), scalarIdentEnd(text, 0))
+			    << "byte " << c << " at " << at;
+		}
+	}
+}
+
+TEST(charClassTest, ScanDigits) {
+	EXPECT_EQ(scanDigits("", 0), 0);
+	EXPECT_EQ(scanDigits("1234567890123;", 0), 13);
+	EXPECT_EQ(scanDigits("12345678", 0), 8);
+	EXPECT_EQ(scanDigits("x1234567890", 1), 11);
+	EXPECT_EQ(scanDigits("123456789a", 0), 9);
+	EXPECT_EQ(scanDigits("1234567\xb9", 0), 7);
+}
@@ -0,0 +1,238 @@
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/token.hpp"
+#include "parser/parser.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
+#include "support/thread_pool.hpp"
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ::frontend;
+
+TEST(diagnosticsTest, DiagnosticsAreSmall) {
+	// an ID, a location and two arguments, with no text of its own
+	EXPECT_LE(sizeof(CompilerError), 32);
+	EXPECT_LE(sizeof(DiagArg), 8);
+}
+
+TEST(diagnosticsTest, MessagesAreFormattedFromArguments) {
+	SourceManager sources;
+	FileID file =
+	    sources.addBuffer("a.adq", SourceBuffer(std::string("var x")));
+	ErrorReporter errors(sources);
+	errors.report(DiagID::EXPECTED_TOKEN, {file, 4},
+		      DiagArg::token(TokenType::SEMICOLON), DiagArg::lexeme(1));
+	errors.report(DiagID::EXPECTED_TYPE_AFTER, {file, 0},
+		      DiagArg::token(TokenType::CONST), DiagArg::lexeme(3));
+	errors.report(DiagID::UNEXPECTED_CHARACTER, {file, 0},
+		      DiagArg::character('#'));
+	errors.report(DiagID::CANNOT_READ, {file, 5}, DiagArg::error(EIO));
+
+	const auto &all = errors.getErrors();
+	ASSERT_EQ(all.size(), 4);
+	EXPECT_EQ(errors.message(all[0]), "Expected ';' but got: x");
+	EXPECT_EQ(errors.message(all[1]),
+		  "Expected type after 'const' but got: var");
+	EXPECT_EQ(errors.message(all[2]), "unexpected character '#'");
+	EXPECT_EQ(errors.message(all[3]),
+		  std::string("cannot read a.adq: ") + std::strerror(EIO));
+	EXPECT_EQ(all[0].phase(), ErrorPhase::PARSER);
+	EXPECT_EQ(all[2].phase(), ErrorPhase::LEXER);
+}
+
+TEST(diagnosticsTest, ParserReportsTheTokenItFound) {
+	ErrorReporter errors;
+	types::TypeContext types;
+	Lexer lexer("func f) -> int {}", errors);
+	Parser parser(lexer, errors, types);
+	EXPECT_EQ(parser.parseProgram(), nullptr);
+
+	ASSERT_TRUE(errors.hasErrors());
+	const CompilerError &err = errors.getErrors()[0];
+	EXPECT_EQ(err.id, DiagID::EXPECTED_TOKEN);
+	EXPECT_EQ(err.location.offset, 6);
+	EXPECT_EQ(errors.message(err), "Expected '(' but got: )");
+}
+
+TEST(diagnosticsTest, ErrorLimitKeepsCounting) {
+	ErrorReporter errors;
+	errors.setErrorLimit(2);
+	for (int i = 0; i < 5; i++) {
+		errors.report(DiagID::UNTERMINATED_STRING, {});
+		EXPECT_EQ(errors.limitReached(), i >= 2);
+	}
+	EXPECT_EQ(errors.getErrors().size(), 2);
+	EXPECT_EQ(errors.getErrorCount(), 5);
+}
+
+TEST(diagnosticsTest, PrintAllRendersEverythingAtOnce) {
+	SourceManager sources;
+	FileID file = sources.addBuffer("a.adq",
+					SourceBuffer(std::string("a\n  @@@")));
+	ErrorReporter errors(sources);
+	errors.setErrorLimit(2);
+	for (uint32_t offset = 4; offset < 7; offset++) {
+		errors.report(DiagID::UNEXPECTED_CHARACTER, {file, offset},
+			      DiagArg::character('@'));
+	}
+
+	std::ostringstream out;
+	errors.printAll(out);
+	EXPECT_EQ(out.str(), "a.adq:2:3: error: unexpected character '@'\n"
+			     "a.adq:2:4: error: unexpected character '@'\n"
+			     "too many errors emitted, stopping now "
+			     "[-ferror-limit=]\n"
+			     "\nCompilation failed with 3 error(s)\n");
+}
+
+namespace {
+// Lexes and parses `file`, as the driver does
+void compile(FileID file, ErrorReporter &errors) {
+	Lexer lexer(file, errors);
+	types::TypeContext types;
+	Parser parser(lexer, errors, types);
+	parser.setRecovery(ErrorRecovery::SYNCHRONIZE);
+	(void)parser.parseProgram();
+}
+
+std::vector<FileID> addFiles(SourceManager &sources) {
+	const std::vector<std::string> texts = {
+	    "func f() -> int { return 1; } #",
+	    "func g( -> int {}",
+	    "struct S { var int x; }\n\"open",
+	    "namespace n { func h() -> void {} }",
+	    "@ $ func k) {}",
+	};
+	std::vector<FileID> files;
+	for (size_t i = 0; i < texts.size(); i++) {
+		files.push_back(sources.addBuffer(std::to_string(i) + ".adq",
+						  SourceBuffer(texts[i])));
+	}
+	return files;
+}
+
+std::string render(const ErrorReporter &errors) {
+	std::ostringstream out;
+	errors.printAll(out);
+	return out.str();
+}
+} // namespace
+
+TEST(diagnosticsTest, ShardsMergeInFileAndOffsetOrder) {
+	SourceManager sources;
+	FileID a = sources.addBuffer("a.adq", SourceBuffer(std::string("ab")));
+	FileID b = sources.addBuffer("b.adq", SourceBuffer(std::string("ab")));
+	DiagnosticSink sink(sources, 2);
+	sink.shard(0).report(DiagID::UNTERMINATED_STRING, {b, 1});
+	sink.shard(0).report(DiagID::UNTERMINATED_CHAR, {a, 1});
+	sink.shard(1).report(DiagID::INT_TOO_LARGE, {b, 0});
+	sink.shard(1).report(DiagID::UNTERMINATED_STRING, {a, 1});
+
+	ErrorReporter errors(sources);
+	sink.mergeInto(errors);
+	const auto &all = errors.getErrors();
+	ASSERT_EQ(all.size(), 4);
+	EXPECT_EQ(all[0].id, DiagID::UNTERMINATED_CHAR);
+	EXPECT_EQ(all[1].id, DiagID::UNTERMINATED_STRING);
+	EXPECT_EQ(all[1].location.file, a);
+	EXPECT_EQ(all[2].id, DiagID::INT_TOO_LARGE);
+	EXPECT_EQ(all[3].location.file, b);
+	EXPECT_EQ(errors.getErrorCount(), 4);
+	EXPECT_TRUE(sink.shard(0).getErrors().empty());
+}
+
+TEST(diagnosticsTest, ParallelFilesPrintWhatASerialRunDoes) {
+	for (size_t limit : {0, 1, 3}) {
+		SCOPED_TRACE("limit " + std::to_string(limit));
+		SourceManager sources;
+		std::vector<FileID> files = addFiles(sources);
+
+		ErrorReporter serial(sources);
+		serial.setErrorLimit(limit);
+		for (FileID file : files) {
+			compile(file, serial);
+			if (serial.limitReached()) {
+				break;
+			}
+		}
+
+		ThreadPool pool(4);
+		DiagnosticSink sink(sources, files.size(), limit);
+		pool.forEach(files.size(), [&](size_t i) {
+			compile(files[i], sink.shard(i));
+		});
+		ErrorReporter parallel(sources);
+		parallel.setErrorLimit(limit);
+		sink.mergeInto(parallel);
+
+		EXPECT_TRUE(serial.hasErrors());
+		EXPECT_EQ(render(parallel), render(serial));
+	}
+}
+
+TEST(diagnosticsTest, ShardsKeepEverythingUntilTheLimitIsApplied) {
+	SourceManager sources;
+	FileID file =
+	    sources.addBuffer("a.adq", SourceBuffer(std::string("@ @ @ @")));
+	DiagnosticSink sink(sources, 1);
+	// reported out of offset order, as a parallel lex followed by its
+	// parse does
+	for (uint32_t offset : {2, 4, 6, 0}) {
+		sink.shard(0).report(DiagID::UNEXPECTED_CHARACTER,
+				     {file, offset}, DiagArg::character('@'));
+	}
+
+	ErrorReporter errors(sources);
+	errors.setErrorLimit(2);
+	sink.mergeInto(errors);
+	const auto &kept = errors.getErrors();
+	ASSERT_EQ(kept.size(), 2);
+	EXPECT_EQ(kept[0].location.offset, 0);
+	EXPECT_EQ(kept[1].location.offset, 2);
+	EXPECT_EQ(errors.getErrorCount(), 3);
+}
+
+TEST(diagnosticsTest, BoundedShardsKeepOnlyTheLowest) {
+	SourceManager sources;
+	FileID file = sources.addBuffer(
+	    "a.adq", SourceBuffer(std::string("@ @ @ @ @ @ @ @")));
+	DiagnosticSink sink(sources, 1, 2);
+	for (uint32_t offset : {8, 14, 4, 12, 2, 10, 4, 6}) {
+		sink.shard(0).report(DiagID::UNEXPECTED_CHARACTER,
+				     {file, offset}, DiagArg::character('@'));
+	}
+
+	ErrorReporter errors(sources);
+	errors.setErrorLimit(2);
+	sink.mergeInto(errors);
+	const auto &kept = errors.getErrors();
+	ASSERT_EQ(kept.size(), 2);
+	EXPECT_EQ(kept[0].location.offset, 2);
+	EXPECT_EQ(kept[1].location.offset, 4);
+	EXPECT_EQ(errors.getErrorCount(), 3);
+}
+
+TEST(diagnosticsTest, KeepLowestBreaksTiesByReportOrder) {
+	SourceManager sources;
+	FileID file =
+	    sources.addBuffer("a.adq", SourceBuffer(std::string("ab")));
+	ErrorReporter errors(sources);
+	errors.keepLowest(2);
+	errors.report(DiagID::INT_TOO_LARGE, {file, 1});
+	errors.report(DiagID::UNTERMINATED_CHAR, {file, 1});
+	errors.report(DiagID::UNTERMINATED_STRING, {file, 1});
+	EXPECT_FALSE(errors.limitReached());
+	EXPECT_EQ(errors.getErrorCount(), 3);
+
+	std::vector<CompilerError> kept = errors.takeSorted();
+	ASSERT_EQ(kept.size(), 2);
+	EXPECT_EQ(kept[0].id, DiagID::INT_TOO_LARGE);
+	EXPECT_EQ(kept[1].id, DiagID::UNTERMINATED_CHAR);
+}
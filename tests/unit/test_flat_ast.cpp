@@ -0,0 +1,362 @@
+#include "ast/ast.hpp"
+#include "ast/decl.hpp"
+#include "ast/expr.hpp"
+#include "ast/flat_ast.hpp"
+#include "ast/stmt.hpp"
+#include "ast/visitor.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "parser/parser.hpp"
+#include "support/arena.hpp"
+#include "types/type.hpp"
+#include "types/type_context.hpp"
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace ::frontend;
+using namespace ::frontend::ast;
+
+namespace {
+const char *const PROGRAM =
+    "struct Point { var int x; var float y = 1.5;"
+    "  func len() -> int { return x; } }\n"
+    "namespace geo {\n"
+    "  func area(int w, const int h) -> double {\n"
+    "    var int cells[4];\n"
+    "    var string s = \"hi\";\n"
+    "    var char c = 'q';\n"
+    "    var bool b = !false;\n"
+    "    for (var int i = 0; i < w; i + 1) {\n"
+    "      if (i == 2) { continue; } else { break; }\n"
+    "    }\n"
+    "    while (w > 0) { w -= 1; }\n"
+    "    w = -h;\n"
+    "    return geo::scale(w * h, 2.5, s);\n"
+    "  }\n"
+    "}\n";
+
+// An ordinary visitor written against the pointer AST: prints the tree as
+// an s-expression
+class Printer : public ASTVisitor {
+	void print(ASTNode *node) {
+		if (node == nullptr) {
+			out += " -";
+			return;
+		}
+		out += " ";
+		node->accept(*this);
+	}
+	template <typename T> void print(const NodeList<T> &list) {
+		out += " [";
+		for (const auto &node : list) {
+			print(node.get());
+		}
+		out += "]";
+	}
+	void open(const std::string &head) { out += "(" + head; }
+	void close() { out += ")"; }
+
+public:
+	std::string out;
+	size_t binaries = 0;
+
+	void visit(NumberLiteralAST &node) override {
+		out += node.isInteger() ? std::to_string(node.getIntValue())
+					: std::to_string(node.getFloatValue());
+	}
+	void visit(StringLiteralAST &node) override {
+		out += "\"" + node.getValue() + "\"";
+	}
+	void visit(CharLiteralAST &node) override {
+		out += std::string("'") + node.getValue() + "'";
+	}
+	void visit(BoolLiteralAST &node) override {
+		out += node.getValue() ? "true" : "false";
+	}
+	void visit(UnaryExprAST &node) override {
+		open("unary " + std::to_string(static_cast<int>(
+				    node.getOperator())));
+		print(node.getOperand());
+		close();
+	}
+	void visit(BinaryExprAST &node) override {
+		binaries++;
+		open("binary " + std::to_string(static_cast<int>(
+				     node.getOperator())));
+		print(node.getLhs());
+		print(node.getRhs());
+		close();
+	}
+	void visit(TernaryExprAST &node) override {
+		open("?:");
+		print(node.getCondition());
+		print(node.getThenBranch());
+		print(node.getElseBranch());
+		close();
+	}
+	void visit(VariableExprAST &node) override {
+		out += node.getQualifiedName().str();
+	}
+	void visit(CallExprAST &node) override {
+		open("call");
+		print(node.getCallee());
+		print(node.getArgs());
+		close();
+	}
+	void visit(BlockStmtAST &node) override {
+		open("block");
+		print(node.getStmts());
+		close();
+	}
+	void visit(ReturnStmtAST &node) override {
+		open("return");
+		print(node.getValue());
+		close();
+	}
+	void visit(BreakStmtAST &) override { out += "(break)"; }
+	void visit(ContinueStmtAST &) override { out += "(continue)"; }
+	void visit(AssignmentStmtAST &node) override {
+		open("assign " + node.getVariableName() + " " +
+		     std::to_string(static_cast<int>(node.getOperator())));
+		print(node.getValue());
+		close();
+	}
+	void visit(IfStmtAST &node) override {
+		open("if");
+		print(node.getCondition());
+		print(node.getThenBranch());
+		print(node.getElseBranch());
+		close();
+	}
+	void visit(ForStmtAST &node) override {
+		open("for");
+		print(node.getInit());
+		print(node.getCondition());
+		print(node.getUpdate());
+		print(node.getBody());
+		close();
+	}
+	void visit(WhileStmtAST &node) override {
+		open("while");
+		print(node.getCondition());
+		print(node.getBody());
+		close();
+	}
+	void visit(DoStmtAST &node) override {
+		open("do");
+		print(node.getBody());
+		print(node.getCondition());
+		close();
+	}
+	void visit(ErrorStmtAST &node) override {
+		out += "(error " + std::to_string(node.getBegin()) + " " +
+		       std::to_string(node.getEnd()) + ")";
+	}
+	void visit(DeclStmtAST &node) override {
+		open("decl");
+		print(node.getDecl());
+		close();
+	}
+	void visit(VariableDeclarationAST &node) override {
+		open("var " + node.getType()->toString() + " " +
+		     node.getName());
+		print(node.getArraySize());
+		print(node.getInit());
+		close();
+	}
+	void visit(FunctionAST &node) override {
+		const PrototypeAST *proto = node.getProto();
+		open("func " + proto->getQualifiedName().str() + " -> " +
+		     proto->getReturnType()->toString());
+		for (const auto &[type, name] : proto->getParams()) {
+			out += " " + type->toString() + " " + name;
+		}
+		print(node.getBody().get());
+		close();
+	}
+	void visit(StructAST &node) override {
+		open("struct " + node.getName());
+		print(node.getFields());
+		print(node.getMethods());
+		close();
+	}
+	void visit(NamespaceAST &node) override {
+		open("namespace " + node.getName());
+		print(node.getDeclarations());
+		close();
+	}
+	void visit(ErrorDeclAST &node) override {
+		out += "(error " + std::to_string(node.getBegin()) + " " +
+		       std::to_string(node.getEnd()) + ")";
+	}
+	void visit(ProgramAST &node) override {
+		open("program");
+		print(node.getDeclarations());
+		close();
+	}
+};
+
+std::string print(ASTNode &node) {
+	Printer printer;
+	node.accept(printer);
+	return printer.out;
+}
+
+std::unique_ptr<ProgramAST> parse(const char *src, types::TypeContext &types,
+				  Arena *arena = nullptr) {
+	ErrorReporter errors;
+	Lexer lexer(src, errors);
+	Parser parser(lexer, errors, {types, arena});
+	auto program = parser.parseProgram();
+	EXPECT_FALSE(errors.hasErrors());
+	return program;
+}
+} // namespace
+
+TEST(flatAstTest, VisitorsRunUnchanged) {
+	types::TypeContext types;
+	auto program = parse(PROGRAM, types);
+	ASSERT_NE(program, nullptr);
+	FlatAST flat = flatten(*program);
+	ASSERT_NE(flat.root(), NO_NODE);
+	EXPECT_EQ(flat.kind(flat.root()), NodeKind::PROGRAM);
+
+	Printer printer;
+	flat.accept(flat.root(), printer);
+	EXPECT_EQ(printer.out, print(*program));
+
+	// and a subtree on its own
+	NodeID geo = flat.children(flat.root())[1];
+	ASSERT_EQ(flat.kind(geo), NodeKind::NAMESPACE);
+	Printer subtree;
+	flat.accept(geo, subtree);
+	EXPECT_EQ(subtree.out, print(*program->getDeclarations()[1]));
+}
+
+TEST(flatAstTest, InflatesIntoAnArena) {
+	types::TypeContext types;
+	auto program = parse(PROGRAM, types);
+	ASSERT_NE(program, nullptr);
+	FlatAST flat = flatten(*program);
+
+	Arena arena;
+	auto copy = flat.inflate(flat.root(), &arena);
+	EXPECT_GT(arena.bytesUsed(), 0);
+	EXPECT_EQ(print(*copy), print(*program));
+}
+
+TEST(flatAstTest, LinearScanSeesEveryNode) {
+	types::TypeContext types;
+	auto program = parse(PROGRAM, types);
+	ASSERT_NE(program, nullptr);
+	FlatAST flat = flatten(*program);
+
+	Printer printer;
+	program->accept(printer);
+	size_t binaries = 0;
+	for (const FlatNode &node : flat.nodes()) {
+		binaries += node.kind == NodeKind::BINARY ? 1 : 0;
+	}
+	EXPECT_EQ(binaries, printer.binaries);
+	// children come before their parents
+	for (NodeID id = 0; id < flat.size(); id++) {
+		if (flat.kind(id) == NodeKind::BINARY) {
+			EXPECT_LT(flat.child(id, 0), id);
+			EXPECT_LT(flat.child(id, 1), id);
+		}
+	}
+	EXPECT_EQ(flat.root(), flat.size() - 1);
+}
+
+TEST(flatAstTest, BuilderAndAccessors) {
+	FlatAST flat;
+	NodeID big = flat.intLiteral(-1234567890123);
+	NodeID half = flat.floatLiteral(-0.5);
+	NodeID sum = flat.binary(BinaryOp::ADD, big, half);
+	NodeID x = flat.variable(QualifiedName({"a", "b"}, "x"));
+	NodeID assign = flat.assignment("y", AssignOp::SHL_ASSIGN, x);
+	NodeID body = flat.block(std::vector<NodeID>{assign});
+	NodeID loop = flat.doStmt(body, sum);
+	NodeID update = flat.ternary(flat.boolLiteral(true), x, big);
+	NodeID forLoop = flat.forStmt(NO_NODE, x, update, body);
+	NodeID field = flat.varDecl(types::TypeContext::getInt(), "f");
+	NodeID method = flat.function(QualifiedName("m"), {},
+				      types::TypeContext::getVoid(), body);
+	NodeID record = flat.structDecl("S", std::vector<NodeID>{field},
+					std::vector<NodeID>{method});
+
+	EXPECT_EQ(flat.intValue(big), -1234567890123);
+	EXPECT_EQ(flat.floatValue(half), -0.5);
+	EXPECT_EQ(flat.node(sum).op, static_cast<uint8_t>(BinaryOp::ADD));
+	EXPECT_EQ(flat.name(x).str(), "a::b::x");
+	EXPECT_EQ(flat.text(assign), "y");
+	EXPECT_EQ(flat.child(assign, 0), x);
+	ASSERT_EQ(flat.children(body).size(), 1);
+	EXPECT_EQ(flat.children(body)[0], assign);
+	EXPECT_EQ(flat.child(loop, 0), body);
+	EXPECT_EQ(flat.child(loop, 1), sum);
+	EXPECT_EQ(flat.child(forLoop, 0), NO_NODE);
+	EXPECT_EQ(flat.child(forLoop, 2), update);
+	EXPECT_EQ(flat.child(update, 2), big);
+	EXPECT_EQ(flat.child(forLoop, 3), body);
+	EXPECT_EQ(flat.type(field)->toString(), "int");
+	EXPECT_EQ(flat.text(field), "f");
+	EXPECT_EQ(flat.type(method)->toString(), "void");
+	EXPECT_EQ(flat.paramCount(method), 0);
+	EXPECT_EQ(flat.text(record), "S");
+	ASSERT_EQ(flat.fields(record).size(), 1);
+	EXPECT_EQ(flat.fields(record)[0], field);
+	ASSERT_EQ(flat.methods(record).size(), 1);
+	EXPECT_EQ(flat.methods(record)[0], method);
+	EXPECT_EQ(flat.root(), NO_NODE);
+
+	// do-while has no syntax yet, so it only comes from a builder
+	Printer printer;
+	flat.accept(loop, printer);
+	EXPECT_EQ(printer.out, "(do (block [ (assign y 6 a::b::x)]) (binary 0 "
+			       "-1234567890123 -0.500000))");
+}
+
+TEST(flatAstTest, EqualNamesAreStoredOnce) {
+	FlatAST flat;
+	NodeID a = flat.variable(QualifiedName({"n"}, "a"));
+	NodeID same = flat.variable(QualifiedName({"n"}, "a"));
+	NodeID other = flat.variable(QualifiedName("a"));
+	NodeID s = flat.stringLiteral("a");
+	NodeID t = flat.assignment("a", AssignOp::ASSIGN, s);
+	size_t before = flat.bytes();
+	flat.stringLiteral("a");
+	flat.variable(QualifiedName({"n"}, "a"));
+
+	EXPECT_EQ(&flat.name(a), &flat.name(same));
+	EXPECT_NE(&flat.name(a), &flat.name(other));
+	EXPECT_EQ(flat.name(other).str(), "a");
+	EXPECT_EQ(&flat.text(s), &flat.text(t));
+	EXPECT_EQ(flat.bytes() - before, 2 * sizeof(FlatNode));
+}
+
+TEST(flatAstTest, SmallerThanThePointerTree) {
+	std::string src;
+	for (int i = 0; i < 200; i++) {
+		src += "func f" + std::to_string(i) +
+		       "(int a, int b) -> int {\n"
+		       "\tvar int c = a * b + (a - b) / 2;\n"
+		       "\tif (c > a && c < b) { c = c << 1; }\n"
+		       "\twhile (c > 0) { c -= f(c, a | b); }\n"
+		       "\treturn c ^ a;\n"
+		       "}\n";
+	}
+	// the pointer tree's node storage, names held inline, without the
+	// heap's overhead; bytes() counts the flat tree's names too, and no
+	// name here is long enough to leave either tree's strings
+	Arena arena;
+	types::TypeContext types;
+	auto program = parse(src.c_str(), types, &arena);
+	ASSERT_NE(program, nullptr);
+	FlatAST flat = flatten(*program);
+	EXPECT_GE(arena.bytesUsed(), 3 * flat.bytes());
+}
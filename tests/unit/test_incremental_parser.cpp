@@ -0,0 +1,377 @@
+#include "../test_helpers.hpp"
+#include "ast/flat_ast.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/relex.hpp"
+#include "parser/incremental_parser.hpp"
+#include "parser/syntax_tree.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace ::frontend;
+using ast::NodeKind;
+
+namespace {
+const std::string PROGRAM =
+    "func f(int a) -> int { return a * 2; }\n"
+    "struct Point { var int x; func len() -> int { return x; } }\n"
+    "namespace geo {\n"
+    "  func g(int w) -> int {\n"
+    "    var int s = 0;\n"
+    "    while (w > 0) { w -= 1; }\n"
+    "    if (w == 0) { s = 1; } else if (s) { s = 2; }\n"
+    "    return f(s);\n"
+    "  }\n"
+    "}\n"
+    "func h() -> int { return 3; }\n";
+
+// Checks every node of `node` against `text`, the file it was parsed from;
+// returns how many there were
+size_t checkPositions(const SyntaxNode &node, std::string_view text) {
+	size_t count = 1;
+	EXPECT_LE(node.endOffset(), text.size());
+	if (node.kind() == NodeKind::FUNCTION) {
+		EXPECT_EQ(text.substr(node.offset(), 4), "func");
+	}
+	for (size_t i = 0; i < node.childCount(); i++) {
+		if (SyntaxNode child = node.child(i)) {
+			EXPECT_GE(child.offset(), node.offset());
+			EXPECT_LE(child.endOffset(), node.endOffset());
+			count += checkPositions(child, text);
+		}
+	}
+	return count;
+}
+
+// A file being edited, with the parse of every version kept up to date
+class Session {
+public:
+	SourceManager sources;
+
+private:
+	ErrorReporter initialErrors{sources};
+
+public:
+	std::string text;
+	FileID file;
+	IncrementalParser parser;
+	ErrorReporter errors{sources}; // of the last edit
+
+	explicit Session(const std::string &text)
+	    : text(text), file(sources.addBuffer("input", SourceBuffer(text))),
+	      parser(file, initialErrors) {}
+
+	SyntaxNode replace(uint32_t offset, uint32_t removed,
+			   const std::string &inserted) {
+		text.replace(offset, removed, inserted);
+		errors.clear();
+		return parser.edit({offset, removed,
+				    static_cast<uint32_t>(inserted.size())},
+				   SourceBuffer(text), errors);
+	}
+
+	// The incremental tree and diagnostics are a fresh parse's
+	void expectFresh() {
+		FileID freshFile =
+		    sources.addBuffer("fresh", SourceBuffer(text));
+		{
+			ErrorReporter freshErrors(sources);
+			IncrementalParser fresh(freshFile, freshErrors);
+			ASSERT_EQ(parser.valid(), fresh.valid());
+			if (fresh.valid()) {
+				EXPECT_TRUE(parser.root().green().equals(
+				    fresh.root().green()));
+			}
+			else {
+				// the parser's, without the lexer's
+				EXPECT_EQ(
+				    messages(errors, ErrorPhase::PARSER),
+				    messages(freshErrors, ErrorPhase::PARSER));
+			}
+		}
+		sources.release(freshFile);
+	}
+};
+} // namespace
+
+TEST(incrementalParserTest, EditReparsesOnlyTheEnclosingBlock) {
+	Session session(PROGRAM);
+	ASSERT_TRUE(session.parser.valid());
+	SyntaxNode before = session.parser.root();
+
+	// "s = 1" becomes "s = 12"
+	auto at = static_cast<uint32_t>(session.text.find("s = 1;"));
+	SyntaxNode reparsed = session.replace(at + 4, 1, "12");
+	ASSERT_TRUE(reparsed);
+	EXPECT_EQ(reparsed.kind(), NodeKind::BLOCK);
+	EXPECT_EQ(reparsed.parent().kind(), NodeKind::IF);
+	EXPECT_TRUE(session.errors.getErrors().empty());
+	session.expectFresh();
+
+	// everything off the path to the edit is shared with the old tree
+	SyntaxNode after = session.parser.root();
+	EXPECT_NE(after.greenPtr(), before.greenPtr());
+	EXPECT_EQ(after.child(0).greenPtr(), before.child(0).greenPtr());
+	EXPECT_EQ(after.child(1).greenPtr(), before.child(1).greenPtr());
+	EXPECT_EQ(after.child(3).greenPtr(), before.child(3).greenPtr());
+	SyntaxNode body = after.child(2).child(0).child(0);
+	SyntaxNode oldBody = before.child(2).child(0).child(0);
+	EXPECT_EQ(body.child(1).greenPtr(), oldBody.child(1).greenPtr());
+	EXPECT_NE(body.child(2).greenPtr(), oldBody.child(2).greenPtr());
+}
+
+TEST(incrementalParserTest, ShapeChangesReparseTheEnclosingUnit) {
+	Session session(PROGRAM);
+
+	// a new statement still fits the block it is typed into
+	auto at = static_cast<uint32_t>(session.text.find("w -= 1; }"));
+	SyntaxNode reparsed = session.replace(at + 8, 0, "s += w; ");
+	ASSERT_TRUE(reparsed);
+	EXPECT_EQ(reparsed.kind(), NodeKind::BLOCK);
+	EXPECT_EQ(reparsed.childCount(), 2);
+	session.expectFresh();
+
+	// a new declaration is found by the whole file
+	at = static_cast<uint32_t>(session.text.find("func h"));
+	reparsed = session.replace(at, 0, "func k() -> int { return 4; }\n");
+	ASSERT_TRUE(reparsed);
+	EXPECT_EQ(reparsed.kind(), NodeKind::PROGRAM);
+	EXPECT_EQ(reparsed.childCount(), 5);
+	session.expectFresh();
+
+	// turning the `else if` into a plain `if` reshapes the function body
+	at = static_cast<uint32_t>(session.text.find("else if"));
+	reparsed = session.replace(at, 5, "");
+	ASSERT_TRUE(reparsed);
+	EXPECT_EQ(reparsed.kind(), NodeKind::BLOCK);
+	EXPECT_EQ(reparsed.parent().kind(), NodeKind::FUNCTION);
+	session.expectFresh();
+}
+
+TEST(incrementalParserTest, BrokenTextKeepsTheDamageUntilItParses) {
+	Session session(PROGRAM);
+	auto brace = static_cast<uint32_t>(session.text.find("} }"));
+	EXPECT_FALSE(session.replace(brace, 1, ""));
+	EXPECT_FALSE(session.parser.valid());
+	EXPECT_FALSE(session.parser.root());
+	EXPECT_TRUE(session.errors.hasErrors());
+	session.expectFresh();
+
+	// edits elsewhere while broken are reparsed together with it
+	auto other = static_cast<uint32_t>(session.text.find("return 3"));
+	session.replace(other + 7, 1, "30");
+	EXPECT_FALSE(session.parser.valid());
+	session.expectFresh();
+
+	SyntaxNode fixed = session.replace(brace, 0, "}");
+	ASSERT_TRUE(fixed);
+	EXPECT_TRUE(session.parser.valid());
+	EXPECT_FALSE(session.errors.hasErrors());
+	session.expectFresh();
+}
+
+TEST(incrementalParserTest, TypingMatchesAFullParseAtEveryStep) {
+	Session session(PROGRAM);
+	const std::string statement = "var int t = f(w) + (s - 1);";
+	auto at = static_cast<uint32_t>(session.text.find("return f(s)"));
+	for (size_t i = 0; i < statement.size(); i++) {
+		session.replace(at + i, 0, statement.substr(i, 1));
+		SCOPED_TRACE(session.text.substr(at, i + 1));
+		session.expectFresh();
+	}
+	EXPECT_TRUE(session.parser.valid());
+	for (size_t i = statement.size(); i-- > 0;) {
+		session.replace(at + i, 1, "");
+		SCOPED_TRACE(session.text.substr(at, i));
+		session.expectFresh();
+	}
+	EXPECT_EQ(session.text, PROGRAM);
+}
+
+TEST(incrementalParserTest, EveryEditOfASmallProgram) {
+	const std::string src = "func f(int a) -> int { if (a) { a = 1; } "
+				"else if (a) { } return a; }\n"
+				"struct S { var int x; func m() -> int "
+				"{ return 2; } }";
+	for (const std::string text :
+	     {"", "}", "{", ";", "x", "1", " ", "if", "func "}) {
+		for (uint32_t at = 0; at <= src.size(); at++) {
+			uint32_t removed = text.empty() ? 1 : 0;
+			if (at + removed > src.size()) {
+				continue;
+			}
+			Session session(src);
+			session.replace(at, removed, text);
+			SCOPED_TRACE(session.text);
+			session.expectFresh();
+		}
+	}
+}
+
+TEST(incrementalParserTest, EditsReplaceTheFileInPlace) {
+	Session session(PROGRAM);
+	auto at = static_cast<uint32_t>(session.text.find("return 3"));
+	for (int i = 0; i < 100; i++) {
+		session.replace(at + 7, 1, std::to_string(i % 10));
+		EXPECT_TRUE(session.parser.valid());
+	}
+	session.expectFresh();
+
+	EXPECT_EQ(session.parser.tokens().fileID(), session.file);
+	EXPECT_EQ(session.sources.text(session.file), session.text);
+	EXPECT_EQ(session.parser.snapshot()->file, session.file);
+	// no file was added per edit, so the next one reuses the second id,
+	// which expectFresh() released
+	EXPECT_EQ(session.sources.addBuffer("next", SourceBuffer(PROGRAM)).id,
+		  2u);
+}
+
+TEST(incrementalParserTest, RedNodesKnowTheirPlace) {
+	Session session(PROGRAM);
+	SyntaxNode root = session.parser.root();
+	ASSERT_TRUE(root);
+	EXPECT_FALSE(root.parent());
+	EXPECT_EQ(root.offset(), 0);
+
+	SyntaxNode point = root.child(1);
+	EXPECT_EQ(point.kind(), NodeKind::STRUCT);
+	EXPECT_EQ(point.offset(), session.text.find("struct Point"));
+	EXPECT_EQ(point.endOffset(), session.text.find("\nnamespace"));
+	EXPECT_EQ(point.parent().greenPtr(), root.greenPtr());
+
+	// the innermost node at an offset, and its way up
+	auto two = static_cast<uint32_t>(session.text.find("2;"));
+	SyntaxNode literal = root.find(two);
+	ASSERT_TRUE(literal);
+	EXPECT_EQ(literal.kind(), NodeKind::INT_LITERAL);
+	EXPECT_EQ(literal.endOffset(), two + 1);
+	EXPECT_EQ(literal.parent().kind(), NodeKind::BINARY);
+	EXPECT_EQ(literal.parent().parent().kind(), NodeKind::RETURN);
+	EXPECT_FALSE(root.find(static_cast<uint32_t>(session.text.size())));
+
+	// absent children are null
+	SyntaxNode g = root.child(2).child(0);
+	SyntaxNode ifStmt = g.child(0).child(2);
+	ASSERT_EQ(ifStmt.kind(), NodeKind::IF);
+	SyntaxNode elseIf = ifStmt.child(2).child(0);
+	ASSERT_EQ(elseIf.kind(), NodeKind::IF);
+	EXPECT_FALSE(elseIf.child(2));
+
+	// positions follow an edit in front of them
+	uint32_t offset = point.offset();
+	session.replace(0, 0, "\n\n");
+	EXPECT_EQ(session.parser.root().child(1).offset(), offset + 2);
+}
+
+TEST(incrementalParserTest, SnapshotsOutliveLaterEdits) {
+	Session session(PROGRAM);
+	std::shared_ptr<const SyntaxSnapshot> first = session.parser.snapshot();
+	ASSERT_NE(first, nullptr);
+	EXPECT_EQ(first->version, 0);
+	std::string_view firstText = first->text();
+	SyntaxNode h = first->root().child(3);
+	EXPECT_EQ(firstText.substr(h.offset(), 6), "func h");
+
+	session.replace(0, 0, "// moved\n");
+	std::shared_ptr<const SyntaxSnapshot> second =
+	    session.parser.snapshot();
+	ASSERT_NE(second, first);
+	EXPECT_EQ(second->version, 1);
+	std::string_view secondText = second->text();
+	EXPECT_EQ(secondText.substr(second->root().child(3).offset(), 6),
+		  "func h");
+	EXPECT_EQ(second->root().child(3).greenPtr(), h.greenPtr());
+
+	// the old version still reads as it was
+	EXPECT_EQ(first->root().child(3).offset(), h.offset());
+	checkPositions(first->root(), firstText);
+	checkPositions(second->root(), secondText);
+
+	// text that does not parse publishes nothing
+	session.replace(0, 0, "}");
+	EXPECT_EQ(session.parser.snapshot(), second);
+}
+
+TEST(incrementalParserTest, DroppedVersionsFreeTheirText) {
+	Session session(PROGRAM);
+	std::shared_ptr<const SyntaxSnapshot> first = session.parser.snapshot();
+	std::weak_ptr<const SourceBuffer> firstText = first->source;
+	std::weak_ptr<const GreenNode> firstRoot = first->green;
+
+	session.replace(0, 0, "// moved\n");
+	EXPECT_FALSE(firstText.expired());
+	EXPECT_EQ(first->text(), PROGRAM);
+	first.reset();
+	EXPECT_TRUE(firstText.expired());
+	EXPECT_TRUE(firstRoot.expired());
+
+	// text that never parsed has no snapshot, and goes with the next edit
+	session.replace(0, 0, "}");
+	std::weak_ptr<const SourceBuffer> broken =
+	    session.sources.source(session.file);
+	session.replace(0, 1, "");
+	EXPECT_TRUE(broken.expired());
+	EXPECT_EQ(session.parser.snapshot()->text(), session.text);
+}
+
+TEST(incrementalParserTest, SnapshotsKeepTheirTypes) {
+	std::shared_ptr<const SyntaxSnapshot> snapshot;
+	{
+		Session session("func f(const int a) -> int { return a; }");
+		snapshot = session.parser.snapshot();
+	}
+	// the parser and its file are gone, the types the nodes name are not
+	ASSERT_NE(snapshot, nullptr);
+	const GreenNode &f = snapshot->root().child(0).green();
+	ASSERT_EQ(f.typed.size(), 2);
+	EXPECT_EQ(f.typed[1].type->toString(), "const int");
+}
+
+TEST(incrementalParserTest, ReadersNeverWaitForEdits) {
+	Session session(PROGRAM);
+	std::atomic<bool> editing = true;
+	auto read = [&] {
+		uint64_t last = 0;
+		size_t snapshots = 0;
+		while (editing.load() || snapshots == 0) {
+			std::shared_ptr<const SyntaxSnapshot> snapshot =
+			    session.parser.snapshot();
+			EXPECT_GE(snapshot->version, last);
+			last = snapshot->version;
+			EXPECT_GT(checkPositions(snapshot->root(),
+						 snapshot->text()),
+				  1);
+			snapshots++;
+		}
+	};
+	std::vector<std::jthread> readers;
+	for (int i = 0; i < 2; i++) {
+		readers.emplace_back(read);
+	}
+
+	// statements come and go, and everything after them moves
+	auto at = static_cast<uint32_t>(session.text.find("return f(s)"));
+	for (int i = 0; i < 200; i++) {
+		if (i % 2 == 0) {
+			session.replace(at, 0, "s = s + 1; ");
+			session.replace(0, 0, " ");
+		}
+		else {
+			session.replace(at + 1, 11, "");
+			session.replace(0, 1, "");
+		}
+		EXPECT_TRUE(session.parser.valid());
+	}
+	editing = false;
+	readers.clear();
+	EXPECT_EQ(session.text, PROGRAM);
+	session.expectFresh();
+}
@@ -1,16 +1,22 @@
 #include "diagnostics/diagnostics.hpp"
 #include "lexer/lexer.hpp"
 #include "lexer/token.hpp"
+#include "lexer/token_buffer.hpp"
+#include "source/line_table.hpp"
+#include "source/source_buffer.hpp"
 #include <gtest/gtest.h>
 #include <string>
+#include <string_view>
 #include <vector>
 
 using namespace ::frontend;
 
 namespace {
-// Lex the whole source, stopping at EOF
-std::vector<Token> lexAll(const std::string &src, ErrorReporter &errors) {
-	Lexer lexer(src, errors);
+// Lex the whole source, stopping at EOF. Lexemes view into `src`, so it
+// must outlive the returned tokens (string literals do).
+std::vector<Token> lexAll(std::string_view src, ErrorReporter &errors) {
+	SourceBuffer buffer = SourceBuffer::borrow(src);
+	Lexer lexer(buffer, errors);
 	std::vector<Token> tokens;
 	while (true) {
 		Token token = lexer.get();
@@ -33,11 +39,11 @@ TEST(lexerTest, Get) {
 	token = lexer.get();
 	ASSERT_EQ(token.type, TokenType::EQUAL);
 	token = lexer.get();
-	ASSERT_EQ(token.type, TokenType::NUMBER_LIT);
+	ASSERT_EQ(token.type, TokenType::INT_LIT);
 	token = lexer.get();
 	ASSERT_EQ(token.type, TokenType::PLUS);
 	token = lexer.get();
-	ASSERT_EQ(token.type, TokenType::NUMBER_LIT);
+	ASSERT_EQ(token.type, TokenType::INT_LIT);
 }
 
 TEST(lexerTest, Keywords) {
@@ -68,6 +74,21 @@ TEST(lexerTest, Keywords) {
 	EXPECT_FALSE(errors.hasErrors());
 }
 
+TEST(lexerTest, KeywordNearMisses) {
+	ErrorReporter errors;
+	// prefixes, extensions, case changes and same-hash-shape words of
+	// real keywords all stay identifiers
+	auto tokens = lexAll("fun funcs If i namespaces Int trues do0 cas "
+			     "casf strung a aaaaaaaaaa",
+			     errors);
+
+	ASSERT_EQ(tokens.size(), 13);
+	for (const auto &token : tokens) {
+		EXPECT_EQ(token.type, TokenType::IDENT) << token.lexeme;
+	}
+	EXPECT_FALSE(errors.hasErrors());
+}
+
 TEST(lexerTest, SingleCharOperatorsAndDelimiters) {
 	ErrorReporter errors;
 	auto tokens =
@@ -153,20 +174,41 @@ TEST(lexerTest, NumberLiterals) {
 	auto tokens = lexAll("42 3.14 0 7.", errors);
 
 	ASSERT_EQ(tokens.size(), 5);
-	EXPECT_EQ(tokens[0].type, TokenType::NUMBER_LIT);
+	EXPECT_EQ(tokens[0].type, TokenType::INT_LIT);
 	EXPECT_EQ(tokens[0].lexeme, "42");
-	EXPECT_EQ(tokens[1].type, TokenType::NUMBER_LIT);
+	EXPECT_EQ(tokens[0].intValue, 42);
+	EXPECT_EQ(tokens[1].type, TokenType::FLOAT_LIT);
 	EXPECT_EQ(tokens[1].lexeme, "3.14");
-	EXPECT_EQ(tokens[2].type, TokenType::NUMBER_LIT);
+	EXPECT_DOUBLE_EQ(tokens[1].floatValue, 3.14);
+	EXPECT_EQ(tokens[2].type, TokenType::INT_LIT);
 	EXPECT_EQ(tokens[2].lexeme, "0");
+	EXPECT_EQ(tokens[2].intValue, 0);
 	// "7." is a number followed by a dot: the '.' only joins the
 	// literal when followed by a digit
-	EXPECT_EQ(tokens[3].type, TokenType::NUMBER_LIT);
+	EXPECT_EQ(tokens[3].type, TokenType::INT_LIT);
 	EXPECT_EQ(tokens[3].lexeme, "7");
 	EXPECT_EQ(tokens[4].type, TokenType::DOT);
 	EXPECT_FALSE(errors.hasErrors());
 }
 
+TEST(lexerTest, NumberLiteralLimits) {
+	ErrorReporter errors;
+	auto tokens = lexAll("9223372036854775807 9223372036854775808 "
+			     "9007199254740993",
+			     errors);
+
+	ASSERT_EQ(tokens.size(), 3);
+	EXPECT_EQ(tokens[0].type, TokenType::INT_LIT);
+	EXPECT_EQ(tokens[0].intValue, INT64_MAX);
+	EXPECT_EQ(tokens[1].type, TokenType::INVALID);
+	EXPECT_EQ(tokens[1].lexeme, "9223372036854775808");
+	// 2^53 + 1 has no exact double
+	EXPECT_EQ(tokens[2].intValue, 9007199254740993);
+	ASSERT_EQ(errors.getErrorCount(), 1);
+	EXPECT_EQ(errors.getErrors()[0].id, DiagID::INT_TOO_LARGE);
+	EXPECT_EQ(errors.getErrors()[0].location.offset, 20);
+}
+
 TEST(lexerTest, StringLiteral) {
 	ErrorReporter errors;
 	auto tokens = lexAll("\"Hello, World!\"", errors);
@@ -184,7 +226,7 @@ TEST(lexerTest, UnterminatedStringLiteral) {
 	ASSERT_EQ(tokens.size(), 1);
 	EXPECT_EQ(tokens[0].type, TokenType::INVALID);
 	ASSERT_TRUE(errors.hasErrors());
-	EXPECT_EQ(errors.getErrors()[0].phase, ErrorPhase::LEXER);
+	EXPECT_EQ(errors.getErrors()[0].phase(), ErrorPhase::LEXER);
 }
 
 TEST(lexerTest, CharLiteral) {
@@ -204,7 +246,7 @@ TEST(lexerTest, MultiCharCharLiteral) {
 	ASSERT_EQ(tokens.size(), 1);
 	EXPECT_EQ(tokens[0].type, TokenType::INVALID);
 	ASSERT_TRUE(errors.hasErrors());
-	EXPECT_EQ(errors.getErrors()[0].phase, ErrorPhase::LEXER);
+	EXPECT_EQ(errors.getErrors()[0].phase(), ErrorPhase::LEXER);
 }
 
 TEST(lexerTest, UnterminatedCharLiteral) {
@@ -214,7 +256,7 @@ TEST(lexerTest, UnterminatedCharLiteral) {
 	ASSERT_EQ(tokens.size(), 1);
 	EXPECT_EQ(tokens[0].type, TokenType::INVALID);
 	ASSERT_TRUE(errors.hasErrors());
-	EXPECT_EQ(errors.getErrors()[0].phase, ErrorPhase::LEXER);
+	EXPECT_EQ(errors.getErrors()[0].phase(), ErrorPhase::LEXER);
 }
 
 TEST(lexerTest, SingleLineComment) {
@@ -224,7 +266,7 @@ TEST(lexerTest, SingleLineComment) {
 	ASSERT_EQ(tokens.size(), 1);
 	EXPECT_EQ(tokens[0].type, TokenType::IDENT);
 	EXPECT_EQ(tokens[0].lexeme, "x");
-	EXPECT_EQ(tokens[0].line, 2);
+	EXPECT_EQ(tokens[0].offset, 13);
 	EXPECT_FALSE(errors.hasErrors());
 }
 
@@ -243,9 +285,9 @@ TEST(lexerTest, CommentBetweenTokens) {
 	auto tokens = lexAll("1 /* mid */ + // trailing\n 2", errors);
 
 	ASSERT_EQ(tokens.size(), 3);
-	EXPECT_EQ(tokens[0].type, TokenType::NUMBER_LIT);
+	EXPECT_EQ(tokens[0].type, TokenType::INT_LIT);
 	EXPECT_EQ(tokens[1].type, TokenType::PLUS);
-	EXPECT_EQ(tokens[2].type, TokenType::NUMBER_LIT);
+	EXPECT_EQ(tokens[2].type, TokenType::INT_LIT);
 	EXPECT_FALSE(errors.hasErrors());
 }
 
@@ -255,20 +297,23 @@ TEST(lexerTest, UnterminatedBlockComment) {
 
 	EXPECT_TRUE(tokens.empty());
 	ASSERT_TRUE(errors.hasErrors());
-	EXPECT_EQ(errors.getErrors()[0].phase, ErrorPhase::LEXER);
+	EXPECT_EQ(errors.getErrors()[0].phase(), ErrorPhase::LEXER);
 }
 
 TEST(lexerTest, LineAndColumnTracking) {
+	const std::string_view src = "ab cd\n  ef";
 	ErrorReporter errors;
-	auto tokens = lexAll("ab cd\n  ef", errors);
+	auto tokens = lexAll(src, errors);
+	LineTable lines(src);
 
 	ASSERT_EQ(tokens.size(), 3);
-	EXPECT_EQ(tokens[0].line, 1);
-	EXPECT_EQ(tokens[0].column, 1);
-	EXPECT_EQ(tokens[1].line, 1);
-	EXPECT_EQ(tokens[1].column, 4);
-	EXPECT_EQ(tokens[2].line, 2);
-	EXPECT_EQ(tokens[2].column, 3);
+	EXPECT_EQ(tokens[0].offset, 0);
+	EXPECT_EQ(tokens[1].offset, 3);
+	EXPECT_EQ(tokens[2].offset, 8);
+	EXPECT_EQ(lines.locate(tokens[1].offset).line, 1);
+	EXPECT_EQ(lines.locate(tokens[1].offset).column, 4);
+	EXPECT_EQ(lines.locate(tokens[2].offset).line, 2);
+	EXPECT_EQ(lines.locate(tokens[2].offset).column, 3);
 }
 
 TEST(lexerTest, UnexpectedCharacter) {
@@ -278,7 +323,7 @@ TEST(lexerTest, UnexpectedCharacter) {
 	ASSERT_EQ(tokens.size(), 1);
 	EXPECT_EQ(tokens[0].type, TokenType::INVALID);
 	ASSERT_TRUE(errors.hasErrors());
-	EXPECT_EQ(errors.getErrors()[0].phase, ErrorPhase::LEXER);
+	EXPECT_EQ(errors.getErrors()[0].phase(), ErrorPhase::LEXER);
 }
 
 TEST(lexerTest, EmptyAndWhitespaceOnlySource) {
@@ -301,3 +346,184 @@ TEST(lexerTest, EofIsSticky) {
 	EXPECT_EQ(lexer.get().type, TokenType::T_EOF);
 	EXPECT_EQ(lexer.get().type, TokenType::T_EOF);
 }
+
+TEST(lexerTest, LexAllMatchesGet) {
+	const std::string_view src = "func f(int a) -> int { return a+1; }"
+				     " // trailing\n var string s = \"x\";";
+	ErrorReporter errors;
+	auto expected = lexAll(src, errors);
+
+	SourceBuffer buffer = SourceBuffer::borrow(src);
+	Lexer lexer(buffer, errors);
+	TokenBuffer tokens = lexer.lexAll();
+
+	ASSERT_EQ(tokens.size(), expected.size() + 1);
+	for (size_t i = 0; i < expected.size(); i++) {
+		EXPECT_EQ(tokens.type(i), expected[i].type) << "token #" << i;
+		EXPECT_EQ(tokens.lexeme(i), expected[i].lexeme);
+		EXPECT_EQ(tokens.offset(i), expected[i].offset);
+	}
+	EXPECT_EQ(tokens.type(expected.size()), TokenType::T_EOF);
+	// literal values are kept on the side and restored by at()
+	EXPECT_EQ(tokens.at(12).intValue, 1);
+	EXPECT_EQ(tokens.at(12).type, TokenType::INT_LIT);
+	EXPECT_FALSE(errors.hasErrors());
+}
+
+TEST(lexerTest, LexAllEofIsSticky) {
+	ErrorReporter errors;
+	Lexer lexer("x", errors);
+	TokenBuffer tokens = lexer.lexAll();
+
+	ASSERT_EQ(tokens.size(), 2);
+	EXPECT_EQ(tokens.type(1), TokenType::T_EOF);
+	EXPECT_EQ(tokens.type(100), TokenType::T_EOF);
+}
+
+TEST(lexerTest, LongIdentifiersAndNumbers) {
+	ErrorReporter errors;
+	auto tokens = lexAll("a_very_long_identifier_name123+"
+			     "12345678901234567890.0987654321 x",
+			     errors);
+
+	ASSERT_EQ(tokens.size(), 4);
+	EXPECT_EQ(tokens[0].type, TokenType::IDENT);
+	EXPECT_EQ(tokens[0].lexeme, "a_very_long_identifier_name123");
+	EXPECT_EQ(tokens[1].type, TokenType::PLUS);
+	EXPECT_EQ(tokens[1].offset, 30);
+	EXPECT_EQ(tokens[2].type, TokenType::FLOAT_LIT);
+	EXPECT_EQ(tokens[2].lexeme, "12345678901234567890.0987654321");
+	EXPECT_EQ(tokens[3].offset, 63);
+	EXPECT_FALSE(errors.hasErrors());
+}
+
+namespace {
+struct LexResult {
+	std::vector<Token> tokens;
+	std::vector<CompilerError> errors;
+};
+
+LexResult lexWith(std::string_view src, LexerBackend backend) {
+	ErrorReporter errors;
+	SourceBuffer buffer = SourceBuffer::borrow(src);
+	Lexer lexer(buffer, errors, backend);
+	LexResult result;
+	while (true) {
+		Token token = lexer.get();
+		result.tokens.push_back(token);
+		if (token.type == TokenType::T_EOF) {
+			break;
+		}
+	}
+	result.errors = errors.getErrors();
+	return result;
+}
+
+// Both backends must agree on every token, location and diagnostic
+void expectBackendsAgree(std::string_view src) {
+	auto scalar = lexWith(src, LexerBackend::SCALAR);
+	auto structural = lexWith(src, LexerBackend::STRUCTURAL);
+
+	ASSERT_EQ(scalar.tokens.size(), structural.tokens.size());
+	for (size_t i = 0; i < scalar.tokens.size(); i++) {
+		const Token &a = scalar.tokens[i];
+		const Token &b = structural.tokens[i];
+		EXPECT_EQ(a.type, b.type) << "token #" << i;
+		EXPECT_EQ(a.lexeme, b.lexeme) << "token #" << i;
+		EXPECT_EQ(a.offset, b.offset) << "token #" << i;
+	}
+	ASSERT_EQ(scalar.errors.size(), structural.errors.size());
+	for (size_t i = 0; i < scalar.errors.size(); i++) {
+		EXPECT_EQ(scalar.errors[i].id, structural.errors[i].id);
+		EXPECT_EQ(scalar.errors[i].args, structural.errors[i].args);
+		EXPECT_EQ(scalar.errors[i].location.offset,
+			  structural.errors[i].location.offset);
+	}
+}
+} // namespace
+
+TEST(lexerTest, StructuralBackendMatchesScalar) {
+	expectBackendsAgree("");
+	expectBackendsAgree("   \t\r\n\v\f  x");
+	expectBackendsAgree("// comment\nx // tail");
+	expectBackendsAgree("/* a ** b *\n*/ y /***/ z");
+	expectBackendsAgree("\"multi\nline\" \"\" \"unterminated");
+	expectBackendsAgree("/* never closed *");
+	expectBackendsAgree(std::string_view("a\0b \"c\0d\"", 9));
+}
+
+TEST(lexerTest, StructuralBackendAcrossBlocks) {
+	// comments, strings and whitespace that straddle 64-byte blocks,
+	// with newlines on both sides of each boundary
+	std::string src;
+	for (int i = 0; i < 40; i++) {
+		src += "func f" + std::to_string(i) + "() -> int {\n";
+		src += std::string(static_cast<size_t>(i * 7 % 70), ' ');
+		src += "/* " + std::string(static_cast<size_t>(i * 13 % 150), '*');
+		src += "\n\n */ return \"";
+		src += std::string(static_cast<size_t>(i * 11 % 90), 'x');
+		src += "\n\" // " + std::string(static_cast<size_t>(i % 66), '/');
+		src += "\n}\n";
+	}
+	expectBackendsAgree(src);
+}
+
+TEST(lexerTest, PeekDoesNotConsume) {
+	ErrorReporter errors;
+	Lexer lexer("a + b;", errors);
+
+	EXPECT_EQ(lexer.peek().type, TokenType::IDENT);
+	EXPECT_EQ(lexer.peek(2).lexeme, "b");
+	EXPECT_EQ(lexer.peek(1).type, TokenType::PLUS);
+	EXPECT_EQ(lexer.get().lexeme, "a");
+	EXPECT_EQ(lexer.peek().type, TokenType::PLUS);
+	EXPECT_EQ(lexer.peek(2).type, TokenType::SEMICOLON);
+	EXPECT_EQ(lexer.get().type, TokenType::PLUS);
+	EXPECT_EQ(lexer.get().lexeme, "b");
+	EXPECT_EQ(lexer.get().type, TokenType::SEMICOLON);
+	EXPECT_EQ(lexer.peek(MAX_PEEK - 1).type, TokenType::T_EOF);
+	EXPECT_EQ(lexer.get().type, TokenType::T_EOF);
+}
+
+TEST(lexerTest, PeekPastTheRingIsFatal) {
+	ErrorReporter errors;
+	std::string src;
+	for (size_t i = 0; i < 2 * MAX_PEEK; i++) {
+		src += "t" + std::to_string(i) + " ";
+	}
+	Lexer lexer(src, errors);
+
+	EXPECT_EQ(lexer.peek(MAX_PEEK - 1).lexeme,
+		  "t" + std::to_string(MAX_PEEK - 1));
+	EXPECT_DEATH((void)lexer.peek(MAX_PEEK), "lookahead past MAX_PEEK");
+	// the tokens already buffered are still returned in order
+	for (size_t i = 0; i < 2 * MAX_PEEK; i++) {
+		EXPECT_EQ(lexer.get().lexeme, "t" + std::to_string(i));
+	}
+	EXPECT_EQ(lexer.get().type, TokenType::T_EOF);
+}
+
+TEST(lexerTest, PeekAndGetInterleavedMatchGet) {
+	// the ring wraps many times over a long input
+	std::string src;
+	for (size_t i = 0; i < 100; i++) {
+		src += "x" + std::to_string(i) + " <<= " + std::to_string(i) +
+		       ";\n";
+	}
+	SourceBuffer buffer = SourceBuffer::borrow(src);
+	ErrorReporter errors;
+	auto expected = lexAll(src, errors);
+
+	Lexer lexer(buffer, errors);
+	for (size_t i = 0; i < expected.size(); i++) {
+		size_t depth = i % MAX_PEEK;
+		if (i + depth < expected.size()) {
+			EXPECT_EQ(lexer.peek(depth).offset,
+				  expected[i + depth].offset);
+		}
+		Token token = lexer.get();
+		EXPECT_EQ(token.offset, expected[i].offset) << "token #" << i;
+		EXPECT_EQ(token.lexeme, expected[i].lexeme) << "token #" << i;
+	}
+	EXPECT_EQ(lexer.get().type, TokenType::T_EOF);
+}
@@ -0,0 +1,74 @@
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "source/line_table.hpp"
+#include "source/source_buffer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace ::frontend;
+
+TEST(lineTableTest, SingleLine) {
+	LineTable lines("abc");
+	EXPECT_EQ(lines.lineCount(), 1);
+	EXPECT_EQ(lines.locate(0).line, 1);
+	EXPECT_EQ(lines.locate(0).column, 1);
+	EXPECT_EQ(lines.locate(2).column, 3);
+	// one past the end is where EOF sits
+	EXPECT_EQ(lines.locate(3).column, 4);
+}
+
+TEST(lineTableTest, Newlines) {
+	LineTable lines("ab\n\ncd\n");
+	EXPECT_EQ(lines.lineCount(), 4);
+
+	// the newline itself belongs to the line it ends
+	EXPECT_EQ(lines.locate(2).line, 1);
+	EXPECT_EQ(lines.locate(2).column, 3);
+	EXPECT_EQ(lines.locate(3).line, 2);
+	EXPECT_EQ(lines.locate(3).column, 1);
+	EXPECT_EQ(lines.locate(5).line, 3);
+	EXPECT_EQ(lines.locate(5).column, 2);
+	EXPECT_EQ(lines.locate(7).line, 4);
+	EXPECT_EQ(lines.locate(7).column, 1);
+}
+
+TEST(lineTableTest, MatchesLinearScanAcrossBlocks) {
+	// uneven line lengths so newlines land on and around block edges
+	std::string text;
+	for (size_t i = 0; i < 200; i++) {
+		text.append(i % 67, 'x');
+		text += '\n';
+	}
+	LineTable lines(text);
+
+	size_t line = 1;
+	size_t column = 1;
+	for (size_t offset = 0; offset <= text.size(); offset++) {
+		LineColumn where = lines.locate(static_cast<uint32_t>(offset));
+		ASSERT_EQ(where.line, line) << "offset " << offset;
+		ASSERT_EQ(where.column, column) << "offset " << offset;
+		if (offset < text.size() && text[offset] == '\n') {
+			line++;
+			column = 1;
+		}
+		else {
+			column++;
+		}
+	}
+}
+
+TEST(lineTableTest, ReporterResolvesOnDemand) {
+	SourceBuffer buffer = SourceBuffer::borrow("x\n  #");
+	ErrorReporter errors;
+	Lexer lexer(buffer, errors);
+	while (lexer.get().type != TokenType::T_EOF) {
+	}
+
+	ASSERT_EQ(errors.getErrors().size(), 1);
+	const CompilerError &err = errors.getErrors()[0];
+	EXPECT_EQ(err.location.offset, 4);
+	EXPECT_EQ(errors.locate(err).line, 2);
+	EXPECT_EQ(errors.locate(err).column, 3);
+}
@@ -0,0 +1,100 @@
+#include "../test_helpers.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/parallel_lexer.hpp"
+#include "lexer/token_buffer.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
+#include "support/thread_pool.hpp"
+#include <atomic>
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace ::frontend;
+
+namespace {
+// Parallel output must match lexAll() token for token and error for error
+void expectMatchesSequential(const std::string &src, size_t chunkSize,
+			     ThreadPool &pool) {
+	SourceManager sources;
+	FileID file = sources.addBuffer("input", SourceBuffer(src));
+
+	ErrorReporter sequentialErrors(sources);
+	Lexer lexer(file, sequentialErrors);
+	TokenBuffer expected = lexer.lexAll();
+
+	ErrorReporter parallelErrors(sources);
+	TokenBuffer actual = lexParallel(file, parallelErrors, pool, chunkSize);
+
+	SCOPED_TRACE("chunk size " + std::to_string(chunkSize));
+	expectSameTokens(actual, expected);
+	expectSameDiagnostics(parallelErrors, sequentialErrors);
+}
+
+// Code with block comments, strings and comment markers inside strings,
+// so chunk boundaries fall in every context
+std::string program(size_t functions) {
+	std::string src;
+	for (size_t i = 0; i < functions; i++) {
+		std::string n = std::to_string(i);
+		src += "/* helper " + n + " with \"quotes\" and // slashes\n"
+		       "   spanning lines */\n"
+		       "func f" + n + "(int a, string s) -> int {\n"
+		       "\tvar string t = \"/* not a comment */ " + n + "\";\n"
+		       "\tvar char c = 'x'; // trailing \"quote\n"
+		       "\treturn a * " + n + ".25 >> 1 <<= 2;\n"
+		       "}\n";
+	}
+	return src;
+}
+} // namespace
+
+TEST(parallelLexerTest, GuessContext) {
+	EXPECT_EQ(guessContext("a + b", 0), ChunkContext::CODE);
+	EXPECT_EQ(guessContext("end of comment */ x", 0),
+		  ChunkContext::BLOCK_COMMENT);
+	EXPECT_EQ(guessContext("/* a */ b", 0), ChunkContext::CODE);
+	EXPECT_EQ(guessContext("tail of string\"; x\n", 0),
+		  ChunkContext::STRING);
+	EXPECT_EQ(guessContext("s = \"x\";\n\"", 0), ChunkContext::CODE);
+}
+
+TEST(parallelLexerTest, MatchesSequentialAtEveryChunkSize) {
+	ThreadPool pool(4);
+	const std::string src = program(3);
+	for (size_t chunkSize = 1; chunkSize <= 96; chunkSize++) {
+		expectMatchesSequential(src, chunkSize, pool);
+	}
+}
+
+TEST(parallelLexerTest, MatchesSequentialOnLargeInput) {
+	ThreadPool pool(4);
+	const std::string src = program(2000);
+	expectMatchesSequential(src, 4096, pool);
+	expectMatchesSequential(src, 1 << 16, pool);
+}
+
+TEST(parallelLexerTest, UnterminatedAndEmptyInput) {
+	ThreadPool pool(3);
+	for (size_t chunkSize : {1, 3, 8}) {
+		for (const char *src :
+		     {"", "a /* open to the end", "x = \"never closed; y",
+		      "'ab' # 'c", "*/ \" */ \""}) {
+			expectMatchesSequential(src, chunkSize, pool);
+		}
+	}
+}
+
+TEST(threadPoolTest, RunsEveryIndexOnce) {
+	ThreadPool pool(4);
+	EXPECT_EQ(pool.size(), 4);
+	for (size_t round = 0; round < 20; round++) {
+		std::vector<std::atomic<int>> hits(round * 7);
+		pool.forEach(hits.size(), [&](size_t i) { hits[i]++; });
+		for (const auto &hit : hits) {
+			EXPECT_EQ(hit.load(), 1);
+		}
+	}
+}
@@ -0,0 +1,224 @@
+#include "../test_helpers.hpp"
+#include "ast/ast.hpp"
+#include "ast/decl.hpp"
+#include "ast/stmt.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/token_buffer.hpp"
+#include "parser/builder.hpp"
+#include "parser/parallel_parser.hpp"
+#include "parser/parser.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
+#include "support/arena.hpp"
+#include "support/thread_pool.hpp"
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace ::frontend;
+using namespace ::frontend::ast;
+
+namespace {
+// Shape of a declaration, enough to tell two parses apart
+std::string describe(const DeclAST *decl) {
+	switch (decl->getKind()) {
+	case NodeKind::FUNCTION: {
+		const auto *func = cast<FunctionAST>(decl);
+		return "func " + func->getProto()->getName() + " " +
+		       std::to_string(func->getBody()->getStmts().size());
+	}
+	case NodeKind::STRUCT: {
+		const auto *record = cast<StructAST>(decl);
+		return "struct " + record->getName() + " " +
+		       std::to_string(record->getFields().size());
+	}
+	case NodeKind::NAMESPACE: {
+		const auto *ns = cast<NamespaceAST>(decl);
+		std::string result = "namespace " + ns->getName() + " {";
+		for (const auto &inner : ns->getDeclarations()) {
+			result += " " + describe(inner.get()) + ";";
+		}
+		return result + " }";
+	}
+	default:
+		return "?";
+	}
+}
+
+std::vector<std::string> describe(const ProgramAST *program) {
+	std::vector<std::string> result;
+	for (const auto &decl : program->getDeclarations()) {
+		result.push_back(describe(decl.get()));
+	}
+	return result;
+}
+
+// parseParallel() must build the tree and raise the diagnostics that
+// parseProgram() does, whatever the number of runs
+void expectMatchesSequential(const std::string &src, ThreadPool &pool,
+			     size_t arenaCount,
+			     ErrorRecovery recovery = ErrorRecovery::STOP) {
+	SourceManager sources;
+	FileID file = sources.addBuffer("input", SourceBuffer(src));
+	ErrorReporter lexErrors(sources);
+	TokenBuffer tokens = Lexer(file, lexErrors).lexAll();
+
+	types::TypeContext types;
+	ErrorReporter sequentialErrors(sources);
+	Parser parser(tokens, sequentialErrors, types);
+	parser.setRecovery(recovery);
+	auto expected = parser.parseProgram();
+
+	std::vector<Arena> arenas(arenaCount);
+	ErrorReporter parallelErrors(sources);
+	auto actual = parseParallel(tokens, parallelErrors, types, pool,
+				    arenas, recovery);
+
+	SCOPED_TRACE(std::to_string(arenaCount) + " arenas");
+	ASSERT_EQ(actual == nullptr, expected == nullptr);
+	if (expected != nullptr) {
+		EXPECT_EQ(describe(actual.get()), describe(expected.get()));
+	}
+
+	expectSameDiagnostics(parallelErrors, sequentialErrors);
+}
+
+// With the NullBuilder the runs must say what a SyntaxChecker says
+void expectChecksLikeSequential(const std::string &src, ThreadPool &pool,
+				ErrorRecovery recovery) {
+	SourceManager sources;
+	FileID file = sources.addBuffer("input", SourceBuffer(src));
+	ErrorReporter lexErrors(sources);
+	TokenBuffer tokens = Lexer(file, lexErrors).lexAll();
+
+	ErrorReporter sequentialErrors(sources);
+	SyntaxChecker checker(tokens, sequentialErrors);
+	checker.setRecovery(recovery);
+	bool expected = static_cast<bool>(checker.parseProgram());
+
+	std::vector<NullBuilder> checkers(pool.size());
+	ErrorReporter parallelErrors(sources);
+	bool actual = static_cast<bool>(parseParallel<NullBuilder>(
+	    tokens, parallelErrors, pool, checkers, recovery));
+
+	EXPECT_EQ(actual, expected);
+	expectSameDiagnostics(parallelErrors, sequentialErrors);
+}
+
+std::string program(size_t functions) {
+	std::string src;
+	for (size_t i = 0; i < functions; i++) {
+		std::string n = std::to_string(i);
+		src += "func f" + n + "(int a) -> int {\n"
+		       "\tvar int b = a * " + n + ";\n"
+		       "\tif (b > 10) { return b; } else { b = 0; }\n"
+		       "\treturn f" + n + "(b - 1);\n"
+		       "}\n";
+		if (i % 7 == 0) {
+			src += "struct S" + n + " { var int x; var int y; }\n";
+		}
+		if (i % 11 == 0) {
+			src += "namespace n" + n + " {\n"
+			       "\tfunc g() -> int { return 1; }\n"
+			       "\tstruct T { var int z; }\n"
+			       "}\n";
+		}
+	}
+	return src;
+}
+} // namespace
+
+TEST(parallelParserTest, SplitsAtTopLevelDeclarations) {
+	ErrorReporter errors;
+	std::string src = "func a() -> int { if (x) { return 1; } }\n"
+			  "struct S { var int x; }\n"
+			  "namespace n { func b() -> int { return 2; } }\n";
+	TokenBuffer tokens = Lexer(src, errors).lexAll();
+	std::vector<size_t> starts = topLevelDecls(tokens);
+	ASSERT_EQ(starts.size(), 3);
+	EXPECT_EQ(starts[0], 0);
+	EXPECT_EQ(tokens.type(starts[1]), TokenType::STRUCT);
+	EXPECT_EQ(tokens.type(starts[2]), TokenType::NAMESPACE);
+}
+
+TEST(parallelParserTest, MatchesSequentialParse) {
+	const std::string src = program(300);
+	for (size_t threads : {1, 2, 4}) {
+		ThreadPool pool(threads);
+		for (size_t arenas : {0, 1, 3, 8}) {
+			expectMatchesSequential(src, pool, arenas);
+		}
+	}
+
+	ErrorReporter errors;
+	types::TypeContext types;
+	TokenBuffer tokens = Lexer(src, errors).lexAll();
+	ThreadPool pool(4);
+	auto parsed = parseParallel(tokens, errors, types, pool);
+	ASSERT_NE(parsed, nullptr);
+	// 300 functions, 43 structs and 28 namespaces
+	EXPECT_EQ(parsed->getDeclarations().size(), 371);
+	EXPECT_FALSE(errors.hasErrors());
+}
+
+TEST(parallelParserTest, MalformedInputGetsSequentialErrors) {
+	ThreadPool pool(4);
+	const std::string good = program(40);
+	for (const std::string &bad :
+	     {std::string("func broken( -> int { return 1; }\n"),
+	      std::string("}\n"), std::string("var int stray;\n"),
+	      std::string("func open() -> int { return 1;\n"),
+	      std::string("struct { var int x; }\n")}) {
+		SCOPED_TRACE(bad);
+		expectMatchesSequential(bad + good, pool, 0);
+		expectMatchesSequential(good + bad + good, pool, 4);
+		expectMatchesSequential(good + bad, pool, 2);
+	}
+}
+
+TEST(parallelParserTest, RecoveryMatchesSequentialRecovery) {
+	ThreadPool pool(4);
+	const std::string good = program(40);
+	for (const std::string &bad :
+	     {std::string("func broken( -> int { return 1; }\n"),
+	      std::string("}\n"), std::string("var int stray;\n"),
+	      std::string("func f() -> int { return 1 }\n"),
+	      std::string("func open() -> int { return 1;\n"),
+	      std::string("struct { var int x; }\n")}) {
+		SCOPED_TRACE(bad);
+		for (size_t arenas : {0, 4}) {
+			expectMatchesSequential(bad + good, pool, arenas,
+						ErrorRecovery::SYNCHRONIZE);
+			expectMatchesSequential(good + bad + good + bad + good,
+						pool, arenas,
+						ErrorRecovery::SYNCHRONIZE);
+			expectMatchesSequential(good + bad, pool, arenas,
+						ErrorRecovery::SYNCHRONIZE);
+		}
+	}
+}
+
+TEST(parallelParserTest, EmptyInput) {
+	ThreadPool pool(2);
+	expectMatchesSequential("", pool, 0);
+	expectMatchesSequential("// only a comment\n", pool, 2);
+}
+
+TEST(parallelParserTest, NullBuilderChecksLikeSyntaxChecker) {
+	ThreadPool pool(4);
+	const std::string good = program(40);
+	expectChecksLikeSequential(good, pool, ErrorRecovery::STOP);
+	for (const std::string &bad :
+	     {std::string("func broken( -> int { return 1; }\n"),
+	      std::string("}\n"), std::string("var int stray;\n"),
+	      std::string("func open() -> int { return 1;\n")}) {
+		SCOPED_TRACE(bad);
+		for (ErrorRecovery recovery :
+		     {ErrorRecovery::STOP, ErrorRecovery::SYNCHRONIZE}) {
+			expectChecksLikeSequential(good + bad + good, pool,
+						   recovery);
+		}
+	}
+}
@@ -2,9 +2,12 @@
 #include "ast/ast.hpp"
 #include "ast/decl.hpp"
 #include "ast/expr.hpp"
+#include "ast/stmt.hpp"
 #include "diagnostics/diagnostics.hpp"
 #include "lexer/lexer.hpp"
+#include "lexer/token_buffer.hpp"
 #include "parser/parser.hpp"
+#include "support/arena.hpp"
 #include "types/type.hpp"
 #include "gtest/gtest.h"
 #include <memory>
@@ -16,16 +19,18 @@ using namespace frontend::types;
 
 namespace {
 std::unique_ptr<DeclAST> parseVarDecl(const std::string &src,
-				      ErrorReporter &errors) {
+				      ErrorReporter &errors,
+				      TypeContext &types) {
 	Lexer lexer(src, errors);
-	Parser parser(lexer, errors);
+	Parser parser(lexer, errors, types);
 	return parser.parseVarDecl();
 }
 
 // Parse a declaration expected to succeed and return it downcast.
 std::unique_ptr<VariableDeclarationAST> expectVarDecl(const std::string &src,
-						      ErrorReporter &errors) {
-	auto decl = parseVarDecl(src, errors);
+						      ErrorReporter &errors,
+						      TypeContext &types) {
+	auto decl = parseVarDecl(src, errors, types);
 	// parseVarDecl only ever produces VariableDeclarationAST or null,
 	// so the failed-cast leak case cannot occur.
 	return std::unique_ptr<VariableDeclarationAST>(
@@ -35,7 +40,8 @@ std::unique_ptr<VariableDeclarationAST> expectVarDecl(const std::string &src,
 // Parse a declaration expected to fail: null result plus an error.
 void expectParseError(const std::string &src) {
 	ErrorReporter errors;
-	auto decl = parseVarDecl(src, errors);
+	TypeContext types;
+	auto decl = parseVarDecl(src, errors, types);
 	EXPECT_EQ(decl, nullptr) << src;
 	EXPECT_TRUE(errors.hasErrors()) << src;
 }
@@ -43,7 +49,8 @@ void expectParseError(const std::string &src) {
 
 TEST(ParserVarDecl, PlainDeclaration) {
 	ErrorReporter errors;
-	auto decl = expectVarDecl("var int x;", errors);
+	TypeContext types;
+	auto decl = expectVarDecl("var int x;", errors, types);
 
 	ASSERT_NE(decl, nullptr);
 	EXPECT_FALSE(errors.hasErrors());
@@ -56,7 +63,8 @@ TEST(ParserVarDecl, PlainDeclaration) {
 
 TEST(ParserVarDecl, LiteralInitializer) {
 	ErrorReporter errors;
-	auto decl = expectVarDecl("var int x = 42;", errors);
+	TypeContext types;
+	auto decl = expectVarDecl("var int x = 42;", errors, types);
 
 	ASSERT_NE(decl, nullptr);
 	EXPECT_FALSE(errors.hasErrors());
@@ -70,7 +78,8 @@ TEST(ParserVarDecl, LiteralInitializer) {
 
 TEST(ParserVarDecl, ExpressionInitializer) {
 	ErrorReporter errors;
-	auto decl = expectVarDecl("var int x = length + 1;", errors);
+	TypeContext types;
+	auto decl = expectVarDecl("var int x = length + 1;", errors, types);
 
 	ASSERT_NE(decl, nullptr);
 	EXPECT_FALSE(errors.hasErrors());
@@ -84,7 +93,8 @@ TEST(ParserVarDecl, ExpressionInitializer) {
 
 TEST(ParserVarDecl, ArrayLiteralSize) {
 	ErrorReporter errors;
-	auto decl = expectVarDecl("var int arr[10];", errors);
+	TypeContext types;
+	auto decl = expectVarDecl("var int arr[10];", errors, types);
 
 	ASSERT_NE(decl, nullptr);
 	EXPECT_FALSE(errors.hasErrors());
@@ -99,7 +109,8 @@ TEST(ParserVarDecl, ArrayLiteralSize) {
 
 TEST(ParserVarDecl, ArrayExpressionSize) {
 	ErrorReporter errors;
-	auto decl = expectVarDecl("var int arr[length + 1];", errors);
+	TypeContext types;
+	auto decl = expectVarDecl("var int arr[length + 1];", errors, types);
 
 	ASSERT_NE(decl, nullptr);
 	EXPECT_FALSE(errors.hasErrors());
@@ -113,7 +124,8 @@ TEST(ParserVarDecl, ArrayExpressionSize) {
 
 TEST(ParserVarDecl, ConstQualifiedType) {
 	ErrorReporter errors;
-	auto decl = expectVarDecl("var const int x = 1;", errors);
+	TypeContext types;
+	auto decl = expectVarDecl("var const int x = 1;", errors, types);
 
 	ASSERT_NE(decl, nullptr);
 	EXPECT_FALSE(errors.hasErrors());
@@ -143,8 +155,9 @@ TEST(ParserVarDecl, MissingSemicolonAfterArray) {
 
 TEST(ParserProto, UnqualifiedName) {
 	ErrorReporter errors;
+	TypeContext types;
 	Lexer lexer("func add(int x, int y) -> int", errors);
-	Parser parser(lexer, errors);
+	Parser parser(lexer, errors, types);
 
 	auto proto = parser.parseProto();
 	ASSERT_NE(proto, nullptr);
@@ -155,8 +168,9 @@ TEST(ParserProto, UnqualifiedName) {
 
 TEST(ParserProto, QualifiedName) {
 	ErrorReporter errors;
+	TypeContext types;
 	Lexer lexer("func math::vec::dot(int x, int y) -> int", errors);
-	Parser parser(lexer, errors);
+	Parser parser(lexer, errors, types);
 
 	auto proto = parser.parseProto();
 	ASSERT_NE(proto, nullptr);
@@ -172,8 +186,9 @@ TEST(ParserProto, QualifiedName) {
 
 TEST(ParserProto, QualifiedNameMissingIdentifier) {
 	ErrorReporter errors;
+	TypeContext types;
 	Lexer lexer("func math::(int x) -> int", errors);
-	Parser parser(lexer, errors);
+	Parser parser(lexer, errors, types);
 
 	auto proto = parser.parseProto();
 	EXPECT_EQ(proto, nullptr);
@@ -182,20 +197,22 @@ TEST(ParserProto, QualifiedNameMissingIdentifier) {
 
 namespace {
 std::unique_ptr<ProgramAST> parseProgram(const std::string &src,
-					 ErrorReporter &errors) {
+					 ErrorReporter &errors,
+					 TypeContext &types) {
 	Lexer lexer(src, errors);
-	Parser parser(lexer, errors);
+	Parser parser(lexer, errors, types);
 	return parser.parseProgram();
 }
 } // namespace
 
 TEST(ParserNamespace, HoldsDeclarations) {
 	ErrorReporter errors;
+	TypeContext types;
 	auto program = parseProgram("namespace math {"
 				    "  func add(int x, int y) -> int { return x; }"
 				    "  func sub(int x, int y) -> int { return x; }"
 				    "}",
-				    errors);
+				    errors, types);
 
 	ASSERT_NE(program, nullptr);
 	EXPECT_FALSE(errors.hasErrors());
@@ -213,7 +230,9 @@ TEST(ParserNamespace, HoldsDeclarations) {
 
 TEST(ParserNamespace, Nested) {
 	ErrorReporter errors;
-	auto program = parseProgram("namespace outer { namespace inner {} }", errors);
+	TypeContext types;
+	auto program = parseProgram("namespace outer { namespace inner {} }",
+				    errors, types);
 
 	ASSERT_NE(program, nullptr);
 	EXPECT_FALSE(errors.hasErrors());
@@ -232,7 +251,8 @@ TEST(ParserNamespace, Nested) {
 
 TEST(ParserNamespace, MissingClosingBrace) {
 	ErrorReporter errors;
-	auto program = parseProgram("namespace math {", errors);
+	TypeContext types;
+	auto program = parseProgram("namespace math {", errors, types);
 
 	EXPECT_EQ(program, nullptr);
 	EXPECT_TRUE(errors.hasErrors());
@@ -240,7 +260,8 @@ TEST(ParserNamespace, MissingClosingBrace) {
 
 TEST(ParserProgram, StrayClosingBrace) {
 	ErrorReporter errors;
-	auto program = parseProgram("}", errors);
+	TypeContext types;
+	auto program = parseProgram("}", errors, types);
 
 	EXPECT_EQ(program, nullptr);
 	EXPECT_TRUE(errors.hasErrors());
@@ -248,12 +269,13 @@ TEST(ParserProgram, StrayClosingBrace) {
 
 TEST(ParserStruct, FieldsAndMethods) {
 	ErrorReporter errors;
+	TypeContext types;
 	auto program = parseProgram("struct Point {"
 				    "  var int x;"
 				    "  var int y;"
 				    "  func length() -> int { return x; }"
 				    "}",
-				    errors);
+				    errors, types);
 
 	ASSERT_NE(program, nullptr);
 	EXPECT_FALSE(errors.hasErrors());
@@ -271,7 +293,8 @@ TEST(ParserStruct, FieldsAndMethods) {
 
 TEST(ParserStruct, Empty) {
 	ErrorReporter errors;
-	auto program = parseProgram("struct Empty {}", errors);
+	TypeContext types;
+	auto program = parseProgram("struct Empty {}", errors, types);
 
 	ASSERT_NE(program, nullptr);
 	EXPECT_FALSE(errors.hasErrors());
@@ -284,7 +307,8 @@ TEST(ParserStruct, Empty) {
 
 TEST(ParserStruct, MissingName) {
 	ErrorReporter errors;
-	auto program = parseProgram("struct {}", errors);
+	TypeContext types;
+	auto program = parseProgram("struct {}", errors, types);
 
 	EXPECT_EQ(program, nullptr);
 	EXPECT_TRUE(errors.hasErrors());
@@ -292,7 +316,8 @@ TEST(ParserStruct, MissingName) {
 
 TEST(ParserStruct, MissingOpeningBrace) {
 	ErrorReporter errors;
-	auto program = parseProgram("struct Point var int x; }", errors);
+	TypeContext types;
+	auto program = parseProgram("struct Point var int x; }", errors, types);
 
 	EXPECT_EQ(program, nullptr);
 	EXPECT_TRUE(errors.hasErrors());
@@ -300,7 +325,8 @@ TEST(ParserStruct, MissingOpeningBrace) {
 
 TEST(ParserStruct, MissingClosingBrace) {
 	ErrorReporter errors;
-	auto program = parseProgram("struct Point { var int x;", errors);
+	TypeContext types;
+	auto program = parseProgram("struct Point { var int x;", errors, types);
 
 	EXPECT_EQ(program, nullptr);
 	EXPECT_TRUE(errors.hasErrors());
@@ -308,8 +334,105 @@ TEST(ParserStruct, MissingClosingBrace) {
 
 TEST(ParserStruct, InvalidFieldPropagatesFailure) {
 	ErrorReporter errors;
-	auto program = parseProgram("struct Point { var int; }", errors);
+	TypeContext types;
+	auto program = parseProgram("struct Point { var int; }", errors, types);
 
 	EXPECT_EQ(program, nullptr);
 	EXPECT_TRUE(errors.hasErrors());
 }
+
+TEST(ParserFunc, LazyBodiesParseOnDemand) {
+	ErrorReporter errors;
+	TypeContext types;
+	TokenBuffer tokens =
+	    Lexer("func f(int a) -> int { var int b = a; if (b) { b = 1; } "
+		  "return b; }"
+		  "namespace n { func g() -> int { return 1; } }",
+		  errors)
+		.lexAll();
+	Parser parser(tokens, errors, types, BodyParsing::LAZY);
+	auto program = parser.parseProgram();
+
+	ASSERT_NE(program, nullptr);
+	EXPECT_FALSE(errors.hasErrors());
+	ASSERT_EQ(program->getDeclarations().size(), 2);
+
+	auto *f = expectNode<FunctionAST>(program->getDeclarations()[0].get());
+	ASSERT_NE(f, nullptr);
+	EXPECT_EQ(f->getProto()->getName(), "f");
+	EXPECT_FALSE(f->isBodyParsed());
+	ASSERT_NE(f->getBody(), nullptr);
+	EXPECT_TRUE(f->isBodyParsed());
+	EXPECT_EQ(f->getBody()->getStmts().size(), 3);
+
+	auto *n = expectNode<NamespaceAST>(program->getDeclarations()[1].get());
+	ASSERT_NE(n, nullptr);
+	auto *g = expectNode<FunctionAST>(n->getDeclarations()[0].get());
+	ASSERT_NE(g, nullptr);
+	EXPECT_FALSE(g->isBodyParsed());
+	ASSERT_NE(g->getBody(), nullptr);
+	EXPECT_EQ(g->getBody()->getStmts().size(), 1);
+}
+
+TEST(ParserFunc, LazyBodiesParseFromAnArena) {
+	ErrorReporter errors;
+	TypeContext types;
+	Arena arena;
+	TokenBuffer tokens =
+	    Lexer("func f() -> int { return 1; }"
+		  "func g() -> int { var int x = 2; return x; }",
+		  errors)
+		.lexAll();
+	Parser parser(tokens, errors, {types, &arena}, BodyParsing::LAZY);
+	auto program = parser.parseProgram();
+
+	ASSERT_NE(program, nullptr);
+	ASSERT_EQ(program->getDeclarations().size(), 2);
+	auto *f = expectNode<FunctionAST>(program->getDeclarations()[0].get());
+	auto *g = expectNode<FunctionAST>(program->getDeclarations()[1].get());
+	ASSERT_NE(f, nullptr);
+	ASSERT_NE(g, nullptr);
+	EXPECT_FALSE(f->isBodyParsed());
+	EXPECT_FALSE(g->isBodyParsed());
+	// the bodies are parsed in either order from the one context
+	ASSERT_NE(g->getBody(), nullptr);
+	EXPECT_EQ(g->getBody()->getStmts().size(), 2);
+	ASSERT_NE(f->getBody(), nullptr);
+	EXPECT_EQ(f->getBody()->getStmts().size(), 1);
+	EXPECT_FALSE(errors.hasErrors());
+}
+
+TEST(ParserFunc, LazyBodyErrorsAreReportedWhenParsed) {
+	ErrorReporter errors;
+	TypeContext types;
+	TokenBuffer tokens =
+	    Lexer("func f() -> int { var int = 1; }", errors).lexAll();
+	Parser parser(tokens, errors, types, BodyParsing::LAZY);
+	auto program = parser.parseProgram();
+
+	ASSERT_NE(program, nullptr);
+	EXPECT_FALSE(errors.hasErrors());
+	auto *f = expectNode<FunctionAST>(program->getDeclarations()[0].get());
+	ASSERT_NE(f, nullptr);
+	EXPECT_EQ(f->getBody(), nullptr);
+	EXPECT_TRUE(errors.hasErrors());
+}
+
+TEST(ParserFunc, UnbalancedLazyBodyIsParsedEagerly) {
+	ErrorReporter eagerErrors;
+	TypeContext types;
+	auto eager =
+	    parseProgram("func f() -> int { return 1;", eagerErrors, types);
+
+	ErrorReporter errors;
+	TokenBuffer tokens =
+	    Lexer("func f() -> int { return 1;", errors).lexAll();
+	Parser parser(tokens, errors, types, BodyParsing::LAZY);
+	auto program = parser.parseProgram();
+
+	EXPECT_EQ(eager, nullptr);
+	EXPECT_EQ(program, nullptr);
+	ASSERT_EQ(errors.getErrors().size(), eagerErrors.getErrors().size());
+	EXPECT_EQ(errors.message(errors.getErrors()[0]),
+		  eagerErrors.message(eagerErrors.getErrors()[0]));
+}
@@ -21,23 +21,24 @@ namespace {
 // Note: expressions need a terminator like ';' after them because the
 // postfix follow-set does not include EOF.
 std::unique_ptr<ExprAST> parseExpr(const std::string &src,
-				   ErrorReporter &errors) {
+				   ErrorReporter &errors, TypeContext &types) {
 	Lexer lexer(src, errors);
-	Parser parser(lexer, errors);
+	Parser parser(lexer, errors, types);
 	return parser.parseExpression();
 }
 
-std::unique_ptr<types::Type> parseType(const std::string &src,
-				       ErrorReporter &errors) {
+const types::Type *parseType(const std::string &src,
+			     ErrorReporter &errors, TypeContext &types) {
 	Lexer lexer(src, errors);
-	Parser parser(lexer, errors);
+	Parser parser(lexer, errors, types);
 	return parser.parseType();
 }
 
 // Parse "<lhs> <op> <rhs>;" and check the resulting binary node
 void expectBinaryOp(const std::string &src, BinaryOp expected_op) {
 	ErrorReporter errors;
-	auto expr = parseExpr(src, errors);
+	TypeContext types;
+	auto expr = parseExpr(src, errors, types);
 
 	auto *binary = expectNode<BinaryExprAST>(expr.get());
 	ASSERT_NE(binary, nullptr) << src;
@@ -50,7 +51,8 @@ void expectBinaryOp(const std::string &src, BinaryOp expected_op) {
 // Parse "<op><operand>;" and check the resulting unary node
 void expectUnaryOp(const std::string &src, UnaryOp expected_op) {
 	ErrorReporter errors;
-	auto expr = parseExpr(src, errors);
+	TypeContext types;
+	auto expr = parseExpr(src, errors, types);
 
 	auto *unary = expectNode<UnaryExprAST>(expr.get());
 	ASSERT_NE(unary, nullptr) << src;
@@ -58,14 +60,32 @@ void expectUnaryOp(const std::string &src, UnaryOp expected_op) {
 	EXPECT_NE(unary->getOperand(), nullptr) << src;
 	EXPECT_FALSE(errors.hasErrors()) << src;
 }
+
+// Fully parenthesized form of a tree of binary operators over variables
+std::string parenthesize(const ExprAST *expr) {
+	static constexpr const char *SPELLING[] = {
+	    "+", "-",  "*",  "/", "%", "==", "!=", "<", ">",
+	    "<=", ">=", "&&", "||", "&", "|",  "^",  "<<", ">>"};
+	if (const auto *var = dyn_cast<VariableExprAST>(expr)) {
+		return var->getName();
+	}
+	const auto *binary = dyn_cast<BinaryExprAST>(expr);
+	if (binary == nullptr) {
+		return "?";
+	}
+	return "(" + parenthesize(binary->getLhs()) + " " +
+	       SPELLING[static_cast<size_t>(binary->getOperator())] + " " +
+	       parenthesize(binary->getRhs()) + ")";
+}
 } // namespace
 
 TEST(ParserExpr, ParseLiteral) {
 	{
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer("2", errors);
 
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 
 		// get std::unique_ptr<ExprAST>
 		auto expr_ast = parser.parseLiteral();
@@ -76,12 +96,41 @@ TEST(ParserExpr, ParseLiteral) {
 
 		double val = literal_ast->getValue();
 		ASSERT_EQ(val, 2.0);
+		EXPECT_TRUE(literal_ast->isInteger());
 	}
 	{
+		// integers stay exact beyond 2^53
 		ErrorReporter errors;
+		TypeContext types;
+		Lexer lexer("9007199254740993", errors);
+		Parser parser(lexer, errors, types);
+		auto expr_ast = parser.parseLiteral();
+
+		auto literal_ast =
+		    expectNode<ast::NumberLiteralAST>(expr_ast.get());
+		ASSERT_NE(literal_ast, nullptr);
+		ASSERT_TRUE(literal_ast->isInteger());
+		EXPECT_EQ(literal_ast->getIntValue(), 9007199254740993);
+	}
+	{
+		ErrorReporter errors;
+		TypeContext types;
+		Lexer lexer("2.5", errors);
+		Parser parser(lexer, errors, types);
+		auto expr_ast = parser.parseLiteral();
+
+		auto literal_ast =
+		    expectNode<ast::NumberLiteralAST>(expr_ast.get());
+		ASSERT_NE(literal_ast, nullptr);
+		ASSERT_FALSE(literal_ast->isInteger());
+		EXPECT_DOUBLE_EQ(literal_ast->getFloatValue(), 2.5);
+	}
+	{
+		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer("'a'", errors);
 
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 
 		// get std::unique_ptr<ExprAST>
 		auto expr_ast = parser.parseLiteral();
@@ -95,9 +144,10 @@ TEST(ParserExpr, ParseLiteral) {
 	}
 	{
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer("\"Hello, World!\"", errors);
 
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 
 		// get std::unique_ptr<ExprAST>
 		auto expr_ast = parser.parseLiteral();
@@ -111,9 +161,10 @@ TEST(ParserExpr, ParseLiteral) {
 	}
 	{
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer("true", errors);
 
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 
 		// get std::unique_ptr<ExprAST>
 		auto expr_ast = parser.parseLiteral();
@@ -127,9 +178,10 @@ TEST(ParserExpr, ParseLiteral) {
 	}
 	{
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer("false", errors);
 
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 
 		// get std::unique_ptr<ExprAST>
 		auto expr_ast = parser.parseLiteral();
@@ -148,8 +200,9 @@ TEST(ParserExpr, ParserPrimitiveType) {
 	    "int", "float", "double", "bool", "char", "string", "void"};
 	for (const auto &name : primitives) {
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer(name, errors);
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 
 		auto prim_type = parser.parsePrimitiveType();
 		ASSERT_NE(prim_type, nullptr) << name;
@@ -160,8 +213,9 @@ TEST(ParserExpr, ParserPrimitiveType) {
 
 TEST(ParserExpr, ParserPrimitiveTypeError) {
 	ErrorReporter errors;
+	TypeContext types;
 	Lexer lexer("foo", errors);
-	Parser parser(lexer, errors);
+	Parser parser(lexer, errors, types);
 
 	auto prim_type = parser.parsePrimitiveType();
 	ASSERT_EQ(prim_type, nullptr);
@@ -170,9 +224,10 @@ TEST(ParserExpr, ParserPrimitiveTypeError) {
 
 TEST(ParserExpr, ParseTypeConst) {
 	ErrorReporter errors;
-	auto type = parseType("const int", errors);
+	TypeContext types;
+	auto type = parseType("const int", errors, types);
 
-	auto *const_type = expectNode<types::ConstType>(type.get());
+	auto *const_type = expectNode<types::ConstType>(type);
 	ASSERT_NE(const_type, nullptr);
 	EXPECT_EQ(const_type->toString(), "const int");
 	EXPECT_FALSE(errors.hasErrors());
@@ -180,9 +235,10 @@ TEST(ParserExpr, ParseTypeConst) {
 
 TEST(ParserExpr, ParseTypeStatic) {
 	ErrorReporter errors;
-	auto type = parseType("static bool", errors);
+	TypeContext types;
+	auto type = parseType("static bool", errors, types);
 
-	auto *static_type = expectNode<types::StaticType>(type.get());
+	auto *static_type = expectNode<types::StaticType>(type);
 	ASSERT_NE(static_type, nullptr);
 	EXPECT_EQ(static_type->toString(), "static bool");
 	EXPECT_FALSE(errors.hasErrors());
@@ -190,7 +246,8 @@ TEST(ParserExpr, ParseTypeStatic) {
 
 TEST(ParserExpr, ParseTypeStaticConst) {
 	ErrorReporter errors;
-	auto type = parseType("static const double", errors);
+	TypeContext types;
+	auto type = parseType("static const double", errors, types);
 
 	ASSERT_NE(type, nullptr);
 	EXPECT_EQ(type->toString(), "static const double");
@@ -199,17 +256,20 @@ TEST(ParserExpr, ParseTypeStaticConst) {
 
 TEST(ParserExpr, ParseTypeStruct) {
 	ErrorReporter errors;
-	auto type = parseType("struct Point", errors);
+	TypeContext types;
+	auto type = parseType("struct Point", errors, types);
 
-	auto *struct_type = expectNode<types::StructType>(type.get());
+	auto *struct_type = expectNode<types::StructType>(type);
 	ASSERT_NE(struct_type, nullptr);
 	EXPECT_EQ(struct_type->getName(), "Point");
 	EXPECT_FALSE(errors.hasErrors());
+	EXPECT_EQ(parseType("struct Point", errors, types), type);
 }
 
 TEST(ParserExpr, ParseTypeStructMissingName) {
 	ErrorReporter errors;
-	auto type = parseType("struct ;", errors);
+	TypeContext types;
+	auto type = parseType("struct ;", errors, types);
 
 	ASSERT_EQ(type, nullptr);
 	ASSERT_TRUE(errors.hasErrors());
@@ -217,7 +277,8 @@ TEST(ParserExpr, ParseTypeStructMissingName) {
 
 TEST(ParserExpr, ParseTypeConstMissingInner) {
 	ErrorReporter errors;
-	auto type = parseType("const ;", errors);
+	TypeContext types;
+	auto type = parseType("const ;", errors, types);
 
 	ASSERT_EQ(type, nullptr);
 	ASSERT_TRUE(errors.hasErrors());
@@ -227,16 +288,18 @@ TEST(ParserExpr, UnaryOperatorPredicate) {
 	std::vector<std::string> unary_ops = {"&", "*", "+", "-", "~", "!"};
 	for (const auto &op : unary_ops) {
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer(op, errors);
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 		EXPECT_TRUE(parser.unaryOperator()) << op;
 	}
 
 	std::vector<std::string> not_unary = {"x", "1", "/", "=="};
 	for (const auto &op : not_unary) {
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer(op, errors);
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 		EXPECT_FALSE(parser.unaryOperator()) << op;
 	}
 }
@@ -246,16 +309,18 @@ TEST(ParserExpr, AssignmentOperatorPredicate) {
 	    "*=", "/=", "%=", "+=", "-=", "<<=", ">>=", "&=", "^=", "|="};
 	for (const auto &op : assign_ops) {
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer(op, errors);
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 		EXPECT_TRUE(parser.assignmentOperator()) << op;
 	}
 
 	std::vector<std::string> not_assign = {"+", "<", "x"};
 	for (const auto &op : not_assign) {
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer(op, errors);
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 		EXPECT_FALSE(parser.assignmentOperator()) << op;
 	}
 }
@@ -263,8 +328,9 @@ TEST(ParserExpr, AssignmentOperatorPredicate) {
 TEST(ParserExpr, ParserPrimaryExpr) {
 	{
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer("2", errors);
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 
 		// get std::unique_ptr<ExprAST>
 		auto prim_expr_ast = parser.parsePrimaryExpr();
@@ -275,8 +341,9 @@ TEST(ParserExpr, ParserPrimaryExpr) {
 	}
 	{
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer("some_variable", errors);
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 
 		auto prim_expr_ast = parser.parsePrimaryExpr();
 
@@ -288,8 +355,9 @@ TEST(ParserExpr, ParserPrimaryExpr) {
 	{
 		// parenthesized expression
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer("(1 + 2)", errors);
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 
 		auto prim_expr_ast = parser.parsePrimaryExpr();
 
@@ -305,8 +373,9 @@ TEST(ParserExpr, ParserPrimaryExprErrors) {
 	{
 		// unclosed parenthesis
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer("(1 + 2;", errors);
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 
 		auto prim_expr_ast = parser.parsePrimaryExpr();
 		ASSERT_EQ(prim_expr_ast, nullptr);
@@ -315,8 +384,9 @@ TEST(ParserExpr, ParserPrimaryExprErrors) {
 	{
 		// no identifier, literal or '('
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer(";", errors);
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 
 		auto prim_expr_ast = parser.parsePrimaryExpr();
 		ASSERT_EQ(prim_expr_ast, nullptr);
@@ -327,8 +397,9 @@ TEST(ParserExpr, ParserPrimaryExprErrors) {
 TEST(ParserExpr, ParserPostfixExpr) {
 	{
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer("2;", errors);
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 
 		// get std::unique_ptr<ExprAST>
 		auto postfix_ast = parser.parsePostfixExpr();
@@ -341,7 +412,8 @@ TEST(ParserExpr, ParserPostfixExpr) {
 
 TEST(ParserExpr, PostfixCall) {
 	ErrorReporter errors;
-	auto expr = parseExpr("add(5, 3);", errors);
+	TypeContext types;
+	auto expr = parseExpr("add(5, 3);", errors, types);
 
 	auto *call = expectNode<CallExprAST>(expr.get());
 	ASSERT_NE(call, nullptr);
@@ -363,7 +435,8 @@ TEST(ParserExpr, PostfixCall) {
 
 TEST(ParserExpr, QualifiedVariable) {
 	ErrorReporter errors;
-	auto expr = parseExpr("math::pi;", errors);
+	TypeContext types;
+	auto expr = parseExpr("math::pi;", errors, types);
 
 	auto *var_expr = expectNode<VariableExprAST>(expr.get());
 	ASSERT_NE(var_expr, nullptr);
@@ -379,7 +452,8 @@ TEST(ParserExpr, QualifiedVariable) {
 
 TEST(ParserExpr, QualifiedCall) {
 	ErrorReporter errors;
-	auto expr = parseExpr("math::vec::dot(a, b);", errors);
+	TypeContext types;
+	auto expr = parseExpr("math::vec::dot(a, b);", errors, types);
 
 	auto *call = expectNode<CallExprAST>(expr.get());
 	ASSERT_NE(call, nullptr);
@@ -400,7 +474,8 @@ TEST(ParserExpr, QualifiedCall) {
 
 TEST(ParserExpr, QualifiedNameMissingIdentifier) {
 	ErrorReporter errors;
-	auto expr = parseExpr("math::;", errors);
+	TypeContext types;
+	auto expr = parseExpr("math::;", errors, types);
 
 	EXPECT_EQ(expr, nullptr);
 	EXPECT_TRUE(errors.hasErrors());
@@ -408,7 +483,8 @@ TEST(ParserExpr, QualifiedNameMissingIdentifier) {
 
 TEST(ParserExpr, PostfixCallWithExprArgs) {
 	ErrorReporter errors;
-	auto expr = parseExpr("f(1 + 2, g(3));", errors);
+	TypeContext types;
+	auto expr = parseExpr("f(1 + 2, g(3));", errors, types);
 
 	auto *call = expectNode<CallExprAST>(expr.get());
 	ASSERT_NE(call, nullptr);
@@ -423,7 +499,8 @@ TEST(ParserExpr, PostfixCallWithExprArgs) {
 TEST(ParserExpr, PostfixIncrementDecrement) {
 	{
 		ErrorReporter errors;
-		auto expr = parseExpr("x++;", errors);
+		TypeContext types;
+		auto expr = parseExpr("x++;", errors, types);
 
 		auto *unary = expectNode<UnaryExprAST>(expr.get());
 		ASSERT_NE(unary, nullptr);
@@ -437,7 +514,8 @@ TEST(ParserExpr, PostfixIncrementDecrement) {
 	}
 	{
 		ErrorReporter errors;
-		auto expr = parseExpr("y--;", errors);
+		TypeContext types;
+		auto expr = parseExpr("y--;", errors, types);
 
 		auto *unary = expectNode<UnaryExprAST>(expr.get());
 		ASSERT_NE(unary, nullptr);
@@ -449,19 +527,22 @@ TEST(ParserExpr, PostfixIncrementDecrement) {
 TEST(ParserExpr, PostfixSubscriptAndMemberAccess) {
 	{
 		ErrorReporter errors;
-		auto expr = parseExpr("a[1];", errors);
+		TypeContext types;
+		auto expr = parseExpr("a[1];", errors, types);
 		EXPECT_NE(expr, nullptr);
 		EXPECT_FALSE(errors.hasErrors());
 	}
 	{
 		ErrorReporter errors;
-		auto expr = parseExpr("p.x;", errors);
+		TypeContext types;
+		auto expr = parseExpr("p.x;", errors, types);
 		EXPECT_NE(expr, nullptr);
 		EXPECT_FALSE(errors.hasErrors());
 	}
 	{
 		ErrorReporter errors;
-		auto expr = parseExpr("math::add;", errors);
+		TypeContext types;
+		auto expr = parseExpr("math::add;", errors, types);
 		EXPECT_NE(expr, nullptr);
 		EXPECT_FALSE(errors.hasErrors());
 	}
@@ -478,11 +559,13 @@ TEST(ParserExpr, UnaryExpr) {
 TEST(ParserExpr, ParserMultiplicative) {
 	{
 		ErrorReporter errors;
+		TypeContext types;
 		Lexer lexer("2 * 2;", errors);
-		Parser parser(lexer, errors);
+		Parser parser(lexer, errors, types);
 
 		// get std::unique_ptr<types::Type>
-		auto mult_ast = parser.parseMultiplicativeExpr();
+		auto mult_ast =
+		    parser.parseBinaryExpr(Precedence::MULTIPLICATIVE);
 
 		auto mult_expr = expectNode<ast::BinaryExprAST>(mult_ast.get());
 		ASSERT_NE(mult_expr, nullptr);
@@ -523,7 +606,8 @@ TEST(ParserExpr, BinaryOperators) {
 TEST(ParserExpr, LeftAssociativity) {
 	// 10 - 4 - 3 must parse as (10 - 4) - 3
 	ErrorReporter errors;
-	auto expr = parseExpr("10 - 4 - 3;", errors);
+	TypeContext types;
+	auto expr = parseExpr("10 - 4 - 3;", errors, types);
 
 	auto *outer = expectNode<BinaryExprAST>(expr.get());
 	ASSERT_NE(outer, nullptr);
@@ -541,7 +625,8 @@ TEST(ParserExpr, LeftAssociativity) {
 TEST(ParserExpr, MultiplicationBindsTighterThanAddition) {
 	// 2 + 3 * 4 must parse as 2 + (3 * 4)
 	ErrorReporter errors;
-	auto expr = parseExpr("2 + 3 * 4;", errors);
+	TypeContext types;
+	auto expr = parseExpr("2 + 3 * 4;", errors, types);
 
 	auto *add = expectNode<BinaryExprAST>(expr.get());
 	ASSERT_NE(add, nullptr);
@@ -559,7 +644,8 @@ TEST(ParserExpr, MultiplicationBindsTighterThanAddition) {
 TEST(ParserExpr, ParensOverridePrecedence) {
 	// (2 + 3) * 4 must parse as (2 + 3) * 4
 	ErrorReporter errors;
-	auto expr = parseExpr("(2 + 3) * 4;", errors);
+	TypeContext types;
+	auto expr = parseExpr("(2 + 3) * 4;", errors, types);
 
 	auto *mul = expectNode<BinaryExprAST>(expr.get());
 	ASSERT_NE(mul, nullptr);
@@ -573,7 +659,8 @@ TEST(ParserExpr, ParensOverridePrecedence) {
 TEST(ParserExpr, BitwisePrecedence) {
 	// 1 | 2 ^ 3 & 4 must parse as 1 | (2 ^ (3 & 4))
 	ErrorReporter errors;
-	auto expr = parseExpr("1 | 2 ^ 3 & 4;", errors);
+	TypeContext types;
+	auto expr = parseExpr("1 | 2 ^ 3 & 4;", errors, types);
 
 	auto *bit_or = expectNode<BinaryExprAST>(expr.get());
 	ASSERT_NE(bit_or, nullptr);
@@ -591,7 +678,8 @@ TEST(ParserExpr, BitwisePrecedence) {
 TEST(ParserExpr, LogicalPrecedence) {
 	// a || b && c must parse as a || (b && c)
 	ErrorReporter errors;
-	auto expr = parseExpr("a || b && c;", errors);
+	TypeContext types;
+	auto expr = parseExpr("a || b && c;", errors, types);
 
 	auto *logical_or = expectNode<BinaryExprAST>(expr.get());
 	ASSERT_NE(logical_or, nullptr);
@@ -602,13 +690,46 @@ TEST(ParserExpr, LogicalPrecedence) {
 	EXPECT_EQ(logical_and->getOperator(), BinaryOp::AND);
 }
 
+TEST(ParserExpr, EveryPrecedenceLevel) {
+	ErrorReporter errors;
+	TypeContext types;
+	auto expr = parseExpr("a || b && c | d ^ e & f == g < h << i + j * k - "
+			      "l % m >> n != o || p;",
+			      errors, types);
+	EXPECT_FALSE(errors.hasErrors());
+	EXPECT_EQ(parenthesize(expr.get()),
+		  "((a || (b && (c | (d ^ (e & ((f == (g < ((h << ((i + (j * "
+		  "k)) - (l % m))) >> n))) != o)))))) || p)");
+
+	auto chain = parseExpr("a * b + c * d - e < f;", errors, types);
+	EXPECT_EQ(parenthesize(chain.get()),
+		  "((((a * b) + (c * d)) - e) < f)");
+}
+
+TEST(ParserExpr, PrecedenceTable) {
+	static_assert(binaryOperator(TokenType::STAR).precedence ==
+		      Precedence::MULTIPLICATIVE);
+	static_assert(binaryOperator(TokenType::PIPE_PIPE).op ==
+		      BinaryOp::OR);
+	// assignment, unary-only and punctuation tokens end an expression
+	for (TokenType type : {TokenType::EQUAL, TokenType::PLUS_EQUAL,
+			       TokenType::TILDE, TokenType::EXCLAMATION,
+			       TokenType::QUESTION, TokenType::SEMICOLON,
+			       TokenType::T_EOF, TokenType::INVALID}) {
+		EXPECT_EQ(binaryOperator(type).precedence, Precedence::NONE);
+	}
+	EXPECT_EQ(binaryOperator(TokenType::MINUS).associativity,
+		  Associativity::LEFT);
+}
+
 TEST(ParserExpr, IncompleteExpressionErrors) {
 	std::vector<std::string> bad_inputs = {
 	    "1 + ;", "2 * ;", "1 << ;", "1 < ;",  "1 == ;", "1 & ;",
 	    "1 ^ ;", "1 | ;", "a && ;", "a || ;", "a ? ;"};
 	for (const auto &src : bad_inputs) {
 		ErrorReporter errors;
-		auto expr = parseExpr(src, errors);
+		TypeContext types;
+		auto expr = parseExpr(src, errors, types);
 		EXPECT_EQ(expr, nullptr) << src;
 		EXPECT_TRUE(errors.hasErrors()) << src;
 	}
@@ -616,6 +737,7 @@ TEST(ParserExpr, IncompleteExpressionErrors) {
 
 TEST(ParserExpr, ArgListTrailingCommaError) {
 	ErrorReporter errors;
-	auto expr = parseExpr("f(1,);", errors);
+	TypeContext types;
+	auto expr = parseExpr("f(1,);", errors, types);
 	EXPECT_TRUE(errors.hasErrors());
 }
@@ -0,0 +1,235 @@
+#include "../test_helpers.hpp"
+#include "ast/ast.hpp"
+#include "ast/decl.hpp"
+#include "ast/flat_ast.hpp"
+#include "ast/stmt.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/token_buffer.hpp"
+#include "parser/builder.hpp"
+#include "parser/parser.hpp"
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace ::frontend;
+using namespace ::frontend::ast;
+
+namespace {
+// Three broken statements in two functions and a broken declaration
+const char *const BROKEN = "func f() -> int {\n"
+			   "  x = );\n"
+			   "  return 1\n"
+			   "}\n"
+			   "func g( -> int { return 2; }\n"
+			   "func h() -> void { y = 1; if (y { y = 2; } }\n";
+
+std::unique_ptr<ProgramAST> parse(std::string_view src, ErrorReporter &errors,
+				  types::TypeContext &types) {
+	Lexer lexer(std::string(src), errors);
+	Parser parser(lexer, errors, types);
+	parser.setRecovery(ErrorRecovery::SYNCHRONIZE);
+	return parser.parseProgram();
+}
+
+// The source an error node covers
+template <typename T>
+std::string_view skipped(std::string_view src, const T &node) {
+	return src.substr(node.getBegin(), node.getEnd() - node.getBegin());
+}
+} // namespace
+
+TEST(parserRecoveryTest, StopsAtTheFirstErrorByDefault) {
+	ErrorReporter errors;
+	types::TypeContext types;
+	Lexer lexer(BROKEN, errors);
+	Parser parser(lexer, errors, types);
+	EXPECT_EQ(parser.parseProgram(), nullptr);
+	ASSERT_TRUE(errors.hasErrors());
+	for (const CompilerError &err : errors.getErrors()) {
+		EXPECT_EQ(err.location.offset, 24);
+	}
+}
+
+TEST(parserRecoveryTest, ReportsEveryBrokenStatementInOnePass) {
+	ErrorReporter errors;
+	types::TypeContext types;
+	auto program = parse(BROKEN, errors, types);
+	ASSERT_NE(program, nullptr);
+	EXPECT_EQ(messages(errors),
+		  (std::vector<std::string>{
+		      "24: Expected identifier, literal or '(' but got: )",
+		      "38: Expected '[', '(', '.', '::', '++', or '--' but "
+		      "got: }",
+		      "48: Expected primitive type but got: ->",
+		      "101: Expected '[', '(', '.', '::', '++', or '--' but "
+		      "got: {",
+		  }));
+
+	const auto &decls = program->getDeclarations();
+	ASSERT_EQ(decls.size(), 3);
+	EXPECT_TRUE(isa<FunctionAST>(decls[0].get()));
+	EXPECT_TRUE(isa<ErrorDeclAST>(decls[1].get()));
+	EXPECT_TRUE(isa<FunctionAST>(decls[2].get()));
+}
+
+TEST(parserRecoveryTest, ErrorNodesCoverWhatWasSkipped) {
+	const std::string_view src = BROKEN;
+	ErrorReporter errors;
+	types::TypeContext types;
+	auto program = parse(src, errors, types);
+	ASSERT_NE(program, nullptr);
+	const auto &decls = program->getDeclarations();
+	ASSERT_EQ(decls.size(), 3);
+
+	auto *f = dyn_cast<FunctionAST>(decls[0].get());
+	ASSERT_NE(f, nullptr);
+	const auto &stmts = f->getBody()->getStmts();
+	ASSERT_EQ(stmts.size(), 2);
+	auto *assign = dyn_cast<ErrorStmtAST>(stmts[0].get());
+	ASSERT_NE(assign, nullptr);
+	EXPECT_EQ(skipped(src, *assign), "x = );");
+	// the '}' it failed at is left to close the body
+	auto *ret = dyn_cast<ErrorStmtAST>(stmts[1].get());
+	ASSERT_NE(ret, nullptr);
+	EXPECT_EQ(skipped(src, *ret), "return 1");
+
+	auto *g = dyn_cast<ErrorDeclAST>(decls[1].get());
+	ASSERT_NE(g, nullptr);
+	EXPECT_EQ(skipped(src, *g), "func g( -> int { return 2; }");
+
+	// a broken statement's braced block goes with it
+	auto *h = dyn_cast<FunctionAST>(decls[2].get());
+	ASSERT_NE(h, nullptr);
+	const auto &body = h->getBody()->getStmts();
+	ASSERT_EQ(body.size(), 2);
+	auto *branch = dyn_cast<ErrorStmtAST>(body[1].get());
+	ASSERT_NE(branch, nullptr);
+	EXPECT_EQ(skipped(src, *branch), "if (y { y = 2; }");
+}
+
+TEST(parserRecoveryTest, UnclosedBodyEndsAtTheNextDeclaration) {
+	ErrorReporter errors;
+	types::TypeContext types;
+	auto program = parse("func f() -> int { return 1;\n"
+			     "func g() -> int { return 2; }",
+			     errors, types);
+	ASSERT_NE(program, nullptr);
+	EXPECT_EQ(messages(errors),
+		  std::vector<std::string>{"28: Expected '}' but got: func"});
+	const auto &decls = program->getDeclarations();
+	ASSERT_EQ(decls.size(), 2);
+	EXPECT_TRUE(isa<ErrorDeclAST>(decls[0].get()));
+	auto *g = dyn_cast<FunctionAST>(decls[1].get());
+	ASSERT_NE(g, nullptr);
+	EXPECT_EQ(g->getProto()->getQualifiedName().str(), "g");
+}
+
+TEST(parserRecoveryTest, StrayBraceIsSkippedOnItsOwn) {
+	const std::string_view src = "func f() -> void {} }\n"
+				     "namespace n { func g( -> void {} }\n"
+				     "struct S { var int x; }";
+	ErrorReporter errors;
+	types::TypeContext types;
+	auto program = parse(src, errors, types);
+	ASSERT_NE(program, nullptr);
+	EXPECT_EQ(messages(errors),
+		  (std::vector<std::string>{
+		      "20: Expected declaration but got: }",
+		      "44: Expected primitive type but got: ->",
+		  }));
+	const auto &decls = program->getDeclarations();
+	ASSERT_EQ(decls.size(), 4);
+	auto *stray = dyn_cast<ErrorDeclAST>(decls[1].get());
+	ASSERT_NE(stray, nullptr);
+	EXPECT_EQ(skipped(src, *stray), "}");
+	// the namespace's own '}' is left to close it
+	auto *n = dyn_cast<NamespaceAST>(decls[2].get());
+	ASSERT_NE(n, nullptr);
+	ASSERT_EQ(n->getDeclarations().size(), 1);
+	EXPECT_TRUE(isa<ErrorDeclAST>(n->getDeclarations()[0].get()));
+	EXPECT_TRUE(isa<StructAST>(decls[3].get()));
+}
+
+TEST(parserRecoveryTest, StopsAtTheErrorLimit) {
+	std::string src = "func f() -> int {\n";
+	for (int i = 0; i < 1000; i++) {
+		src += "  x = );\n";
+	}
+	src += "}\n";
+	for (int i = 0; i < 1000; i++) {
+		src += "func g( -> int { return 2; }\n";
+	}
+
+	ErrorReporter unlimited;
+	types::TypeContext types;
+	ASSERT_NE(parse(src, unlimited, types), nullptr);
+	EXPECT_EQ(unlimited.getErrorCount(), 2000);
+
+	// the error past the limit is the last one looked for
+	ErrorReporter errors;
+	errors.setErrorLimit(3);
+	EXPECT_EQ(parse(src, errors, types), nullptr);
+	EXPECT_EQ(errors.getErrorCount(), 4);
+	std::vector<std::string> all = messages(unlimited);
+	EXPECT_EQ(messages(errors),
+		  std::vector<std::string>(all.begin(), all.begin() + 3));
+
+	// lexer errors count towards it as well
+	ErrorReporter lexerErrors;
+	lexerErrors.setErrorLimit(3);
+	EXPECT_EQ(parse("func f() -> int { return 1; }\n" +
+			    std::string(1000, '#') +
+			    "\nfunc g( -> int { return 2; }\n",
+			lexerErrors, types),
+		  nullptr);
+	EXPECT_LE(lexerErrors.getErrorCount(), 4 + MAX_PEEK);
+}
+
+TEST(parserRecoveryTest, EveryBuilderRecoversAlike) {
+	ErrorReporter treeErrors;
+	types::TypeContext types;
+	auto program = parse(BROKEN, treeErrors, types);
+	ASSERT_NE(program, nullptr);
+
+	ErrorReporter checkErrors;
+	Lexer checkLexer(BROKEN, checkErrors);
+	SyntaxChecker checker(checkLexer, checkErrors);
+	checker.setRecovery(ErrorRecovery::SYNCHRONIZE);
+	EXPECT_TRUE(checker.parseProgram());
+	EXPECT_EQ(messages(checkErrors), messages(treeErrors));
+
+	ErrorReporter flatErrors;
+	FlatAST flat;
+	Lexer flatLexer(BROKEN, flatErrors);
+	FlatParser flatParser(flatLexer, flatErrors, FlatBuilder(flat, types));
+	flatParser.setRecovery(ErrorRecovery::SYNCHRONIZE);
+	ASSERT_NE(flatParser.parseProgram(), nullptr);
+	EXPECT_EQ(messages(flatErrors), messages(treeErrors));
+	auto decls = flat.children(flat.root());
+	ASSERT_EQ(decls.size(), 3);
+	ASSERT_EQ(flat.kind(decls[1]), NodeKind::ERROR_DECL);
+	EXPECT_EQ(flat.skipped(decls[1]),
+		  (std::pair<uint32_t, uint32_t>{40, 68}));
+	NodeID body = flat.child(decls[0], 0);
+	ASSERT_EQ(flat.kind(body), NodeKind::BLOCK);
+	for (NodeID stmt : flat.children(body)) {
+		EXPECT_EQ(flat.kind(stmt), NodeKind::ERROR_STMT);
+	}
+
+	// green nodes measure what they skipped in tokens and bytes
+	ErrorReporter greenErrors;
+	TokenBuffer tokens = Lexer(BROKEN, greenErrors).lexAll();
+	GreenParser greenParser(tokens, greenErrors,
+				GreenBuilder(tokens, types));
+	greenParser.setRecovery(ErrorRecovery::SYNCHRONIZE);
+	GreenRef root = greenParser.parseProgram();
+	ASSERT_NE(root, nullptr);
+	EXPECT_EQ(messages(greenErrors), messages(treeErrors));
+	ASSERT_EQ(root.node->children.size(), 3);
+	const GreenNode &error = *root.node->children[1].node;
+	EXPECT_EQ(error.kind, NodeKind::ERROR_DECL);
+	EXPECT_EQ(error.length, 68 - 40);
+}
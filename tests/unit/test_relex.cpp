@@ -0,0 +1,164 @@
+#include "../test_helpers.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/relex.hpp"
+#include "lexer/token_buffer.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+using namespace ::frontend;
+
+namespace {
+struct Edited {
+	TokenBuffer incremental;
+	TokenBuffer full;
+	RelexRange range;
+};
+
+// Lexes `before`, applies the edit both incrementally and from scratch
+Edited applyEdit(SourceManager &sources, const std::string &before,
+		 uint32_t offset, uint32_t removed, const std::string &text) {
+	std::string after = before;
+	after.replace(offset, removed, text);
+
+	ErrorReporter errors(sources);
+	FileID oldFile = sources.addBuffer("old", SourceBuffer(before));
+	FileID newFile = sources.addBuffer("new", SourceBuffer(after));
+
+	Lexer oldLexer(oldFile, errors);
+	TokenBuffer tokens = oldLexer.lexAll();
+	TextEdit edit{offset, removed, static_cast<uint32_t>(text.size())};
+	RelexRange range = relex(tokens, newFile, edit, errors);
+
+	Lexer newLexer(newFile, errors);
+	return {tokens, newLexer.lexAll(), range};
+}
+} // namespace
+
+TEST(relexTest, LocalEditStaysLocal) {
+	SourceManager sources;
+	std::string src;
+	for (size_t i = 0; i < 500; i++) {
+		src += "var int x" + std::to_string(i) + " = " +
+		       std::to_string(i) + ";\n";
+	}
+
+	// rename one identifier in the middle of the file
+	auto offset = static_cast<uint32_t>(src.find("x250"));
+	Edited result = applyEdit(sources, src, offset, 4, "renamed");
+	expectSameTokens(result.incremental, result.full);
+	EXPECT_LE(result.range.removed, 3);
+	EXPECT_LE(result.range.inserted, 3);
+}
+
+TEST(relexTest, EditsAtEdges) {
+	SourceManager sources;
+	const std::string src = "a + b;";
+	Edited atStart = applyEdit(sources, src, 0, 0, "c ");
+	expectSameTokens(atStart.incremental, atStart.full);
+	Edited atEnd = applyEdit(sources, src, 6, 0, " d");
+	expectSameTokens(atEnd.incremental, atEnd.full);
+	Edited all = applyEdit(sources, src, 0, 6, "");
+	expectSameTokens(all.incremental, all.full);
+	Edited empty = applyEdit(sources, "", 0, 0, "x");
+	expectSameTokens(empty.incremental, empty.full);
+}
+
+TEST(relexTest, LookaheadAndMergedTokens) {
+	SourceManager sources;
+	// "1." followed by an edit that makes "1.5"
+	Edited number = applyEdit(sources, "1.x;", 2, 1, "5");
+	expectSameTokens(number.incremental, number.full);
+	// "+" followed by an inserted "=" becomes "+="
+	Edited op = applyEdit(sources, "a + b;", 3, 0, "=");
+	expectSameTokens(op.incremental, op.full);
+	// deleting the space joins two identifiers
+	Edited join = applyEdit(sources, "ab cd;", 2, 1, "");
+	expectSameTokens(join.incremental, join.full);
+}
+
+TEST(relexTest, CommentsAndStringsReachPastTheEdit) {
+	SourceManager sources;
+	const std::string src = "a; b; \"s\"; c; /* x */ d; e;";
+
+	// opening a comment swallows tokens up to the next "*/"
+	Edited open = applyEdit(sources, src, 3, 0, "/*");
+	expectSameTokens(open.incremental, open.full);
+	// closing the existing comment early turns " x */" into tokens
+	auto inside = static_cast<uint32_t>(src.find('x'));
+	Edited close = applyEdit(sources, src, inside, 0, "*/");
+	expectSameTokens(close.incremental, close.full);
+	// removing "/*" leaves a stray "*/"
+	auto opener = static_cast<uint32_t>(src.find("/*"));
+	Edited unopen = applyEdit(sources, src, opener, 2, "");
+	expectSameTokens(unopen.incremental, unopen.full);
+	// an unmatched quote turns the rest of the text inside out
+	Edited quote = applyEdit(sources, src, 0, 0, "\"");
+	expectSameTokens(quote.incremental, quote.full);
+	// an unterminated comment runs to the end of input
+	Edited tail = applyEdit(sources, "a; b; c;", 1, 0, "/*");
+	expectSameTokens(tail.incremental, tail.full);
+	EXPECT_EQ(tail.incremental.size(), 2);
+}
+
+TEST(relexTest, EveryEditOfASmallProgram) {
+	// every single-byte insertion and deletion of interesting bytes
+	SourceManager sources;
+	const std::string src = "func f(int a)->int{/*c*/return a>>=1.5;}"
+				"\"s\\n\" 'c' // x\n";
+	for (const std::string text : {"", "/", "*", "\"", "'", ".", "=",
+				       "\n", " ", "9", "a"}) {
+		for (uint32_t at = 0; at <= src.size(); at++) {
+			uint32_t removed = text.empty() ? 1 : 0;
+			if (at + removed > src.size()) {
+				continue;
+			}
+			Edited result =
+			    applyEdit(sources, src, at, removed, text);
+			SCOPED_TRACE("insert '" + text + "' at " +
+				     std::to_string(at));
+			expectSameTokens(result.incremental, result.full);
+		}
+	}
+}
+
+TEST(relexTest, SuccessiveEditsOfOneBuffer) {
+	// the edits jump back and forth, so the gap left by each one moves
+	// both ways past literals to reach the next
+	SourceManager sources;
+	ErrorReporter errors(sources);
+	std::string text;
+	for (size_t i = 0; i < 50; i++) {
+		text += "x" + std::to_string(i) + " = " + std::to_string(i) +
+			" + 0.5;\n";
+	}
+	FileID file = sources.addBuffer("edited", SourceBuffer(text));
+	TokenBuffer tokens = Lexer(file, errors).lexAll();
+
+	// fractions of the text, in percent, where each round edits
+	const size_t places[] = {80, 10, 50, 95, 20};
+	for (size_t round = 0; round < 3; round++) {
+		for (size_t place : places) {
+			auto at =
+			    static_cast<uint32_t>(text.size() * place / 100);
+			const std::string inserted =
+			    round == 1 ? "" : std::to_string(round) + "1 ";
+			text.replace(at, 1, inserted);
+			// the tokens view the old text until relex() is done
+			std::shared_ptr<const SourceBuffer> previous =
+			    sources.source(file);
+			sources.replace(file, SourceBuffer(text));
+			TextEdit edit{at, 1,
+				      static_cast<uint32_t>(inserted.size())};
+			(void)relex(tokens, file, edit, errors);
+
+			SCOPED_TRACE(text);
+			expectSameTokens(tokens, Lexer(file, errors).lexAll());
+		}
+	}
+}
@@ -0,0 +1,87 @@
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/token.hpp"
+#include "source/source_buffer.hpp"
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+
+using namespace ::frontend;
+
+namespace {
+// Writes `contents` to a fresh file under the test temp dir
+std::filesystem::path writeTempFile(const std::string &name,
+				    const std::string &contents) {
+	auto path = std::filesystem::temp_directory_path() / name;
+	std::ofstream out(path, std::ios::binary);
+	out << contents;
+	return path;
+}
+} // namespace
+
+TEST(sourceBufferTest, OwnedText) {
+	SourceBuffer buffer(std::string("var int x;"));
+	EXPECT_EQ(buffer.text(), "var int x;");
+	EXPECT_EQ(buffer.size(), 10);
+	EXPECT_FALSE(buffer.isMapped());
+}
+
+TEST(sourceBufferTest, MoveKeepsOwnedTextValid) {
+	// short enough for the small-string buffer, which moves with it
+	SourceBuffer first(std::string("x"));
+	SourceBuffer second(std::move(first));
+	EXPECT_EQ(second.text(), "x");
+	EXPECT_TRUE(first.text().empty()); // NOLINT(bugprone-use-after-move)
+}
+
+TEST(sourceBufferTest, MapFile) {
+	auto path = writeTempFile("adq_source_buffer_map.ac", "func f() {}");
+	auto buffer = SourceBuffer::mapFile(path.string());
+
+	ASSERT_TRUE(buffer.has_value());
+	EXPECT_TRUE(buffer->isMapped());
+	EXPECT_EQ(buffer->text(), "func f() {}");
+	std::filesystem::remove(path);
+}
+
+TEST(sourceBufferTest, MapEmptyFile) {
+	auto path = writeTempFile("adq_source_buffer_empty.ac", "");
+	auto buffer = SourceBuffer::mapFile(path.string());
+
+	ASSERT_TRUE(buffer.has_value());
+	EXPECT_TRUE(buffer->text().empty());
+	std::filesystem::remove(path);
+}
+
+TEST(sourceBufferTest, MapMissingFile) {
+	EXPECT_FALSE(
+	    SourceBuffer::mapFile("/nonexistent/adq_missing.ac").has_value());
+	EXPECT_EQ(errno, ENOENT);
+}
+
+TEST(sourceBufferTest, MapDirectory) {
+	auto path = std::filesystem::temp_directory_path();
+	EXPECT_FALSE(SourceBuffer::mapFile(path.string()).has_value());
+	EXPECT_EQ(errno, EISDIR);
+}
+
+TEST(sourceBufferTest, LexemesViewMappedFile) {
+	auto path = writeTempFile("adq_source_buffer_lex.ac", "var int count");
+	auto buffer = SourceBuffer::mapFile(path.string());
+	ASSERT_TRUE(buffer.has_value());
+
+	ErrorReporter errors;
+	Lexer lexer(*buffer, errors);
+	lexer.get(); // var
+	lexer.get(); // int
+	Token name = lexer.get();
+
+	EXPECT_EQ(name.type, TokenType::IDENT);
+	EXPECT_EQ(name.lexeme, "count");
+	// zero-copy: the lexeme points into the mapping itself
+	EXPECT_EQ(name.lexeme.data(), buffer->text().data() + 8);
+	std::filesystem::remove(path);
+}
@@ -0,0 +1,217 @@
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/token.hpp"
+#include "lexer/token_buffer.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ::frontend;
+
+TEST(sourceManagerTest, AddBuffers) {
+	SourceManager sources;
+	FileID a = sources.addBuffer("a.adq", SourceBuffer(std::string("x")));
+	FileID b =
+	    sources.addBuffer("b.adq", SourceBuffer(std::string("y\nzz")));
+
+	EXPECT_TRUE(a.isValid());
+	EXPECT_FALSE(FileID{}.isValid());
+	EXPECT_NE(a, b);
+	EXPECT_EQ(sources.name(a), "a.adq");
+	EXPECT_EQ(sources.text(b), "y\nzz");
+	EXPECT_EQ(sources.locate({b, 3}).line, 2);
+	EXPECT_EQ(sources.locate({b, 3}).column, 2);
+}
+
+TEST(sourceManagerTest, StreamedFilesLocatePinnedOffsets) {
+	SourceManager sources;
+	FileID stream = sources.addStream("<stdin>");
+	sources.pin({stream, 900}, {40, 3});
+	sources.pin({stream, 12}, {2, 5});
+
+	EXPECT_EQ(sources.name(stream), "<stdin>");
+	EXPECT_TRUE(sources.text(stream).empty());
+	EXPECT_EQ(sources.locate({stream, 12}).line, 2);
+	EXPECT_EQ(sources.locate({stream, 12}).column, 5);
+	EXPECT_EQ(sources.locate({stream, 900}).line, 40);
+	// never pinned: only the byte offset is known
+	EXPECT_EQ(sources.locate({stream, 50}).line, 1);
+	EXPECT_EQ(sources.locate({stream, 50}).column, 51);
+}
+
+TEST(sourceManagerTest, AddFile) {
+	auto path = std::filesystem::temp_directory_path() / "sm_file.adq";
+	std::ofstream(path, std::ios::binary) << "var int x;";
+
+	SourceManager sources;
+	auto file = sources.addFile(path.string());
+	ASSERT_TRUE(file.has_value());
+	EXPECT_EQ(sources.text(*file), "var int x;");
+	EXPECT_EQ(sources.name(*file), path.string());
+	EXPECT_FALSE(sources.addFile("/nonexistent/dir/x.adq").has_value());
+
+	std::filesystem::remove(path);
+}
+
+TEST(sourceManagerTest, EntriesDoNotMove) {
+	// spans several segments; earlier views must stay valid
+	SourceManager sources;
+	FileID first = sources.addBuffer("0", SourceBuffer(std::string("0")));
+	const char *data = sources.text(first).data();
+	for (size_t i = 1; i < 1000; i++) {
+		sources.addBuffer(std::to_string(i),
+				  SourceBuffer(std::to_string(i)));
+	}
+	EXPECT_EQ(sources.text(first).data(), data);
+	EXPECT_EQ(sources.text(FileID{1000}), "999");
+}
+
+TEST(sourceManagerTest, DiagnosticsCarryTheirFile) {
+	SourceManager sources;
+	FileID a = sources.addBuffer("a.adq", SourceBuffer(std::string("#")));
+	FileID b =
+	    sources.addBuffer("b.adq", SourceBuffer(std::string("\n  #")));
+
+	ErrorReporter errors(sources);
+	for (FileID file : {a, b}) {
+		Lexer lexer(file, errors);
+		while (lexer.get().type != TokenType::T_EOF) {
+		}
+	}
+
+	const auto &all = errors.getErrors();
+	ASSERT_EQ(all.size(), 2);
+	EXPECT_EQ(all[0].location.file, a);
+	EXPECT_EQ(all[1].location.file, b);
+	EXPECT_EQ(errors.locate(all[1]).line, 2);
+	EXPECT_EQ(errors.locate(all[1]).column, 3);
+}
+
+TEST(sourceManagerTest, ConcurrentLexersAndAdds) {
+	SourceManager sources;
+	std::vector<FileID> files;
+	for (size_t i = 0; i < 8; i++) {
+		files.push_back(sources.addBuffer(
+		    "f" + std::to_string(i),
+		    SourceBuffer(std::string(i + 1, '\n') + "a b c #")));
+	}
+
+	// readers lex and resolve locations while a writer keeps adding
+	std::vector<std::thread> threads;
+	std::vector<size_t> lines(files.size());
+	for (size_t i = 0; i < files.size(); i++) {
+		threads.emplace_back([&, i] {
+			ErrorReporter errors(sources);
+			Lexer lexer(files[i], errors);
+			while (lexer.get().type != TokenType::T_EOF) {
+			}
+			lines[i] = errors.locate(errors.getErrors()[0]).line;
+		});
+	}
+	threads.emplace_back([&] {
+		for (size_t i = 0; i < 600; i++) {
+			sources.addBuffer("extra",
+					  SourceBuffer(std::string("x")));
+		}
+	});
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	for (size_t i = 0; i < files.size(); i++) {
+		EXPECT_EQ(lines[i], i + 2);
+	}
+}
+
+TEST(sourceManagerTest, ReleasedIdsAreReused) {
+	SourceManager sources;
+	FileID kept = sources.addBuffer("kept", SourceBuffer(std::string("k")));
+	FileID dropped =
+	    sources.addBuffer("dropped", SourceBuffer(std::string("d")));
+	sources.release(dropped);
+	FileID reused =
+	    sources.addBuffer("reused", SourceBuffer(std::string("r\nr")));
+	EXPECT_EQ(reused.id, dropped.id);
+	EXPECT_NE(reused, dropped);
+	EXPECT_EQ(sources.name(reused), "reused");
+	EXPECT_EQ(sources.locate({reused, 2}).line, 2);
+	EXPECT_EQ(sources.text(kept), "k");
+
+	// a lexer releases the file it registered, so lexing strings forever
+	// never runs out of ids
+	ErrorReporter errors(sources);
+	for (size_t i = 0; i <= SourceManager::MAX_FILES; i++) {
+		Lexer lexer(std::string("x #"), errors);
+		while (lexer.get().type != TokenType::T_EOF) {
+		}
+		EXPECT_EQ(errors.locate(errors.getErrors()[0]).column, 3);
+		errors.clear();
+	}
+}
+
+TEST(sourceManagerTest, ReleasedIdsAreNotAliased) {
+	SourceManager sources;
+	FileID stale = sources.addBuffer("old", SourceBuffer(std::string("o")));
+	sources.release(stale);
+	FileID reused =
+	    sources.addBuffer("new", SourceBuffer(std::string("n")));
+	ASSERT_EQ(reused.id, stale.id);
+	EXPECT_DEATH((void)sources.name(stale), "released source file");
+	EXPECT_EQ(sources.name(reused), "new");
+}
+
+TEST(sourceManagerTest, TokensKeepTheirLexersFile) {
+	SourceManager sources;
+	ErrorReporter errors(sources);
+	TokenBuffer tokens = Lexer(std::string("a b"), errors).lexAll();
+	FileID file = tokens.fileID();
+	EXPECT_EQ(sources.text(file), "a b");
+	EXPECT_EQ(tokens.lexeme(1), "b");
+
+	// once the tokens go too, the id is free for the next file
+	tokens = TokenBuffer(FileID{}, {});
+	EXPECT_EQ(sources.addBuffer("next", SourceBuffer(std::string("n"))).id,
+		  file.id);
+}
+
+TEST(sourceManagerTest, DiagnosticsKeepTheirFileUntilCleared) {
+	SourceManager sources;
+	ErrorReporter errors(sources);
+	{ Lexer(std::string("a # b"), errors).lexAll(); }
+	ASSERT_EQ(errors.getErrors().size(), 1u);
+	const CompilerError &err = errors.getErrors()[0];
+	EXPECT_EQ(errors.message(err), "unexpected character '#'");
+	EXPECT_EQ(sources.locate(err.location).column, 3);
+
+	FileID file = err.location.file;
+	errors.clear();
+	EXPECT_EQ(sources.addBuffer("next", SourceBuffer(std::string("n"))).id,
+		  file.id);
+}
+
+TEST(sourceManagerTest, ReplacedTextLivesWhileHeld) {
+	SourceManager sources;
+	FileID file =
+	    sources.addBuffer("a.adq", SourceBuffer(std::string("ab")));
+	std::shared_ptr<const SourceBuffer> first = sources.source(file);
+	EXPECT_EQ(sources.locate({file, 1}).column, 2);
+
+	sources.replace(file, SourceBuffer(std::string("\nab")));
+	EXPECT_EQ(sources.name(file), "a.adq");
+	EXPECT_EQ(sources.text(file), "\nab");
+	EXPECT_EQ(sources.locate({file, 1}).line, 2);
+	EXPECT_EQ(first->text(), "ab");
+
+	// nothing else holds the second version once it is replaced
+	std::weak_ptr<const SourceBuffer> second = sources.source(file);
+	sources.replace(file, SourceBuffer(std::string("c")));
+	EXPECT_TRUE(second.expired());
+	EXPECT_EQ(first->text(), "ab");
+}
@@ -0,0 +1,158 @@
+#include "../test_helpers.hpp"
+#include "diagnostics/diagnostics.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/stream_lexer.hpp"
+#include "lexer/token.hpp"
+#include "source/line_table.hpp"
+#include "source/source_buffer.hpp"
+#include "source/source_manager.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace ::frontend;
+
+namespace {
+// Streamed output must match a Lexer over the whole text, down to where
+// each diagnostic is reported
+void expectMatchesLexer(const std::string &src, size_t windowSize) {
+	SourceManager sources;
+	ErrorReporter wholeErrors(sources);
+	Lexer lexer(sources.addBuffer("input", SourceBuffer(src)),
+		    wholeErrors);
+
+	ErrorReporter streamErrors(sources);
+	std::istringstream in(src);
+	StreamLexer stream(in, "input", streamErrors, windowSize);
+
+	SCOPED_TRACE("window size " + std::to_string(windowSize));
+	for (size_t i = 0;; i++) {
+		SCOPED_TRACE("token #" + std::to_string(i));
+		Token want = lexer.get();
+		Token got = stream.get();
+		ASSERT_EQ(got.type, want.type);
+		ASSERT_EQ(got.offset, want.offset);
+		ASSERT_EQ(got.lexeme, want.lexeme);
+		if (want.type == TokenType::T_EOF) {
+			break;
+		}
+	}
+
+	expectSameDiagnostics(streamErrors, wholeErrors);
+}
+
+std::string program(size_t functions) {
+	std::string src;
+	for (size_t i = 0; i < functions; i++) {
+		std::string n = std::to_string(i);
+		src += "/* helper " + n + " with \"quotes\" and // slashes\n"
+		       "   spanning lines **/\n"
+		       "func f" + n + "(int a, string s) -> int {\n"
+		       "\tvar string t = \"/* not a comment */ " + n + "\";\n"
+		       "\tvar char c = 'x'; // trailing \"quote\n"
+		       "\treturn a * " + n + ".25 >> 1 <<= 2; # 'ab'\n"
+		       "}\n";
+	}
+	return src;
+}
+} // namespace
+
+TEST(streamLexerTest, MatchesLexerAtEveryWindowSize) {
+	const std::string src = program(3);
+	for (size_t windowSize = 1; windowSize <= 96; windowSize++) {
+		expectMatchesLexer(src, windowSize);
+	}
+}
+
+TEST(streamLexerTest, UnterminatedAndEmptyInput) {
+	for (size_t windowSize : {1, 4, 64}) {
+		for (const char *src :
+		     {"", "   ", "a /* open to the end *",
+		      "x = \"never closed; y", "// comment without newline",
+		      "'ab' # 'c", "a/", "/*/"}) {
+			expectMatchesLexer(src, windowSize);
+		}
+	}
+}
+
+TEST(streamLexerTest, TokensLongerThanTheWindow) {
+	std::string longString = "\"" + std::string(5000, 's') + "\"";
+	std::string src = "var string s = " + longString + ";\n" +
+			  "identifier_" + std::string(300, 'x') + " 1234567.5";
+	expectMatchesLexer(src, 16);
+}
+
+TEST(streamLexerTest, CommentsDoNotGrowTheWindow) {
+	std::string src = "a /*" + std::string(100000, '*') + "*/ b // " +
+			  std::string(100000, '/') + "\nc";
+	std::istringstream in(src);
+	ErrorReporter errors;
+	StreamLexer stream(in, "input", errors, 64);
+	EXPECT_EQ(stream.get().lexeme, "a");
+	EXPECT_EQ(stream.get().lexeme, "b");
+	EXPECT_EQ(stream.get().lexeme, "c");
+	EXPECT_EQ(stream.get().type, TokenType::T_EOF);
+	EXPECT_EQ(stream.capacity(), 64);
+	EXPECT_FALSE(errors.hasErrors());
+}
+
+TEST(streamLexerTest, MemoryStaysConstantOnLargeInput) {
+	std::string src = program(5000);
+	std::istringstream in(src);
+	ErrorReporter errors;
+	StreamLexer stream(in, "input", errors, 4096);
+	size_t tokens = 0;
+	while (stream.get().type != TokenType::T_EOF) {
+		tokens++;
+	}
+	EXPECT_GT(tokens, 5000 * 30);
+	EXPECT_EQ(stream.capacity(), 4096);
+	EXPECT_TRUE(errors.sources().text(stream.fileID()).empty());
+}
+
+TEST(streamLexerTest, ReadsFromFileDescriptor) {
+	const std::string src = program(50) + "\"unterminated";
+	int fds[2];
+	ASSERT_EQ(::pipe(fds), 0);
+	// small writes, so reads return short counts; the whole input fits
+	// in the pipe's buffer
+	std::jthread writer([&] {
+		for (size_t i = 0; i < src.size(); i += 7) {
+			size_t count = std::min<size_t>(7, src.size() - i);
+			EXPECT_EQ(::write(fds[1], src.data() + i, count),
+				  static_cast<ssize_t>(count));
+		}
+		::close(fds[1]);
+	});
+
+	ErrorReporter wholeErrors;
+	Lexer lexer(src, wholeErrors);
+	ErrorReporter streamErrors;
+	StreamLexer stream(fds[0], "pipe", streamErrors, 128);
+	while (true) {
+		Token want = lexer.get();
+		Token got = stream.get();
+		ASSERT_EQ(got.type, want.type);
+		ASSERT_EQ(got.offset, want.offset);
+		ASSERT_EQ(got.lexeme, want.lexeme);
+		if (want.type == TokenType::T_EOF) {
+			break;
+		}
+	}
+	::close(fds[0]);
+
+	const auto &want = wholeErrors.getErrors();
+	const auto &got = streamErrors.getErrors();
+	ASSERT_EQ(got.size(), want.size());
+	LineColumn wantWhere = wholeErrors.locate(want.back());
+	LineColumn gotWhere = streamErrors.locate(got.back());
+	EXPECT_EQ(streamErrors.message(got.back()),
+		  "unterminated string literal");
+	EXPECT_EQ(gotWhere.line, wantWhere.line);
+	EXPECT_EQ(gotWhere.column, wantWhere.column);
+	EXPECT_EQ(streamErrors.sources().name(stream.fileID()), "pipe");
+}
@@ -4,10 +4,9 @@
 using namespace ::frontend;
 
 TEST(tokenTest, token) {
-	Token token(TokenType::INT, "int", 2, 4);
+	Token token(TokenType::INT, "int", 12);
 
 	ASSERT_EQ(token.type, TokenType::INT);
 	ASSERT_EQ(token.lexeme, "int");
-	ASSERT_EQ(token.line, 2);
-	ASSERT_EQ(token.column, 4);
+	ASSERT_EQ(token.offset, 12);
 }
@@ -1,38 +1,45 @@
-
 #include "../test_helpers.hpp"
+#include "support/thread_pool.hpp"
 #include "types/type.hpp"
+#include "types/type_context.hpp"
 #include "gtest/gtest.h"
-#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 using namespace frontend;
+using types::TypeContext;
+
+namespace {
+std::vector<std::pair<const types::Type *, std::string>> primitives() {
+	return {
+	    {TypeContext::getInt(), "int"},
+	    {TypeContext::getFloat(), "float"},
+	    {TypeContext::getDouble(), "double"},
+	    {TypeContext::getBool(), "bool"},
+	    {TypeContext::getChar(), "char"},
+	    {TypeContext::getString(), "string"},
+	    {TypeContext::getVoid(), "void"},
+	};
+}
+} // namespace
 
 TEST(Types, IntegerType) {
-	auto int_type = std::make_unique<types::IntType>();
+	const types::Type *int_type = TypeContext::getInt();
 	ASSERT_NE(int_type, nullptr);
 
 	ASSERT_EQ(int_type->toString(), "int");
 
 	// test equals()
-	auto type = std::make_unique<types::FloatType>();
-	ASSERT_FALSE(int_type->equals(type.get()));
+	ASSERT_FALSE(int_type->equals(TypeContext::getFloat()));
+	ASSERT_TRUE(int_type->equals(TypeContext::getInt()));
 
 	// check if primitive type
 	ASSERT_TRUE(int_type->isPrimitive());
 }
 
 TEST(Types, PrimitiveToStringAndPredicates) {
-	std::vector<std::pair<std::unique_ptr<types::Type>, std::string>> cases;
-	cases.emplace_back(std::make_unique<types::IntType>(), "int");
-	cases.emplace_back(std::make_unique<types::FloatType>(), "float");
-	cases.emplace_back(std::make_unique<types::DoubleType>(), "double");
-	cases.emplace_back(std::make_unique<types::BoolType>(), "bool");
-	cases.emplace_back(std::make_unique<types::CharType>(), "char");
-	cases.emplace_back(std::make_unique<types::StringType>(), "string");
-	cases.emplace_back(std::make_unique<types::VoidType>(), "void");
-
-	for (const auto &[type, name] : cases) {
+	for (const auto &[type, name] : primitives()) {
 		EXPECT_EQ(type->toString(), name);
 		EXPECT_TRUE(type->isPrimitive()) << name;
 		EXPECT_FALSE(type->isArray()) << name;
@@ -43,111 +50,138 @@ TEST(Types, PrimitiveToStringAndPredicates) {
 }
 
 TEST(Types, PrimitiveEquals) {
-	std::vector<std::unique_ptr<types::Type>> all;
-	all.emplace_back(std::make_unique<types::IntType>());
-	all.emplace_back(std::make_unique<types::FloatType>());
-	all.emplace_back(std::make_unique<types::DoubleType>());
-	all.emplace_back(std::make_unique<types::BoolType>());
-	all.emplace_back(std::make_unique<types::CharType>());
-	all.emplace_back(std::make_unique<types::StringType>());
-	all.emplace_back(std::make_unique<types::VoidType>());
-
-	std::vector<std::unique_ptr<types::Type>> same;
-	same.emplace_back(std::make_unique<types::IntType>());
-	same.emplace_back(std::make_unique<types::FloatType>());
-	same.emplace_back(std::make_unique<types::DoubleType>());
-	same.emplace_back(std::make_unique<types::BoolType>());
-	same.emplace_back(std::make_unique<types::CharType>());
-	same.emplace_back(std::make_unique<types::StringType>());
-	same.emplace_back(std::make_unique<types::VoidType>());
-
+	auto all = primitives();
 	for (size_t i = 0; i < all.size(); i++) {
 		for (size_t j = 0; j < all.size(); j++) {
-			EXPECT_EQ(all[i]->equals(same[j].get()), i == j)
-			    << all[i]->toString() << " vs "
-			    << same[j]->toString();
+			EXPECT_EQ(all[i].first->equals(all[j].first), i == j)
+			    << all[i].second << " vs " << all[j].second;
 		}
 	}
 }
 
+TEST(Types, PrimitivesAreSharedByEveryContext) {
+	TypeContext a;
+	TypeContext b;
+	EXPECT_EQ(a.get<types::IntType>(), b.get<types::IntType>());
+	EXPECT_EQ(a.get<types::VoidType>(), TypeContext::getVoid());
+	EXPECT_EQ(a.size(), 0);
+}
+
 TEST(Types, ArrayType) {
-	types::ArrayType int3(std::make_unique<types::IntType>(), 3);
-
-	EXPECT_EQ(int3.toString(), "int[3]");
-	EXPECT_EQ(int3.getSize(), 3);
-	ASSERT_NE(int3.getElementType(), nullptr);
-	EXPECT_TRUE(int3.getElementType()->isPrimitive());
-	EXPECT_FALSE(int3.isPrimitive());
-
-	types::ArrayType int3_same(std::make_unique<types::IntType>(), 3);
-	types::ArrayType int5(std::make_unique<types::IntType>(), 5);
-	types::ArrayType bool3(std::make_unique<types::BoolType>(), 3);
-	types::IntType plain_int;
-
-	EXPECT_TRUE(int3.equals(&int3_same));
-	EXPECT_FALSE(int3.equals(&int5)) << "same element, different size";
-	EXPECT_FALSE(int3.equals(&bool3)) << "same size, different element";
-	EXPECT_FALSE(int3.equals(&plain_int));
+	TypeContext types;
+	const types::ArrayType *int3 =
+	    types.getArray(TypeContext::getInt(), 3);
+
+	EXPECT_EQ(int3->toString(), "int[3]");
+	EXPECT_EQ(int3->getSize(), 3);
+	EXPECT_EQ(int3->getElementType(), TypeContext::getInt());
+	EXPECT_FALSE(int3->isPrimitive());
+
+	EXPECT_EQ(types.getArray(TypeContext::getInt(), 3), int3);
+	EXPECT_NE(types.getArray(TypeContext::getInt(), 5), int3)
+	    << "same element, different size";
+	EXPECT_NE(types.getArray(TypeContext::getBool(), 3), int3)
+	    << "same size, different element";
+	EXPECT_FALSE(int3->equals(TypeContext::getInt()));
+	EXPECT_EQ(types.size(), 3);
 }
 
 TEST(Types, StructType) {
-	types::StructType point("Point");
-
-	EXPECT_EQ(point.toString(), "struct Point");
-	EXPECT_EQ(point.getName(), "Point");
-	EXPECT_TRUE(point.isStruct());
-	EXPECT_FALSE(point.isPrimitive());
-
-	types::StructType point_same("Point");
-	types::StructType other("Other");
-	types::IntType plain_int;
-
-	EXPECT_TRUE(point.equals(&point_same));
-	EXPECT_FALSE(point.equals(&other));
-	EXPECT_FALSE(point.equals(&plain_int));
+	TypeContext types;
+	const types::StructType *point = types.getStruct("Point");
+
+	EXPECT_EQ(point->toString(), "struct Point");
+	EXPECT_EQ(point->getName(), "Point");
+	EXPECT_TRUE(point->isStruct());
+	EXPECT_FALSE(point->isPrimitive());
+
+	// looked up by the name, not by where it came from
+	std::string name = "Point";
+	EXPECT_EQ(types.getStruct(name), point);
+	EXPECT_NE(types.getStruct("Other"), point);
+	EXPECT_FALSE(point->equals(TypeContext::getInt()));
 }
 
 TEST(Types, ConstType) {
-	types::ConstType const_int(std::make_unique<types::IntType>());
+	TypeContext types;
+	const types::ConstType *const_int =
+	    types.getConst(TypeContext::getInt());
 
-	EXPECT_EQ(const_int.toString(), "const int");
-	ASSERT_NE(const_int.getInnerType(), nullptr);
-	EXPECT_EQ(const_int.getInnerType()->toString(), "int");
+	EXPECT_EQ(const_int->toString(), "const int");
+	EXPECT_EQ(const_int->getInnerType(), TypeContext::getInt());
 
-	types::ConstType const_int_same(std::make_unique<types::IntType>());
-	types::ConstType const_bool(std::make_unique<types::BoolType>());
-	types::IntType plain_int;
-
-	EXPECT_TRUE(const_int.equals(&const_int_same));
-	EXPECT_FALSE(const_int.equals(&const_bool));
-	EXPECT_FALSE(const_int.equals(&plain_int));
+	EXPECT_EQ(types.getConst(TypeContext::getInt()), const_int);
+	EXPECT_NE(types.getConst(TypeContext::getBool()), const_int);
+	EXPECT_FALSE(const_int->equals(TypeContext::getInt()));
 }
 
 TEST(Types, StaticType) {
-	types::StaticType static_int(std::make_unique<types::IntType>());
-
-	EXPECT_EQ(static_int.toString(), "static int");
-	ASSERT_NE(static_int.getInnerType(), nullptr);
-	EXPECT_EQ(static_int.getInnerType()->toString(), "int");
+	TypeContext types;
+	const types::StaticType *static_int =
+	    types.getStatic(TypeContext::getInt());
 
-	types::StaticType static_int_same(std::make_unique<types::IntType>());
-	types::StaticType static_bool(std::make_unique<types::BoolType>());
-	types::IntType plain_int;
+	EXPECT_EQ(static_int->toString(), "static int");
+	EXPECT_EQ(static_int->getInnerType(), TypeContext::getInt());
 
-	EXPECT_TRUE(static_int.equals(&static_int_same));
-	EXPECT_FALSE(static_int.equals(&static_bool));
-	EXPECT_FALSE(static_int.equals(&plain_int));
+	EXPECT_EQ(types.getStatic(TypeContext::getInt()), static_int);
+	EXPECT_NE(types.getStatic(TypeContext::getBool()), static_int);
+	// the same inner type, qualified differently
+	EXPECT_FALSE(static_int->equals(types.getConst(TypeContext::getInt())));
 }
 
 TEST(Types, NestedQualifiers) {
-	types::StaticType static_const_int(std::make_unique<types::ConstType>(
-	    std::make_unique<types::IntType>()));
+	TypeContext types;
+	const types::StaticType *static_const_int =
+	    types.get<types::StaticType>(
+		types.get<types::ConstType>(TypeContext::getInt()));
 
-	EXPECT_EQ(static_const_int.toString(), "static const int");
+	EXPECT_EQ(static_const_int->toString(), "static const int");
 
-	auto *inner = static_const_int.getInnerType();
+	const types::Type *inner = static_const_int->getInnerType();
 	ASSERT_NE(inner, nullptr);
 	auto *const_inner = expectNode<types::ConstType>(inner);
 	ASSERT_NE(const_inner, nullptr);
 	EXPECT_EQ(const_inner->getInnerType()->toString(), "int");
+	EXPECT_EQ(static_const_int,
+		  types.getStatic(types.getConst(TypeContext::getInt())));
+}
+
+TEST(Types, KindsClassifyTypes) {
+	TypeContext types;
+	const types::Type *array = types.getArray(TypeContext::getInt(), 2);
+	const types::Type *qualified = types.getConst(array);
+
+	EXPECT_EQ(array->getKind(), types::TypeKind::ARRAY);
+	EXPECT_TRUE(array->isArray());
+	EXPECT_TRUE(isa<types::ArrayType>(array));
+	EXPECT_FALSE(isa<types::ConstType>(array));
+	EXPECT_EQ(cast<types::ArrayType>(array)->getSize(), 2);
+	EXPECT_EQ(dyn_cast<types::StaticType>(qualified), nullptr);
+	ASSERT_NE(dyn_cast<types::ConstType>(qualified), nullptr);
+	EXPECT_EQ(cast<types::ConstType>(qualified)->getInnerType(), array);
+
+	for (const auto &[type, name] : primitives()) {
+		EXPECT_LE(type->getKind(), types::TypeKind::VOID) << name;
+	}
+	EXPECT_TRUE(isa<types::IntType>(TypeContext::getInt()));
+	EXPECT_TRUE(types.getStruct("S")->isStruct());
+}
+
+TEST(Types, ConcurrentLookupsMakeOneOfEach) {
+	TypeContext types;
+	ThreadPool pool(4);
+	std::vector<const types::Type *> structs(64);
+	std::vector<const types::Type *> arrays(64);
+	pool.forEach(structs.size(), [&](size_t i) {
+		structs[i] = types.getStruct("S" + std::to_string(i % 4));
+		arrays[i] = types.getArray(
+		    types.getConst(TypeContext::getChar()), i % 4);
+	});
+
+	for (size_t i = 4; i < structs.size(); i++) {
+		EXPECT_EQ(structs[i], structs[i % 4]);
+		EXPECT_EQ(arrays[i], arrays[i % 4]);
+	}
+	// four structs, one const char and four arrays of it
+	EXPECT_EQ(types.size(), 9);
 }